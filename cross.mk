@@ -96,6 +96,18 @@ X86_64_DEV_CFLAGS = $(X86_64_CFLAGS) -DDEV_BLD
 AARCH64_DEV_CFLAGS = $(AARCH64_CFLAGS) -DDEV_BLD
 RISCV64_DEV_CFLAGS = $(RISCV64_CFLAGS) -DDEV_BLD
 
+# Trace builds log every function entry and exit; see src/trace.c.
+X86_64_TRACE_CFLAGS = $(X86_64_CFLAGS) -DTRACE_BLD -g -finstrument-functions
+AARCH64_TRACE_CFLAGS = $(AARCH64_CFLAGS) -DTRACE_BLD -g -finstrument-functions
+
+# Extra flags for HOT_SOURCES (see Makefile), in every build flavour.
+HOT_CFLAGS = -O2
+
+# Host tools. These run on the build machine against tools/host/efi.h,
+# not GNU-EFI.
+HOST_CC = cc
+HOST_CFLAGS = -O2 -g -Wall -fshort-wchar -Itools/host -Iinclude
+
 X86_64_LINK_SCRIPT = $(GNU_EFI_DIR)/gnuefi/elf_x86_64_efi.lds
 AARCH64_LINK_SCRIPT = $(GNU_EFI_DIR)/gnuefi/elf_aarch64_efi.lds
 RISCV64_LINK_SCRIPT = $(GNU_EFI_DIR)/gnuefi/elf_riscv64_efi.lds
@@ -0,0 +1,77 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * arena.h
+ * Page-backed allocator for short-lived loader and filesystem buffers.
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * Small requests are rounded up to a power of two between ARENA_MIN_SIZE
+ * and ARENA_MAX_SIZE and served from per-class free lists carved out of
+ * ARENA_SLAB_PAGES page runs. Anything larger gets its own pages.
+ */
+#define ARENA_MIN_SHIFT		5
+#define ARENA_MAX_SHIFT		16
+#define ARENA_MIN_SIZE		(1U << ARENA_MIN_SHIFT)
+#define ARENA_MAX_SIZE		(1U << ARENA_MAX_SHIFT)
+#define ARENA_NCLASSES		(ARENA_MAX_SHIFT - ARENA_MIN_SHIFT + 1)
+#define ARENA_SLAB_PAGES	64
+
+/* The command arena grows in runs of this many pages. */
+#define CMD_ARENA_PAGES		16
+
+struct arena_stats {
+	UINT64 InUse;		/* bytes handed out, rounded to class size */
+	UINT64 Peak;		/* high-water mark of InUse */
+	UINT64 Reserved;	/* bytes held in slabs and large runs */
+	UINT64 Allocs;		/* ArenaAlloc calls since startup */
+	UINT64 CmdInUse;	/* bytes in the command arena right now */
+	UINT64 CmdPeak;		/* largest command arena footprint seen */
+	UINT64 CmdReserved;	/* pages held by the command arena */
+};
+
+extern VOID *ArenaAlloc(UINTN Size);
+extern VOID *ArenaZeroAlloc(UINTN Size);
+extern VOID ArenaFree(VOID *Buffer);
+extern VOID *CmdArenaAlloc(UINTN Size);
+extern VOID CmdArenaReset(VOID);
+extern VOID ArenaGetStats(struct arena_stats *Stats);
+
+#endif /* _ARENA_H_ */
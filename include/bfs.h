@@ -175,5 +175,8 @@ extern EFI_STATUS MountBFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA,
 extern EFI_STATUS ReadBFSDir(void *mount_ctx, const CHAR16 *path);
 extern EFI_STATUS UmountBFS(void *mount);
 extern EFI_STATUS OpenBFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenBFSDir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadBFSDirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseBFSDir(void *dir);
 
 #endif /* _BFS_H_ */
@@ -43,17 +43,32 @@
 
 typedef EFI_STATUS (*InputFunc)(UINT8 *Dest, UINTN *Length);
 
+// One piece of the download buffer; see download.c.
+#define DL_MAX_REGIONS	32
+
+struct dl_region {
+	UINT8 *Base;
+	UINTN Size;
+	UINTN Used;
+};
+
 // Global functions and variables, sorted by filename.
 
 // download.c
 extern BOOLEAN ImageDeflated;
 extern BOOLEAN ImageZip;
 extern UINTN FileSize, LoadSize;
+extern struct dl_region DlRegions[];
+extern UINTN DlNumRegions;
+extern EFI_STATUS ReserveDownloadBuffer(UINTN Size);
+extern VOID ReleaseDownloadBuffer(VOID);
+extern EFI_STATUS GetInnerCompression(const CHAR16 *Name);
 extern EFI_STATUS DoDownload(void);
 
 // exec_efi.c
 extern BOOLEAN IsEfiBinary(const void *Buffer);
-extern EFI_STATUS LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHandle, CHAR16 *ProgArgs);
+extern EFI_STATUS LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHandle, CHAR16 *ProgArgs,
+    VOID *SourceBuffer, UINTN SourceSize);
 
 // exec_elf.c
 extern BOOLEAN IsElf64(UINT8 *Header);
@@ -67,6 +82,8 @@ extern void HeliumBootPanic(EFI_STATUS Status, const CHAR16 *fmt, ...);
 extern UINT32 SwapBytes32(UINT32 val);
 extern UINT16 SwapBytes16(UINT16 val);
 extern UINT64 GetTimeSeconds(void);
+extern void InitMemRoutines(void);
+extern const CHAR16 *GetMemRoutinesName(void);
 extern INTN MemCmp(const void *p1, const void *p2, UINTN Size);
 extern void *MemMove(void *dst, const void *src, UINTN len);
 extern void *MemCopy(void *Dest, const void *Src, UINTN Length);
@@ -81,6 +98,7 @@ extern void HexDump(UINT8 *Address, UINTN Length);
 extern EFI_STATUS ReadInputData(UINT8 *Dest, UINTN *Length);
 extern EFI_STATUS ReadAndPrintChar(EFI_SERIAL_IO_PROTOCOL *Serial);
 extern UINT8 *DestinationAddress(void);
+extern EFI_STATUS FillFileInfo(const CHAR16 *Name, UINT64 FileSize, UINT64 Attribute, UINTN *BufferSize, VOID *Buffer);
 
 // loadfile.c
 extern EFI_STATUS LoadFile(CHAR16 *args);
@@ -0,0 +1,112 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * bootperf.h
+ * Boot performance records handed to the operating system.
+ */
+
+#ifndef _BOOTPERF_H_
+#define _BOOTPERF_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * The table is installed as an EFI configuration table under this GUID.
+ * Its layout follows the ACPI FPDT Firmware Basic Boot Performance Table:
+ * an 'FBPT' header, the standard basic boot record, then HeliumBoot's own
+ * records. Every record starts with the usual FPDT type/length/revision
+ * header, so a reader can skip the ones it does not know. Timestamps are
+ * in nanoseconds since reset, as in the FPDT.
+ */
+#define HELIUMBOOT_PERF_TABLE_GUID \
+	{ 0x7a3c51e9, 0x2b84, 0x4d6f, { 0xb1, 0x0e, 0x48, 0x42, 0x50, 0x45, 0x52, 0x46 } }
+
+#define HB_PERF_SIGNATURE		0x54504246	/* "FBPT" */
+
+#define HB_PERF_BASIC_RECORD		0x0002	/* FPDT basic boot record */
+#define HB_PERF_LOADER_RECORD		0x3000
+#define HB_PERF_PHASE_RECORD		0x3001
+#define HB_PERF_COUNTER_RECORD		0x3002
+
+/* Counter record IDs past the enum boot_counter values. */
+#define HB_PERF_INFLATE_RATE		0x100	/* bytes per second */
+
+struct hb_perf_header {
+	UINT32 Signature;
+	UINT32 Length;		/* header and all records */
+} __attribute__((packed));
+
+struct hb_perf_record {
+	UINT16 Type;
+	UINT8 Length;
+	UINT8 Revision;
+} __attribute__((packed));
+
+struct hb_perf_basic {
+	struct hb_perf_record Hdr;
+	UINT32 Reserved;
+	UINT64 ResetEnd;
+	UINT64 OsLoaderLoadImageStart;
+	UINT64 OsLoaderStartImageStart;
+	UINT64 ExitBootServicesEntry;
+	UINT64 ExitBootServicesExit;
+} __attribute__((packed));
+
+struct hb_perf_loader {
+	struct hb_perf_record Hdr;
+	UINT32 Reserved;
+	UINT64 LoaderStart;	/* when HeliumBoot was entered */
+	UINT64 ClockFrequency;	/* Hz of the counter the times came from */
+} __attribute__((packed));
+
+struct hb_perf_phase {
+	struct hb_perf_record Hdr;
+	UINT32 Phase;		/* enum boot_phase */
+	UINT64 Start;		/* first entry, 0 if never entered */
+	UINT64 Duration;	/* total time inside */
+	UINT32 Count;
+	UINT32 Reserved;
+} __attribute__((packed));
+
+struct hb_perf_counter {
+	struct hb_perf_record Hdr;
+	UINT32 Counter;		/* enum boot_counter or HB_PERF_INFLATE_RATE */
+	UINT64 Value;
+} __attribute__((packed));
+
+extern EFI_STATUS PublishBootPerf(VOID);
+extern VOID FinishBootPerf(VOID);
+
+#endif /* _BOOTPERF_H_ */
@@ -0,0 +1,105 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * clock.h
+ * Monotonic clock and boot-phase profiler.
+ */
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * Phases of the boot path we keep timing for. Each may be entered more
+ * than once (the menu can mount several slices, say); the profiler keeps
+ * the first entry time, the total time spent inside and the entry count.
+ */
+enum boot_phase {
+	BOOT_PHASE_VIDEO,
+	BOOT_PHASE_CONFIG,
+	BOOT_PHASE_MENU,
+	BOOT_PHASE_MOUNT,
+	BOOT_PHASE_LOAD,
+	BOOT_PHASE_DECOMPRESS,
+	BOOT_PHASE_EXIT_BS,
+	BOOT_PHASE_MAX
+};
+
+/*
+ * Byte counters kept alongside the phases, so that throughput can be
+ * worked out from the phase times.
+ */
+enum boot_counter {
+	BOOT_CTR_DISK_READ,	/* read through slice block I/O */
+	BOOT_CTR_FILE_READ,	/* executable image read by the loaders */
+	BOOT_CTR_DOWNLOAD,	/* received by DoDownload() */
+	BOOT_CTR_INFLATE_IN,	/* deflate input consumed */
+	BOOT_CTR_INFLATE_OUT,	/* deflate output produced */
+	BOOT_CTR_LZ4_IN,	/* LZ4 input consumed */
+	BOOT_CTR_LZ4_OUT,	/* LZ4 output produced */
+	BOOT_CTR_ZSTD_IN,	/* zstd input consumed */
+	BOOT_CTR_ZSTD_OUT,	/* zstd output produced */
+	BOOT_CTR_XZ_IN,		/* xz input consumed */
+	BOOT_CTR_XZ_OUT,	/* xz output produced */
+	BOOT_CTR_MAX
+};
+
+struct boot_phase_rec {
+	UINT64 First;		/* ticks at first entry, 0 if never entered */
+	UINT64 Total;		/* ticks spent inside, summed over entries */
+	UINT64 Start;		/* ticks at entry of the latest activation */
+	UINT64 End;		/* ticks at exit of the latest activation */
+	UINT32 Count;		/* completed activations */
+	UINT32 Depth;		/* nesting depth; only the outermost is timed */
+};
+
+extern VOID InitClock(VOID);
+extern UINT64 ReadClock(VOID);
+extern UINT64 GetClockFrequency(VOID);
+extern UINT64 TicksToMicroseconds(UINT64 Ticks);
+extern UINT64 TicksToNanoseconds(UINT64 Ticks);
+extern UINT64 GetClockBase(VOID);
+extern UINT64 GetTimeMicroseconds(VOID);
+extern UINT64 GetTimeMilliseconds(VOID);
+extern VOID BootPhaseBegin(enum boot_phase Phase);
+extern VOID BootPhaseEnd(enum boot_phase Phase);
+extern const struct boot_phase_rec *GetBootPhase(enum boot_phase Phase);
+extern VOID BootCounterAdd(enum boot_counter Counter, UINT64 Bytes);
+extern UINT64 GetBootCounter(enum boot_counter Counter);
+extern UINT64 GetInflateRate(VOID);
+extern VOID PrintBootStats(VOID);
+
+#endif /* _CLOCK_H_ */
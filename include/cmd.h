@@ -56,6 +56,7 @@ extern void CommandMonitor(void);
 extern void about(CHAR16 *args);
 extern void boot(CHAR16 *args);
 extern void boot_efi(CHAR16 *args);
+extern void bootstat(CHAR16 *args);
 extern void cls(CHAR16 *args);
 extern void echo(CHAR16 *args);
 extern void exit(CHAR16 *args);
@@ -63,9 +64,12 @@ extern void help(CHAR16 *args);
 extern void hinv(CHAR16 *args);
 extern void ls(CHAR16 *args);
 extern void lsblk(CHAR16 *args);
+extern void meminfo(CHAR16 *args);
 extern void pconf(CHAR16 *args);
 extern void reboot(CHAR16 *args);
 extern void sconf(CHAR16 *args);
+extern void trace(CHAR16 *args);
+extern void zdict(CHAR16 *args);
 extern void print_revision(CHAR16 *args);
 extern void print_version(CHAR16 *args);
 
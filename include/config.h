@@ -43,13 +43,15 @@ struct ConfigFile {
     BOOLEAN UefiConsoleFlag;
     UINT8 SerialPort;
     UINT32 SerialBaudRate;
-    UINT8 Padding[244];
+    BOOLEAN NativeFatFlag;
+    UINT8 ZstdWindowLog;
+    UINT8 Padding[242];
     UINT16 CheckSum;
 } __attribute__((packed));
 
 static_assert(sizeof(struct ConfigFile) == 256);
 
-#define CONFIG_FILE_VERSION		3
+#define CONFIG_FILE_VERSION		5
 #define CONFIG_FILE             L"config.dat"
 #define CONFIG_MAGIC            0xA345
 
@@ -59,10 +61,13 @@ static_assert(sizeof(struct ConfigFile) == 256);
 #define CFG_FIELD_UEFI_CONSOLE  4
 #define CFG_FIELD_SERIAL_PORT   5
 #define CFG_FIELD_SERIAL_BAUD   6
+#define CFG_FIELD_NATIVE_FAT    10
+#define CFG_FIELD_ZSTD_WINDOW   11
 #define CFG_FIELD_CHKSUM        254
 
 extern BOOLEAN NoMenuLoad;
 extern BOOLEAN UseUefiConsole;
+extern BOOLEAN UseNativeFat;
 extern EFI_STATUS ReadConfig(const UINT16 *Path, struct ConfigFile *OutCfg);
 extern EFI_STATUS WriteConfig(UINT8 Field, UINT32 Value);
 
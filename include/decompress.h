@@ -0,0 +1,104 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * decompress.h
+ * Decompressors shared by the filesystem plugins and the download path.
+ */
+
+#ifndef _DECOMPRESS_H_
+#define _DECOMPRESS_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * A decompressor takes one complete compressed buffer and writes at most
+ * OutSize bytes; *OutLen receives the number of bytes produced. Corrupt
+ * input, or output that would not fit, yields EFI_COMPROMISED_DATA.
+ */
+typedef EFI_STATUS (*decompress_fn)(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+
+/*
+ * Streaming input for InflateStream(), Lz4Stream(), ZstdStream() and
+ * XzStream(). Each call hands the decoder the next piece of compressed
+ * data in *Buf and *Len; the previous piece has been consumed by then and
+ * may be reused.
+ * EFI_END_OF_FILE, or any other error, ends the input.
+ */
+typedef EFI_STATUS (*inflate_input_fn)(VOID *Context, UINT8 **Buf, UINTN *Len);
+
+/* Called after each deflate, LZ4, zstd block or LZMA2 chunk with the output produced so far. */
+typedef VOID (*inflate_progress_fn)(VOID *Context, UINTN OutLen);
+
+extern EFI_STATUS InflateStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen, UINT32 *Crc);
+extern EFI_STATUS InflateStreamTrailer(inflate_input_fn Input, VOID *Context, VOID *Buf, UINTN Len);
+extern EFI_STATUS InflateBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen, UINTN *InUsed);
+extern EFI_STATUS ZlibDecompress(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern UINT32 Adler32(UINT32 Adler, const VOID *Buffer, UINTN Length);
+
+// crc32.c
+extern UINT32 Crc32(UINT32 Crc, const VOID *Buffer, UINTN Length);
+extern void InitCrc32(void);
+extern const CHAR16 *GetCrc32Name(void);
+
+// lz4.c
+extern BOOLEAN IsLz4(const VOID *Header);
+extern EFI_STATUS Lz4Stream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS Lz4Buffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS Lz4DecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound);
+extern UINTN Lz4InPlaceMargin(UINTN InLen);
+extern EFI_STATUS Lz4Decompress(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+
+// zstd.c
+extern UINT8 ZstdMaxWindowLog;
+extern BOOLEAN IsZstd(const VOID *Header);
+extern EFI_STATUS ZstdStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS ZstdBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS ZstdDecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound);
+extern UINTN ZstdInPlaceMargin(UINTN InLen);
+extern EFI_STATUS ZstdSetDictionary(const VOID *Dict, UINTN Len);
+extern UINT32 ZstdDictionaryId(VOID);
+
+// xz.c
+extern BOOLEAN IsXz(const VOID *Header);
+extern EFI_STATUS XzStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS XzBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS XzDecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound);
+extern UINTN XzInPlaceMargin(UINTN InLen);
+
+#endif /* _DECOMPRESS_H_ */
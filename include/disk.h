@@ -40,8 +40,9 @@
 #include "part.h"
 
 extern EFI_STATUS FindSysVPartition(struct mbr_partition *Partitions, UINT32 *PartitionStart);
+extern EFI_STATUS FindLinuxPartition(struct mbr_partition *Partitions, UINT32 Index, UINT32 *PartitionStart, UINT32 *PartitionSize);
 extern EFI_STATUS GetPartitionData(EFI_BLOCK_IO_PROTOCOL *BlockIo, struct mbr_partition *Partitions);
-extern EFI_STATUS GetWholeDiskByIndex(UINTN DiskIndex, EFI_BLOCK_IO_PROTOCOL **DiskBio);
+extern EFI_STATUS GetWholeDiskByIndex(UINTN DiskIndex, EFI_BLOCK_IO_PROTOCOL **DiskBio, EFI_HANDLE *DiskHandle);
 extern EFI_STATUS GetWholeDiskBlockIo(EFI_HANDLE *HandleBuffer, UINTN HandleCount, EFI_BLOCK_IO_PROTOCOL **DiskBio);
 extern BOOLEAN BootedFromInternalFlash(void);
 extern EFI_STATUS SearchDrivesRaw(void);
@@ -0,0 +1,322 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ext4.h
+ * ext2/ext3/ext4 filesystem structures and definitions.
+ */
+
+#ifndef _EXT4_H_
+#define _EXT4_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <assert.h>
+
+#define EXT4_SB_OFFSET      1024    /* byte offset of the superblock */
+#define EXT4_SB_MAGIC       0xEF53
+#define EXT4_ROOT_INO       2
+#define EXT4_GOOD_OLD_INODE_SIZE    128
+
+/*
+ * Superblock. Only the fields up to s_flags are used.
+ */
+struct ext4_superblock {
+    UINT32 s_inodes_count;
+    UINT32 s_blocks_count_lo;
+    UINT32 s_r_blocks_count_lo;
+    UINT32 s_free_blocks_count_lo;
+    UINT32 s_free_inodes_count;
+    UINT32 s_first_data_block;  /* 1 for 1 KiB blocks, else 0 */
+    UINT32 s_log_block_size;    /* block size is 1024 << this */
+    UINT32 s_log_cluster_size;
+    UINT32 s_blocks_per_group;
+    UINT32 s_clusters_per_group;
+    UINT32 s_inodes_per_group;
+    UINT32 s_mtime;
+    UINT32 s_wtime;
+    UINT16 s_mnt_count;
+    INT16 s_max_mnt_count;
+    UINT16 s_magic;             /* EXT4_SB_MAGIC */
+    UINT16 s_state;
+    UINT16 s_errors;
+    UINT16 s_minor_rev_level;
+    UINT32 s_lastcheck;
+    UINT32 s_checkinterval;
+    UINT32 s_creator_os;
+    UINT32 s_rev_level;         /* 0: 128-byte inodes, no features */
+    UINT16 s_def_resuid;
+    UINT16 s_def_resgid;
+    UINT32 s_first_ino;
+    UINT16 s_inode_size;
+    UINT16 s_block_group_nr;
+    UINT32 s_feature_compat;
+    UINT32 s_feature_incompat;
+    UINT32 s_feature_ro_compat;
+    UINT8 s_uuid[16];
+    INT8 s_volume_name[16];
+    INT8 s_last_mounted[64];
+    UINT32 s_algorithm_usage_bitmap;
+    UINT8 s_prealloc_blocks;
+    UINT8 s_prealloc_dir_blocks;
+    UINT16 s_reserved_gdt_blocks;
+    UINT8 s_journal_uuid[16];
+    UINT32 s_journal_inum;
+    UINT32 s_journal_dev;
+    UINT32 s_last_orphan;
+    UINT32 s_hash_seed[4];      /* htree hash seed */
+    UINT8 s_def_hash_version;
+    UINT8 s_jnl_backup_type;
+    UINT16 s_desc_size;         /* group descriptor size, with 64BIT */
+    UINT32 s_default_mount_opts;
+    UINT32 s_first_meta_bg;
+    UINT32 s_mkfs_time;
+    UINT32 s_jnl_blocks[17];
+    UINT32 s_blocks_count_hi;
+    UINT32 s_r_blocks_count_hi;
+    UINT32 s_free_blocks_count_hi;
+    UINT16 s_min_extra_isize;
+    UINT16 s_want_extra_isize;
+    UINT32 s_flags;
+    UINT8 s_reserved[668];
+} __attribute__((packed));
+
+static_assert(sizeof(struct ext4_superblock) == 1024);
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX       0x0020
+
+#define EXT4_FEATURE_INCOMPAT_FILETYPE      0x0002
+#define EXT4_FEATURE_INCOMPAT_RECOVER       0x0004
+#define EXT4_FEATURE_INCOMPAT_META_BG       0x0010
+#define EXT4_FEATURE_INCOMPAT_EXTENTS       0x0040
+#define EXT4_FEATURE_INCOMPAT_64BIT         0x0080
+#define EXT4_FEATURE_INCOMPAT_MMP           0x0100
+#define EXT4_FEATURE_INCOMPAT_FLEX_BG       0x0200
+#define EXT4_FEATURE_INCOMPAT_EA_INODE      0x0400
+#define EXT4_FEATURE_INCOMPAT_CSUM_SEED     0x2000
+#define EXT4_FEATURE_INCOMPAT_LARGEDIR      0x4000
+#define EXT4_FEATURE_INCOMPAT_INLINE_DATA   0x8000
+#define EXT4_FEATURE_INCOMPAT_CASEFOLD      0x20000
+
+/* everything else changes the on-disk layout in ways this reader ignores */
+#define EXT4_FEATURE_INCOMPAT_SUPP  (EXT4_FEATURE_INCOMPAT_FILETYPE | EXT4_FEATURE_INCOMPAT_RECOVER | \
+    EXT4_FEATURE_INCOMPAT_EXTENTS | EXT4_FEATURE_INCOMPAT_64BIT | EXT4_FEATURE_INCOMPAT_MMP | \
+    EXT4_FEATURE_INCOMPAT_FLEX_BG | EXT4_FEATURE_INCOMPAT_EA_INODE | EXT4_FEATURE_INCOMPAT_CSUM_SEED | \
+    EXT4_FEATURE_INCOMPAT_LARGEDIR | EXT4_FEATURE_INCOMPAT_INLINE_DATA | EXT4_FEATURE_INCOMPAT_CASEFOLD)
+
+#define EXT4_FLAGS_UNSIGNED_HASH    0x0002
+
+/*
+ * Block group descriptor. The second half is only present with 64BIT.
+ */
+struct ext4_group_desc {
+    UINT32 bg_block_bitmap_lo;
+    UINT32 bg_inode_bitmap_lo;
+    UINT32 bg_inode_table_lo;   /* first block of the inode table */
+    UINT16 bg_free_blocks_count_lo;
+    UINT16 bg_free_inodes_count_lo;
+    UINT16 bg_used_dirs_count_lo;
+    UINT16 bg_flags;
+    UINT32 bg_exclude_bitmap_lo;
+    UINT16 bg_block_bitmap_csum_lo;
+    UINT16 bg_inode_bitmap_csum_lo;
+    UINT16 bg_itable_unused_lo;
+    UINT16 bg_checksum;
+    UINT32 bg_block_bitmap_hi;
+    UINT32 bg_inode_bitmap_hi;
+    UINT32 bg_inode_table_hi;
+    UINT8 bg_reserved[20];
+} __attribute__((packed));
+
+static_assert(sizeof(struct ext4_group_desc) == 64);
+
+#define EXT4_MIN_DESC_SIZE  32
+
+/*
+ * On-disk inode, the part common to all inode sizes.
+ */
+struct ext4_inode {
+    UINT16 i_mode;
+    UINT16 i_uid;
+    UINT32 i_size_lo;
+    UINT32 i_atime;
+    UINT32 i_ctime;
+    UINT32 i_mtime;
+    UINT32 i_dtime;
+    UINT16 i_gid;
+    UINT16 i_links_count;
+    UINT32 i_blocks_lo;
+    UINT32 i_flags;
+    UINT32 i_osd1;
+    UINT32 i_block[15];         /* block map, extent tree or symlink target */
+    UINT32 i_generation;
+    UINT32 i_file_acl_lo;
+    UINT32 i_size_high;
+    UINT32 i_obso_faddr;
+    UINT8 i_osd2[12];
+} __attribute__((packed));
+
+static_assert(sizeof(struct ext4_inode) == EXT4_GOOD_OLD_INODE_SIZE);
+
+#define EXT4_S_IFMT         0xF000
+#define EXT4_S_IFLNK        0xA000
+#define EXT4_S_IFREG        0x8000
+#define EXT4_S_IFDIR        0x4000
+
+#define EXT4_NDIR_BLOCKS    12
+#define EXT4_IND_BLOCK      12
+#define EXT4_DIND_BLOCK     13
+#define EXT4_TIND_BLOCK     14
+
+#define EXT4_INDEX_FL       0x00001000  /* hashed directory */
+#define EXT4_EXTENTS_FL     0x00080000  /* i_block holds an extent tree */
+#define EXT4_INLINE_DATA_FL 0x10000000  /* data lives in the inode */
+#define EXT4_CASEFOLD_FL    0x40000000  /* case-insensitive directory */
+
+/*
+ * Extent tree. Each node starts with a header, followed by index entries
+ * (interior nodes) or extents (leaves).
+ */
+struct ext4_extent_header {
+    UINT16 eh_magic;            /* EXT4_EXT_MAGIC */
+    UINT16 eh_entries;
+    UINT16 eh_max;
+    UINT16 eh_depth;            /* 0 for leaves */
+    UINT32 eh_generation;
+} __attribute__((packed));
+
+struct ext4_extent {
+    UINT32 ee_block;            /* first logical block */
+    UINT16 ee_len;              /* above EXT4_EXT_INIT_MAX_LEN: unwritten */
+    UINT16 ee_start_hi;
+    UINT32 ee_start_lo;         /* first physical block */
+} __attribute__((packed));
+
+struct ext4_extent_idx {
+    UINT32 ei_block;            /* first logical block covered */
+    UINT32 ei_leaf_lo;          /* block of the next level */
+    UINT16 ei_leaf_hi;
+    UINT16 ei_unused;
+} __attribute__((packed));
+
+#define EXT4_EXT_MAGIC          0xF30A
+#define EXT4_EXT_INIT_MAX_LEN   32768
+#define EXT4_EXT_MAX_DEPTH      5
+
+/*
+ * Directory entry, with the FILETYPE feature.
+ */
+struct ext4_dirent {
+    UINT32 inode;               /* 0 for unused entries */
+    UINT16 rec_len;
+    UINT8 name_len;
+    UINT8 file_type;
+    INT8 name[];
+} __attribute__((packed));
+
+#define EXT4_DIRENT_BASE    8
+
+#define EXT4_FT_REG_FILE    1
+#define EXT4_FT_DIR         2
+#define EXT4_FT_SYMLINK     7
+
+/*
+ * Hashed (htree) directory index. Block 0 holds "." and ".." followed by
+ * the root info and the first level of entries; interior blocks look like
+ * a single empty directory entry covering the block.
+ */
+struct ext4_dx_root_info {
+    UINT32 reserved_zero;
+    UINT8 hash_version;
+    UINT8 info_length;          /* 8 */
+    UINT8 indirect_levels;
+    UINT8 unused_flags;
+} __attribute__((packed));
+
+struct ext4_dx_countlimit {
+    UINT16 limit;
+    UINT16 count;
+} __attribute__((packed));
+
+struct ext4_dx_entry {
+    UINT32 hash;                /* the first entry holds the count/limit instead */
+    UINT32 block;
+} __attribute__((packed));
+
+#define EXT4_DX_HASH_LEGACY     0
+#define EXT4_DX_HASH_HALF_MD4   1
+#define EXT4_DX_HASH_TEA        2
+#define EXT4_DX_HASH_UNSIGNED   3   /* added to the above for unsigned char hosts */
+#define EXT4_DX_MAX_LEVELS      3
+
+#define EXT4_NAME_LEN       255
+#define EXT4_SYMLINK_MAX    8       /* symlinks followed in one lookup */
+
+/*
+ * Physical run of a file: 'count' blocks starting at logical block 'lblk'
+ * are stored at 'pblk'. Gaps between runs are holes.
+ */
+struct ext4_run {
+    UINT32 lblk;
+    UINT32 count;
+    UINT64 pblk;
+};
+
+/*
+ * ext4 mount private data.
+ */
+struct ext4_mount {
+    struct ext4_superblock sb;
+    EFI_BLOCK_IO_PROTOCOL *bio;
+    UINT32 slice_start_lba;
+    UINT32 blksize;             /* filesystem block size */
+    UINT32 lbasperblk;          /* device blocks per filesystem block */
+    UINT32 inode_size;
+    UINT32 ngroups;
+    UINT64 *itable;             /* inode table block of each group */
+    UINT8 hash_unsigned;        /* EXT4_DX_HASH_UNSIGNED or 0 */
+    UINT64 iblock_nr;           /* inode table block in iblock */
+    UINT8 *iblock;
+};
+
+extern EFI_STATUS DetectEXT4(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void);
+extern EFI_STATUS MountEXT4(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out);
+extern EFI_STATUS ReadEXT4Dir(void *mount_ctx, const CHAR16 *path);
+extern EFI_STATUS UmountEXT4(void *mount);
+extern EFI_STATUS OpenEXT4(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenEXT4Dir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadEXT4DirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseEXT4Dir(void *dir);
+
+#endif /* _EXT4_H_ */
@@ -0,0 +1,181 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * fat.h
+ * FAT32 filesystem structures and definitions.
+ */
+
+#ifndef _FAT_H_
+#define _FAT_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <assert.h>
+
+/*
+ * FAT32 boot sector, including the BIOS parameter block.
+ */
+struct fat_bootsector {
+    UINT8 bs_jmpboot[3];        /* jump to boot code */
+    INT8 bs_oemname[8];         /* formatting system name */
+    UINT16 bpb_bytspersec;      /* bytes per sector */
+    UINT8 bpb_secperclus;       /* sectors per cluster */
+    UINT16 bpb_rsvdseccnt;      /* reserved sectors, including this one */
+    UINT8 bpb_numfats;          /* number of FAT copies */
+    UINT16 bpb_rootentcnt;      /* root directory entries (0 on FAT32) */
+    UINT16 bpb_totsec16;        /* total sectors, if < 65536 */
+    UINT8 bpb_media;            /* media descriptor */
+    UINT16 bpb_fatsz16;         /* sectors per FAT (0 on FAT32) */
+    UINT16 bpb_secpertrk;       /* sectors per track */
+    UINT16 bpb_numheads;        /* number of heads */
+    UINT32 bpb_hiddsec;         /* sectors before the volume */
+    UINT32 bpb_totsec32;        /* total sectors */
+    UINT32 bpb_fatsz32;         /* sectors per FAT */
+    UINT16 bpb_extflags;        /* active FAT / mirroring flags */
+    UINT16 bpb_fsver;           /* version, must be 0 */
+    UINT32 bpb_rootclus;        /* first cluster of the root directory */
+    UINT16 bpb_fsinfo;          /* FSINFO sector */
+    UINT16 bpb_bkbootsec;       /* backup boot sector */
+    UINT8 bpb_reserved[12];
+    UINT8 bs_drvnum;            /* BIOS drive number */
+    UINT8 bs_reserved1;
+    UINT8 bs_bootsig;           /* 0x29 if the next three fields are valid */
+    UINT32 bs_volid;            /* volume serial number */
+    INT8 bs_vollab[11];         /* volume label */
+    INT8 bs_filsystype[8];      /* "FAT32   ", informational only */
+    UINT8 bs_bootcode[420];
+    UINT16 bs_signature;        /* 0xAA55 */
+} __attribute__((packed));
+
+static_assert(sizeof(struct fat_bootsector) == 512);
+
+/*
+ * Short (8.3) directory entry.
+ */
+struct fat_dirent {
+    INT8 dir_name[11];          /* name and extension, space padded */
+    UINT8 dir_attr;             /* attributes */
+    UINT8 dir_ntres;            /* case flags for the name and extension */
+    UINT8 dir_crttimetenth;
+    UINT16 dir_crttime;
+    UINT16 dir_crtdate;
+    UINT16 dir_lstaccdate;
+    UINT16 dir_fstclushi;       /* high word of the first cluster */
+    UINT16 dir_wrttime;
+    UINT16 dir_wrtdate;
+    UINT16 dir_fstcluslo;       /* low word of the first cluster */
+    UINT32 dir_filesize;        /* size in bytes */
+} __attribute__((packed));
+
+/*
+ * Long file name entry. Up to 20 of these precede the short entry, last
+ * part first.
+ */
+struct fat_lfn {
+    UINT8 ldir_ord;             /* sequence number, 0x40 on the last part */
+    UINT16 ldir_name1[5];
+    UINT8 ldir_attr;            /* always FAT_ATTR_LFN */
+    UINT8 ldir_type;            /* 0 */
+    UINT8 ldir_chksum;          /* checksum of the short name */
+    UINT16 ldir_name2[6];
+    UINT16 ldir_fstcluslo;      /* 0 */
+    UINT16 ldir_name3[2];
+} __attribute__((packed));
+
+static_assert(sizeof(struct fat_dirent) == 32);
+static_assert(sizeof(struct fat_lfn) == 32);
+
+#define FAT_ATTR_READ_ONLY  0x01
+#define FAT_ATTR_HIDDEN     0x02
+#define FAT_ATTR_SYSTEM     0x04
+#define FAT_ATTR_VOLUME_ID  0x08
+#define FAT_ATTR_DIRECTORY  0x10
+#define FAT_ATTR_ARCHIVE    0x20
+#define FAT_ATTR_LFN        0x0F
+
+#define FAT_NTRES_LOWER_BASE    0x08
+#define FAT_NTRES_LOWER_EXT     0x10
+
+#define FAT_LFN_LAST        0x40
+#define FAT_LFN_CHARS       13
+#define FAT_LFN_MAXPARTS    20
+#define FAT_MAXNAMELEN      255
+#define FAT_NAMEBUF         (FAT_LFN_MAXPARTS * FAT_LFN_CHARS + 1)  /* room for a full LFN sequence */
+
+#define FAT_DIRENT_FREE     0xE5    /* first name byte of a deleted entry */
+#define FAT_DIRENT_END      0x00    /* first name byte past the last entry */
+
+#define FAT_SIGNATURE       0xAA55
+#define FAT32_MIN_CLUSTERS  65525
+#define FAT32_MASK          0x0FFFFFFF
+#define FAT32_BAD           0x0FFFFFF7
+#define FAT32_EOC           0x0FFFFFF8
+
+#define FAT_MAX_DIRSIZE     (65536 * sizeof(struct fat_dirent))
+
+/*
+ * A run of physically contiguous clusters.
+ */
+struct fat_run {
+    UINT32 cluster;             /* first cluster of the run */
+    UINT32 count;               /* number of clusters */
+};
+
+/*
+ * FAT mount private data.
+ */
+struct fat_mount {
+    struct fat_bootsector bs;
+    EFI_BLOCK_IO_PROTOCOL *bio;
+    UINT32 slice_start_lba;
+    UINT32 secsize;             /* bytes per FAT sector */
+    UINT32 lbaspersec;          /* device blocks per FAT sector */
+    UINT32 clussize;            /* bytes per cluster */
+    UINT32 fatstart;            /* first sector of the active FAT */
+    UINT32 datastart;           /* sector of cluster 2 */
+    UINT32 nclusters;           /* number of data clusters */
+    UINT32 *fat;                /* cached FAT, nclusters + 2 entries */
+};
+
+extern EFI_STATUS DetectFAT(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void);
+extern EFI_STATUS MountFAT(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out);
+extern EFI_STATUS ReadFATDir(void *mount_ctx, const CHAR16 *path);
+extern EFI_STATUS UmountFAT(void *mount);
+extern EFI_STATUS OpenFAT(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenFATDir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadFATDirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseFATDir(void *dir);
+
+#endif /* _FAT_H_ */
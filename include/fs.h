@@ -38,7 +38,11 @@
 #include <efilib.h>
 
 #include "bfs.h"
+#include "ext4.h"
+#include "fat.h"
+#include "iso9660.h"
 #include "s5fs.h"
+#include "squashfs.h"
 #include "ufs.h"
 
 typedef EFI_STATUS (*fs_detect_fn)(EFI_BLOCK_IO_PROTOCOL *bio, UINT32 slice_lba, void *sb_buffer);
@@ -47,6 +51,19 @@ typedef EFI_STATUS (*fs_list_fn)(void *mount_ctx, const CHAR16 *path);
 typedef EFI_STATUS (*fs_umount_fn)(void *mount_ctx);
 typedef EFI_STATUS (*fs_open_file_fn)(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
 
+/*
+ * Directory iteration, for the Simple File System published on a slice.
+ * open_dir() returns EFI_NOT_FOUND if 'path' does not exist and
+ * EFI_UNSUPPORTED if it is not a directory. Each read_dir() call returns
+ * the next entry as an EFI_FILE_INFO, leaving "." and ".." out, and sets
+ * *size to 0 at the end. If 'buf' is too small, *size is set to the size
+ * needed, EFI_BUFFER_TOO_SMALL is returned, and the entry is returned
+ * again by the next call.
+ */
+typedef EFI_STATUS (*fs_open_dir_fn)(void *mount_ctx, const CHAR16 *path, void **dir_out);
+typedef EFI_STATUS (*fs_read_dir_fn)(void *dir, UINTN *size, VOID *buf);
+typedef void (*fs_close_dir_fn)(void *dir);
+
 /*
  * Filesystem table entry structure.
  */
@@ -57,6 +74,9 @@ struct fs_tab_entry {
 	fs_list_fn list_dir;	// Filesystem directory listing function.
 	fs_umount_fn umount_fs;	// Filesystem umount function.
 	fs_open_file_fn open;	// Filesystem open function.
+	fs_open_dir_fn open_dir;	// Directory iteration: open.
+	fs_read_dir_fn read_dir;	// Directory iteration: next entry.
+	fs_close_dir_fn close_dir;	// Directory iteration: close.
 	UINTN sb_size;			// Filesystem superblock size.
 };
 
@@ -0,0 +1,67 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * heap.h
+ * Accounting for pool and page allocations.
+ *
+ * The loader is linked with --wrap for AllocatePool, AllocateZeroPool,
+ * ReallocatePool and FreePool (see HEAP_WRAP in the Makefile), so every
+ * pool allocation made by our code or by gnu-efi goes through heap.c and
+ * is charged to the call site that made it. Page allocations that should
+ * be accounted for use HeapAllocatePages/HeapFreePages instead of the
+ * boot services directly.
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#define HEAP_SLOTS	4096	/* live allocations tracked at once */
+#define HEAP_SITES	128	/* distinct call sites */
+
+/* A site whose live count grows across this many commands in a row is reported. */
+#define HEAP_LEAK_STRIKES	3
+
+extern EFI_STATUS HeapAllocatePages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN Pages,
+	EFI_PHYSICAL_ADDRESS *Memory);
+extern EFI_STATUS HeapFreePages(EFI_PHYSICAL_ADDRESS Memory, UINTN Pages);
+extern EFI_STATUS HeapTrimPages(EFI_PHYSICAL_ADDRESS Memory, UINTN OldPages, UINTN Pages);
+extern EFI_STATUS HeapGrowPagesDown(EFI_MEMORY_TYPE MemoryType, EFI_PHYSICAL_ADDRESS *Memory, UINTN *Pages,
+	UINTN More);
+extern VOID HeapCheckpoint(VOID);
+extern VOID HeapReport(BOOLEAN All);
+
+#endif /* _HEAP_H_ */
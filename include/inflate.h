@@ -61,13 +61,36 @@ typedef unsigned long  ulg;
 #define LOCHDR 30               /* size of local header, including sig */
 #define EXTHDR 16               /* size of extended local header, inc sig */
 
+#define CENSIG 0x02014b50L      /* central directory header signature */
+#define CENFLG 8                /* offset of bit flag */
+#define CENHOW 10               /* offset of compression method */
+#define CENCRC 16               /* offset of crc */
+#define CENSIZ 20               /* offset of compressed size */
+#define CENLEN 24               /* offset of uncompressed length */
+#define CENNAM 28               /* offset of file name length */
+#define CENEXT 30               /* offset of extra field length */
+#define CENCOM 32               /* offset of file comment length */
+#define CENOFF 42               /* offset of local header offset */
+#define CENHDR 46               /* size of central directory header, inc sig */
+
+#define ENDSIG 0x06054b50L      /* end of central directory signature */
+#define ENDTOT 10               /* offset of total number of entries */
+#define ENDSIZ 12               /* offset of central directory size */
+#define ENDOFF 16               /* offset of central directory offset */
+#define ENDCOM 20               /* offset of zip file comment length */
+#define ENDHDR 22               /* size of end record, inc sig */
+
 extern uch* volatile inbuf_end;		/* pointer to last valid input byte+1 */
 extern uch* volatile inptr;			/* pointer to next byte to be processed in inbuf */
 extern uch* volatile outptr;		/* pointer to output data */
+extern uch* volatile outbuf_start;	/* first byte of the output buffer */
+extern uch* volatile outbuf_end;	/* output buffer end+1; inflate() fails rather than pass it */
+
+extern ulg bb;						/* bit buffer, holds look-ahead after inflate() */
+extern unsigned bk;					/* bits in bit buffer */
+extern volatile int inbuf_overrun;	/* set by fill_inbuf() once the input is used up; inflate() fails */
 
 extern uch fill_inbuf();
-extern void* malloc(unsigned);
-extern void free(void*);
 
 extern void process_block(int error);
 extern int inflate();
@@ -0,0 +1,147 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * inflate_fixed.h
+ * Decode tables for the fixed Huffman codes of RFC 1951, section 3.2.6,
+ * in the entry format described in inflate.c. These are what
+ * build_table() produces for the fixed code lengths, kept here so that
+ * fixed blocks need no table building at run time. Only inflate.c
+ * includes this file.
+ */
+
+#ifndef _INFLATE_FIXED_H_
+#define _INFLATE_FIXED_H_
+
+#define FIXED_LITLEN_BITS   9
+#define FIXED_DIST_BITS     5
+
+static const huff_t fixed_litlen[512] = {
+    0x00000207, 0x00500108, 0x00100108, 0x00730048, 0x001f0027, 0x00700108,
+    0x00300108, 0x00c00109, 0x000a0007, 0x00600108, 0x00200108, 0x00a00109,
+    0x00000108, 0x00800108, 0x00400108, 0x00e00109, 0x00060007, 0x00580108,
+    0x00180108, 0x00900109, 0x003b0037, 0x00780108, 0x00380108, 0x00d00109,
+    0x00110017, 0x00680108, 0x00280108, 0x00b00109, 0x00080108, 0x00880108,
+    0x00480108, 0x00f00109, 0x00040007, 0x00540108, 0x00140108, 0x00e30058,
+    0x002b0037, 0x00740108, 0x00340108, 0x00c80109, 0x000d0017, 0x00640108,
+    0x00240108, 0x00a80109, 0x00040108, 0x00840108, 0x00440108, 0x00e80109,
+    0x00080007, 0x005c0108, 0x001c0108, 0x00980109, 0x00530047, 0x007c0108,
+    0x003c0108, 0x00d80109, 0x00170027, 0x006c0108, 0x002c0108, 0x00b80109,
+    0x000c0108, 0x008c0108, 0x004c0108, 0x00f80109, 0x00030007, 0x00520108,
+    0x00120108, 0x00a30058, 0x00230037, 0x00720108, 0x00320108, 0x00c40109,
+    0x000b0017, 0x00620108, 0x00220108, 0x00a40109, 0x00020108, 0x00820108,
+    0x00420108, 0x00e40109, 0x00070007, 0x005a0108, 0x001a0108, 0x00940109,
+    0x00430047, 0x007a0108, 0x003a0108, 0x00d40109, 0x00130027, 0x006a0108,
+    0x002a0108, 0x00b40109, 0x000a0108, 0x008a0108, 0x004a0108, 0x00f40109,
+    0x00050007, 0x00560108, 0x00160108, 0x00000808, 0x00330037, 0x00760108,
+    0x00360108, 0x00cc0109, 0x000f0017, 0x00660108, 0x00260108, 0x00ac0109,
+    0x00060108, 0x00860108, 0x00460108, 0x00ec0109, 0x00090007, 0x005e0108,
+    0x001e0108, 0x009c0109, 0x00630047, 0x007e0108, 0x003e0108, 0x00dc0109,
+    0x001b0027, 0x006e0108, 0x002e0108, 0x00bc0109, 0x000e0108, 0x008e0108,
+    0x004e0108, 0x00fc0109, 0x00000207, 0x00510108, 0x00110108, 0x00830058,
+    0x001f0027, 0x00710108, 0x00310108, 0x00c20109, 0x000a0007, 0x00610108,
+    0x00210108, 0x00a20109, 0x00010108, 0x00810108, 0x00410108, 0x00e20109,
+    0x00060007, 0x00590108, 0x00190108, 0x00920109, 0x003b0037, 0x00790108,
+    0x00390108, 0x00d20109, 0x00110017, 0x00690108, 0x00290108, 0x00b20109,
+    0x00090108, 0x00890108, 0x00490108, 0x00f20109, 0x00040007, 0x00550108,
+    0x00150108, 0x01020008, 0x002b0037, 0x00750108, 0x00350108, 0x00ca0109,
+    0x000d0017, 0x00650108, 0x00250108, 0x00aa0109, 0x00050108, 0x00850108,
+    0x00450108, 0x00ea0109, 0x00080007, 0x005d0108, 0x001d0108, 0x009a0109,
+    0x00530047, 0x007d0108, 0x003d0108, 0x00da0109, 0x00170027, 0x006d0108,
+    0x002d0108, 0x00ba0109, 0x000d0108, 0x008d0108, 0x004d0108, 0x00fa0109,
+    0x00030007, 0x00530108, 0x00130108, 0x00c30058, 0x00230037, 0x00730108,
+    0x00330108, 0x00c60109, 0x000b0017, 0x00630108, 0x00230108, 0x00a60109,
+    0x00030108, 0x00830108, 0x00430108, 0x00e60109, 0x00070007, 0x005b0108,
+    0x001b0108, 0x00960109, 0x00430047, 0x007b0108, 0x003b0108, 0x00d60109,
+    0x00130027, 0x006b0108, 0x002b0108, 0x00b60109, 0x000b0108, 0x008b0108,
+    0x004b0108, 0x00f60109, 0x00050007, 0x00570108, 0x00170108, 0x00000808,
+    0x00330037, 0x00770108, 0x00370108, 0x00ce0109, 0x000f0017, 0x00670108,
+    0x00270108, 0x00ae0109, 0x00070108, 0x00870108, 0x00470108, 0x00ee0109,
+    0x00090007, 0x005f0108, 0x001f0108, 0x009e0109, 0x00630047, 0x007f0108,
+    0x003f0108, 0x00de0109, 0x001b0027, 0x006f0108, 0x002f0108, 0x00be0109,
+    0x000f0108, 0x008f0108, 0x004f0108, 0x00fe0109, 0x00000207, 0x00500108,
+    0x00100108, 0x00730048, 0x001f0027, 0x00700108, 0x00300108, 0x00c10109,
+    0x000a0007, 0x00600108, 0x00200108, 0x00a10109, 0x00000108, 0x00800108,
+    0x00400108, 0x00e10109, 0x00060007, 0x00580108, 0x00180108, 0x00910109,
+    0x003b0037, 0x00780108, 0x00380108, 0x00d10109, 0x00110017, 0x00680108,
+    0x00280108, 0x00b10109, 0x00080108, 0x00880108, 0x00480108, 0x00f10109,
+    0x00040007, 0x00540108, 0x00140108, 0x00e30058, 0x002b0037, 0x00740108,
+    0x00340108, 0x00c90109, 0x000d0017, 0x00640108, 0x00240108, 0x00a90109,
+    0x00040108, 0x00840108, 0x00440108, 0x00e90109, 0x00080007, 0x005c0108,
+    0x001c0108, 0x00990109, 0x00530047, 0x007c0108, 0x003c0108, 0x00d90109,
+    0x00170027, 0x006c0108, 0x002c0108, 0x00b90109, 0x000c0108, 0x008c0108,
+    0x004c0108, 0x00f90109, 0x00030007, 0x00520108, 0x00120108, 0x00a30058,
+    0x00230037, 0x00720108, 0x00320108, 0x00c50109, 0x000b0017, 0x00620108,
+    0x00220108, 0x00a50109, 0x00020108, 0x00820108, 0x00420108, 0x00e50109,
+    0x00070007, 0x005a0108, 0x001a0108, 0x00950109, 0x00430047, 0x007a0108,
+    0x003a0108, 0x00d50109, 0x00130027, 0x006a0108, 0x002a0108, 0x00b50109,
+    0x000a0108, 0x008a0108, 0x004a0108, 0x00f50109, 0x00050007, 0x00560108,
+    0x00160108, 0x00000808, 0x00330037, 0x00760108, 0x00360108, 0x00cd0109,
+    0x000f0017, 0x00660108, 0x00260108, 0x00ad0109, 0x00060108, 0x00860108,
+    0x00460108, 0x00ed0109, 0x00090007, 0x005e0108, 0x001e0108, 0x009d0109,
+    0x00630047, 0x007e0108, 0x003e0108, 0x00dd0109, 0x001b0027, 0x006e0108,
+    0x002e0108, 0x00bd0109, 0x000e0108, 0x008e0108, 0x004e0108, 0x00fd0109,
+    0x00000207, 0x00510108, 0x00110108, 0x00830058, 0x001f0027, 0x00710108,
+    0x00310108, 0x00c30109, 0x000a0007, 0x00610108, 0x00210108, 0x00a30109,
+    0x00010108, 0x00810108, 0x00410108, 0x00e30109, 0x00060007, 0x00590108,
+    0x00190108, 0x00930109, 0x003b0037, 0x00790108, 0x00390108, 0x00d30109,
+    0x00110017, 0x00690108, 0x00290108, 0x00b30109, 0x00090108, 0x00890108,
+    0x00490108, 0x00f30109, 0x00040007, 0x00550108, 0x00150108, 0x01020008,
+    0x002b0037, 0x00750108, 0x00350108, 0x00cb0109, 0x000d0017, 0x00650108,
+    0x00250108, 0x00ab0109, 0x00050108, 0x00850108, 0x00450108, 0x00eb0109,
+    0x00080007, 0x005d0108, 0x001d0108, 0x009b0109, 0x00530047, 0x007d0108,
+    0x003d0108, 0x00db0109, 0x00170027, 0x006d0108, 0x002d0108, 0x00bb0109,
+    0x000d0108, 0x008d0108, 0x004d0108, 0x00fb0109, 0x00030007, 0x00530108,
+    0x00130108, 0x00c30058, 0x00230037, 0x00730108, 0x00330108, 0x00c70109,
+    0x000b0017, 0x00630108, 0x00230108, 0x00a70109, 0x00030108, 0x00830108,
+    0x00430108, 0x00e70109, 0x00070007, 0x005b0108, 0x001b0108, 0x00970109,
+    0x00430047, 0x007b0108, 0x003b0108, 0x00d70109, 0x00130027, 0x006b0108,
+    0x002b0108, 0x00b70109, 0x000b0108, 0x008b0108, 0x004b0108, 0x00f70109,
+    0x00050007, 0x00570108, 0x00170108, 0x00000808, 0x00330037, 0x00770108,
+    0x00370108, 0x00cf0109, 0x000f0017, 0x00670108, 0x00270108, 0x00af0109,
+    0x00070108, 0x00870108, 0x00470108, 0x00ef0109, 0x00090007, 0x005f0108,
+    0x001f0108, 0x009f0109, 0x00630047, 0x007f0108, 0x003f0108, 0x00df0109,
+    0x001b0027, 0x006f0108, 0x002f0108, 0x00bf0109, 0x000f0108, 0x008f0108,
+    0x004f0108, 0x00ff0109,
+};
+
+static const huff_t fixed_dist[32] = {
+    0x00010005, 0x01010075, 0x00110035, 0x100100b5, 0x00050015, 0x04010095,
+    0x00410055, 0x400100d5, 0x00030005, 0x02010085, 0x00210045, 0x200100c5,
+    0x00090025, 0x080100a5, 0x00810065, 0x00000805, 0x00020005, 0x01810075,
+    0x00190035, 0x180100b5, 0x00070015, 0x06010095, 0x00610055, 0x600100d5,
+    0x00040005, 0x03010085, 0x00310045, 0x300100c5, 0x000d0025, 0x0c0100a5,
+    0x00c10065, 0x00000805,
+};
+
+#endif /* _INFLATE_FIXED_H_ */
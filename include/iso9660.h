@@ -0,0 +1,194 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * iso9660.h
+ * ISO 9660 filesystem structures and definitions.
+ */
+
+#ifndef _ISO9660_H_
+#define _ISO9660_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <assert.h>
+
+#define ISO_SECTOR_SIZE     2048
+#define ISO_VD_START        16      /* first volume descriptor sector */
+#define ISO_VD_MAX          32      /* give up after this many descriptors */
+
+#define ISO_VD_PRIMARY      1
+#define ISO_VD_TERMINATOR   255
+
+#define ISO_STANDARD_ID     "CD001"
+
+/*
+ * Directory record. Numeric fields are recorded in both byte orders;
+ * only the little endian half is used.
+ */
+struct iso_dirrec {
+    UINT8 length;               /* length of this record */
+    UINT8 ext_attr_length;      /* extended attribute record length */
+    UINT32 extent;              /* first logical block (LE) */
+    UINT32 extent_be;
+    UINT32 size;                /* data length (LE) */
+    UINT32 size_be;
+    UINT8 date[7];              /* recording date and time */
+    UINT8 flags;                /* file flags */
+    UINT8 file_unit_size;       /* interleaved mode unit size */
+    UINT8 interleave;           /* interleave gap size */
+    UINT16 volume_seq;          /* volume sequence number (LE) */
+    UINT16 volume_seq_be;
+    UINT8 name_len;             /* length of the file identifier */
+    INT8 name[1];               /* file identifier, then padding and system use */
+} __attribute__((packed));
+
+#define ISO_DIRREC_BASE     33      /* record length without the identifier */
+
+#define ISO_FLAG_HIDDEN     0x01
+#define ISO_FLAG_DIRECTORY  0x02
+#define ISO_FLAG_MULTIEXT   0x80    /* not the final extent of the file */
+
+/*
+ * Primary volume descriptor.
+ */
+struct iso_pvd {
+    UINT8 type;                 /* ISO_VD_PRIMARY */
+    INT8 id[5];                 /* ISO_STANDARD_ID */
+    UINT8 version;              /* 1 */
+    UINT8 unused1;
+    INT8 system_id[32];
+    INT8 volume_id[32];
+    UINT8 unused2[8];
+    UINT32 volume_space_size;   /* in logical blocks (LE) */
+    UINT32 volume_space_size_be;
+    UINT8 unused3[32];
+    UINT16 volume_set_size;
+    UINT16 volume_set_size_be;
+    UINT16 volume_seq;
+    UINT16 volume_seq_be;
+    UINT16 logical_block_size;  /* usually 2048 (LE) */
+    UINT16 logical_block_size_be;
+    UINT32 path_table_size;     /* in bytes (LE) */
+    UINT32 path_table_size_be;
+    UINT32 path_table_l;        /* type L path table location */
+    UINT32 opt_path_table_l;
+    UINT32 path_table_m;        /* type M path table location (BE) */
+    UINT32 opt_path_table_m;
+    UINT8 root[34];             /* root directory record */
+    INT8 volume_set_id[128];
+    INT8 publisher_id[128];
+    INT8 preparer_id[128];
+    INT8 application_id[128];
+    INT8 copyright_file_id[37];
+    INT8 abstract_file_id[37];
+    INT8 bibliographic_file_id[37];
+    UINT8 creation_date[17];
+    UINT8 modification_date[17];
+    UINT8 expiration_date[17];
+    UINT8 effective_date[17];
+    UINT8 file_structure_version;
+    UINT8 unused4;
+    UINT8 application_use[512];
+    UINT8 reserved[653];
+} __attribute__((packed));
+
+static_assert(sizeof(struct iso_pvd) == ISO_SECTOR_SIZE);
+
+/*
+ * Type L path table record.
+ */
+struct iso_ptrec {
+    UINT8 name_len;             /* length of the directory identifier */
+    UINT8 ext_attr_length;
+    UINT32 extent;              /* first logical block of the directory */
+    UINT16 parent;              /* 1-based index of the parent directory */
+    INT8 name[1];               /* identifier, padded to an even length */
+} __attribute__((packed));
+
+#define ISO_PTREC_BASE      8
+
+/*
+ * Rock Ridge / SUSP.
+ */
+#define SUSP_SIG(a, b)      ((UINT16)(a) | ((UINT16)(b) << 8))
+#define SUSP_SP             SUSP_SIG('S', 'P')
+#define SUSP_ST             SUSP_SIG('S', 'T')
+#define RRIP_NM             SUSP_SIG('N', 'M')
+
+#define RRIP_NM_CONTINUE    0x01
+#define RRIP_NM_CURRENT     0x02
+#define RRIP_NM_PARENT      0x04
+
+#define ISO_MAXNAMELEN      255
+
+/*
+ * Cached path table entry.
+ */
+struct iso_dir {
+    UINT32 extent;              /* first logical block of the directory */
+    UINT16 parent;              /* 0-based index of the parent */
+    UINT8 name_len;
+    CHAR8 *name;                /* ISO identifier, in the path table buffer */
+};
+
+/*
+ * ISO 9660 mount private data.
+ */
+struct iso_mount {
+    struct iso_pvd pvd;
+    EFI_BLOCK_IO_PROTOCOL *bio;
+    UINT32 slice_start_lba;
+    UINT32 blksize;             /* logical block size */
+    UINT32 lbasperblk;          /* device blocks per logical block */
+    BOOLEAN rockridge;          /* Rock Ridge names present */
+    UINT8 susp_skip;            /* SUSP bytes to skip in each system use area */
+    UINT8 *ptbuf;               /* raw path table */
+    struct iso_dir *dirs;       /* parsed path table */
+    UINTN ndirs;
+    UINT32 dcache_extent;       /* last directory read */
+    UINT32 dcache_size;
+    UINT8 *dcache;
+};
+
+extern EFI_STATUS DetectISO(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void);
+extern EFI_STATUS MountISO(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out);
+extern EFI_STATUS ReadISODir(void *mount_ctx, const CHAR16 *path);
+extern EFI_STATUS UmountISO(void *mount);
+extern EFI_STATUS OpenISO(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenISODir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadISODirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseISODir(void *dir);
+
+#endif /* _ISO9660_H_ */
@@ -0,0 +1,64 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * memmap.h
+ * Cached view of the firmware memory map.
+ */
+
+#ifndef _MEMMAP_H_
+#define _MEMMAP_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#define MEMMAP_MAX_FREE	256	/* conventional memory regions kept */
+#define MEMMAP_SLACK	16	/* spare descriptors in the map buffer */
+
+/* A run of free (EfiConventionalMemory) pages. */
+struct mem_region {
+	EFI_PHYSICAL_ADDRESS Start;
+	UINT64 Pages;
+};
+
+extern EFI_STATUS MemMapRefresh(VOID);
+extern EFI_STATUS MemMapGetRaw(EFI_MEMORY_DESCRIPTOR **Map, UINTN *Size, UINTN *Key,
+	UINTN *DescriptorSize, UINT32 *DescriptorVersion);
+extern UINT64 MemMapTotal(EFI_MEMORY_TYPE Type);
+extern UINTN MemMapFreeRegions(const struct mem_region **Regions);
+extern BOOLEAN MemMapLargestFree(struct mem_region *Region);
+extern BOOLEAN MemMapFindFree(EFI_PHYSICAL_ADDRESS Min, UINT64 Size, UINT64 Align, EFI_PHYSICAL_ADDRESS *Addr);
+extern EFI_STATUS MemMapAllocatePages(EFI_PHYSICAL_ADDRESS Min, UINT64 Size, UINT64 Align,
+	EFI_MEMORY_TYPE Type, EFI_PHYSICAL_ADDRESS *Addr);
+
+#endif /* _MEMMAP_H_ */
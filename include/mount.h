@@ -0,0 +1,83 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _MOUNT_H_
+#define _MOUNT_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "fs.h"
+
+/*
+ * Vendor GUID used for the media device path node of a mounted slice.
+ */
+#define HELIUMBOOT_SLICE_GUID \
+	{ 0x4c1b7d2e, 0x9a63, 0x4f0e, { 0x8d, 0x15, 0x53, 0x79, 0x53, 0x56, 0x76, 0x63 } }
+
+/*
+ * Media vendor device path node describing a VTOC slice.
+ */
+struct slice_device_path {
+	VENDOR_DEVICE_PATH Vendor;
+	UINT32 SliceIndex;		// VTOC slice number.
+	UINT32 SliceLBA;		// First sector of the slice on the whole disk.
+	UINT32 SliceSize;		// Slice size in sectors.
+};
+
+/*
+ * A mounted slice. The plugin mount context lives as long as the child
+ * handle does, so any caches kept by the plugin survive between commands
+ * and are shared with the firmware.
+ */
+struct slice_mount {
+	EFI_HANDLE Handle;			// Child handle with the protocols below.
+	EFI_BLOCK_IO_PROTOCOL *ParentBio;	// Block I/O of the whole disk.
+	UINT32 SliceIndex;			// VTOC slice number.
+	UINT32 SliceLBA;			// First sector of the slice.
+	UINT32 SliceSize;			// Slice size in sectors.
+	struct fs_tab_entry *fs;		// Filesystem plugin serving the slice.
+	void *mount_ctx;			// Plugin mount context.
+	EFI_BLOCK_IO_PROTOCOL BlockIo;		// Read-only window onto the slice.
+	EFI_BLOCK_IO_MEDIA Media;		// Media descriptor of the window.
+	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL SimpleFs;	// Simple File System backed by the plugin.
+	EFI_DEVICE_PATH *DevicePath;		// Parent path plus a slice node.
+	struct slice_mount *Next;
+};
+
+extern EFI_STATUS MountSlice(EFI_HANDLE DiskHandle, EFI_BLOCK_IO_PROTOCOL *DiskBio, UINT32 SliceIndex, UINT32 SliceLBA, UINT32 SliceSize, struct slice_mount **MountOut);
+extern EFI_STATUS MountVolume(EFI_HANDLE Handle, struct slice_mount **MountOut);
+extern EFI_STATUS UnmountSlice(struct slice_mount *Mount);
+extern void UnmountAllSlices(void);
+
+#endif /* _MOUNT_H_ */
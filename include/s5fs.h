@@ -178,5 +178,8 @@ extern EFI_STATUS MountS5(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA,
 extern EFI_STATUS ReadS5Dir(void *mount_ctx, const CHAR16 *path);
 extern EFI_STATUS UmountS5(void *mount);
 extern EFI_STATUS OpenS5(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenS5Dir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadS5DirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseS5Dir(void *dir);
 
 #endif /* _S5FS_H_ */
@@ -77,5 +77,6 @@ extern UINT32 SerialDownloadPort, SerialBaud;
 
 extern EFI_STATUS InitSerial(UINTN Port, UINTN Baud);
 extern EFI_STATUS InitSerialDownload(UINTN Port);
+extern EFI_STATUS SerialWrite(const VOID *Buffer, UINTN Length);
 
 #endif /* _SERIAL_H_ */
@@ -0,0 +1,247 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * squashfs.h
+ * SquashFS 4.0 filesystem structures and definitions.
+ */
+
+#ifndef _SQUASHFS_H_
+#define _SQUASHFS_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <assert.h>
+
+#include "decompress.h"
+
+#define SQFS_MAGIC          0x73717368
+#define SQFS_MAJOR          4
+
+#define SQFS_COMP_GZIP      1
+#define SQFS_COMP_LZMA      2
+#define SQFS_COMP_LZO       3
+#define SQFS_COMP_XZ        4
+#define SQFS_COMP_LZ4       5
+#define SQFS_COMP_ZSTD      6
+
+#define SQFS_MIN_BLOCK_LOG  12
+#define SQFS_MAX_BLOCK_LOG  20
+
+#define SQFS_METADATA_SIZE  8192
+#define SQFS_META_UNCOMPRESSED  0x8000  /* in the metadata block header */
+#define SQFS_DATA_UNCOMPRESSED  (1U << 24)  /* in data and fragment sizes */
+#define SQFS_DATA_SIZE(s)   ((s) & (SQFS_DATA_UNCOMPRESSED - 1))
+
+#define SQFS_INVALID_FRAG   0xFFFFFFFF
+#define SQFS_FRAGS_PER_META (SQFS_METADATA_SIZE / sizeof(struct sqfs_fragment))
+
+/* inode types; directory entries use the basic ones */
+#define SQFS_DIR_TYPE       1
+#define SQFS_REG_TYPE       2
+#define SQFS_SYMLINK_TYPE   3
+#define SQFS_LDIR_TYPE      8
+#define SQFS_LREG_TYPE      9
+#define SQFS_LSYMLINK_TYPE  10
+
+#define SQFS_NAME_LEN       256
+#define SQFS_SYMLINK_MAX    8       /* symlinks followed in one lookup */
+
+/* caches of decompressed blocks */
+#define SQFS_META_CACHE     32      /* metadata blocks */
+#define SQFS_DATA_CACHE     8       /* data and fragment blocks */
+
+struct sqfs_superblock {
+    UINT32 s_magic;             /* SQFS_MAGIC */
+    UINT32 inodes;
+    UINT32 mkfs_time;
+    UINT32 block_size;
+    UINT32 fragments;
+    UINT16 compression;         /* SQFS_COMP_* */
+    UINT16 block_log;
+    UINT16 flags;
+    UINT16 no_ids;
+    UINT16 s_major;
+    UINT16 s_minor;
+    UINT64 root_inode;          /* inode reference of the root directory */
+    UINT64 bytes_used;
+    UINT64 id_table_start;
+    UINT64 xattr_id_table_start;
+    UINT64 inode_table_start;
+    UINT64 directory_table_start;
+    UINT64 fragment_table_start;
+    UINT64 lookup_table_start;
+};
+
+static_assert(sizeof(struct sqfs_superblock) == 96);
+
+/*
+ * Inodes. An inode reference holds the metadata block of the inode,
+ * relative to the inode table, above bit 16 and its offset in the
+ * uncompressed block below.
+ */
+struct sqfs_base_inode {
+    UINT16 inode_type;
+    UINT16 mode;
+    UINT16 uid;
+    UINT16 guid;
+    UINT32 mtime;
+    UINT32 inode_number;
+};
+
+struct sqfs_dir_inode {
+    UINT32 start_block;         /* directory table block of the listing */
+    UINT32 nlink;
+    UINT16 file_size;           /* listing size plus 3 */
+    UINT16 offset;
+    UINT32 parent_inode;
+};
+
+struct sqfs_ldir_inode {
+    UINT32 nlink;
+    UINT32 file_size;
+    UINT32 start_block;
+    UINT32 parent_inode;
+    UINT16 i_count;             /* directory index entries that follow */
+    UINT16 offset;
+    UINT32 xattr;
+};
+
+struct sqfs_dir_index {
+    UINT32 index;               /* listing offset of the metadata block */
+    UINT32 start_block;         /* that block, relative to the directory table */
+    UINT32 size;                /* name length - 1; the name follows */
+};
+
+struct sqfs_reg_inode {
+    UINT32 start_block;         /* byte position of the first data block */
+    UINT32 fragment;
+    UINT32 offset;              /* offset of the tail in the fragment */
+    UINT32 file_size;
+};                              /* followed by one UINT32 size per block */
+
+struct sqfs_lreg_inode {
+    UINT64 start_block;
+    UINT64 file_size;
+    UINT64 sparse;
+    UINT32 nlink;
+    UINT32 fragment;
+    UINT32 offset;
+    UINT32 xattr;
+};
+
+struct sqfs_symlink_inode {
+    UINT32 nlink;
+    UINT32 symlink_size;        /* the target follows */
+};
+
+/*
+ * Directory listings are a sequence of headers, each followed by up to
+ * 256 entries whose inodes share one metadata block.
+ */
+struct sqfs_dir_header {
+    UINT32 count;               /* entries - 1 */
+    UINT32 start_block;
+    UINT32 inode_number;
+};
+
+struct sqfs_dir_entry {
+    UINT16 offset;
+    INT16 inode_number;
+    UINT16 type;
+    UINT16 size;                /* name length - 1; the name follows */
+};
+
+struct sqfs_fragment {
+    UINT64 start_block;
+    UINT32 size;
+    UINT32 unused;
+};
+
+/*
+ * Position in a metadata table: the byte position of a metadata block in
+ * the image and an offset into its uncompressed contents.
+ */
+struct sqfs_cursor {
+    UINT64 block;
+    UINT32 offset;
+};
+
+/*
+ * Decompressed block cache entry, keyed by the position of the block in
+ * the image. 'next' is the position of the following metadata block.
+ */
+struct sqfs_cache_entry {
+    UINT64 pos;
+    UINT64 next;
+    UINT32 len;
+    UINT64 stamp;               /* last use, for LRU replacement */
+    UINT8 *data;                /* NULL until the entry is first used */
+};
+
+struct sqfs_cache {
+    struct sqfs_cache_entry *entries;
+    UINTN nentries;
+    UINTN size;                 /* bytes per entry */
+    UINT64 clock;
+};
+
+/*
+ * SquashFS mount private data.
+ */
+struct sqfs_mount {
+    struct sqfs_superblock sb;
+    EFI_BLOCK_IO_PROTOCOL *bio;
+    UINT32 slice_start_lba;
+    UINT32 devbs;               /* device block size */
+    decompress_fn decompress;
+    UINT64 *frag_index;         /* metadata block of every 512 fragment entries */
+    struct sqfs_cache meta;
+    struct sqfs_cache data;
+    UINT8 *stage;               /* raw reads from the device */
+    UINTN stage_size;
+    UINT64 stage_pos;           /* image bytes held in 'stage' */
+    UINTN stage_len;
+};
+
+extern EFI_STATUS DetectSQFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void);
+extern EFI_STATUS MountSQFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out);
+extern EFI_STATUS ReadSQFSDir(void *mount_ctx, const CHAR16 *path);
+extern EFI_STATUS UmountSQFS(void *mount);
+extern EFI_STATUS OpenSQFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out);
+extern EFI_STATUS OpenSQFSDir(void *mount_ctx, const CHAR16 *path, void **dir_out);
+extern EFI_STATUS ReadSQFSDirEntry(void *dir, UINTN *size, VOID *buf);
+extern void CloseSQFSDir(void *dir);
+
+#endif /* _SQUASHFS_H_ */
@@ -0,0 +1,80 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * trace.h
+ * Function entry/exit tracing for trace builds.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * Trace builds compile everything with -finstrument-functions. Each
+ * function entry and exit is logged into a ring of TRACE_ENTRIES records
+ * (a power of two); once full, the oldest records are overwritten.
+ */
+#define TRACE_ENTRIES		32768
+#define TRACE_EXIT		(1ULL << 63)	/* set in Ticks for exits */
+
+struct trace_entry {
+	UINT64 Fn;		/* run-time address of the function */
+	UINT64 Ticks;		/* clock counter, TRACE_EXIT on return */
+};
+
+/*
+ * "trace dump" sends this header over the serial port, followed by Count
+ * trace_entry records, oldest first, all little-endian. Subtracting
+ * ImageBase from Fn gives the address in boot_trace.so.
+ */
+#define TRACE_MAGIC		0x52544248	/* "HBTR" */
+#define TRACE_VERSION		1
+
+struct trace_dump_header {
+	UINT32 Magic;
+	UINT16 Version;
+	UINT16 EntrySize;
+	UINT32 Count;
+	UINT32 Lost;		/* records overwritten before the dump */
+	UINT64 ClockFrequency;
+	UINT64 ImageBase;
+} __attribute__((packed));
+
+extern VOID TraceReset(VOID);
+extern EFI_STATUS TraceDump(VOID);
+extern VOID TraceStatus(VOID);
+
+#endif /* _TRACE_H_ */
@@ -48,6 +48,17 @@
 #include <efi.h>
 #include <efilib.h>
 
+/*
+ * Compressed input passes through a ring of ZIP_RING_BLOCKS reads of
+ * ZIP_INBUF_SIZE bytes; the ring size must be a power of two.
+ */
+#define ZIP_INBUF_SIZE      0x2000
+#define ZIP_RING_BLOCKS     4
+
+/* Pieces an indexed entry is read in, and the first guess at the tail. */
+#define ZIP_FILE_CHUNK      0x10000
+#define ZIP_TAIL_GUESS      0x1000
+
 typedef enum {
     ZIP_HEADER_NOT_PROCESSED = 0,
     ZIP_HEADER_PROCESSING,
@@ -74,9 +85,44 @@ struct ZipInfo {
     ZIP_HEADER_STATE ProcessedHeader;
     volatile INTN HeaderDone;
     UINT8 *OutBuf;
-    INTN Remain;
+    INTN Remain;            /* bytes of the transfer not yet read */
+    UINTN DataRemain;       /* compressed bytes not yet given to inflate() */
+    UINTN Pending;          /* ring bytes inflate() is still reading */
+    BOOLEAN InputDone;      /* the input source has reported end of file */
+};
+
+/*
+ * A zip file that can be read at any offset is indexed from its central
+ * directory instead, so that one entry can be extracted without reading
+ * the others.
+ */
+struct ZipEntry {
+    CHAR8 *Name;            /* NUL terminated, as stored (usually '/' separated) */
+    UINT16 Flags;
+    UINT16 CompressionMethod;
+    UINT32 Crc;
+    UINT32 CompressedSize;
+    UINT32 UncompressedSize;
+    UINT64 HeaderOffset;    /* of the entry's local header in the file */
+};
+
+struct ZipIndex {
+    EFI_FILE_PROTOCOL *File;
+    UINT64 CentralOffset;   /* entry data must end before the central directory */
+    UINTN Count;
+    struct ZipEntry *Entries;
 };
 
 extern EFI_STATUS ReadBlockToBuffer(struct ZipInfo *Zip, EFI_FILE_PROTOCOL *BootFile);
+extern EFI_STATUS ZipReadLocalHeader(struct ZipInfo *Zip);
+extern EFI_STATUS ZipExtract(struct ZipInfo *Zip, UINT8 *Out, UINTN OutSize, UINTN *OutLen);
+extern EFI_STATUS ZipDrain(struct ZipInfo *Zip);
+
+extern BOOLEAN IsZip(const VOID *Header);
+extern EFI_STATUS ZipOpenIndex(EFI_FILE_PROTOCOL *File, struct ZipIndex **Index);
+extern struct ZipEntry *ZipFindEntry(struct ZipIndex *Index, const CHAR16 *Name);
+extern EFI_STATUS ZipExtractEntry(struct ZipIndex *Index, struct ZipEntry *Entry, UINT8 *Out, UINTN OutSize,
+    UINTN *OutLen);
+extern VOID ZipCloseIndex(struct ZipIndex *Index);
 
 #endif /* _ZIP_H_ */
@@ -56,6 +56,13 @@ riscv64/%.o: src/%.c
 	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
 	$(HIDE)$(RISCV64_CC) $(RISCV64_CFLAGS) -c $< -o $@
 
+# HOT_SOURCES get HOT_CFLAGS on top of the flags of whichever flavour
+# they are built for.
+HOT_NAMES = $(patsubst src/%.c,%,$(HOT_SOURCES))
+$(foreach n,$(HOT_NAMES),x86_64/$(n).o x86_64/debug_$(n).o x86_64/dev_$(n).o x86_64/trace_$(n).o): X86_64_CFLAGS += $(HOT_CFLAGS)
+$(foreach n,$(HOT_NAMES),aarch64/$(n).o aarch64/debug_$(n).o aarch64/dev_$(n).o aarch64/trace_$(n).o): AARCH64_CFLAGS += $(HOT_CFLAGS)
+$(foreach n,$(HOT_NAMES),riscv64/$(n).o riscv64/debug_$(n).o riscv64/dev_$(n).o): RISCV64_CFLAGS += $(HOT_CFLAGS)
+
 x86_64/boot.so: $(X86_64_OBJS)
 	$(HIDE)$(ECHO) "  LD       $(notdir $@)"
 	$(call link_x86_64)
@@ -117,6 +124,40 @@ aarch64/dev_%.o: src/%.c
 	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
 	$(HIDE)$(AARCH64_CC) $(AARCH64_DEV_CFLAGS) -c $< -o $@
 
+# Object rules for trace builds.
+x86_64/trace_vers.o: x86_64/vers.c
+	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
+	$(HIDE)$(X86_64_CC) $(X86_64_TRACE_CFLAGS) -c $< -o $@
+
+aarch64/trace_vers.o: aarch64/vers.c
+	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
+	$(HIDE)$(AARCH64_CC) $(AARCH64_TRACE_CFLAGS) -c $< -o $@
+
+x86_64/trace_%.o: src/%.c
+	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
+	$(HIDE)$(X86_64_CC) $(X86_64_TRACE_CFLAGS) -c $< -o $@
+
+aarch64/trace_%.o: src/%.c
+	$(HIDE)$(ECHO) "  CC       $(notdir $@)"
+	$(HIDE)$(AARCH64_CC) $(AARCH64_TRACE_CFLAGS) -c $< -o $@
+
+x86_64/boot_trace.so: $(X86_64_TRACE_OBJS)
+	$(HIDE)$(ECHO) "  LD       $(notdir $@)"
+	$(call link_x86_64_trace)
+
+aarch64/boot_trace.so: $(AARCH64_TRACE_OBJS)
+	$(HIDE)$(ECHO) "  LD       $(notdir $@)"
+	$(call link_aarch64_trace)
+
+# The .so is kept; host/tracesym reads its symbol table.
+x86_64/boot_trace.efi: x86_64/boot_trace.so
+	$(HIDE)$(ECHO) "  OBJCOPY  $(notdir $@)"
+	$(HIDE)$(X86_64_OBJCOPY) $(EFI_OBJCOPY_FLAGS) --target efi-app-x86_64 $< $@
+
+aarch64/boot_trace.efi: aarch64/boot_trace.so
+	$(HIDE)$(ECHO) "  OBJCOPY  $(notdir $@)"
+	$(HIDE)$(AARCH64_OBJCOPY) $(EFI_OBJCOPY_FLAGS) --target efi-app-aarch64 $< $@
+
 x86_64/boot_debug.efi: x86_64/boot_debug.so
 	$(HIDE)$(ECHO) "  OBJCOPY  $(notdir $@)"
 	$(HIDE)$(X86_64_OBJCOPY) $(EFI_OBJCOPY_FLAGS) --target efi-app-x86_64 $< $@
@@ -144,6 +185,7 @@ define link_x86_64
 $(HIDE)$(X86_64_LD) -shared -Bsymbolic \
 	-L$(X86_64_LIB_DIR)/lib -L$(X86_64_LIB_DIR)/gnuefi \
 	-T$(X86_64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(X86_64_LIB_DIR)/gnuefi/crt0-efi-x86_64.o \
 	$(X86_64_OBJS) -o x86_64/boot.so -lgnuefi -lefi
 endef
@@ -152,6 +194,7 @@ define link_aarch64
 $(HIDE)$(AARCH64_LD) -shared -Bsymbolic -nostdlib \
 	-L$(AARCH64_LIB_DIR)/lib -L$(AARCH64_LIB_DIR)/gnuefi \
 	-T$(AARCH64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(AARCH64_LIB_DIR)/gnuefi/crt0-efi-aarch64.o \
 	$(AARCH64_OBJS) -o aarch64/boot.so -lgnuefi -lefi
 endef
@@ -160,6 +203,7 @@ define link_riscv64
 $(HIDE)$(RISCV64_LD) -shared -Bsymbolic -nostdlib \
 	-L$(RISCV64_LIB_DIR)/lib -L$(RISCV64_LIB_DIR)/gnuefi \
 	-T$(RISCV64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(RISCV64_LIB_DIR)/gnuefi/crt0-efi-riscv64.o \
 	$(RISCV64_OBJS) -o riscv64/boot.so -lgnuefi -lefi
 endef
@@ -169,6 +213,7 @@ define link_x86_64_dev
 $(HIDE)$(X86_64_LD) -shared -Bsymbolic \
 	-L$(X86_64_LIB_DIR)/lib -L$(X86_64_LIB_DIR)/gnuefi \
 	-T$(X86_64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(X86_64_LIB_DIR)/gnuefi/crt0-efi-x86_64.o \
 	$(X86_64_DEV_OBJS) -o x86_64/boot_dev.so -lgnuefi -lefi
 endef
@@ -177,6 +222,7 @@ define link_aarch64_dev
 $(HIDE)$(AARCH64_LD) -shared -Bsymbolic -nostdlib \
 	-L$(AARCH64_LIB_DIR)/lib -L$(AARCH64_LIB_DIR)/gnuefi \
 	-T$(AARCH64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(AARCH64_LIB_DIR)/gnuefi/crt0-efi-aarch64.o \
 	$(AARCH64_DEV_OBJS) -o aarch64/boot_dev.so -lgnuefi -lefi
 endef
@@ -185,6 +231,7 @@ define link_x86_64_debug
 $(HIDE)$(X86_64_LD) -shared -Bsymbolic \
 	-L$(X86_64_LIB_DIR)/lib -L$(X86_64_LIB_DIR)/gnuefi \
 	-T$(X86_64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(X86_64_LIB_DIR)/gnuefi/crt0-efi-x86_64.o \
 	$(X86_64_DEBUG_OBJS) -o x86_64/boot_debug.so -lgnuefi -lefi
 endef
@@ -193,10 +240,29 @@ define link_aarch64_debug
 $(HIDE)$(AARCH64_LD) -shared -Bsymbolic -nostdlib \
 	-L$(AARCH64_LIB_DIR)/lib -L$(AARCH64_LIB_DIR)/gnuefi \
 	-T$(AARCH64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
 	$(AARCH64_LIB_DIR)/gnuefi/crt0-efi-aarch64.o \
 	$(AARCH64_DEBUG_OBJS) -o aarch64/boot_debug.so -lgnuefi -lefi
 endef
 
+define link_x86_64_trace
+$(HIDE)$(X86_64_LD) -shared -Bsymbolic \
+	-L$(X86_64_LIB_DIR)/lib -L$(X86_64_LIB_DIR)/gnuefi \
+	-T$(X86_64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
+	$(X86_64_LIB_DIR)/gnuefi/crt0-efi-x86_64.o \
+	$(X86_64_TRACE_OBJS) -o x86_64/boot_trace.so -lgnuefi -lefi
+endef
+
+define link_aarch64_trace
+$(HIDE)$(AARCH64_LD) -shared -Bsymbolic -nostdlib \
+	-L$(AARCH64_LIB_DIR)/lib -L$(AARCH64_LIB_DIR)/gnuefi \
+	-T$(AARCH64_LINK_SCRIPT) \
+	$(HEAP_WRAP) \
+	$(AARCH64_LIB_DIR)/gnuefi/crt0-efi-aarch64.o \
+	$(AARCH64_TRACE_OBJS) -o aarch64/boot_trace.so -lgnuefi -lefi
+endef
+
 x86_64/boot.efi: x86_64/boot.so
 	$(HIDE)$(ECHO) "  OBJCOPY  $(notdir $@)"
 	$(HIDE)$(X86_64_OBJCOPY) $(EFI_OBJCOPY_FLAGS) --target efi-app-x86_64 $< $@
@@ -266,6 +332,16 @@ aarch64_dev_build: prep_build aarch64/boot_dev.efi
 	$(HIDE)$(ECHO) "  MCOPY  $(notdir $@)"
 	$(HIDE)mcopy -i fat.img aarch64/boot_dev.efi ::/EFI/BOOT/BOOTAA64.EFI
 
+x86_64_trace_build: prep_build x86_64/boot_trace.efi
+	$(call link_x86_64_trace)
+	$(HIDE)$(ECHO) "  MCOPY  $(notdir $@)"
+	$(HIDE)mcopy -i fat.img x86_64/boot_trace.efi ::/EFI/BOOT/BOOTX64.EFI
+
+aarch64_trace_build: prep_build aarch64/boot_trace.efi
+	$(call link_aarch64_trace)
+	$(HIDE)$(ECHO) "  MCOPY  $(notdir $@)"
+	$(HIDE)mcopy -i fat.img aarch64/boot_trace.efi ::/EFI/BOOT/BOOTAA64.EFI
+
 x86_64_iso_prep:
 	@rm -rf iso_root
 	@mkdir -p iso_root/EFI/BOOT
@@ -304,3 +380,32 @@ aarch64_iso: aarch64_iso_prep
 		-eltorito-platform efi -eltorito-boot EFI/BOOT/BOOTAA64.EFI -volid "HELIUMBOOT" \
 		-output heliumboot_aarch64.iso iso_root
 
+
+# Host benchmark.
+host/%.o: src/%.c
+	$(HIDE)mkdir -p host
+	$(HIDE)$(ECHO) "  HOSTCC   $(notdir $@)"
+	$(HIDE)$(HOST_CC) $(HOST_CFLAGS) -c $< -o $@
+
+host/%.o: tools/host/%.c
+	$(HIDE)mkdir -p host
+	$(HIDE)$(ECHO) "  HOSTCC   $(notdir $@)"
+	$(HIDE)$(HOST_CC) $(HOST_CFLAGS) -c $< -o $@
+
+host/host_bench: $(HOST_BENCH_OBJS)
+	$(HIDE)$(ECHO) "  HOSTLD   $(notdir $@)"
+	$(HIDE)$(HOST_CC) $(HOST_CFLAGS) $(HOST_HEAP_WRAP) $^ -o $@
+
+host_bench: host/host_bench
+
+host/mkimage: $(HOST_MKIMAGE_OBJS)
+	$(HIDE)$(ECHO) "  HOSTLD   $(notdir $@)"
+	$(HIDE)$(HOST_CC) $(HOST_CFLAGS) $^ -o $@
+
+host_mkimage: host/mkimage
+
+host/tracesym: host/tracesym.o
+	$(HIDE)$(ECHO) "  HOSTLD   $(notdir $@)"
+	$(HIDE)$(HOST_CC) $(HOST_CFLAGS) $^ -o $@
+
+host_tracesym: host/tracesym
@@ -0,0 +1,300 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * arena.c
+ * Page-backed allocator for short-lived loader and filesystem buffers.
+ *
+ * The filesystem plugins allocate a block-sized buffer, read into it and
+ * free it again many times per file. Going to the firmware pool for each
+ * of those is slow, and the scattered pool pages end up in the memory map
+ * handed to the kernel. Instead, small buffers come from size-class free
+ * lists carved out of a few large page runs which are never given back.
+ *
+ * The command arena is a bump allocator for scratch memory that only has
+ * to live until the current Command Monitor command returns.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "arena.h"
+#include "boot.h"
+#include "heap.h"
+
+#define ARENA_MAGIC		0x414e5241	/* "ARNA" */
+#define ARENA_LARGE		ARENA_NCLASSES
+
+/* Precedes every block; 16 bytes so that the payload stays aligned. */
+struct arena_hdr {
+	UINT32 Magic;
+	UINT32 Class;
+	UINT64 Pages;		/* only for ARENA_LARGE */
+};
+
+struct arena_free {
+	struct arena_free *Next;
+};
+
+struct cmd_chunk {
+	struct cmd_chunk *Next;
+	UINTN Pages;
+	UINTN Used;
+	UINTN Pad;
+};
+
+static struct arena_free *FreeList[ARENA_NCLASSES];
+static UINT8 *SlabPtr, *SlabEnd;
+static struct cmd_chunk *CmdBase, *CmdCur;
+static struct arena_stats Stats;
+
+static VOID *
+arena_get_pages(UINTN Pages)
+{
+	EFI_PHYSICAL_ADDRESS Addr;
+	EFI_STATUS Status;
+
+	Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, Pages, &Addr);
+	if (EFI_ERROR(Status))
+		return NULL;
+
+	return (VOID *)(UINTN)Addr;
+}
+
+static VOID
+arena_put_pages(VOID *Buffer, UINTN Pages)
+{
+	HeapFreePages((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
+}
+
+static UINT32
+arena_class(UINTN Size)
+{
+	UINT32 Class = 0;
+
+	while ((ARENA_MIN_SIZE << Class) < Size)
+		Class++;
+
+	return Class;
+}
+
+static VOID
+arena_push(UINT32 Class, UINT8 *Block)
+{
+	struct arena_hdr *Hdr = (struct arena_hdr *)Block;
+	struct arena_free *Free = (struct arena_free *)(Hdr + 1);
+
+	Hdr->Magic = ARENA_MAGIC;
+	Hdr->Class = Class;
+	Hdr->Pages = 0;
+	Free->Next = FreeList[Class];
+	FreeList[Class] = Free;
+}
+
+/*
+ * Start a new slab. Whatever is left of the old one is split into the
+ * largest blocks that fit so it does not go to waste.
+ */
+static BOOLEAN
+arena_refill(VOID)
+{
+	UINT8 *Slab;
+	INT32 Class;
+
+	Slab = arena_get_pages(ARENA_SLAB_PAGES);
+	if (!Slab)
+		return FALSE;
+
+	for (Class = ARENA_NCLASSES - 1; Class >= 0; Class--) {
+		UINTN Need = sizeof(struct arena_hdr) + (ARENA_MIN_SIZE << Class);
+
+		while ((UINTN)(SlabEnd - SlabPtr) >= Need) {
+			arena_push(Class, SlabPtr);
+			SlabPtr += Need;
+		}
+	}
+
+	SlabPtr = Slab;
+	SlabEnd = Slab + ARENA_SLAB_PAGES * EFI_PAGE_SIZE;
+	Stats.Reserved += ARENA_SLAB_PAGES * EFI_PAGE_SIZE;
+	return TRUE;
+}
+
+VOID *
+ArenaAlloc(UINTN Size)
+{
+	struct arena_hdr *Hdr;
+	struct arena_free *Free;
+	UINT32 Class;
+	UINTN Need, Pages;
+
+	if (Size > ARENA_MAX_SIZE) {
+		Pages = EFI_SIZE_TO_PAGES(Size + sizeof(*Hdr));
+		Hdr = arena_get_pages(Pages);
+		if (!Hdr)
+			return NULL;
+		Hdr->Magic = ARENA_MAGIC;
+		Hdr->Class = ARENA_LARGE;
+		Hdr->Pages = Pages;
+		Stats.Reserved += Pages * EFI_PAGE_SIZE;
+		Need = Pages * EFI_PAGE_SIZE;
+		goto done;
+	}
+
+	Class = arena_class(Size);
+	Need = ARENA_MIN_SIZE << Class;
+
+	if (!FreeList[Class]) {
+		if ((UINTN)(SlabEnd - SlabPtr) < sizeof(*Hdr) + Need && !arena_refill())
+			return NULL;
+		arena_push(Class, SlabPtr);
+		SlabPtr += sizeof(*Hdr) + Need;
+	}
+
+	Free = FreeList[Class];
+	FreeList[Class] = Free->Next;
+	Hdr = (struct arena_hdr *)Free - 1;
+
+done:
+	Stats.InUse += Need;
+	if (Stats.InUse > Stats.Peak)
+		Stats.Peak = Stats.InUse;
+	Stats.Allocs++;
+	return Hdr + 1;
+}
+
+VOID *
+ArenaZeroAlloc(UINTN Size)
+{
+	VOID *Buffer = ArenaAlloc(Size);
+
+	if (Buffer)
+		SetMem(Buffer, Size, 0);
+
+	return Buffer;
+}
+
+VOID
+ArenaFree(VOID *Buffer)
+{
+	struct arena_hdr *Hdr;
+
+	if (!Buffer)
+		return;
+
+	Hdr = (struct arena_hdr *)Buffer - 1;
+	if (Hdr->Magic != ARENA_MAGIC) {
+		PrintToScreen(L"Error: ArenaFree: bad block at 0x%lx\n", (UINT64)(UINTN)Buffer);
+		return;
+	}
+
+	if (Hdr->Class == ARENA_LARGE) {
+		Stats.InUse -= Hdr->Pages * EFI_PAGE_SIZE;
+		Stats.Reserved -= Hdr->Pages * EFI_PAGE_SIZE;
+		Hdr->Magic = 0;
+		arena_put_pages(Hdr, Hdr->Pages);
+		return;
+	}
+
+	Stats.InUse -= ARENA_MIN_SIZE << Hdr->Class;
+	arena_push(Hdr->Class, (UINT8 *)Hdr);
+}
+
+VOID *
+CmdArenaAlloc(UINTN Size)
+{
+	struct cmd_chunk *Chunk;
+	UINTN Pages;
+	UINT8 *Buffer;
+
+	Size = (Size + 15) & ~(UINTN)15;
+
+	if (!CmdCur || CmdCur->Pages * EFI_PAGE_SIZE - CmdCur->Used < Size) {
+		Pages = EFI_SIZE_TO_PAGES(sizeof(*Chunk) + Size);
+		if (Pages < CMD_ARENA_PAGES)
+			Pages = CMD_ARENA_PAGES;
+
+		Chunk = arena_get_pages(Pages);
+		if (!Chunk)
+			return NULL;
+		Chunk->Next = NULL;
+		Chunk->Pages = Pages;
+		Chunk->Used = sizeof(*Chunk);
+
+		if (CmdCur)
+			CmdCur->Next = Chunk;
+		else
+			CmdBase = Chunk;
+		CmdCur = Chunk;
+		Stats.CmdReserved += Pages * EFI_PAGE_SIZE;
+	}
+
+	Buffer = (UINT8 *)CmdCur + CmdCur->Used;
+	CmdCur->Used += Size;
+	Stats.CmdInUse += Size;
+	if (Stats.CmdInUse > Stats.CmdPeak)
+		Stats.CmdPeak = Stats.CmdInUse;
+
+	SetMem(Buffer, Size, 0);
+	return Buffer;
+}
+
+/*
+ * Drop everything allocated from the command arena. The first run of
+ * pages is kept for the next command; any overflow runs are returned.
+ */
+VOID
+CmdArenaReset(VOID)
+{
+	struct cmd_chunk *Chunk, *Next;
+
+	if (!CmdBase)
+		return;
+
+	for (Chunk = CmdBase->Next; Chunk; Chunk = Next) {
+		Next = Chunk->Next;
+		Stats.CmdReserved -= Chunk->Pages * EFI_PAGE_SIZE;
+		arena_put_pages(Chunk, Chunk->Pages);
+	}
+
+	CmdBase->Next = NULL;
+	CmdBase->Used = sizeof(*CmdBase);
+	CmdCur = CmdBase;
+	Stats.CmdInUse = 0;
+}
+
+VOID
+ArenaGetStats(struct arena_stats *Out)
+{
+	*Out = Stats;
+}
@@ -34,6 +34,7 @@
 #include <efi.h>
 #include <efilib.h>
 
+#include "arena.h"
 #include "bfs.h"
 #include "boot.h"
 
@@ -80,16 +81,17 @@ bfs_read_at(struct bfs_mount *mnt, UINT64 off, UINTN len, VOID *buf)
     UINTN first_off = off % blksz;
     UINTN to_read = len;
     UINT8 *out = (UINT8 *)buf;
+    VOID *bblock;
+
+    bblock = ArenaAlloc(blksz);
+    if (!bblock)
+        return EFI_OUT_OF_RESOURCES;
 
     while (to_read) {
         /* read one block */
-        VOID *bblock = AllocatePool(blksz);
-        if (!bblock)
-            return EFI_OUT_OF_RESOURCES;
-
         Status = uefi_call_wrapper(bio->ReadBlocks, 5, bio, bio->Media->MediaId, start_lba, blksz, bblock);
         if (EFI_ERROR(Status)) {
-            FreePool(bblock);
+            ArenaFree(bblock);
             return Status;
         }
 
@@ -98,7 +100,6 @@ bfs_read_at(struct bfs_mount *mnt, UINT64 off, UINTN len, VOID *buf)
             chunk = to_read;
 
         MemMove(out, (UINT8 *)bblock + first_off, chunk);
-        FreePool(bblock);
 
         out += chunk;
         to_read -= chunk;
@@ -106,6 +107,7 @@ bfs_read_at(struct bfs_mount *mnt, UINT64 off, UINTN len, VOID *buf)
         first_off = 0;
     }
 
+    ArenaFree(bblock);
     return EFI_SUCCESS;
 }
 
@@ -282,8 +284,8 @@ ReadBFSDir(void *mount_ctx, const CHAR16 *path)
     return EFI_SUCCESS;
 }
 
-/* Minimal in-memory file handle for BFS that implements the EFI file methods
- * used by the loader (Read, SetPosition, Close). */
+/* Minimal in-memory file handle for BFS. It implements the read-only subset of
+ * the EFI file methods used by the loader and by the firmware's LoadImage(). */
 struct bfs_file {
     EFI_FILE_PROTOCOL File;
     struct bfs_mount *mnt;
@@ -291,6 +293,7 @@ struct bfs_file {
     UINT64 size;  /* file size in bytes */
     UINT64 pos;   /* current file position */
     UINT16 ino;   /* inode number */
+    CHAR16 name[BFS_MAXFNLENN]; /* file name, for GetInfo */
 };
 
 #define BFS_MAX_SCAN (1 << 20) /* reuse heuristic from bfs_find_name_for_ino */
@@ -362,6 +365,20 @@ bfs_read_dirent_by_inode(struct bfs_mount *mnt, UINT16 inode, struct bfs_dirent
     return bfs_read_dirent_at(mnt, idx, de);
 }
 
+/* File size from a dirent; d_sblock is block start, d_eoffset is EOF disk offset. */
+static UINT64
+bfs_dirent_size(const struct bfs_dirent *de)
+{
+    UINT64 start = (UINT64)de->d_sblock * (UINT64)BFS_BSIZE;
+    UINT64 eof = (UINT64)de->d_eoffset;
+
+    if (eof >= start)
+        return eof - start;
+    if (de->d_eblock >= de->d_sblock) /* fallback to block range */
+        return (UINT64)(de->d_eblock - de->d_sblock + 1) * (UINT64)BFS_BSIZE;
+    return 0;
+}
+
 /* EFI file methods (minimal) */
 static EFI_STATUS EFIAPI
 bfs_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
@@ -413,6 +430,55 @@ bfs_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
     return EFI_SUCCESS;
 }
 
+static EFI_STATUS EFIAPI
+bfs_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct bfs_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+bfs_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    struct bfs_file *bf = (struct bfs_file *)This;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+        return EFI_UNSUPPORTED;
+
+    return FillFileInfo(bf->name, bf->size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+bfs_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* BFS is flat; a regular file has nothing below it */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+bfs_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+bfs_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+bfs_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
 static EFI_STATUS EFIAPI
 bfs_file_close(EFI_FILE_PROTOCOL *This)
 {
@@ -424,6 +490,13 @@ bfs_file_close(EFI_FILE_PROTOCOL *This)
     return EFI_SUCCESS;
 }
 
+static EFI_STATUS EFIAPI
+bfs_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    bfs_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
 /*
  * OpenBFS:
  * - locate inode for filename
@@ -454,17 +527,8 @@ OpenBFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
     if (de.d_fattr.va_type != VREG)
         return EFI_UNSUPPORTED;
 
-    /* compute file start and size; d_sblock is block start, d_eoffset is EOF disk offset */
     UINT64 start = (UINT64)de.d_sblock * (UINT64)BFS_BSIZE;
-    UINT64 eof = (UINT64)de.d_eoffset;
-    UINT64 size = 0;
-
-    if (eof >= start)
-        size = eof - start;
-    else if (de.d_eblock >= de.d_sblock) /* fallback to block range */
-        size = (UINT64)(de.d_eblock - de.d_sblock + 1) * (UINT64)BFS_BSIZE;
-    else
-        size = 0;
+    UINT64 size = bfs_dirent_size(&de);
 
     struct bfs_file *bf = AllocateZeroPool(sizeof(*bf));
     if (!bf)
@@ -476,18 +540,24 @@ OpenBFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
     bf->pos = 0;
     bf->ino = ino;
 
-    /* fill EFI_FILE_PROTOCOL fields (only methods we need) */
+    /* keep the bare name for GetInfo */
+    while (*filename == L'\\' || *filename == L'/')
+        filename++;
+    StrnCpy(bf->name, filename, BFS_MAXFNLEN);
+    bf->name[BFS_MAXFNLEN] = L'\0';
+
+    /* fill EFI_FILE_PROTOCOL fields; writes are refused */
     bf->File.Revision = EFI_FILE_PROTOCOL_REVISION;
-    bf->File.Open = NULL;
+    bf->File.Open = bfs_file_open;
     bf->File.Close = bfs_file_close;
-    bf->File.Delete = NULL;
+    bf->File.Delete = bfs_file_delete;
     bf->File.Read = bfs_file_read;
-    bf->File.Write = NULL;
-    bf->File.GetPosition = NULL;
+    bf->File.Write = bfs_file_write;
+    bf->File.GetPosition = bfs_file_getpos;
     bf->File.SetPosition = bfs_file_setpos;
-    bf->File.GetInfo = NULL;
-    bf->File.SetInfo = NULL;
-    bf->File.Flush = NULL;
+    bf->File.GetInfo = bfs_file_getinfo;
+    bf->File.SetInfo = bfs_file_setinfo;
+    bf->File.Flush = bfs_file_flush;
 
     *file_out = &bf->File;
     return EFI_SUCCESS;
@@ -501,3 +571,96 @@ UmountBFS(void *mount)
     FreePool(mount);
     return EFI_SUCCESS;
 }
+
+/*
+ * Directory iterator. BFS is flat, so only the root can be opened; its
+ * entries are the name list held in the root inode's extent, and the
+ * position is the byte offset of the next one.
+ */
+struct bfs_dir {
+    struct bfs_mount *mnt;
+    UINT64 off;
+    UINT64 end;
+};
+
+EFI_STATUS
+OpenBFSDir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct bfs_mount *mnt = (struct bfs_mount *)mount_ctx;
+    struct bfs_dirent root;
+    struct bfs_dir *bd;
+    EFI_STATUS Status;
+    UINT16 ino;
+
+    if (!mnt || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    while (*path == L'\\' || *path == L'/')
+        path++;
+    if (*path != L'\0')
+        return EFI_ERROR(bfs_find_inode_by_name(mnt, path, &ino)) ? EFI_NOT_FOUND : EFI_UNSUPPORTED;
+
+    Status = bfs_read_dirent_by_inode(mnt, BFSROOTINO, &root);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    bd = AllocateZeroPool(sizeof(*bd));
+    if (!bd)
+        return EFI_OUT_OF_RESOURCES;
+
+    bd->mnt = mnt;
+    bd->off = (UINT64)root.d_sblock * BFS_BSIZE;
+    bd->end = bd->off + bfs_dirent_size(&root);
+    if (bd->end - bd->off > BFS_MAX_SCAN)
+        bd->end = bd->off + BFS_MAX_SCAN;
+    *dir_out = bd;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReadBFSDirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct bfs_dir *bd = dir;
+    struct bfs_mount *mnt = bd->mnt;
+    struct bfs_ldirs lentry;
+    struct bfs_dirent de;
+    CHAR16 name[BFS_MAXFNLENN];
+    EFI_STATUS Status;
+    UINTN k;
+
+    for (; bd->off + sizeof(lentry) <= bd->end; bd->off += sizeof(lentry)) {
+        Status = bfs_read_at(mnt, bd->off, sizeof(lentry), &lentry);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        if (lentry.l_ino == 0 || lentry.l_name[0] == '\0')
+            continue;
+        if (lentry.l_name[0] == '.' &&
+            (lentry.l_name[1] == '\0' || (lentry.l_name[1] == '.' && lentry.l_name[2] == '\0')))
+            continue;
+
+        /* lentry.l_name is not necessarily NUL-terminated */
+        for (k = 0; k < BFS_MAXFNLEN && lentry.l_name[k] != '\0'; k++)
+            name[k] = (UINT8)lentry.l_name[k];
+        name[k] = L'\0';
+
+        Status = bfs_read_dirent_by_inode(mnt, lentry.l_ino, &de);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        Status = FillFileInfo(name, bfs_dirent_size(&de), EFI_FILE_READ_ONLY, size, buf);
+        if (!EFI_ERROR(Status))
+            bd->off += sizeof(lentry);
+        return Status;
+    }
+
+    *size = 0;
+    return EFI_SUCCESS;
+}
+
+void
+CloseBFSDir(void *dir)
+{
+    if (dir)
+        FreePool(dir);
+}
@@ -0,0 +1,179 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * bootperf.c
+ * Boot performance records handed to the operating system.
+ *
+ * Just before control passes to the loaded program, the boot phase times
+ * and byte counters are copied into a table in ACPI reclaim memory and
+ * installed as an EFI configuration table, so that the kernel can report
+ * how long the loader took without anyone watching the console. The ELF
+ * path refreshes the table once more after ExitBootServices(), which only
+ * writes to memory we already own.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "bootperf.h"
+#include "clock.h"
+#include "heap.h"
+
+#define PERF_TABLE_PAGES	1
+
+static EFI_GUID PerfGuid = HELIUMBOOT_PERF_TABLE_GUID;
+static struct hb_perf_header *PerfTable = NULL;
+static UINT64 StartImageTicks;
+
+static VOID *
+AddRecord(UINT8 **Pos, UINT16 Type, UINT8 Length)
+{
+	struct hb_perf_record *Rec = (struct hb_perf_record *)*Pos;
+
+	SetMem(Rec, Length, 0);
+	Rec->Type = Type;
+	Rec->Length = Length;
+	Rec->Revision = (Type == HB_PERF_BASIC_RECORD) ? 2 : 1;
+	*Pos += Length;
+	return Rec;
+}
+
+static UINT64
+PhaseNs(UINT64 Ticks)
+{
+	return Ticks ? TicksToNanoseconds(Ticks) : 0;
+}
+
+static void
+FillBootPerf(void)
+{
+	const struct boot_phase_rec *Load, *Ebs, *p;
+	struct hb_perf_basic *Basic;
+	struct hb_perf_loader *Loader;
+	struct hb_perf_phase *Phase;
+	struct hb_perf_counter *Ctr;
+	UINT8 *Pos;
+	UINTN i;
+
+	Pos = (UINT8 *)(PerfTable + 1);
+	Load = GetBootPhase(BOOT_PHASE_LOAD);
+	Ebs = GetBootPhase(BOOT_PHASE_EXIT_BS);
+
+	// ResetEnd belongs to the firmware; we have no way to know it.
+	Basic = AddRecord(&Pos, HB_PERF_BASIC_RECORD, sizeof(*Basic));
+	Basic->OsLoaderLoadImageStart = PhaseNs(Load->Start);
+	Basic->OsLoaderStartImageStart = PhaseNs(StartImageTicks);
+	if (Ebs->Count) {
+		Basic->ExitBootServicesEntry = PhaseNs(Ebs->Start);
+		Basic->ExitBootServicesExit = PhaseNs(Ebs->End);
+	}
+
+	Loader = AddRecord(&Pos, HB_PERF_LOADER_RECORD, sizeof(*Loader));
+	Loader->LoaderStart = PhaseNs(GetClockBase());
+	Loader->ClockFrequency = GetClockFrequency();
+
+	for (i = 0; i < BOOT_PHASE_MAX; i++) {
+		p = GetBootPhase(i);
+		Phase = AddRecord(&Pos, HB_PERF_PHASE_RECORD, sizeof(*Phase));
+		Phase->Phase = i;
+		Phase->Start = PhaseNs(p->First);
+		Phase->Duration = TicksToNanoseconds(p->Total);
+		Phase->Count = p->Count;
+	}
+
+	for (i = 0; i < BOOT_CTR_MAX; i++) {
+		Ctr = AddRecord(&Pos, HB_PERF_COUNTER_RECORD, sizeof(*Ctr));
+		Ctr->Counter = i;
+		Ctr->Value = GetBootCounter(i);
+	}
+
+	Ctr = AddRecord(&Pos, HB_PERF_COUNTER_RECORD, sizeof(*Ctr));
+	Ctr->Counter = HB_PERF_INFLATE_RATE;
+	Ctr->Value = GetInflateRate();
+
+	PerfTable->Signature = HB_PERF_SIGNATURE;
+	PerfTable->Length = (UINT32)(Pos - (UINT8 *)PerfTable);
+}
+
+/*
+ * Function:
+ * PublishBootPerf()
+ *
+ * Description:
+ * Build the boot performance table and install it as a configuration
+ * table. Called right before the loaded program is started; the table is
+ * reused if an earlier boot attempt failed and we come back here.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, or the error from the allocation or the
+ * installation. Failing to publish should not stop the boot.
+ */
+EFI_STATUS
+PublishBootPerf(void)
+{
+	EFI_STATUS Status;
+	EFI_PHYSICAL_ADDRESS Addr;
+
+	if (!PerfTable) {
+		Status = HeapAllocatePages(AllocateAnyPages, EfiACPIReclaimMemory, PERF_TABLE_PAGES, &Addr);
+		if (EFI_ERROR(Status))
+			return Status;
+		PerfTable = (struct hb_perf_header *)(UINTN)Addr;
+	}
+
+	StartImageTicks = ReadClock();
+	FillBootPerf();
+
+	return uefi_call_wrapper(BS->InstallConfigurationTable, 2, &PerfGuid, PerfTable);
+}
+
+/*
+ * Function:
+ * FinishBootPerf()
+ *
+ * Description:
+ * Bring the published table up to date with whatever happened since
+ * PublishBootPerf(), ExitBootServices() in particular. Safe to call after
+ * boot services are gone.
+ */
+void
+FinishBootPerf(void)
+{
+	if (!PerfTable)
+		return;
+
+	StartImageTicks = ReadClock();
+	FillBootPerf();
+}
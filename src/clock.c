@@ -0,0 +1,329 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * clock.c
+ * Monotonic clock and boot-phase profiler.
+ *
+ * The clock reads the CPU's free-running counter: the TSC on x86_64,
+ * CNTVCT_EL0 on AArch64 and the time CSR on RISC-V. Only AArch64 tells
+ * us the counter frequency, so elsewhere it is calibrated once against
+ * gBS->Stall(). Builds without a known counter fall back to the RTC,
+ * which many firmwares only keep to the second.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "clock.h"
+
+#define CLOCK_CALIBRATE_US	10000
+
+static UINT64 ClockFreq;
+static UINT64 ClockBase;
+static const CHAR16 *ClockSource = L"none";
+static struct boot_phase_rec Phases[BOOT_PHASE_MAX];
+static UINT64 Counters[BOOT_CTR_MAX];
+
+static const CHAR16 *PhaseNames[BOOT_PHASE_MAX] = {
+	[BOOT_PHASE_VIDEO]	= L"video",
+	[BOOT_PHASE_CONFIG]	= L"config",
+	[BOOT_PHASE_MENU]	= L"menu",
+	[BOOT_PHASE_MOUNT]	= L"mount",
+	[BOOT_PHASE_LOAD]	= L"load",
+	[BOOT_PHASE_DECOMPRESS]	= L"decompress",
+	[BOOT_PHASE_EXIT_BS]	= L"exitbs",
+};
+
+static const CHAR16 *CounterNames[BOOT_CTR_MAX] = {
+	[BOOT_CTR_DISK_READ]	= L"disk read",
+	[BOOT_CTR_FILE_READ]	= L"file read",
+	[BOOT_CTR_DOWNLOAD]	= L"download",
+	[BOOT_CTR_INFLATE_IN]	= L"inflate in",
+	[BOOT_CTR_INFLATE_OUT]	= L"inflate out",
+	[BOOT_CTR_LZ4_IN]	= L"lz4 in",
+	[BOOT_CTR_LZ4_OUT]	= L"lz4 out",
+	[BOOT_CTR_ZSTD_IN]	= L"zstd in",
+	[BOOT_CTR_ZSTD_OUT]	= L"zstd out",
+	[BOOT_CTR_XZ_IN]	= L"xz in",
+	[BOOT_CTR_XZ_OUT]	= L"xz out",
+};
+
+#if !defined(X86_64_BLD) && !defined(AARCH64_BLD) && !defined(RISCV64_BLD)
+static UINT64
+ReadRtcMicroseconds(void)
+{
+	EFI_TIME Time;
+
+	if (EFI_ERROR(uefi_call_wrapper(RT->GetTime, 2, &Time, NULL)))
+		return 0;
+
+	return ((UINT64)Time.Hour * 3600 + (UINT64)Time.Minute * 60 +
+	    (UINT64)Time.Second) * 1000000 + Time.Nanosecond / 1000;
+}
+#endif
+
+UINT64
+ReadClock(void)
+{
+#if defined(X86_64_BLD)
+	UINT32 Lo, Hi;
+
+	__asm__ volatile ("rdtsc" : "=a" (Lo), "=d" (Hi));
+	return ((UINT64)Hi << 32) | Lo;
+#elif defined(AARCH64_BLD)
+	UINT64 Cnt;
+
+	__asm__ volatile ("isb; mrs %0, cntvct_el0" : "=r" (Cnt) : : "memory");
+	return Cnt;
+#elif defined(RISCV64_BLD)
+	UINT64 Cnt;
+
+	__asm__ volatile ("rdtime %0" : "=r" (Cnt));
+	return Cnt;
+#else
+	return ReadRtcMicroseconds();
+#endif
+}
+
+UINT64
+GetClockFrequency(void)
+{
+	return ClockFreq;
+}
+
+/*
+ * Split the conversion so that Ticks * 1000000 cannot overflow, even for
+ * a multi-GHz TSC that has been running for days.
+ */
+UINT64
+TicksToMicroseconds(UINT64 Ticks)
+{
+	if (ClockFreq == 0)
+		return 0;
+
+	return (Ticks / ClockFreq) * 1000000 +
+	    ((Ticks % ClockFreq) * 1000000) / ClockFreq;
+}
+
+UINT64
+TicksToNanoseconds(UINT64 Ticks)
+{
+	if (ClockFreq == 0)
+		return 0;
+
+	return (Ticks / ClockFreq) * 1000000000 +
+	    ((Ticks % ClockFreq) * 1000000000) / ClockFreq;
+}
+
+/*
+ * Counter value when the loader started. The hardware counters run from
+ * reset, so this is also roughly how long the firmware took.
+ */
+UINT64
+GetClockBase(void)
+{
+	return ClockBase;
+}
+
+UINT64
+GetTimeMicroseconds(void)
+{
+	return TicksToMicroseconds(ReadClock() - ClockBase);
+}
+
+UINT64
+GetTimeMilliseconds(void)
+{
+	return GetTimeMicroseconds() / 1000;
+}
+
+void
+InitClock(void)
+{
+	UINT64 End;
+
+	ClockBase = ReadClock();
+
+#if defined(AARCH64_BLD)
+	__asm__ volatile ("mrs %0, cntfrq_el0" : "=r" (ClockFreq));
+	ClockSource = L"CNTVCT";
+	if (ClockFreq != 0)
+		return;
+#elif defined(X86_64_BLD)
+	ClockSource = L"TSC";
+#elif defined(RISCV64_BLD)
+	ClockSource = L"rdtime";
+#else
+	ClockSource = L"RTC";
+	ClockFreq = 1000000;
+	return;
+#endif
+
+	uefi_call_wrapper(BS->Stall, 1, CLOCK_CALIBRATE_US);
+	End = ReadClock();
+	ClockFreq = (End - ClockBase) * (1000000 / CLOCK_CALIBRATE_US);
+
+	// A counter that did not move is no use; report time in ticks of 1us
+	// so that callers at least see a stable, if frozen, clock.
+	if (ClockFreq == 0)
+		ClockFreq = 1000000;
+}
+
+void
+BootPhaseBegin(enum boot_phase Phase)
+{
+	struct boot_phase_rec *p;
+
+	if (Phase >= BOOT_PHASE_MAX)
+		return;
+
+	p = &Phases[Phase];
+	if (p->Depth++ != 0)
+		return;
+
+	p->Start = ReadClock();
+	if (p->First == 0)
+		p->First = p->Start;
+}
+
+void
+BootPhaseEnd(enum boot_phase Phase)
+{
+	struct boot_phase_rec *p;
+
+	if (Phase >= BOOT_PHASE_MAX)
+		return;
+
+	p = &Phases[Phase];
+	if (p->Depth == 0 || --p->Depth != 0)
+		return;
+
+	p->End = ReadClock();
+	p->Total += p->End - p->Start;
+	p->Count++;
+}
+
+const struct boot_phase_rec *
+GetBootPhase(enum boot_phase Phase)
+{
+	if (Phase >= BOOT_PHASE_MAX)
+		return NULL;
+
+	return &Phases[Phase];
+}
+
+void
+BootCounterAdd(enum boot_counter Counter, UINT64 Bytes)
+{
+	if (Counter < BOOT_CTR_MAX)
+		Counters[Counter] += Bytes;
+}
+
+UINT64
+GetBootCounter(enum boot_counter Counter)
+{
+	if (Counter >= BOOT_CTR_MAX)
+		return 0;
+
+	return Counters[Counter];
+}
+
+/*
+ * Decompressed output, deflate, LZ4, zstd and xz together, in bytes per
+ * second of time spent decompressing.
+ */
+UINT64
+GetInflateRate(void)
+{
+	UINT64 Us;
+
+	Us = TicksToMicroseconds(Phases[BOOT_PHASE_DECOMPRESS].Total);
+	if (Us == 0)
+		return 0;
+
+	return ((Counters[BOOT_CTR_INFLATE_OUT] + Counters[BOOT_CTR_LZ4_OUT] + Counters[BOOT_CTR_ZSTD_OUT] +
+	    Counters[BOOT_CTR_XZ_OUT]) * 1000000) / Us;
+}
+
+static void
+PrintMicroseconds(UINT64 Us)
+{
+	PrintToScreen(L"%8lu.%03lu", Us / 1000, Us % 1000);
+}
+
+void
+PrintBootStats(void)
+{
+	struct boot_phase_rec *p;
+	UINT64 Total;
+	UINTN i;
+
+	PrintToScreen(L"Clock source: %s, %lu.%03lu MHz\n", ClockSource,
+	    ClockFreq / 1000000, (ClockFreq % 1000000) / 1000);
+#if defined(X86_64_BLD) || defined(AARCH64_BLD) || defined(RISCV64_BLD)
+	// The counter starts at reset, so this is the firmware's share.
+	PrintToScreen(L"Loader start: ");
+	PrintMicroseconds(TicksToMicroseconds(ClockBase));
+	PrintToScreen(L" ms after counter reset\n");
+#endif
+	PrintToScreen(L"Uptime:       ");
+	PrintMicroseconds(GetTimeMicroseconds());
+	PrintToScreen(L" ms since loader start\n\n");
+
+	PrintToScreen(L"Phase          Start (ms)      Total (ms)  Count\n");
+	for (i = 0; i < BOOT_PHASE_MAX; i++) {
+		p = &Phases[i];
+		PrintToScreen(L"%-10s   ", PhaseNames[i]);
+		if (p->First == 0) {
+			PrintToScreen(L"           -               -      0\n");
+			continue;
+		}
+		// A phase still running (the menu, say) counts up to now.
+		Total = p->Total;
+		if (p->Depth)
+			Total += ReadClock() - p->Start;
+		PrintMicroseconds(TicksToMicroseconds(p->First - ClockBase));
+		PrintToScreen(L"    ");
+		PrintMicroseconds(TicksToMicroseconds(Total));
+		PrintToScreen(L"  %5u%s\n", p->Count, p->Depth ? L" (running)" : L"");
+	}
+
+	PrintToScreen(L"\n");
+	for (i = 0; i < BOOT_CTR_MAX; i++)
+		PrintToScreen(L"%-12s %12lu bytes\n", CounterNames[i], Counters[i]);
+	if (Counters[BOOT_CTR_INFLATE_OUT] || Counters[BOOT_CTR_LZ4_OUT] || Counters[BOOT_CTR_ZSTD_OUT] ||
+	    Counters[BOOT_CTR_XZ_OUT])
+		PrintToScreen(L"Decompress rate: %lu KB/s\n", GetInflateRate() / 1024);
+}
@@ -40,6 +40,7 @@ struct boot_command_tab cmd_tab[] = {
 	{ L"?", help, CMD_NO_ARGS, L"?: help" },
 	{ L"about", about, CMD_NO_ARGS, L"about: about" },
 	{ L"boot", boot, CMD_REQUIRED_ARGS, L"boot: sd(x,y)FILE [ARGS]" },
+	{ L"bootstat", bootstat, CMD_NO_ARGS, L"bootstat: bootstat" },
 	{ L"clear", cls, CMD_NO_ARGS, L"clear: cls" },
 	{ L"cls", cls, CMD_NO_ARGS, L"cls: cls" },
 	{ L"dir", ls, CMD_REQUIRED_ARGS, L"dir: ls" },
@@ -49,10 +50,13 @@ struct boot_command_tab cmd_tab[] = {
 	{ L"hinv", hinv, CMD_NO_ARGS, L"hinv: hinv" },
 	{ L"ls", ls, CMD_REQUIRED_ARGS, L"ls: sd(x,y)[PATH]" },
 	{ L"lsblk", lsblk, CMD_NO_ARGS, L"lsblk: lsblk" },
+	{ L"meminfo", meminfo, CMD_OPTIONAL_ARGS, L"meminfo: [all]" },
 	{ L"pconf", pconf, CMD_NO_ARGS, L"pconf: pconf" },
 	{ L"reboot", reboot, CMD_NO_ARGS, L"reboot: reboot" },
 	{ L"revision", print_revision, CMD_NO_ARGS, L"revision: revision" },
 	{ L"sconf", sconf, CMD_REQUIRED_ARGS, L"sconf: FIELD VALUE" },
+	{ L"trace", trace, CMD_OPTIONAL_ARGS, L"trace: [dump|clear]" },
 	{ L"version", print_version, CMD_NO_ARGS, L"version: version" },
+	{ L"zdict", zdict, CMD_OPTIONAL_ARGS, L"zdict: [PATH|off]" },
 	{ NULL, NULL, CMD_NO_ARGS, NULL }
 };
@@ -34,11 +34,19 @@
 #include <efi.h>
 #include <efilib.h>
 
+#include "arena.h"
 #include "boot.h"
+#include "clock.h"
 #include "cmd.h"
 #include "config.h"
+#include "decompress.h"
 #include "disk.h"
 #include "fs.h"
+#include "heap.h"
+#include "memmap.h"
+#include "mount.h"
+#include "serial.h"
+#include "trace.h"
 #include "vtoc.h"
 
 void
@@ -59,11 +67,22 @@ boot(CHAR16 *args)
 {
 	EFI_STATUS Status;
 
+	BootPhaseBegin(BOOT_PHASE_LOAD);
 	Status = LoadFile(args);
+	BootPhaseEnd(BOOT_PHASE_LOAD);
 	if (EFI_ERROR(Status))
 		PrintToScreen(L"boot: Failed to boot file (%r)\n", Status);
 }
 
+/*
+ * Show where the time since the loader started has gone.
+ */
+void
+bootstat(CHAR16 *args)
+{
+	PrintBootStats();
+}
+
 void
 cls(CHAR16 *args)
 {
@@ -98,6 +117,7 @@ hinv(CHAR16 *args)
 {
 	UINT64 MemBytes = GetTotalMemoryBytes();
 	CHAR16 *ScreenInfo = GetScreenInfo();
+	struct arena_stats Arena;
 
 	PrintToScreen(L"\tHardware Inventory:\n\n");
 	PrintToScreen(L"\tFirmware:               %s (%d.%d)\n", ST->FirmwareVendor,
@@ -128,6 +148,13 @@ hinv(CHAR16 *args)
 #endif
 	PrintToScreen(L"\tInstalled memory:       %d MB\n", MemBytes / (1024 * 1024));
 	PrintToScreen(L"\tScreen Output:          %s\n", ScreenInfo);
+	PrintToScreen(L"\tMemory routines:        %s\n", GetMemRoutinesName());
+	PrintToScreen(L"\tCRC-32 routine:         %s\n", GetCrc32Name());
+	ArenaGetStats(&Arena);
+	PrintToScreen(L"\tLoader arena:           %lu KB peak, %lu KB reserved\n",
+		Arena.Peak / 1024, Arena.Reserved / 1024);
+	PrintToScreen(L"\tCommand arena:          %lu KB peak, %lu KB reserved\n",
+		Arena.CmdPeak / 1024, Arena.CmdReserved / 1024);
 
 	// GetScreenInfo() allocates memory. Free it.
 	FreePool(ScreenInfo);
@@ -147,13 +174,11 @@ ls(CHAR16 *args)
 	CHAR16 *Path = NULL;
 	UINTN DriveIndex = 0, SliceIndex = 0;
 	EFI_HANDLE *HandleBuffer = NULL;
+	EFI_HANDLE DiskHandle = NULL;
 	UINT32 PartitionStart = 0;
 	struct svr4_vtoc *Vtoc = NULL;
-	VOID *sb = NULL;
-	UINT32 SliceLBA, SectorStart;
-	struct fs_tab_entry *fs_entry_ptr;
-	VOID *mount_ctx = NULL;
-	BOOLEAN detected_by_plugin = FALSE;
+	UINT32 SliceLBA, SliceSize, SectorStart;
+	struct slice_mount *Mount;
 	struct mbr_partition *Partitions = NULL;
 
 	// Process sd(x,y) only.
@@ -224,16 +249,21 @@ ls(CHAR16 *args)
 		return;
 	}
 
-	Status = GetWholeDiskByIndex(DriveIndex, &BlockIo);
+	Status = GetWholeDiskByIndex(DriveIndex, &BlockIo, &DiskHandle);
 	if (EFI_ERROR(Status)) {
 		PrintToScreen(L"Cannot get whole disk by index: %r\n", Status);
 		goto cleanup;
 	}
 
-	if (BlockIo->Media->RemovableMedia && !BlockIo->Media->LogicalPartition)
+	if (BlockIo->Media->RemovableMedia && !BlockIo->Media->LogicalPartition) {
+		if (BlockIo->Media->BlockSize == ISO_SECTOR_SIZE && !EFI_ERROR(MountVolume(DiskHandle, &Mount)))
+			goto list_mount;
+		if (UseNativeFat && !EFI_ERROR(MountVolume(LoadedImage->DeviceHandle, &Mount)))
+			goto list_mount;
 		goto open_volume;
+	}
 
-	Partitions = AllocateZeroPool(sizeof(struct mbr_partition) * 4);
+	Partitions = CmdArenaAlloc(sizeof(struct mbr_partition) * 4);
     if (!Partitions) {
         PrintToScreen(L"Failed to allocate memory for partition table\n");
         goto cleanup;
@@ -247,11 +277,15 @@ ls(CHAR16 *args)
 
 	Status = FindSysVPartition(Partitions, &PartitionStart);
 	if (EFI_ERROR(Status)) {
-		PrintToScreen(L"No System V partition detected.\n");
-		goto cleanup;
+		// Without a VTOC, sd(d,p) names MBR partition p if it holds a Linux filesystem.
+		if (EFI_ERROR(FindLinuxPartition(Partitions, SliceIndex, &SliceLBA, &SliceSize))) {
+			PrintToScreen(L"No System V partition detected.\n");
+			goto cleanup;
+		}
+		goto mount_slice;
 	}
 
-	Vtoc = AllocateZeroPool(sizeof(struct svr4_vtoc));
+	Vtoc = CmdArenaAlloc(sizeof(struct svr4_vtoc));
     if (!Vtoc) {
         PrintToScreen(L"Failed to allocate memory for VTOC\n");
         goto cleanup;
@@ -322,65 +356,28 @@ ls(CHAR16 *args)
 		goto cleanup;
 	}
 
-	// Run through all supported filesystems to detect one.
-	for (fs_entry_ptr = fs_tab; fs_entry_ptr && fs_entry_ptr->fs_name != NULL; fs_entry_ptr++) {
-		if (fs_entry_ptr->sb_size == 0 || fs_entry_ptr->detect_fs == NULL)
-			continue;
+	SliceSize = Vtoc->v_part[SliceIndex].p_size;
 
-		sb = AllocateZeroPool(fs_entry_ptr->sb_size);
-		if (!sb) {
-			PrintToScreen(L"Failed to allocate memory for superblock\n");
-			continue;
-		}
-
-		Status = fs_entry_ptr->detect_fs(BlockIo, SliceLBA, sb);
-		if (EFI_ERROR(Status)) {
-			FreePool(sb);
-			sb = NULL;
-			continue;
-		}
-
-		PrintToScreen(L"Detected filesystem: %s\n", fs_entry_ptr->fs_name);
-
-		if (fs_entry_ptr->mount_fs) {
-			Status = fs_entry_ptr->mount_fs(BlockIo, SliceLBA, sb, &mount_ctx);
-			if (EFI_ERROR(Status)) {
-				PrintToScreen(L"Failed to mount %s: %r\n", fs_entry_ptr->fs_name, Status);
-				FreePool(sb);
-				sb = NULL;
-				continue;
-			}
-		}
-
-		FreePool(sb);
-		sb = NULL;
-		detected_by_plugin = TRUE;
-
-		if (fs_entry_ptr->list_dir && mount_ctx) {
-			if (!Path)
-				Path = L"\\";
-			Status = fs_entry_ptr->list_dir(mount_ctx, Path);
-			if (EFI_ERROR(Status))
-				PrintToScreen(L"Failed to list directory %s: %r\n", Path, Status);
-		}
-
-		if (fs_entry_ptr->umount_fs && mount_ctx) {
-			fs_entry_ptr->umount_fs(mount_ctx);
-			mount_ctx = NULL;
-		}
-
-		if (detected_by_plugin)
-			break;
+mount_slice:
+	// Mount the slice, or reuse an existing mount of it.
+	Status = MountSlice(DiskHandle, BlockIo, SliceIndex, SliceLBA, SliceSize, &Mount);
+	if (EFI_ERROR(Status)) {
+		if (Status == EFI_NOT_FOUND)
+			PrintToScreen(L"No supported filesystem found at sd(%d,%d)\n", DriveIndex, SliceIndex);
+		else
+			PrintToScreen(L"Cannot mount sd(%d,%d): %r\n", DriveIndex, SliceIndex, Status);
+		goto cleanup;
 	}
 
-	// A filesystem was detected and listed by a plugin. Clean up and exit.
-	if (detected_by_plugin)
-		goto cleanup;
-	else {
-		PrintToScreen(L"No supported filesystem found at sd(%d,%d)\n", DriveIndex, SliceIndex);
-		goto cleanup;
+list_mount:
+	if (Mount->fs->list_dir) {
+		Status = Mount->fs->list_dir(Mount->mount_ctx, Path);
+		if (EFI_ERROR(Status))
+			PrintToScreen(L"Failed to list directory %s: %r\n", Path, Status);
 	}
 
+	goto cleanup;
+
 open_volume:
 	if (!SimpleFileSystem) {
 		PrintToScreen(L"No valid Simple File System protocol context exists!\n");
@@ -403,7 +400,7 @@ open_volume:
 	}
 
 	BufferSize = SIZE_OF_EFI_FILE_INFO + 512;
-	FileInfo = AllocatePool(BufferSize);
+	FileInfo = CmdArenaAlloc(BufferSize);
 	if (!FileInfo) {
 		PrintToScreen(L"Failed to allocate memory to list directory\n");
 		goto cleanup;
@@ -437,15 +434,7 @@ open_volume:
 	}
 
 cleanup:
-	if (sb)
-		FreePool(sb);
-
-	if (FileInfo)
-		FreePool(FileInfo);
-
-	if (Partitions)
-		FreePool(Partitions);
-
+	// Partitions, Vtoc and FileInfo live in the command arena.
 	if (Dir)
 		uefi_call_wrapper(Dir->Close, 1, Dir);
 
@@ -454,9 +443,6 @@ cleanup:
 
 	if (HandleBuffer)
 		FreePool(HandleBuffer);
-
-	if (Vtoc)
-		FreePool(Vtoc);
 }
 
 void
@@ -500,6 +486,37 @@ lsblk(CHAR16 *args)
 	uefi_call_wrapper(BS->FreePool, 1, HandleBuffer);
 }
 
+void
+meminfo(CHAR16 *args)
+{
+	struct arena_stats Arena;
+	struct mem_region Largest;
+	const struct mem_region *Regions;
+	UINTN NumFree;
+	BOOLEAN All = args && StrCmp(args, L"all") == 0;
+
+	if (args && *args != L'\0' && !All) {
+		PrintToScreen(L"Usage: meminfo [all]\n");
+		return;
+	}
+
+	HeapReport(All);
+
+	MemMapRefresh();
+	if (MemMapLargestFree(&Largest)) {
+		NumFree = MemMapFreeRegions(&Regions);
+		PrintToScreen(L"\nFree memory:   %lu MB in %lu regions, largest %lu MB at 0x%lx\n",
+			MemMapTotal(EfiConventionalMemory) / (1024 * 1024), NumFree,
+			Largest.Pages * EFI_PAGE_SIZE / (1024 * 1024), Largest.Start);
+	}
+
+	ArenaGetStats(&Arena);
+	PrintToScreen(L"\nLoader arena:  %lu KB in use, %lu KB peak, %lu KB reserved\n",
+		Arena.InUse / 1024, Arena.Peak / 1024, Arena.Reserved / 1024);
+	PrintToScreen(L"Command arena: %lu KB peak, %lu KB reserved\n",
+		Arena.CmdPeak / 1024, Arena.CmdReserved / 1024);
+}
+
 void
 pconf(CHAR16 *args)
 {
@@ -519,6 +536,10 @@ pconf(CHAR16 *args)
         Cfg.UefiConsoleFlag ? L"YES" : L"NO");
     PrintToScreen(L"5: Serial port for communication:         0x%02x (%u)\n", Cfg.SerialPort, Cfg.SerialPort);
     PrintToScreen(L"6-9: Serial port baud rate:               0x%08x (%u)\n", Cfg.SerialBaudRate, Cfg.SerialBaudRate);
+    PrintToScreen(L"10: Use built-in FAT32 driver:            0x%02x (%s)\n", Cfg.NativeFatFlag,
+        Cfg.NativeFatFlag ? L"YES" : L"NO");
+    PrintToScreen(L"11: zstd window limit (log2, 0=default):  0x%02x (%u)\n", Cfg.ZstdWindowLog,
+        Cfg.ZstdWindowLog ? Cfg.ZstdWindowLog : ZstdMaxWindowLog);
 
     return;
 }
@@ -572,14 +593,17 @@ sconf(CHAR16 *args)
     if (field_num != CFG_FIELD_NOMENU &&
         field_num != CFG_FIELD_UEFI_CONSOLE &&
         field_num != CFG_FIELD_SERIAL_PORT &&
-        field_num != CFG_FIELD_SERIAL_BAUD) {
-        PrintToScreen(L"Invalid field. Valid fields are: %d=NoMenu, %d=UefiConsole, %d=SerialPort, %d=SerialBaud\n",
-            CFG_FIELD_NOMENU, CFG_FIELD_UEFI_CONSOLE, CFG_FIELD_SERIAL_PORT, CFG_FIELD_SERIAL_BAUD);
+        field_num != CFG_FIELD_SERIAL_BAUD &&
+        field_num != CFG_FIELD_NATIVE_FAT &&
+        field_num != CFG_FIELD_ZSTD_WINDOW) {
+        PrintToScreen(L"Invalid field. Valid fields are: %d=NoMenu, %d=UefiConsole, %d=SerialPort, %d=SerialBaud, %d=NativeFat, %d=ZstdWindow\n",
+            CFG_FIELD_NOMENU, CFG_FIELD_UEFI_CONSOLE, CFG_FIELD_SERIAL_PORT, CFG_FIELD_SERIAL_BAUD, CFG_FIELD_NATIVE_FAT,
+            CFG_FIELD_ZSTD_WINDOW);
         return;
     }
 
     /* Validate value ranges per-field */
-    if (field_num == CFG_FIELD_NOMENU || field_num == CFG_FIELD_UEFI_CONSOLE) {
+    if (field_num == CFG_FIELD_NOMENU || field_num == CFG_FIELD_UEFI_CONSOLE || field_num == CFG_FIELD_NATIVE_FAT) {
         if (value_num != 0 && value_num != 1) {
             PrintToScreen(L"Invalid value. Must be 0 or 1 for this field.\n");
             return;
@@ -594,6 +618,11 @@ sconf(CHAR16 *args)
             PrintToScreen(L"Invalid value. Baud rate out of range.\n");
             return;
         }
+    } else if (field_num == CFG_FIELD_ZSTD_WINDOW) {
+        if (value_num != 0 && (value_num < 10 || value_num > 31)) {
+            PrintToScreen(L"Invalid value. zstd window log must be 0 or 10-31.\n");
+            return;
+        }
     }
 
     ConfigField = (UINT8)field_num;
@@ -604,6 +633,125 @@ sconf(CHAR16 *args)
         PrintToScreen(L"Failed to write configuration: %r\n", Status);
 }
 
+/*
+ * Function trace control for trace builds. "trace dump" sends the ring
+ * over the serial download port; see host/tracesym.
+ */
+void
+trace(CHAR16 *args)
+{
+	EFI_STATUS Status;
+
+	if (!args || *args == L'\0') {
+		TraceStatus();
+	} else if (StrCmp(args, L"dump") == 0) {
+		PrintToScreen(L"Sending trace on serial port %u...\n", SerialDownloadPort);
+		Status = TraceDump();
+		if (EFI_ERROR(Status))
+			PrintToScreen(L"trace: dump failed: %r\n", Status);
+	} else if (StrCmp(args, L"clear") == 0) {
+		TraceReset();
+	} else {
+		PrintToScreen(L"Usage: trace [dump|clear]\n");
+	}
+}
+
+/*
+ * Load a zstd dictionary from the boot volume for compressed images that
+ * were made with one, or drop it with "zdict off".
+ */
+void
+zdict(CHAR16 *args)
+{
+	EFI_STATUS Status;
+	EFI_LOADED_IMAGE *LoadedImage;
+	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *SimpleFs;
+	EFI_FILE_HANDLE Root = NULL, File = NULL;
+	EFI_FILE_INFO *Info;
+	VOID *Buf = NULL;
+	UINTN Size, Got, Len;
+
+	if (!args || *args == L'\0') {
+		if (ZstdDictionaryId())
+			PrintToScreen(L"zstd dictionary %u loaded.\n", ZstdDictionaryId());
+		else
+			PrintToScreen(L"No zstd dictionary loaded.\n");
+		return;
+	}
+	if (StrCmp(args, L"off") == 0) {
+		ZstdSetDictionary(NULL, 0);
+		return;
+	}
+
+	Status = uefi_call_wrapper(BS->HandleProtocol, 3, gImageHandle, &LoadedImageProtocol, (void **)&LoadedImage);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Failed to get LoadedImage protocol: %r\n", Status);
+		return;
+	}
+
+	Status = uefi_call_wrapper(BS->HandleProtocol, 3, LoadedImage->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (void **)&SimpleFs);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Failed to get SimpleFileSystem protocol: %r\n", Status);
+		return;
+	}
+
+	Status = uefi_call_wrapper(SimpleFs->OpenVolume, 2, SimpleFs, &Root);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot open filesystem volume: %r\n", Status);
+		return;
+	}
+
+	Status = uefi_call_wrapper(Root->Open, 5, Root, &File, args, EFI_FILE_MODE_READ, 0);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot open file %s: %r\n", args, Status);
+		goto cleanup;
+	}
+
+	Len = SIZE_OF_EFI_FILE_INFO + 512;
+	Info = AllocatePool(Len);
+	if (!Info) {
+		PrintToScreen(L"Failed to allocate memory for file info\n");
+		goto cleanup;
+	}
+	Status = uefi_call_wrapper(File->GetInfo, 4, File, &gEfiFileInfoGuid, &Len, Info);
+	Size = EFI_ERROR(Status) ? 0 : (UINTN)Info->FileSize;
+	FreePool(Info);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot get file info for %s: %r\n", args, Status);
+		goto cleanup;
+	}
+
+	Buf = AllocatePool(Size ? Size : 1);
+	if (!Buf) {
+		PrintToScreen(L"Failed to allocate memory for the dictionary\n");
+		goto cleanup;
+	}
+
+	for (Got = 0; Got < Size; Got += Len) {
+		Len = Size - Got;
+		Status = uefi_call_wrapper(File->Read, 3, File, &Len, (UINT8 *)Buf + Got);
+		if (!EFI_ERROR(Status) && Len == 0)
+			Status = EFI_END_OF_FILE;
+		if (EFI_ERROR(Status)) {
+			PrintToScreen(L"Cannot read file %s: %r\n", args, Status);
+			goto cleanup;
+		}
+	}
+
+	Status = ZstdSetDictionary(Buf, Size);
+	if (EFI_ERROR(Status))
+		PrintToScreen(L"Cannot use %s as a zstd dictionary: %r\n", args, Status);
+	else
+		PrintToScreen(L"zstd dictionary %u loaded.\n", ZstdDictionaryId());
+
+cleanup:
+	if (Buf)
+		FreePool(Buf);
+	if (File)
+		uefi_call_wrapper(File->Close, 1, File);
+	uefi_call_wrapper(Root->Close, 1, Root);
+}
+
 void
 print_revision(CHAR16 *args)
 {
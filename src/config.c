@@ -36,10 +36,12 @@
 
 #include "boot.h"
 #include "config.h"
+#include "decompress.h"
 #include "serial.h"
 
 BOOLEAN UseUefiConsole = FALSE;
 BOOLEAN NoMenuLoad = FALSE;
+BOOLEAN UseNativeFat = FALSE;
 
 static BOOLEAN ConfigFirstRun = FALSE;
 
@@ -122,6 +124,8 @@ WriteDefaultConfig(UINT8 *Buffer, UINT8 *OutBuffer, EFI_FILE_HANDLE RootFS, EFI_
     Dec.UefiConsoleFlag = FALSE;
     Dec.SerialPort = 0;
     Dec.SerialBaudRate = 115200;
+    Dec.NativeFatFlag = FALSE;
+    Dec.ZstdWindowLog = 0;
 
     Status = CheckSumConfig(&Dec, TRUE);
     if (EFI_ERROR(Status)) {
@@ -227,6 +231,8 @@ ReadConfig(const UINT16 *Path, struct ConfigFile *OutCfg)
 	PrintToScreen(L"Config file version:   0x%02x\n", DecryptedCfg.Version);
 	PrintToScreen(L"Serial port:           0x%02x\n", DecryptedCfg.SerialPort);
 	PrintToScreen(L"Serial port baud:      %u\n", DecryptedCfg.SerialBaudRate);
+	PrintToScreen(L"Native FAT flag:       0x%02x\n", DecryptedCfg.NativeFatFlag);
+	PrintToScreen(L"zstd window log:       %u\n", DecryptedCfg.ZstdWindowLog);
 #endif
 
     /*
@@ -237,6 +243,9 @@ ReadConfig(const UINT16 *Path, struct ConfigFile *OutCfg)
         UseUefiConsole = DecryptedCfg.UefiConsoleFlag ? TRUE : FALSE;
         SerialDownloadPort = DecryptedCfg.SerialPort;
         SerialBaud = DecryptedCfg.SerialBaudRate;
+        UseNativeFat = DecryptedCfg.NativeFatFlag ? TRUE : FALSE;
+        if (DecryptedCfg.ZstdWindowLog != 0)
+            ZstdMaxWindowLog = DecryptedCfg.ZstdWindowLog;
     }
 
     ConfigFirstRun = TRUE;
@@ -331,6 +340,16 @@ WriteConfig(UINT8 Field, UINT32 Value)
         case CFG_FIELD_SERIAL_BAUD:
             DecryptedCfg.SerialBaudRate = Value;
             break;
+        case CFG_FIELD_NATIVE_FAT:
+            DecryptedCfg.NativeFatFlag = Value ? TRUE : FALSE;
+            break;
+        case CFG_FIELD_ZSTD_WINDOW:
+            if (Value != 0 && (Value < 10 || Value > 31)) {
+                PrintToScreen(L"Invalid zstd window log. Valid values are 0 and 10-31.\n");
+                return EFI_INVALID_PARAMETER;
+            }
+            DecryptedCfg.ZstdWindowLog = (UINT8)Value;
+            break;
         case CFG_FIELD_CHKSUM:
         case CFG_FIELD_CHKSUM + 1:
         case CFG_FIELD_VERSION:
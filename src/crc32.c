@@ -0,0 +1,314 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * crc32.c
+ * CRC-32 (ISO-HDLC, as in gzip and zip) of decoder output.
+ *
+ * The decoders fold each span of output into the CRC while it is still in
+ * the cache, so the routine runs on hot data and should keep up with
+ * memory. Three are provided: carry-less multiply folding with PCLMULQDQ
+ * on x86_64, the CRC32 instructions of ARMv8, and slice-by-8 tables for
+ * everything else and for the short ends the others leave. The routine is
+ * picked once at startup and checked against the tables before use.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "decompress.h"
+
+#if defined(X86_64_BLD)
+#include <wmmintrin.h>
+#endif
+
+#define CRC32_POLY          0xEDB88320U     /* reflected 0x04C11DB7 */
+#define CRC32_CHECK_SIZE    300
+
+typedef UINT32 (*crc32_fn)(UINT32 Crc, const UINT8 *p, UINTN Len);
+
+/*
+ * The routines work on the CRC register, i.e. the complement of the
+ * value callers see; Crc32() does the complementing.
+ */
+static UINT32 Crc32Table[8][256];
+
+static VOID
+crc32_tables(VOID)
+{
+    UINT32 c;
+    UINTN i, k;
+
+    for (i = 0; i < 256; i++) {
+        c = (UINT32)i;
+        for (k = 0; k < 8; k++)
+            c = (c >> 1) ^ (CRC32_POLY & (0U - (c & 1)));
+        Crc32Table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        c = Crc32Table[0][i];
+        for (k = 1; k < 8; k++) {
+            c = Crc32Table[0][c & 0xFF] ^ (c >> 8);
+            Crc32Table[k][i] = c;
+        }
+    }
+}
+
+/* Eight bytes per step; all the targets are little-endian. */
+static UINT32
+crc32_slice8(UINT32 Crc, const UINT8 *p, UINTN Len)
+{
+    UINT64 v;
+
+    if (Crc32Table[0][1] == 0)
+        crc32_tables();
+
+    while (Len >= 8) {
+        __builtin_memcpy(&v, p, sizeof(v));
+        v ^= Crc;
+        Crc = Crc32Table[7][v & 0xFF] ^ Crc32Table[6][(v >> 8) & 0xFF] ^
+              Crc32Table[5][(v >> 16) & 0xFF] ^ Crc32Table[4][(v >> 24) & 0xFF] ^
+              Crc32Table[3][(v >> 32) & 0xFF] ^ Crc32Table[2][(v >> 40) & 0xFF] ^
+              Crc32Table[1][(v >> 48) & 0xFF] ^ Crc32Table[0][v >> 56];
+        p += 8;
+        Len -= 8;
+    }
+    while (Len--)
+        Crc = Crc32Table[0][(Crc ^ *p++) & 0xFF] ^ (Crc >> 8);
+    return Crc;
+}
+
+#if defined(X86_64_BLD)
+/*
+ * Fold four 128-bit lanes across each 64 bytes with carry-less multiplies,
+ * then the lanes into one, then Barrett-reduce that to 32 bits (Intel,
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"). The
+ * constants are x^n mod P for the fold distances, bit-reflected. Len must
+ * be a multiple of 16 and at least 64.
+ */
+static __attribute__((target("pclmul"))) UINT32
+crc32_fold_pclmul(UINT32 Crc, const UINT8 *p, UINTN Len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596ULL, 0x0154442BD4ULL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009EULL, 0x01751997D0ULL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163CD6124ULL);
+    const __m128i poly = _mm_set_epi64x(0x01F7011641ULL, 0x01DB710641ULL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), _mm_cvtsi32_si128((int)Crc));
+    x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+    x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+    x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+    p += 64;
+    Len -= 64;
+
+    x0 = k1k2;
+    while (Len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)p));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 48)));
+        p += 64;
+        Len -= 64;
+    }
+
+    // Four lanes into one, then any 16-byte blocks left over.
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+    while (Len >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+        p += 16;
+        Len -= 16;
+    }
+
+    // 128 bits to 64.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32.
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (UINT32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+static UINT32
+crc32_pclmul(UINT32 Crc, const UINT8 *p, UINTN Len)
+{
+    UINTN n;
+
+    if (Len >= 64) {
+        n = Len & ~(UINTN)15;
+        Crc = crc32_fold_pclmul(Crc, p, n);
+        p += n;
+        Len -= n;
+    }
+    return crc32_slice8(Crc, p, Len);
+}
+
+static BOOLEAN
+CpuHasPclmul(void)
+{
+    UINT32 Ecx;
+
+    AsmCpuid(1, 0, NULL, NULL, &Ecx, NULL);
+    return (Ecx & (1 << 1)) != 0;
+}
+#endif /* X86_64_BLD */
+
+#if defined(AARCH64_BLD)
+/*
+ * The ARMv8 CRC32 instructions use the gzip polynomial. Eight bytes per
+ * instruction; their latency is hidden by the loads of the next words.
+ */
+static UINT32
+crc32_armv8(UINT32 Crc, const UINT8 *p, UINTN Len)
+{
+    UINT64 v;
+
+    for (; Len && ((UINTN)p & 7); Len--)
+        __asm__ (".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r" (Crc) : "r" ((UINT32)*p++));
+    for (; Len >= 8; Len -= 8) {
+        v = *(const UINT64 *)p;
+        __asm__ (".arch_extension crc\n\tcrc32x %w0, %w0, %x1" : "+r" (Crc) : "r" (v));
+        p += 8;
+    }
+    for (; Len; Len--)
+        __asm__ (".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r" (Crc) : "r" ((UINT32)*p++));
+    return Crc;
+}
+
+static BOOLEAN
+CpuHasCrc32(void)
+{
+    UINT64 Isar0;
+
+    // ID_AA64ISAR0_EL1.CRC32 is nonzero when the instructions are implemented
+    __asm__ volatile ("mrs %0, id_aa64isar0_el1" : "=r" (Isar0));
+    return ((Isar0 >> 16) & 0xF) != 0;
+}
+#endif /* AARCH64_BLD */
+
+static crc32_fn Crc32Routine = crc32_slice8;
+static const CHAR16 *Crc32Name = L"slice-by-8";
+
+UINT32
+Crc32(UINT32 Crc, const VOID *Buffer, UINTN Length)
+{
+    return ~Crc32Routine(~Crc, Buffer, Length);
+}
+
+#if defined(X86_64_BLD) || defined(AARCH64_BLD)
+/*
+ * Compare a routine with the tables over every alignment and a range of
+ * lengths, crossing the 64-byte and 16-byte steps of the folding loop.
+ */
+static BOOLEAN
+Crc32SelfCheck(crc32_fn Fn)
+{
+    UINT8 Buf[CRC32_CHECK_SIZE];
+    UINTN Len, Off, i;
+
+    for (i = 0; i < CRC32_CHECK_SIZE; i++)
+        Buf[i] = (UINT8)(i * 13 + 5);
+
+    for (Len = 0; Len + 16 <= CRC32_CHECK_SIZE; Len += (Len < 160 ? 1 : 37)) {
+        for (Off = 0; Off < 16; Off++) {
+            if (Fn(~0U, Buf + Off, Len) != crc32_slice8(~0U, Buf + Off, Len))
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+#endif
+
+/*
+ * Select the CRC-32 routine for this CPU. Called once at startup.
+ */
+void
+InitCrc32(void)
+{
+    crc32_tables();
+
+#if defined(X86_64_BLD)
+    if (CpuHasPclmul()) {
+        if (Crc32SelfCheck(crc32_pclmul)) {
+            Crc32Routine = crc32_pclmul;
+            Crc32Name = L"PCLMULQDQ";
+        } else {
+            Crc32Name = L"slice-by-8 (PCLMULQDQ self-check failed)";
+        }
+    }
+#elif defined(AARCH64_BLD)
+    if (CpuHasCrc32()) {
+        if (Crc32SelfCheck(crc32_armv8)) {
+            Crc32Routine = crc32_armv8;
+            Crc32Name = L"ARMv8 CRC32";
+        } else {
+            Crc32Name = L"slice-by-8 (CRC32 self-check failed)";
+        }
+    }
+#endif
+}
+
+const CHAR16 *
+GetCrc32Name(void)
+{
+    return Crc32Name;
+}
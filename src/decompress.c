@@ -0,0 +1,323 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * decompress.c
+ * Glue between the deflate decoder in inflate.c and its callers, plus the
+ * zlib framing around it. Callers either have the whole compressed stream
+ * in memory (InflateBuffer) or feed it piecewise (InflateStream).
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "clock.h"
+#include "decompress.h"
+#include "inflate.h"
+
+#define ZLIB_CM_DEFLATE     8
+#define ZLIB_FLG_FDICT      0x20
+#define ADLER_BASE          65521
+#define ADLER_NMAX          5552    /* bytes before the sums must be reduced */
+
+/*
+ * State shared with inflate.c. The decoder reads through inptr and writes
+ * through outptr; the whole output buffer serves as its window.
+ */
+uch* volatile inbuf_end;
+uch* volatile inptr;
+uch* volatile outptr;
+uch* volatile outbuf_start;
+uch* volatile outbuf_end;
+volatile int inbuf_overrun;
+
+static UINTN InflateOverrun;    /* bytes fed past the end of the input */
+
+/* Set while InflateStream() runs. */
+static inflate_input_fn StreamInput;
+static inflate_progress_fn StreamProgress;
+static VOID *StreamContext;
+static EFI_STATUS StreamStatus;
+static UINTN StreamFed;
+static UINT32 *StreamCrc;       /* running CRC-32 of the output, if asked for */
+static uch *StreamCrcEnd;       /* end of the output it covers */
+
+/*
+ * Fold the output decoded since the last call into the running CRC-32
+ * while it is still in the cache. Everything below outptr is final; the
+ * decoder's wild copies only write beyond it.
+ */
+static void
+stream_crc(void)
+{
+    uch *end = outptr;
+
+    if (StreamCrc && end > StreamCrcEnd) {
+        *StreamCrc = Crc32(*StreamCrc, StreamCrcEnd, (UINTN)(end - StreamCrcEnd));
+        StreamCrcEnd = end;
+    }
+}
+
+/*
+ * Called when the decoder runs off the end of the input. A streaming
+ * caller is asked for the next piece first. Past the real end, the
+ * decoder may still look a few bytes ahead, so feed it zeros and let the
+ * caller decide from the final bit position whether that mattered. More
+ * zeros than the bit buffer holds cannot be look-ahead: the stream is
+ * truncated, and inbuf_overrun stops the decoder at its next symbol
+ * rather than let it decode zeros up to the end of the output.
+ */
+uch
+fill_inbuf(void)
+{
+    UINT8 *Buf;
+    UINTN Len;
+    EFI_STATUS Status;
+
+    if (StreamInput && StreamStatus == EFI_SUCCESS) {
+        stream_crc();
+        Status = StreamInput(StreamContext, &Buf, &Len);
+        if (!EFI_ERROR(Status) && Len > 0) {
+            StreamFed += Len;
+            inptr = Buf;
+            inbuf_end = Buf + Len;
+            return *inptr++;
+        }
+        StreamStatus = EFI_ERROR(Status) ? Status : EFI_END_OF_FILE;
+    }
+
+    if (++InflateOverrun > sizeof(bb))
+        inbuf_overrun = 1;
+    return 0;
+}
+
+void
+process_block(int error)
+{
+    if (error == 0)
+        stream_crc();
+    if (StreamProgress && error == 0)
+        StreamProgress(StreamContext, (UINTN)(outptr - outbuf_start));
+}
+
+/*
+ * InflateBuffer: decode one raw deflate stream. *InUsed, if given,
+ * receives the number of input bytes the stream occupied, so that a
+ * trailer following it can be found.
+ */
+EFI_STATUS
+InflateBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen, UINTN *InUsed)
+{
+    UINTN used;
+    int rc;
+
+    if (!In || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    inptr = (uch *)In;
+    inbuf_end = (uch *)In + InLen;
+    outptr = outbuf_start = (uch *)Out;
+    outbuf_end = (uch *)Out + OutSize;
+    InflateOverrun = 0;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    rc = inflate();
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+    if (rc != 0)
+        return EFI_COMPROMISED_DATA;
+
+    /* whole bytes still sitting in the bit buffer were not part of the stream */
+    used = (UINTN)(inptr - (uch *)In) + InflateOverrun - (bk >> 3);
+    if (used > InLen)
+        return EFI_COMPROMISED_DATA;
+
+    *OutLen = (UINTN)(outptr - (uch *)Out);
+    BootCounterAdd(BOOT_CTR_INFLATE_IN, used);
+    BootCounterAdd(BOOT_CTR_INFLATE_OUT, *OutLen);
+    if (InUsed)
+        *InUsed = used;
+    return EFI_SUCCESS;
+}
+
+/*
+ * InflateStream: decode one raw deflate stream whose input arrives in
+ * pieces from Input. The output goes straight to Out, which doubles as
+ * the decoder's window, so it must be one contiguous buffer. *Crc, if
+ * given, receives the CRC-32 of the output, summed a piece at a time as
+ * it is decoded rather than in a pass over it afterwards.
+ */
+EFI_STATUS
+InflateStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen, UINT32 *Crc)
+{
+    int rc;
+
+    if (!Input || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    StreamInput = Input;
+    StreamProgress = Progress;
+    StreamContext = Context;
+    StreamStatus = EFI_SUCCESS;
+    StreamFed = 0;
+    StreamCrc = Crc;
+    StreamCrcEnd = (uch *)Out;
+    if (Crc)
+        *Crc = 0;
+
+    inptr = inbuf_end = NULL;
+    outptr = outbuf_start = (uch *)Out;
+    outbuf_end = (uch *)Out + OutSize;
+    InflateOverrun = 0;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    rc = inflate();
+    stream_crc();
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+
+    StreamInput = NULL;
+    StreamProgress = NULL;
+    StreamContext = NULL;
+    StreamCrc = NULL;
+
+    *OutLen = (UINTN)(outptr - (uch *)Out);
+    BootCounterAdd(BOOT_CTR_INFLATE_IN, StreamFed);
+    BootCounterAdd(BOOT_CTR_INFLATE_OUT, *OutLen);
+
+    // A read error explains a bad stream better than the decoder can.
+    if (EFI_ERROR(StreamStatus) && StreamStatus != EFI_END_OF_FILE)
+        return StreamStatus;
+
+    // Zeros that were part of the stream, not just look-ahead, mean the
+    // input ended early.
+    if (rc != 0 || InflateOverrun > (bk >> 3))
+        return EFI_COMPROMISED_DATA;
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * InflateStreamTrailer: after a successful InflateStream(), read the Len
+ * bytes that follow the deflate stream, such as a gzip trailer. The
+ * decoder may already have read some of them ahead; the rest come from
+ * the last piece it was given, then from Input.
+ */
+EFI_STATUS
+InflateStreamTrailer(inflate_input_fn Input, VOID *Context, VOID *Buf, UINTN Len)
+{
+    UINT8 *p = Buf;
+    UINT8 *Piece;
+    UINTN ahead;
+    EFI_STATUS Status;
+
+    // Whole bytes in the bit buffer, less the zeros fed past the end.
+    ahead = bk >> 3;
+    ahead = ahead > InflateOverrun ? ahead - InflateOverrun : 0;
+    bb >>= bk & 7;
+    bk -= bk & 7;
+    while (Len > 0 && ahead > 0) {
+        *p++ = (UINT8)bb;
+        bb >>= 8;
+        bk -= 8;
+        ahead--;
+        Len--;
+    }
+
+    while (Len > 0) {
+        if (inptr == inbuf_end) {
+            Status = Input(Context, &Piece, &ahead);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (ahead == 0)
+                return EFI_END_OF_FILE;
+            inptr = Piece;
+            inbuf_end = Piece + ahead;
+        }
+        *p++ = *inptr++;
+        Len--;
+    }
+
+    return EFI_SUCCESS;
+}
+
+UINT32
+Adler32(UINT32 Adler, const VOID *Buffer, UINTN Length)
+{
+    const UINT8 *p = Buffer;
+    UINT32 a = Adler & 0xFFFF, b = Adler >> 16;
+    UINTN n;
+
+    while (Length) {
+        n = Length < ADLER_NMAX ? Length : ADLER_NMAX;
+        Length -= n;
+        while (n--) {
+            a += *p++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+
+    return (b << 16) | a;
+}
+
+/*
+ * ZlibDecompress: decode a zlib stream (RFC 1950), checking the header
+ * and the Adler-32 of the output.
+ */
+EFI_STATUS
+ZlibDecompress(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    const UINT8 *p = In;
+    EFI_STATUS Status;
+    UINTN used;
+    UINT32 check;
+
+    if (!In || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    if (InLen < 6 || (p[0] & 0x0F) != ZLIB_CM_DEFLATE || (p[0] >> 4) > 7 ||
+        ((p[0] << 8) | p[1]) % 31 != 0 || (p[1] & ZLIB_FLG_FDICT))
+        return EFI_COMPROMISED_DATA;
+
+    Status = InflateBuffer(p + 2, InLen - 6, Out, OutSize, OutLen, &used);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    p += 2 + used;
+    check = ((UINT32)p[0] << 24) | ((UINT32)p[1] << 16) | ((UINT32)p[2] << 8) | p[3];
+    if (check != Adler32(1, Out, *OutLen))
+        return EFI_CRC_ERROR;
+
+    return EFI_SUCCESS;
+}
@@ -44,6 +44,7 @@ static EFI_BLOCK_IO_PROTOCOL *InputBlockIo;
 static UINT32 InputMediaId;
 static UINT64 InputPos;
 static void *ScratchBuffer;
+static UINTN ScratchSize;
 
 EFI_STATUS
 FindSysVPartition(struct mbr_partition *Partitions, UINT32 *PartitionStart)
@@ -64,6 +65,24 @@ FindSysVPartition(struct mbr_partition *Partitions, UINT32 *PartitionStart)
 	return EFI_NOT_FOUND;
 }
 
+/*
+ * Return MBR partition 'Index' if it holds a Linux filesystem.
+ */
+EFI_STATUS
+FindLinuxPartition(struct mbr_partition *Partitions, UINT32 Index, UINT32 *PartitionStart, UINT32 *PartitionSize)
+{
+	if (!Partitions || !PartitionStart || !PartitionSize || Index > 3)
+		return EFI_INVALID_PARAMETER;
+
+	if (Partitions[Index].os_type != 0x83)	// 0x83 is Linux native (ext2/3/4).
+		return EFI_NOT_FOUND;
+
+	*PartitionStart = Partitions[Index].starting_lba;
+	*PartitionSize = Partitions[Index].size_in_lba;
+	PrintToScreen(L"Found Linux partition %u at LBA %u\n", Index, *PartitionStart);
+	return EFI_SUCCESS;
+}
+
 /*
  * Find the start of the partition list.
  */
@@ -111,8 +130,12 @@ GetPartitionData(EFI_BLOCK_IO_PROTOCOL *BlockIo, struct mbr_partition *Partition
 	return EFI_SUCCESS;
 }
 
+/*
+ * Find the DiskIndex'th whole disk. DiskHandle may be NULL if the caller
+ * does not need the handle.
+ */
 EFI_STATUS
-GetWholeDiskByIndex(UINTN DiskIndex, EFI_BLOCK_IO_PROTOCOL **DiskBio)
+GetWholeDiskByIndex(UINTN DiskIndex, EFI_BLOCK_IO_PROTOCOL **DiskBio, EFI_HANDLE *DiskHandle)
 {
     EFI_STATUS Status;
     EFI_HANDLE *Handles = NULL;
@@ -133,6 +156,8 @@ GetWholeDiskByIndex(UINTN DiskIndex, EFI_BLOCK_IO_PROTOCOL **DiskBio)
         if (!Bio->Media->LogicalPartition) {
             if (Found == DiskIndex) {
                 *DiskBio = Bio;
+                if (DiskHandle)
+                    *DiskHandle = Handles[i];
                 FreePool(Handles);
                 return EFI_SUCCESS;
             }
@@ -235,6 +260,8 @@ Found:
     PrintToScreen(L"ROM partition selected\n");
 
     InputFunction = ReadFromBlockIo;
+    // There is no name to go by; DoDownload() looks for compression magic.
+    ImageDeflated = FALSE;
 
     return TRUE;
 }
@@ -265,6 +292,20 @@ ReadFromBlockIo(UINT8 *Dest, UINTN *Length)
 
     UINTN AlignedSize = ALIGN_VALUE(ToRead + Offset, BlockSize);
 
+    /*
+     * Grow the bounce buffer to the largest request seen so far.
+     */
+    if (AlignedSize > ScratchSize) {
+        if (ScratchBuffer)
+            FreePool(ScratchBuffer);
+        ScratchBuffer = AllocatePool(AlignedSize);
+        if (!ScratchBuffer) {
+            ScratchSize = 0;
+            return EFI_OUT_OF_RESOURCES;
+        }
+        ScratchSize = AlignedSize;
+    }
+
 	// must be BlockSize-aligned
     Status = uefi_call_wrapper(InputBlockIo->ReadBlocks, 5, InputBlockIo, InputMediaId, Lba, AlignedSize, ScratchBuffer);
     if (EFI_ERROR(Status))
@@ -46,28 +46,267 @@
 #include <efilib.h>
 
 #include "boot.h"
+#include "clock.h"
+#include "decompress.h"
+#include "heap.h"
+#include "memmap.h"
 #include "zip.h"
 
-UINT8 Buffer[1024];
-
 BOOLEAN ImageZip = FALSE;
-BOOLEAN ImageDeflated = FALSE;
+BOOLEAN ImageDeflated = FALSE;     /* the name says compressed; a hint, see GetInnerCompression() */
 EFI_FILE_PROTOCOL *BootFile;
 UINTN FileSize = 0;
 UINTN LoadSize = 0;
 UINTN ImageReadProgress;
 UINTN ImageSize;
 
+/*
+ * The download buffer is allocated once the image size is known, rather
+ * than up front. It is placed at a 2 MB boundary above 1 MB, wherever the
+ * memory map has room. An image of unknown size spills into further
+ * DL_CHUNK_SIZE regions as data arrives; these are copied into one region
+ * once the transfer is complete.
+ */
+#define DL_ALIGN        (2 * 1024 * 1024)
+#define DL_MIN_ADDR     0x100000
+#define DL_CHUNK_SIZE   (8 * 1024 * 1024)
+
+struct dl_region DlRegions[DL_MAX_REGIONS];
+UINTN DlNumRegions;
+static UINTN DlCur;
+
+static EFI_STATUS
+AddDownloadRegion(UINTN Size)
+{
+    EFI_STATUS Status;
+    EFI_PHYSICAL_ADDRESS Addr;
+
+    if (DlNumRegions == DL_MAX_REGIONS)
+        return EFI_OUT_OF_RESOURCES;
+
+    Size = (Size + DL_ALIGN - 1) & ~(UINTN)(DL_ALIGN - 1);
+    Status = MemMapAllocatePages(DL_MIN_ADDR, Size, DL_ALIGN, EfiLoaderData, &Addr);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    DlRegions[DlNumRegions].Base = (UINT8 *)(UINTN)Addr;
+    DlRegions[DlNumRegions].Size = Size;
+    DlRegions[DlNumRegions].Used = 0;
+    if (DlNumRegions++ == 0) {
+#if _LP64
+        ActualDestinationAddress = (UINT64 *)(UINTN)Addr;
+#else
+        ActualDestinationAddress = (UINT32 *)(UINTN)Addr;
+#endif
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Size of the largest aligned piece of free memory above DL_MIN_ADDR, or
+ * zero if there is none.
+ */
+static UINTN
+LargestDownloadSpace(VOID)
+{
+    struct mem_region Largest;
+    EFI_PHYSICAL_ADDRESS Start, End;
+
+    if (!MemMapLargestFree(&Largest))
+        return 0;
+
+    Start = (MAX(Largest.Start, DL_MIN_ADDR) + DL_ALIGN - 1) & ~(UINT64)(DL_ALIGN - 1);
+    End = (Largest.Start + Largest.Pages * EFI_PAGE_SIZE) & ~(UINT64)(DL_ALIGN - 1);
+    if (End <= Start)
+        return 0;
+
+    return (UINTN)(End - Start);
+}
+
+/*
+ * Add a region of up to Size bytes: all of it if the memory map has room,
+ * otherwise the largest aligned piece that is left.
+ */
+static EFI_STATUS
+AddSpillRegion(UINTN Size, UINTN *Got)
+{
+    EFI_STATUS Status;
+    UINTN Largest;
+
+    Status = AddDownloadRegion(Size);
+    if (EFI_ERROR(Status)) {
+        Largest = LargestDownloadSpace();
+        if (Largest == 0)
+            return EFI_OUT_OF_RESOURCES;
+
+        Status = AddDownloadRegion(MIN(Largest, Size));
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    *Got = DlRegions[DlNumRegions - 1].Size;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Make room for an image of Size bytes (0 if unknown). The image has to
+ * end up contiguous at DestinationAddress(), so a known size must fit in
+ * one region; failing here saves transferring an image that could not be
+ * run. An image of unknown size starts in one DL_CHUNK_SIZE region, and
+ * whatever spills past it is joined up by CoalesceDownloadBuffer() once
+ * the image is in.
+ */
+EFI_STATUS
+ReserveDownloadBuffer(UINTN Size)
+{
+    EFI_STATUS Status;
+    UINTN Got;
+
+    /* Whatever an earlier attempt reserved may be the wrong size. */
+    ReleaseDownloadBuffer();
+
+    if (Size)
+        return AddDownloadRegion(Size);
+
+    Status = AddSpillRegion(DL_CHUNK_SIZE, &Got);
+    if (EFI_ERROR(Status))
+        ReleaseDownloadBuffer();
+
+    return Status;
+}
+
+VOID
+ReleaseDownloadBuffer(VOID)
+{
+    UINTN i;
+
+    for (i = 0; i < DlNumRegions; i++)
+        HeapFreePages((EFI_PHYSICAL_ADDRESS)(UINTN)DlRegions[i].Base, EFI_SIZE_TO_PAGES(DlRegions[i].Size));
+
+    DlNumRegions = 0;
+    DlCur = 0;
+    ActualDestinationAddress = NULL;
+}
+
+/*
+ * Reserve the largest free region as a single download region, for an
+ * image whose size is only known once it has been decoded. The unused
+ * part is given back with TrimDownloadBuffer().
+ */
+static EFI_STATUS
+ReserveLargestDownloadBuffer(VOID)
+{
+    UINTN Size;
+
+    ReleaseDownloadBuffer();
+
+    Size = LargestDownloadSpace();
+    if (Size == 0)
+        return EFI_OUT_OF_RESOURCES;
+
+    return AddDownloadRegion(Size);
+}
+
+static VOID
+TrimDownloadBuffer(UINTN Used)
+{
+    struct dl_region *R = &DlRegions[0];
+    UINTN Pages = MAX(EFI_SIZE_TO_PAGES(Used), 1);
+
+    if (DlNumRegions != 1 || Pages >= EFI_SIZE_TO_PAGES(R->Size))
+        return;
+
+    if (!EFI_ERROR(HeapTrimPages((EFI_PHYSICAL_ADDRESS)(UINTN)R->Base, EFI_SIZE_TO_PAGES(R->Size), Pages)))
+        R->Size = Pages * EFI_PAGE_SIZE;
+}
+
+/*
+ * Where the next Len (at most *Len) bytes of the image go. Moves on to
+ * the next region, allocating one if needed, when the current one fills.
+ */
+static EFI_STATUS
+NextDownloadSpace(UINT8 **Dest, UINTN *Len)
+{
+    EFI_STATUS Status;
+    struct dl_region *R;
+    UINTN Got;
+
+    while (DlCur < DlNumRegions && DlRegions[DlCur].Used == DlRegions[DlCur].Size)
+        DlCur++;
+
+    if (DlCur == DlNumRegions) {
+        Status = AddSpillRegion(DL_CHUNK_SIZE, &Got);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    R = &DlRegions[DlCur];
+    *Dest = R->Base + R->Used;
+    *Len = MIN(*Len, R->Size - R->Used);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Everything that runs the image reads it as one piece at
+ * DestinationAddress(), so an image that was spread over several regions
+ * is copied into a single one here. Fails if there is no free region
+ * large enough, and the buffer is left as it was.
+ */
+static EFI_STATUS
+CoalesceDownloadBuffer(VOID)
+{
+    EFI_STATUS Status;
+    EFI_PHYSICAL_ADDRESS Addr;
+    UINTN i, Total = 0, Size;
+    UINT8 *Base;
+
+    if (DlNumRegions <= 1)
+        return EFI_SUCCESS;
+
+    for (i = 0; i < DlNumRegions; i++)
+        Total += DlRegions[i].Used;
+
+    Size = (MAX(Total, 1) + DL_ALIGN - 1) & ~(UINTN)(DL_ALIGN - 1);
+    Status = MemMapAllocatePages(DL_MIN_ADDR, Size, DL_ALIGN, EfiLoaderData, &Addr);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    Base = (UINT8 *)(UINTN)Addr;
+    Total = 0;
+    for (i = 0; i < DlNumRegions; i++) {
+        CopyMem(Base + Total, DlRegions[i].Base, DlRegions[i].Used);
+        Total += DlRegions[i].Used;
+    }
+
+    ReleaseDownloadBuffer();
+    DlRegions[0].Base = Base;
+    DlRegions[0].Size = Size;
+    DlRegions[0].Used = Total;
+    DlNumRegions = 1;
+#if _LP64
+    ActualDestinationAddress = (UINT64 *)(UINTN)Addr;
+#else
+    ActualDestinationAddress = (UINT32 *)(UINTN)Addr;
+#endif
+
+    return EFI_SUCCESS;
+}
+
 static void
 InitInfo(struct ZipInfo *Zip)
 {
-    Zip->InBufSize = 0;
+    Zip->InBufSize = ZIP_INBUF_SIZE;
     Zip->FileBufR = 0;
 	Zip->FileBufW = 0;
 	Zip->FileBuf = NULL;
+	Zip->Filename = NULL;
 	Zip->ProcessedHeader = ZIP_HEADER_NOT_PROCESSED;
 	Zip->HeaderDone = 0;
 	Zip->OutBuf = NULL;
+	Zip->DataRemain = 0;
+	Zip->Pending = 0;
+	Zip->InputDone = FALSE;
 }
 
 static EFI_STATUS
@@ -76,7 +315,7 @@ Initialise(struct ZipInfo *Zip)
     EFI_STATUS Status;
 
     InitInfo(Zip);
-    Zip->FileBufSize = 4 * Zip->InBufSize;
+    Zip->FileBufSize = ZIP_RING_BLOCKS * Zip->InBufSize;
 
     Status = uefi_call_wrapper(gBS->AllocatePool, 3, EfiLoaderData, Zip->FileBufSize, (VOID **)&Zip->FileBuf);
     if (EFI_ERROR(Status)) {
@@ -97,75 +336,413 @@ static void
 CleanupZip(struct ZipInfo *Zip)
 {
     FreePool(Zip->FileBuf);
+    if (Zip->Filename)
+        FreePool(Zip->Filename);
 
     Zip->FileBuf = NULL;
+    Zip->Filename = NULL;
     Zip->OutBuf = NULL;
 }
 
+/*
+ * Unzip the first entry of a zip transfer into the download buffer. The
+ * local header gives the uncompressed size, so the buffer is reserved
+ * before any data is decoded; inflate() then pulls the compressed data
+ * through the ZipInfo ring and writes straight to DestinationAddress().
+ * Only the ring and the decoder's tables are needed besides the image.
+ */
 EFI_STATUS
 DoZipDownload(EFI_FILE_PROTOCOL *BootFile)
 {
     EFI_STATUS Status;
     struct ZipInfo Zip;
-    UINT8 *Dest;
-    UINTN Len;
+    UINTN OutLen = 0;
 
-    Zip.Remain = FileSize;
-    InitProgressBar(0, FileSize, "Unzipping image");
     Status = Initialise(&Zip);
     if (EFI_ERROR(Status))
         return Status;
 
-    while (Zip.Remain) {
-        Status = ReadBlockToBuffer(&Zip, BootFile);
-        if (EFI_ERROR(Status)) {
-            PrintToScreen(L"Unzip error!\n");
-            if (Zip.FileBufW - Zip.FileBufR == Zip.FileBufSize)
-                PrintToScreen(L"Check there is only one image in the zip file.\n");
-            goto error;
-        }
+    Status = ZipReadLocalHeader(&Zip);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot read zip header: %r\n", Status);
+        goto cleanup;
+    }
+
+    PrintToScreen(L"Unzipping %a: %u bytes -> %u bytes\n", Zip.Filename,
+        (UINTN)Zip.CompressedSize, (UINTN)Zip.UncompressedSize);
 
-        UpdateProgressBar(0, (FileSize - Zip.Remain));
+    // inflate() uses its output as the window, so it must be contiguous.
+    Status = ReserveDownloadBuffer(Zip.UncompressedSize);
+    if (!EFI_ERROR(Status) && DlNumRegions != 1) {
+        ReleaseDownloadBuffer();
+        Status = EFI_OUT_OF_RESOURCES;
+    }
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot allocate %u contiguous bytes for the image: %r\n",
+            (UINTN)Zip.UncompressedSize, Status);
+        goto cleanup;
     }
 
-error:
-    if (Zip.Remain || Status != EFI_SUCCESS) {
+    InitProgressBar(0, FileSize, "UNZIP");
+    Status = ZipExtract(&Zip, DestinationAddress(), DlRegions[0].Size, &OutLen);
+    if (EFI_ERROR(Status)) {
         PrintToScreen(L"Unzip failed! Exit reason: %r\n", Status);
         goto cleanup;
-    } else
-        PrintToScreen(L"Unzip complete!\n");
+    }
 
-    Dest = Buffer;
-    Len = sizeof(Buffer);
+    DlRegions[0].Used = OutLen;
+    ImageSize = OutLen;
 
-    Status = ReadInputData(Dest, &Len);
-    if (Status != EFI_END_OF_FILE)
-        return Status;
+    Status = ZipDrain(&Zip);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Error reading the end of the zip file: %r\n", Status);
+        goto cleanup;
+    }
 
-cleanup:
-    gBS->Stall(20000);
+    PrintToScreen(L"Unzip complete!\n");
 
+cleanup:
     CleanupZip(&Zip);
+    return Status;
+}
+
+/*
+ * Deflated images are either gzip (RFC 1952) members or raw deflate
+ * streams. A raw stream cannot start with the gzip magic: 0x1f would be
+ * a final block of the reserved type 3.
+ */
+#define GZIP_ID1            0x1f
+#define GZIP_ID2            0x8b
+#define GZIP_CM_DEFLATE     8
+#define GZIP_FHCRC          0x02
+#define GZIP_FEXTRA         0x04
+#define GZIP_FNAME          0x08
+#define GZIP_FCOMMENT       0x10
+#define GZIP_FRESERVED      0xE0
+#define GZIP_HDR_SIZE       10
+#define GZIP_TRAILER_SIZE   8
+#define GZIP_GET32(p)       ((UINT32)(p)[0] | ((UINT32)(p)[1] << 8) | ((UINT32)(p)[2] << 16) | ((UINT32)(p)[3] << 24))
+
+#define COMPRESSED_INBUF_SIZE 0x4000
+
+struct compressed_input {
+    UINT8 *Buf;
+    UINTN Len;              /* bytes in Buf */
+    UINTN Pos;              /* bytes of Buf already used */
+    UINTN Read;             /* bytes read from the input so far */
+    BOOLEAN InputDone;      /* the input has reported its end */
+};
+
+/*
+ * Read the next piece of the image into the input buffer. The progress
+ * bar follows the compressed bytes read.
+ */
+static EFI_STATUS
+CompressedFill(struct compressed_input *In)
+{
+    EFI_STATUS Status;
+    UINTN Len;
+
+    if (In->InputDone)
+        return EFI_END_OF_FILE;
+
+    Len = COMPRESSED_INBUF_SIZE;
+    Status = ReadInputData(In->Buf, &Len);
+    if (EFI_ERROR(Status) && Status != EFI_END_OF_FILE)
+        return Status;
+
+    if (Len > COMPRESSED_INBUF_SIZE)
+        Len = COMPRESSED_INBUF_SIZE;
+    if (Status == EFI_END_OF_FILE || Len == 0)
+        In->InputDone = TRUE;
+
+    In->Len = Len;
+    In->Pos = 0;
+    In->Read += Len;
+    ImageReadProgress += Len;
+    BootCounterAdd(BOOT_CTR_DOWNLOAD, Len);
+    if (FileSize > 0)
+        UpdateProgressBar(0, In->Read);
+
+    return Len ? EFI_SUCCESS : EFI_END_OF_FILE;
+}
+
+/* inflate_input_fn: hand the decoder the rest of the input buffer. */
+static EFI_STATUS
+CompressedInput(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct compressed_input *In = Context;
+    EFI_STATUS Status;
+
+    if (In->Pos == In->Len) {
+        Status = CompressedFill(In);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    *Buf = In->Buf + In->Pos;
+    *Len = In->Len - In->Pos;
+    In->Pos = In->Len;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+CompressedGetByte(struct compressed_input *In, UINT8 *Byte)
+{
+    EFI_STATUS Status;
+
+    if (In->Pos == In->Len) {
+        Status = CompressedFill(In);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    *Byte = In->Buf[In->Pos++];
+    return EFI_SUCCESS;
+}
+
+/*
+ * Skip a gzip member header, leaving the input at the deflate data. The
+ * optional header CRC is skipped rather than checked; the trailer covers
+ * what matters.
+ */
+static EFI_STATUS
+GzipReadHeader(struct compressed_input *In)
+{
+    EFI_STATUS Status;
+    UINT8 Hdr[GZIP_HDR_SIZE];
+    UINT8 c;
+    UINTN i, Skip;
+
+    for (i = 0; i < sizeof(Hdr); i++) {
+        Status = CompressedGetByte(In, &Hdr[i]);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    if (Hdr[0] != GZIP_ID1 || Hdr[1] != GZIP_ID2 || Hdr[2] != GZIP_CM_DEFLATE ||
+        (Hdr[3] & GZIP_FRESERVED))
+        return EFI_UNSUPPORTED;
+
+    // The optional fields follow in the order EXTRA, NAME, COMMENT, HCRC.
+    Skip = 0;
+    if (Hdr[3] & GZIP_FEXTRA) {
+        for (i = 0; i < 2; i++) {
+            Status = CompressedGetByte(In, &c);
+            if (EFI_ERROR(Status))
+                return Status;
+            Skip |= (UINTN)c << (8 * i);
+        }
+    }
+    while (Skip--) {
+        Status = CompressedGetByte(In, &c);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    // The name and comment are zero terminated.
+    for (i = 0; i < 2; i++) {
+        if (!(Hdr[3] & (i == 0 ? GZIP_FNAME : GZIP_FCOMMENT)))
+            continue;
+        do {
+            Status = CompressedGetByte(In, &c);
+            if (EFI_ERROR(Status))
+                return Status;
+        } while (c != 0);
+    }
+
+    if (Hdr[3] & GZIP_FHCRC) {
+        for (i = 0; i < 2; i++) {
+            Status = CompressedGetByte(In, &c);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+    }
+
     return EFI_SUCCESS;
 }
 
+/*
+ * Decode a gzip member or raw deflate stream into the download buffer,
+ * checking a gzip trailer's CRC-32, summed during decoding, and length
+ * against the output.
+ */
+static EFI_STATUS
+DeflateDecode(struct compressed_input *In, UINTN *OutLen)
+{
+    EFI_STATUS Status;
+    UINT8 Trailer[GZIP_TRAILER_SIZE];
+    BOOLEAN Gzip;
+    UINT32 Crc;
+
+    *OutLen = 0;
+
+    Gzip = In->Len - In->Pos >= 2 && In->Buf[In->Pos] == GZIP_ID1 && In->Buf[In->Pos + 1] == GZIP_ID2;
+    if (Gzip) {
+        Status = GzipReadHeader(In);
+        if (EFI_ERROR(Status)) {
+            PrintToScreen(L"Bad gzip header: %r\n", Status);
+            return Status;
+        }
+    }
+
+    Status = InflateStream(CompressedInput, NULL, In, DestinationAddress(), DlRegions[0].Size, OutLen,
+        Gzip ? &Crc : NULL);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Inflate failed after %u bytes: %r\n", *OutLen, Status);
+        return Status;
+    }
+
+    if (!Gzip)
+        return EFI_SUCCESS;
+
+    Status = InflateStreamTrailer(CompressedInput, In, Trailer, sizeof(Trailer));
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot read the gzip trailer: %r\n", Status);
+        return Status;
+    }
+
+    if (Crc != GZIP_GET32(Trailer)) {
+        PrintToScreen(L"gzip CRC-32 mismatch: %08x, expected %08x\n", Crc, GZIP_GET32(Trailer));
+        return EFI_CRC_ERROR;
+    }
+    if ((UINT32)*OutLen != GZIP_GET32(Trailer + 4)) {
+        PrintToScreen(L"gzip length mismatch: %u bytes, expected %u\n", *OutLen, GZIP_GET32(Trailer + 4));
+        return EFI_CRC_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Tell a compressed image by the magic at its start: an LZ4 or zstd
+ * frame, an xz stream or a gzip member. Raw deflate has no magic; only
+ * the image name can say that an image is raw deflate.
+ */
+static BOOLEAN
+IsCompressedImage(const UINT8 *Buf, UINTN Len)
+{
+    return (Len >= 2 && Buf[0] == GZIP_ID1 && Buf[1] == GZIP_ID2) ||
+        (Len >= 4 && (IsLz4(Buf) || IsZstd(Buf))) || (Len >= 6 && IsXz(Buf));
+}
+
+/*
+ * Decode a compressed image from the input straight into the download
+ * buffer. 'In' holds the first piece of the image, already read to tell
+ * its format. LZ4, zstd, xz and gzip are told apart by their magic, and
+ * anything else is taken to be raw deflate. None of these formats has to
+ * give the decoded size up front, and every decoder needs its output in
+ * one piece, so the largest free region is reserved and then trimmed to
+ * the image once it has been decoded.
+ */
+static EFI_STATUS
+DoCompressedDownload(struct compressed_input *In)
+{
+    EFI_STATUS Status;
+    UINTN OutLen = 0;
+
+    if (FileSize > 0) {
+        InitProgressBar(0, FileSize, "UNPACK");
+        UpdateProgressBar(0, In->Read);
+    }
+
+    if (In->Len == 0) {
+        PrintToScreen(L"The compressed image is empty.\n");
+        return EFI_END_OF_FILE;
+    }
+
+    Status = ReserveLargestDownloadBuffer();
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot allocate a buffer to decompress into: %r\n", Status);
+        return Status;
+    }
+
+    if (In->Len >= 4 && IsLz4(In->Buf)) {
+        Status = Lz4Stream(CompressedInput, NULL, In, DestinationAddress(), DlRegions[0].Size, &OutLen);
+        if (EFI_ERROR(Status))
+            PrintToScreen(L"LZ4 decode failed after %u bytes: %r\n", OutLen, Status);
+    } else if (In->Len >= 4 && IsZstd(In->Buf)) {
+        Status = ZstdStream(CompressedInput, NULL, In, DestinationAddress(), DlRegions[0].Size, &OutLen);
+        if (EFI_ERROR(Status))
+            PrintToScreen(L"zstd decode failed after %u bytes: %r\n", OutLen, Status);
+        if (Status == EFI_NOT_FOUND)
+            PrintToScreen(L"The image needs a dictionary; load it with 'zdict'.\n");
+        else if (Status == EFI_UNSUPPORTED)
+            PrintToScreen(L"The image's window is over the configured limit.\n");
+    } else if (In->Len >= 6 && IsXz(In->Buf)) {
+        Status = XzStream(CompressedInput, NULL, In, DestinationAddress(), DlRegions[0].Size, &OutLen);
+        if (EFI_ERROR(Status))
+            PrintToScreen(L"xz decode failed after %u bytes: %r\n", OutLen, Status);
+        if (Status == EFI_UNSUPPORTED)
+            PrintToScreen(L"The image uses a filter this build does not decode.\n");
+    } else {
+        Status = DeflateDecode(In, &OutLen);
+    }
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    TrimDownloadBuffer(OutLen);
+    DlRegions[0].Used = OutLen;
+    ImageSize = OutLen;
+
+    // Let the input source see the end of the transfer too.
+    while (!In->InputDone) {
+        Status = CompressedFill(In);
+        if (Status == EFI_END_OF_FILE)
+            break;
+        if (EFI_ERROR(Status))
+            goto fail;
+    }
+
+    PrintToScreen(L"Decompressed %u bytes to %u.\n", In->Read, OutLen);
+    return EFI_SUCCESS;
+
+fail:
+    ReleaseDownloadBuffer();
+    return Status;
+}
+
+/*
+ * Take a hint from the image name that a transfer that is not a zip is
+ * compressed. DoDownload() goes by the magic in the first bytes of the
+ * image, and only falls back on the hint when there is none, which makes
+ * the hint the one way to load a raw deflate image.
+ */
 EFI_STATUS
-DoDeflateDownload(void)
+GetInnerCompression(const CHAR16 *Name)
 {
+    static const CHAR16 *Suffixes[] = { L".gz", L".gzip", L".deflate", L".lz4", L".zst", L".zstd", L".xz" };
+    UINTN i, Len, SufLen;
+
+    ImageDeflated = FALSE;
+    if (!Name)
+        return EFI_SUCCESS;
+
+    Len = StrLen(Name);
+    for (i = 0; i < ARRAY_SIZE(Suffixes); i++) {
+        SufLen = StrLen(Suffixes[i]);
+        if (Len > SufLen && StrCmp((CHAR16 *)Name + Len - SufLen, (CHAR16 *)Suffixes[i]) == 0) {
+            ImageDeflated = TRUE;
+            break;
+        }
+    }
+
     return EFI_SUCCESS;
 }
 
 /*
  * DoDownload() is ultimatly called by all the download routines, it is
  * responsible for unzipping images as well as writing disk images to drives.
+ * Compressed images are told by the magic in their first bytes.
  */
 EFI_STATUS
 DoDownload(void)
 {
     EFI_STATUS Status;
+    struct compressed_input In;
     INTN BlockSize;
     UINTN Len;
-    UINT8 *Dest;
+    UINT8 *Dest, Tail;
 
     if (ImageZip) {
         PrintToScreen(L"Loading zip ...\n");
@@ -176,45 +753,103 @@ DoDownload(void)
         }
     } else {
         LoadSize = FileSize;
-        if (ImageDeflated) {
-            PrintToScreen(L"\n\nLoading deflated image...\n");
-            DoDeflateDownload();
-            PrintToScreen(L"Deflated image download complete.\n");
+
+        // The first piece of the image tells whether it is compressed.
+        In.Len = 0;
+        In.Pos = 0;
+        In.Read = 0;
+        In.InputDone = FALSE;
+        In.Buf = AllocatePool(COMPRESSED_INBUF_SIZE);
+        if (!In.Buf)
+            return EFI_OUT_OF_RESOURCES;
+
+        if (FileSize > 0)
+            InitProgressBar(0, FileSize, "LOAD");
+        Status = CompressedFill(&In);
+        if (EFI_ERROR(Status) && Status != EFI_END_OF_FILE) {
+            PrintToScreen(L"Cannot read the image: %r\n", Status);
+            goto out;
+        }
+
+        if (IsCompressedImage(In.Buf, In.Len) || ImageDeflated) {
+            PrintToScreen(L"\n\nLoading compressed image...\n");
+            Status = DoCompressedDownload(&In);
+            if (EFI_ERROR(Status)) {
+                PrintToScreen(L"\nFailed to download compressed image: %r\n", Status);
+                goto out;
+            }
+            PrintToScreen(L"Compressed image download complete.\n");
         } else {
             ImageSize = LoadSize;
-            Dest = DestinationAddress();
+            Status = ReserveDownloadBuffer(FileSize);
+            if (EFI_ERROR(Status)) {
+                PrintToScreen(L"Cannot allocate download buffer for %u bytes: %r\n", FileSize, Status);
+                goto out;
+            }
             if (FileSize == 0)
                 BlockSize = 0x1000;
             else
                 BlockSize = MAX(0x1000, FileSize >> 8);
             BlockSize = (BlockSize + 0xfff) &~ 0xfff;
-            if (FileSize > 0)
-                InitProgressBar(0, FileSize, "LOAD");
             Status = EFI_SUCCESS;
 
             while (Status == EFI_SUCCESS) {
-                Len = BlockSize;
-                Status = ReadInputData(Dest, &Len);
-                if (Status != EFI_SUCCESS && Status != EFI_END_OF_FILE)
+                if (In.Pos == In.Len && (In.InputDone || (FileSize > 0 && ImageReadProgress >= FileSize))) {
+                    // The whole image is in; only let the input see the end.
+                    Len = 0;
+                    Status = In.InputDone ? EFI_END_OF_FILE : ReadInputData(&Tail, &Len);
+                    if (Status == EFI_SUCCESS)
+                        Status = EFI_END_OF_FILE;
                     break;
-                Dest += Len;
-                ImageReadProgress += Len;
+                }
+                Len = BlockSize;
+                Status = NextDownloadSpace(&Dest, &Len);
+                if (EFI_ERROR(Status)) {
+                    PrintToScreen(L"Error: Out of download space after %u bytes.\n", ImageReadProgress);
+                    goto out;
+                }
+                if (In.Pos < In.Len) {
+                    // The piece read to tell the format is already counted.
+                    Len = MIN(Len, In.Len - In.Pos);
+                    CopyMem(Dest, In.Buf + In.Pos, Len);
+                    In.Pos += Len;
+                } else {
+                    Status = ReadInputData(Dest, &Len);
+                    if (Status != EFI_SUCCESS && Status != EFI_END_OF_FILE)
+                        break;
+                    ImageReadProgress += Len;
+                    BootCounterAdd(BOOT_CTR_DOWNLOAD, Len);
+                }
+                DlRegions[DlCur].Used += Len;
                 if (FileSize > 0)
                     UpdateProgressBar(0, ImageReadProgress);
             }
 
             if (Status != EFI_END_OF_FILE) {
                 PrintToScreen(L"Error: Premature EOF. %u bytes read.\n", ImageReadProgress);
-                return Status;
+                goto out;
             } else
                 PrintToScreen(L"Loaded %d bytes.\n", ImageReadProgress);
 
-            if (ImageReadProgress < LoadSize)
+            if (LoadSize == 0 || ImageReadProgress < LoadSize)
                 ImageSize = ImageReadProgress;
+
+            Status = CoalesceDownloadBuffer();
+            if (EFI_ERROR(Status)) {
+                PrintToScreen(L"Error: The %u byte image does not fit contiguously in memory: %r\n",
+                    ImageReadProgress, Status);
+                ReleaseDownloadBuffer();
+                goto out;
+            }
         }
+        FreePool(In.Buf);
     }
 
     PrintToScreen(L"Booting Image...\n");
 
     return EFI_SUCCESS;
+
+out:
+    FreePool(In.Buf);
+    return Status;
 }
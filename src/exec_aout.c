@@ -40,6 +40,9 @@
 
 #include "aout.h"
 #include "boot.h"
+#include "bootperf.h"
+#include "clock.h"
+#include "heap.h"
 
 BOOLEAN
 IsAOut(UINT8 *Header)
@@ -114,7 +117,7 @@ LoadAOutBinary(EFI_FILE_HANDLE File)
     /* Allocate pages to hold the image */
     Pages = EFI_SIZE_TO_PAGES(TotalMem);
     AllocAddr = 0;
-    Status = uefi_call_wrapper(gBS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, Pages, &AllocAddr);
+    Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, Pages, &AllocAddr);
     if (EFI_ERROR(Status)) {
         PrintToScreen(L"Failed to allocate pages for a.out image: %r\n", Status);
         return EFI_LOAD_ERROR;
@@ -129,6 +132,7 @@ LoadAOutBinary(EFI_FILE_HANDLE File)
             PrintToScreen(L"Failed to read text segment: %r\n", Status);
             goto fail;
         }
+        BootCounterAdd(BOOT_CTR_FILE_READ, ReadSize);
     }
 
     /* Read data segment */
@@ -139,6 +143,7 @@ LoadAOutBinary(EFI_FILE_HANDLE File)
             PrintToScreen(L"Failed to read data segment: %r\n", Status);
             goto fail;
         }
+        BootCounterAdd(BOOT_CTR_FILE_READ, ReadSize);
     }
 
     /* Zero BSS */
@@ -162,6 +167,11 @@ LoadAOutBinary(EFI_FILE_HANDLE File)
         else
             EntryAddr = (UINTN)exec.a_entry;
 
+        BootPhaseEnd(BOOT_PHASE_LOAD);
+        Status = PublishBootPerf();
+        if (EFI_ERROR(Status))
+            PrintToScreen(L"Cannot publish boot performance table: %r\n", Status);
+
         /* Jump to entry */
         void (*Entry)(void) = (void (*)(void))(UINTN)EntryAddr;
         Entry();
@@ -171,6 +181,6 @@ LoadAOutBinary(EFI_FILE_HANDLE File)
 
 fail:
     if (AllocAddr != 0 && Pages != 0)
-        uefi_call_wrapper(gBS->FreePages, 2, AllocAddr, Pages);
+        HeapFreePages(AllocAddr, Pages);
     return EFI_LOAD_ERROR;
 }
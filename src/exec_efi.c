@@ -35,6 +35,8 @@
 #include <efilib.h>
 
 #include "boot.h"
+#include "bootperf.h"
+#include "clock.h"
 
 typedef struct {
     UINT16 e_magic;     /* "MZ" */
@@ -98,7 +100,8 @@ IsEfiBinary(const void *Buffer)
 }
 
 EFI_STATUS
-LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHandle, CHAR16 *ProgArgs)
+LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHandle, CHAR16 *ProgArgs,
+    VOID *SourceBuffer, UINTN SourceSize)
 {
 	EFI_STATUS Status;
 	EFI_HANDLE Image;
@@ -113,9 +116,9 @@ LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHand
 		return EFI_NOT_FOUND;
 	}
 
-	// Load the file.
+	// Load the file, or the image already decoded from it.
 	Status = uefi_call_wrapper(gST->BootServices->LoadImage,
-		6, FALSE, gImageHandle, FilePath, NULL, 0, &Image);
+		6, FALSE, gImageHandle, FilePath, SourceBuffer, SourceSize, &Image);
 
 	FreePool(FilePath);
 
@@ -138,6 +141,11 @@ LoadEfiBinary(CHAR16 *Path, EFI_LOADED_IMAGE *LoadedImage, EFI_HANDLE DeviceHand
         }
     }
 
+	BootPhaseEnd(BOOT_PHASE_LOAD);
+	Status = PublishBootPerf();
+	if (EFI_ERROR(Status))
+		PrintToScreen(L"Cannot publish boot performance table: %r\n", Status);
+
 	Status = uefi_call_wrapper(gBS->StartImage, 3, Image, NULL, NULL);
 	if (EFI_ERROR(Status)) {
 		PrintToScreen(L"Failed to start image (%r)\n", Status);
@@ -43,7 +43,11 @@
 #include <limits.h>
 
 #include "boot.h"
+#include "bootperf.h"
+#include "clock.h"
 #include "fatelf.h"
+#include "heap.h"
+#include "memmap.h"
 
 #if defined(X86_64_BLD) || defined(__x86_64__)
 static Elf64_Half ArchNum = EM_X86_64;
@@ -211,7 +215,7 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
         seg_offset_in_page = (UINTN)(Ph->p_vaddr & (EFI_PAGE_SIZE - 1));
         Pages = EFI_SIZE_TO_PAGES((UINTN)Ph->p_memsz + seg_offset_in_page);
         AllocAddr = 0;
-        Status = uefi_call_wrapper(gBS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, Pages, &AllocAddr);
+        Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, Pages, &AllocAddr);
         if (EFI_ERROR(Status)) {
             PrintToScreen(L"Failed to allocate pages for segment: %r\n", Status);
             goto fail;
@@ -226,6 +230,7 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
             Status = EFI_LOAD_ERROR;
             goto fail;
         }
+        BootCounterAdd(BOOT_CTR_FILE_READ, ReadSize);
 
         /* Zero BSS (memsz - filesz) */
         if (Ph->p_memsz > Ph->p_filesz)
@@ -236,7 +241,16 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
     uefi_call_wrapper(gBS->FreePool, 1, Phdrs);
     Phdrs = NULL;
 
+    /* The image is in place; what follows is handing over the machine. */
+    BootPhaseEnd(BOOT_PHASE_LOAD);
+
+    /* Install this before taking the memory map; it allocates. */
+    Status = PublishBootPerf();
+    if (EFI_ERROR(Status))
+        PrintToScreen(L"Cannot publish boot performance table: %r\n", Status);
+
     /* Exit EFI boot services. */
+    BootPhaseBegin(BOOT_PHASE_EXIT_BS);
     {
         EFI_STATUS es;
         EFI_MEMORY_DESCRIPTOR *MemMap = NULL;
@@ -246,24 +260,10 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
 
         /* Loop to handle races where the memory map changes */
         for (attempts = 0; attempts < 5; attempts++) {
-            es = uefi_call_wrapper(gBS->GetMemoryMap, 5, &MapSize, MemMap, &MapKey, &DescSize, &DescVersion);
-            if (es == EFI_BUFFER_TOO_SMALL) {
-                /* (Re)allocate buffer with some slack */
-                if (MemMap)
-                    uefi_call_wrapper(gBS->FreePool, 1, MemMap);
-                MapSize += 2 * DescSize;
-                es = uefi_call_wrapper(gBS->AllocatePool, 3, EfiLoaderData, MapSize, (VOID **)&MemMap);
-                if (EFI_ERROR(es)) {
-                    PrintToScreen(L"Failed to allocate memory for memory map: %r\n", es);
-                    goto fail;
-                }
-                /* Try again to fill buffer */
-                es = uefi_call_wrapper(gBS->GetMemoryMap, 5, &MapSize, MemMap, &MapKey, &DescSize, &DescVersion);
-            }
-
+            /* The map buffer is reused across attempts, so this does not allocate. */
+            es = MemMapGetRaw(&MemMap, &MapSize, &MapKey, &DescSize, &DescVersion);
             if (EFI_ERROR(es)) {
                 PrintToScreen(L"GetMemoryMap failed: %r\n", es);
-                if (MemMap) { uefi_call_wrapper(gBS->FreePool, 1, MemMap); MemMap = NULL; }
                 goto fail;
             }
 
@@ -273,7 +273,6 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
 
             /* If ExitBootServices failed we need to retry (map likely changed). */
             PrintToScreen(L"ExitBootServices failed (attempt %d): %r\n", attempts + 1, es);
-            /* Keep the current MemMap buffer and loop to get updated map again */
         }
         if (attempts == 5) {
             PrintToScreen(L"ExitBootServices failed after retries\n");
@@ -281,6 +280,9 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
         }
     }
 
+    BootPhaseEnd(BOOT_PHASE_EXIT_BS);
+    FinishBootPerf();
+
     /* Jump to entry. */
     void (*Entry)(void) = (void (*)(void))(UINTN)Ehdr.e_entry;
     Entry();
@@ -288,6 +290,7 @@ LoadElfBinary(EFI_HANDLE ImageHandle, EFI_FILE_HANDLE File)
     return EFI_SUCCESS;
 
 fail:
+    BootPhaseEnd(BOOT_PHASE_EXIT_BS);
     if (Phdrs)
         uefi_call_wrapper(gBS->FreePool, 1, Phdrs);
     return EFI_LOAD_ERROR;
@@ -0,0 +1,1477 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ext4.c
+ * Read-only ext2/ext3/ext4 filesystem plugin.
+ *
+ * A file's block map or extent tree is turned into a list of physical
+ * runs when it is opened, so reads transfer whole runs straight into the
+ * caller's buffer. The inode table location of every group is cached at
+ * mount time, and hashed directories are searched through their htree
+ * index instead of block by block.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "ext4.h"
+
+#define EXT4_MAX_DIRSIZE    (64 * 1024 * 1024)
+#define EXT4_PATH_MAX       4096
+
+/*
+ * In-memory file handle.
+ */
+struct ext4_file {
+    EFI_FILE_PROTOCOL File;
+    struct ext4_mount *mnt;
+    struct ext4_run *runs;      /* physical runs of the file */
+    UINTN nruns;
+    UINTN maxruns;
+    UINTN run;                  /* run holding the last block read */
+    UINT64 size;                /* file size in bytes */
+    UINT64 pos;                 /* current file position */
+    UINT8 *bounce;              /* one block, for partial and unaligned reads */
+    CHAR16 name[EXT4_NAME_LEN + 1];     /* file name, for GetInfo */
+};
+
+static EFI_STATUS
+ext4_read_lbas(struct ext4_mount *mnt, UINT64 lba, UINTN count, VOID *buf)
+{
+    EFI_BLOCK_IO_PROTOCOL *bio = mnt->bio;
+
+    return uefi_call_wrapper(bio->ReadBlocks, 5, bio, bio->Media->MediaId, (UINT64)mnt->slice_start_lba + lba,
+        count * bio->Media->BlockSize, buf);
+}
+
+static EFI_STATUS
+ext4_read_blocks(struct ext4_mount *mnt, UINT64 blk, UINTN count, VOID *buf)
+{
+    return ext4_read_lbas(mnt, blk * mnt->lbasperblk, count * mnt->lbasperblk, buf);
+}
+
+static UINT64
+ext4_blocks_count(struct ext4_superblock *sb)
+{
+    UINT64 count = sb->s_blocks_count_lo;
+
+    if (sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT)
+        count |= (UINT64)sb->s_blocks_count_hi << 32;
+    return count;
+}
+
+EFI_STATUS
+DetectEXT4(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void)
+{
+    EFI_STATUS Status;
+    UINTN BlockSize = BlockIo->Media->BlockSize;
+    struct ext4_superblock *sb = (struct ext4_superblock *)sb_void;
+    UINTN off, count;
+    UINT32 blksize;
+    UINT8 *Buffer;
+
+    if (BlockSize == 0)
+        return EFI_UNSUPPORTED;
+
+    /* the superblock is 1 KiB at byte 1024, whatever the device block size */
+    off = EXT4_SB_OFFSET % BlockSize;
+    count = (off + sizeof(*sb) + BlockSize - 1) / BlockSize;
+
+    Buffer = AllocatePool(count * BlockSize);
+    if (!Buffer)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = uefi_call_wrapper(BlockIo->ReadBlocks, 5, BlockIo, BlockIo->Media->MediaId,
+        SliceStartLBA + EXT4_SB_OFFSET / BlockSize, count * BlockSize, Buffer);
+    if (EFI_ERROR(Status)) {
+        FreePool(Buffer);
+        return Status;
+    }
+
+    MemMove(sb, Buffer + off, sizeof(*sb));
+    FreePool(Buffer);
+
+    if (sb->s_magic != EXT4_SB_MAGIC)
+        return EFI_NOT_FOUND;
+
+    blksize = 1024 << (sb->s_log_block_size < 7 ? sb->s_log_block_size : 0);
+    if (sb->s_log_block_size > 6 || blksize % BlockSize != 0 || sb->s_blocks_per_group == 0 ||
+        sb->s_inodes_per_group == 0) {
+        PrintToScreen(L"Unsupported ext2/3/4 volume (%u byte blocks)\n", blksize);
+        return EFI_UNSUPPORTED;
+    }
+
+    if (sb->s_rev_level > 0) {
+        if (sb->s_feature_incompat & ~EXT4_FEATURE_INCOMPAT_SUPP) {
+            PrintToScreen(L"Unsupported ext4 features 0x%x\n", sb->s_feature_incompat & ~EXT4_FEATURE_INCOMPAT_SUPP);
+            return EFI_UNSUPPORTED;
+        }
+        if (sb->s_inode_size < EXT4_GOOD_OLD_INODE_SIZE || sb->s_inode_size > blksize ||
+            (sb->s_inode_size & (sb->s_inode_size - 1)) != 0) {
+            PrintToScreen(L"Error: Invalid ext4 inode size %u\n", sb->s_inode_size);
+            return EFI_VOLUME_CORRUPTED;
+        }
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * MountEXT4: read the group descriptor table in one request and keep the
+ * inode table location of each group.
+ */
+EFI_STATUS
+MountEXT4(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out)
+{
+    struct ext4_mount *mnt;
+    struct ext4_superblock *sb;
+    struct ext4_group_desc *gd;
+    EFI_STATUS Status;
+    UINT64 nblocks;
+    UINTN descsize, gdtblks, g;
+    UINT8 *gdt = NULL;
+
+    if (!sb_buffer || !mount_out)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = AllocateZeroPool(sizeof(*mnt));
+    if (!mnt)
+        return EFI_OUT_OF_RESOURCES;
+
+    MemMove(&mnt->sb, sb_buffer, sizeof(mnt->sb));
+    sb = &mnt->sb;
+
+    mnt->bio = BlockIo;
+    mnt->slice_start_lba = SliceStartLBA;
+    mnt->blksize = 1024 << sb->s_log_block_size;
+    mnt->lbasperblk = mnt->blksize / BlockIo->Media->BlockSize;
+    mnt->inode_size = sb->s_rev_level > 0 ? sb->s_inode_size : EXT4_GOOD_OLD_INODE_SIZE;
+    mnt->hash_unsigned = (sb->s_flags & EXT4_FLAGS_UNSIGNED_HASH) ? EXT4_DX_HASH_UNSIGNED : 0;
+
+    nblocks = ext4_blocks_count(sb);
+    if (nblocks <= sb->s_first_data_block) {
+        Status = EFI_VOLUME_CORRUPTED;
+        goto fail;
+    }
+    mnt->ngroups = (UINT32)((nblocks - sb->s_first_data_block + sb->s_blocks_per_group - 1) / sb->s_blocks_per_group);
+    if ((UINT64)mnt->ngroups * sb->s_inodes_per_group < sb->s_inodes_count) {
+        Status = EFI_VOLUME_CORRUPTED;
+        goto fail;
+    }
+
+    descsize = EXT4_MIN_DESC_SIZE;
+    if (sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT) {
+        descsize = sb->s_desc_size;
+        if (descsize < EXT4_MIN_DESC_SIZE || descsize > mnt->blksize || (descsize & (descsize - 1)) != 0) {
+            Status = EFI_VOLUME_CORRUPTED;
+            goto fail;
+        }
+    }
+
+    if (sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_RECOVER)
+        PrintToScreen(L"Warning: ext4 journal needs recovery, recent changes may be missing\n");
+
+    /* the descriptors follow the block holding the superblock */
+    gdtblks = ((UINTN)mnt->ngroups * descsize + mnt->blksize - 1) / mnt->blksize;
+    gdt = AllocatePool(gdtblks * mnt->blksize);
+    mnt->itable = AllocatePool(mnt->ngroups * sizeof(*mnt->itable));
+    mnt->iblock = AllocatePool(mnt->blksize);
+    if (!gdt || !mnt->itable || !mnt->iblock) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto fail;
+    }
+
+    Status = ext4_read_blocks(mnt, (UINT64)sb->s_first_data_block + 1, gdtblks, gdt);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot read ext4 group descriptors: %r\n", Status);
+        goto fail;
+    }
+
+    for (g = 0; g < mnt->ngroups; g++) {
+        gd = (struct ext4_group_desc *)(gdt + g * descsize);
+        mnt->itable[g] = gd->bg_inode_table_lo;
+        if (descsize >= sizeof(*gd))
+            mnt->itable[g] |= (UINT64)gd->bg_inode_table_hi << 32;
+    }
+
+    FreePool(gdt);
+    *mount_out = mnt;
+    return EFI_SUCCESS;
+
+fail:
+    if (gdt)
+        FreePool(gdt);
+    UmountEXT4(mnt);
+    return Status;
+}
+
+EFI_STATUS
+UmountEXT4(void *mount)
+{
+    struct ext4_mount *mnt = (struct ext4_mount *)mount;
+
+    if (!mnt)
+        return EFI_INVALID_PARAMETER;
+
+    if (mnt->itable)
+        FreePool(mnt->itable);
+    if (mnt->iblock)
+        FreePool(mnt->iblock);
+    FreePool(mnt);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read an inode. The last inode table block read is kept, so the inodes
+ * of one directory are usually found without further I/O.
+ */
+static EFI_STATUS
+ext4_read_inode(struct ext4_mount *mnt, UINT32 ino, struct ext4_inode *inode)
+{
+    EFI_STATUS Status;
+    UINT32 group, idx;
+    UINT64 off, blk;
+
+    if (ino == 0 || ino > mnt->sb.s_inodes_count)
+        return EFI_VOLUME_CORRUPTED;
+
+    group = (ino - 1) / mnt->sb.s_inodes_per_group;
+    idx = (ino - 1) % mnt->sb.s_inodes_per_group;
+    off = (UINT64)idx * mnt->inode_size;
+    blk = mnt->itable[group] + off / mnt->blksize;
+
+    if (blk != mnt->iblock_nr) {
+        Status = ext4_read_blocks(mnt, blk, 1, mnt->iblock);
+        if (EFI_ERROR(Status)) {
+            mnt->iblock_nr = 0;
+            return Status;
+        }
+        mnt->iblock_nr = blk;
+    }
+
+    CopyMem(inode, mnt->iblock + off % mnt->blksize, sizeof(*inode));
+    return EFI_SUCCESS;
+}
+
+static UINT64
+ext4_inode_size(struct ext4_inode *inode)
+{
+    return inode->i_size_lo | ((UINT64)inode->i_size_high << 32);
+}
+
+/*
+ * Append a run, merging it with the previous one when both the logical
+ * and the physical blocks follow on.
+ */
+static EFI_STATUS
+ext4_add_run(struct ext4_file *ef, UINT32 lblk, UINT32 count, UINT64 pblk)
+{
+    struct ext4_run *r, *runs;
+    UINTN max;
+
+    if (count == 0 || pblk == 0)
+        return EFI_SUCCESS;
+
+    if (ef->nruns > 0) {
+        r = &ef->runs[ef->nruns - 1];
+        if (lblk < r->lblk + r->count)
+            return EFI_VOLUME_CORRUPTED;
+        if (lblk == r->lblk + r->count && pblk == r->pblk + r->count) {
+            r->count += count;
+            return EFI_SUCCESS;
+        }
+    }
+
+    if (ef->nruns == ef->maxruns) {
+        max = ef->maxruns ? ef->maxruns * 2 : 8;
+        runs = ReallocatePool(ef->runs, ef->maxruns * sizeof(*runs), max * sizeof(*runs));
+        if (!runs)
+            return EFI_OUT_OF_RESOURCES;
+        ef->runs = runs;
+        ef->maxruns = max;
+    }
+
+    r = &ef->runs[ef->nruns++];
+    r->lblk = lblk;
+    r->count = count;
+    r->pblk = pblk;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Collect the extents of an extent tree node of 'size' bytes. Unwritten
+ * extents read as zeroes, so they are left out like holes.
+ */
+static EFI_STATUS
+ext4_extent_runs(struct ext4_file *ef, struct ext4_extent_header *eh, UINTN size, UINTN depth)
+{
+    struct ext4_mount *mnt = ef->mnt;
+    struct ext4_extent *ex;
+    struct ext4_extent_idx *ix;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT8 *buf;
+    UINTN i;
+
+    if (eh->eh_magic != EXT4_EXT_MAGIC || eh->eh_depth > depth ||
+        sizeof(*eh) + (UINTN)eh->eh_entries * sizeof(*ex) > size)
+        return EFI_VOLUME_CORRUPTED;
+
+    if (eh->eh_depth == 0) {
+        ex = (struct ext4_extent *)(eh + 1);
+        for (i = 0; i < eh->eh_entries && !EFI_ERROR(Status); i++, ex++) {
+            if (ex->ee_len > EXT4_EXT_INIT_MAX_LEN)
+                continue;
+            Status = ext4_add_run(ef, ex->ee_block, ex->ee_len, ex->ee_start_lo | ((UINT64)ex->ee_start_hi << 32));
+        }
+        return Status;
+    }
+
+    buf = AllocatePool(mnt->blksize);
+    if (!buf)
+        return EFI_OUT_OF_RESOURCES;
+
+    ix = (struct ext4_extent_idx *)(eh + 1);
+    for (i = 0; i < eh->eh_entries && !EFI_ERROR(Status); i++, ix++) {
+        Status = ext4_read_blocks(mnt, ix->ei_leaf_lo | ((UINT64)ix->ei_leaf_hi << 32), 1, buf);
+        if (!EFI_ERROR(Status))
+            Status = ext4_extent_runs(ef, (struct ext4_extent_header *)buf, mnt->blksize, eh->eh_depth - 1);
+    }
+
+    FreePool(buf);
+    return Status;
+}
+
+/*
+ * Collect the runs of an ext2/ext3 block map. 'level' is 0 for block
+ * numbers, 1 for indirect blocks and so on; '*lblk' is the logical block
+ * mapped by ptrs[0], and the walk stops at 'nblocks'.
+ */
+static EFI_STATUS
+ext4_map_runs(struct ext4_file *ef, const UINT32 *ptrs, UINTN nptrs, UINTN level, UINT64 *lblk, UINT64 nblocks)
+{
+    struct ext4_mount *mnt = ef->mnt;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT64 span = 1;
+    UINT32 *buf = NULL;
+    UINTN i, l, per = mnt->blksize / sizeof(UINT32);
+
+    for (l = 0; l < level; l++)
+        span *= per;
+
+    for (i = 0; i < nptrs && *lblk < nblocks && !EFI_ERROR(Status); i++) {
+        if (ptrs[i] == 0) {
+            *lblk += span;
+            continue;
+        }
+
+        if (level == 0) {
+            Status = ext4_add_run(ef, (UINT32)*lblk, 1, ptrs[i]);
+            (*lblk)++;
+            continue;
+        }
+
+        if (!buf) {
+            buf = AllocatePool(mnt->blksize);
+            if (!buf)
+                return EFI_OUT_OF_RESOURCES;
+        }
+
+        Status = ext4_read_blocks(mnt, ptrs[i], 1, buf);
+        if (!EFI_ERROR(Status))
+            Status = ext4_map_runs(ef, buf, per, level - 1, lblk, nblocks);
+    }
+
+    if (buf)
+        FreePool(buf);
+    return Status;
+}
+
+static EFI_STATUS
+ext4_file_new(struct ext4_mount *mnt, struct ext4_inode *inode, struct ext4_file **ef_out)
+{
+    struct ext4_file *ef;
+    EFI_STATUS Status;
+    UINT64 lblk = 0, nblocks;
+    UINT32 map[15];
+
+    /* small files and directories stored inside the inode */
+    if (inode->i_flags & EXT4_INLINE_DATA_FL)
+        return EFI_UNSUPPORTED;
+
+    ef = AllocateZeroPool(sizeof(*ef));
+    if (!ef)
+        return EFI_OUT_OF_RESOURCES;
+
+    ef->mnt = mnt;
+    ef->size = ext4_inode_size(inode);
+    nblocks = (ef->size + mnt->blksize - 1) / mnt->blksize;
+    if (nblocks > 0xFFFFFFFF) {
+        Status = EFI_VOLUME_CORRUPTED;
+        goto fail;
+    }
+
+    if (inode->i_flags & EXT4_EXTENTS_FL) {
+        Status = ext4_extent_runs(ef, (struct ext4_extent_header *)inode->i_block, sizeof(inode->i_block),
+            EXT4_EXT_MAX_DEPTH);
+    } else {
+        CopyMem(map, inode->i_block, sizeof(map));
+        Status = ext4_map_runs(ef, map, EXT4_NDIR_BLOCKS, 0, &lblk, nblocks);
+        if (!EFI_ERROR(Status))
+            Status = ext4_map_runs(ef, &map[EXT4_IND_BLOCK], 1, 1, &lblk, nblocks);
+        if (!EFI_ERROR(Status))
+            Status = ext4_map_runs(ef, &map[EXT4_DIND_BLOCK], 1, 2, &lblk, nblocks);
+        if (!EFI_ERROR(Status))
+            Status = ext4_map_runs(ef, &map[EXT4_TIND_BLOCK], 1, 3, &lblk, nblocks);
+    }
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    *ef_out = ef;
+    return EFI_SUCCESS;
+
+fail:
+    if (ef->runs)
+        FreePool(ef->runs);
+    FreePool(ef);
+    return Status;
+}
+
+static void
+ext4_file_free(struct ext4_file *ef)
+{
+    if (ef->runs)
+        FreePool(ef->runs);
+    if (ef->bounce)
+        FreePool(ef->bounce);
+    FreePool(ef);
+}
+
+/*
+ * Read 'len' bytes at offset 'pos' of a file. Whole device blocks inside
+ * a run go straight to the caller's buffer in one transfer per run; holes
+ * are zero filled; the unaligned head and tail, and buffers that do not
+ * meet the device's IoAlign, go through the bounce buffer.
+ */
+static EFI_STATUS
+ext4_read(struct ext4_file *ef, UINT64 pos, UINT8 *out, UINTN len)
+{
+    struct ext4_mount *mnt = ef->mnt;
+    UINT32 bsize = mnt->bio->Media->BlockSize;
+    UINT32 ioalign = mnt->bio->Media->IoAlign;
+    struct ext4_run *r;
+    EFI_STATUS Status;
+    UINT64 lblk, off, avail, lba;
+    UINTN chunk, soff, n, left;
+
+    while (len > 0) {
+        lblk = pos / mnt->blksize;
+        if (ef->run >= ef->nruns || lblk < ef->runs[ef->run].lblk)
+            ef->run = 0;
+        while (ef->run < ef->nruns && lblk >= (UINT64)ef->runs[ef->run].lblk + ef->runs[ef->run].count)
+            ef->run++;
+
+        if (ef->run == ef->nruns || lblk < ef->runs[ef->run].lblk) {
+            /* hole, up to the next run */
+            chunk = len;
+            if (ef->run < ef->nruns && (UINT64)ef->runs[ef->run].lblk * mnt->blksize - pos < chunk)
+                chunk = (UINTN)((UINT64)ef->runs[ef->run].lblk * mnt->blksize - pos);
+            SetMem(out, chunk, 0);
+            goto next;
+        }
+
+        r = &ef->runs[ef->run];
+        off = pos - (UINT64)r->lblk * mnt->blksize;
+        avail = (UINT64)r->count * mnt->blksize - off;
+        chunk = len < avail ? len : (UINTN)avail;
+        lba = r->pblk * mnt->lbasperblk + off / bsize;
+        soff = off % bsize;
+
+        if (soff == 0 && chunk >= bsize && (ioalign <= 1 || ((UINTN)out & (ioalign - 1)) == 0)) {
+            n = chunk / bsize;
+            Status = ext4_read_lbas(mnt, lba, n, out);
+            if (EFI_ERROR(Status))
+                return Status;
+            chunk = n * bsize;
+        } else {
+            if (!ef->bounce) {
+                ef->bounce = AllocatePool(mnt->blksize);
+                if (!ef->bounce)
+                    return EFI_OUT_OF_RESOURCES;
+            }
+
+            /* up to the end of the filesystem block, or of the request */
+            left = mnt->lbasperblk - (off % mnt->blksize) / bsize;
+            n = (soff + chunk + bsize - 1) / bsize;
+            if (n > left)
+                n = left;
+            Status = ext4_read_lbas(mnt, lba, n, ef->bounce);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (chunk > n * bsize - soff)
+                chunk = n * bsize - soff;
+            CopyMem(out, ef->bounce + soff, chunk);
+        }
+
+next:
+        pos += chunk;
+        out += chunk;
+        len -= chunk;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read a whole directory into memory.
+ */
+static EFI_STATUS
+ext4_dir_load(struct ext4_mount *mnt, struct ext4_inode *inode, UINT8 **buf_out, UINTN *size_out)
+{
+    struct ext4_file *dir;
+    EFI_STATUS Status;
+    UINT8 *buf;
+
+    Status = ext4_file_new(mnt, inode, &dir);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    if (dir->size > EXT4_MAX_DIRSIZE)
+        dir->size = EXT4_MAX_DIRSIZE;
+
+    buf = AllocatePool(dir->size);
+    if (!buf) {
+        ext4_file_free(dir);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = ext4_read(dir, 0, buf, dir->size);
+    *size_out = dir->size;
+    ext4_file_free(dir);
+    if (EFI_ERROR(Status)) {
+        FreePool(buf);
+        return Status;
+    }
+
+    *buf_out = buf;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Return the next used directory entry at or after *off.
+ */
+static BOOLEAN
+ext4_dir_next(UINT8 *buf, UINTN size, UINTN *off, struct ext4_dirent **de_out)
+{
+    struct ext4_dirent *de;
+    UINTN reclen;
+
+    while (*off + EXT4_DIRENT_BASE <= size) {
+        de = (struct ext4_dirent *)(buf + *off);
+
+        /* 64 KiB blocks store a whole-block rec_len as 0 or 65535 */
+        reclen = de->rec_len;
+        if (reclen == 0 || reclen == 65535)
+            reclen = 65536;
+
+        if (reclen < EXT4_DIRENT_BASE || (reclen & 3) || *off + reclen > size ||
+            EXT4_DIRENT_BASE + de->name_len > reclen)
+            return FALSE;
+
+        *off += reclen;
+        if (de->inode != 0 && de->name_len != 0) {
+            *de_out = de;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*
+ * Convert a UTF-8 name to UCS-2. Bytes that are not valid UTF-8 are taken
+ * as Latin-1; characters outside the BMP become '?'.
+ */
+static void
+ext4_name_to_ucs2(const UINT8 *s, UINTN len, CHAR16 *out, UINTN max)
+{
+    UINTN i = 0, n = 0;
+    UINT8 c;
+
+    while (i < len && n < max) {
+        c = s[i];
+        if (c >= 0xC2 && c <= 0xDF && i + 1 < len && (s[i + 1] & 0xC0) == 0x80) {
+            out[n++] = ((c & 0x1F) << 6) | (s[i + 1] & 0x3F);
+            i += 2;
+        } else if (c >= 0xE0 && c <= 0xEF && i + 2 < len && (s[i + 1] & 0xC0) == 0x80 && (s[i + 2] & 0xC0) == 0x80) {
+            out[n++] = ((c & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+            i += 3;
+        } else if (c >= 0xF0 && c <= 0xF4 && i + 3 < len) {
+            out[n++] = L'?';
+            i += 4;
+        } else {
+            out[n++] = c;
+            i++;
+        }
+    }
+    out[n] = L'\0';
+}
+
+/*
+ * Convert a path component to UTF-8. Returns the length, or 0 if the name
+ * is longer than EXT4_NAME_LEN bytes.
+ */
+static UINTN
+ext4_name_to_utf8(const CHAR16 *s, UINTN len, UINT8 *out)
+{
+    UINTN i, n = 0;
+    CHAR16 c;
+
+    for (i = 0; i < len; i++) {
+        c = s[i];
+        if (c < 0x80) {
+            if (n + 1 > EXT4_NAME_LEN)
+                return 0;
+            out[n++] = c;
+        } else if (c < 0x800) {
+            if (n + 2 > EXT4_NAME_LEN)
+                return 0;
+            out[n++] = 0xC0 | (c >> 6);
+            out[n++] = 0x80 | (c & 0x3F);
+        } else {
+            if (n + 3 > EXT4_NAME_LEN)
+                return 0;
+            out[n++] = 0xE0 | (c >> 12);
+            out[n++] = 0x80 | ((c >> 6) & 0x3F);
+            out[n++] = 0x80 | (c & 0x3F);
+        }
+    }
+    return n;
+}
+
+/*
+ * htree name hashes, as computed by Linux. The signed variants treat name
+ * bytes as signed char, which is what filesystems created on x86 use.
+ */
+#define EXT4_ROL32(x, s)    (((x) << (s)) | ((x) >> (32 - (s))))
+
+static void
+ext4_str2hashbuf(const UINT8 *msg, UINTN len, UINT32 *buf, INTN num, BOOLEAN unsign)
+{
+    UINT32 pad, val;
+    UINTN i;
+
+    pad = (UINT32)len | ((UINT32)len << 8);
+    pad |= pad << 16;
+
+    val = pad;
+    if (len > (UINTN)num * 4)
+        len = num * 4;
+    for (i = 0; i < len; i++) {
+        val = (unsign ? (UINT32)msg[i] : (UINT32)(INT32)(INT8)msg[i]) + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+    if (--num >= 0)
+        *buf++ = val;
+    while (--num >= 0)
+        *buf++ = pad;
+}
+
+#define EXT4_MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define EXT4_MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define EXT4_MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define EXT4_MD4_ROUND(f, a, b, c, d, x, s) \
+    (a += f(b, c, d) + (x), a = EXT4_ROL32(a, s))
+#define EXT4_MD4_K2         013240474631U
+#define EXT4_MD4_K3         015666365641U
+
+static void
+ext4_half_md4(UINT32 buf[4], const UINT32 in[8])
+{
+    UINT32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    EXT4_MD4_ROUND(EXT4_MD4_F, a, b, c, d, in[0], 3);
+    EXT4_MD4_ROUND(EXT4_MD4_F, d, a, b, c, in[1], 7);
+    EXT4_MD4_ROUND(EXT4_MD4_F, c, d, a, b, in[2], 11);
+    EXT4_MD4_ROUND(EXT4_MD4_F, b, c, d, a, in[3], 19);
+    EXT4_MD4_ROUND(EXT4_MD4_F, a, b, c, d, in[4], 3);
+    EXT4_MD4_ROUND(EXT4_MD4_F, d, a, b, c, in[5], 7);
+    EXT4_MD4_ROUND(EXT4_MD4_F, c, d, a, b, in[6], 11);
+    EXT4_MD4_ROUND(EXT4_MD4_F, b, c, d, a, in[7], 19);
+
+    EXT4_MD4_ROUND(EXT4_MD4_G, a, b, c, d, in[1] + EXT4_MD4_K2, 3);
+    EXT4_MD4_ROUND(EXT4_MD4_G, d, a, b, c, in[3] + EXT4_MD4_K2, 5);
+    EXT4_MD4_ROUND(EXT4_MD4_G, c, d, a, b, in[5] + EXT4_MD4_K2, 9);
+    EXT4_MD4_ROUND(EXT4_MD4_G, b, c, d, a, in[7] + EXT4_MD4_K2, 13);
+    EXT4_MD4_ROUND(EXT4_MD4_G, a, b, c, d, in[0] + EXT4_MD4_K2, 3);
+    EXT4_MD4_ROUND(EXT4_MD4_G, d, a, b, c, in[2] + EXT4_MD4_K2, 5);
+    EXT4_MD4_ROUND(EXT4_MD4_G, c, d, a, b, in[4] + EXT4_MD4_K2, 9);
+    EXT4_MD4_ROUND(EXT4_MD4_G, b, c, d, a, in[6] + EXT4_MD4_K2, 13);
+
+    EXT4_MD4_ROUND(EXT4_MD4_H, a, b, c, d, in[3] + EXT4_MD4_K3, 3);
+    EXT4_MD4_ROUND(EXT4_MD4_H, d, a, b, c, in[7] + EXT4_MD4_K3, 9);
+    EXT4_MD4_ROUND(EXT4_MD4_H, c, d, a, b, in[2] + EXT4_MD4_K3, 11);
+    EXT4_MD4_ROUND(EXT4_MD4_H, b, c, d, a, in[6] + EXT4_MD4_K3, 15);
+    EXT4_MD4_ROUND(EXT4_MD4_H, a, b, c, d, in[1] + EXT4_MD4_K3, 3);
+    EXT4_MD4_ROUND(EXT4_MD4_H, d, a, b, c, in[5] + EXT4_MD4_K3, 9);
+    EXT4_MD4_ROUND(EXT4_MD4_H, c, d, a, b, in[0] + EXT4_MD4_K3, 11);
+    EXT4_MD4_ROUND(EXT4_MD4_H, b, c, d, a, in[4] + EXT4_MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+static void
+ext4_tea(UINT32 buf[4], const UINT32 in[4])
+{
+    UINT32 sum = 0, b0 = buf[0], b1 = buf[1];
+    UINTN n;
+
+    for (n = 0; n < 16; n++) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+        b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+    }
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+static UINT32
+ext4_dx_hash(struct ext4_mount *mnt, UINT8 version, const UINT8 *name, UINTN len)
+{
+    UINT32 buf[4] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476 };
+    UINT32 in[8], hash = 0, hash0 = 0x12A3FE2D, hash1 = 0x37ABE8F9;
+    BOOLEAN unsign = version >= EXT4_DX_HASH_UNSIGNED;
+    INT32 c;
+    UINTN i;
+
+    for (i = 0; i < 4; i++) {
+        if (mnt->sb.s_hash_seed[i]) {
+            CopyMem(buf, mnt->sb.s_hash_seed, sizeof(buf));
+            break;
+        }
+    }
+
+    switch (version % EXT4_DX_HASH_UNSIGNED) {
+    case EXT4_DX_HASH_LEGACY:
+        for (i = 0; i < len; i++) {
+            c = unsign ? (INT32)name[i] : (INT32)(INT8)name[i];
+            hash = hash1 + (hash0 ^ (UINT32)(c * 7152373));
+            if (hash & 0x80000000)
+                hash -= 0x7FFFFFFF;
+            hash1 = hash0;
+            hash0 = hash;
+        }
+        hash = hash0 << 1;
+        break;
+    case EXT4_DX_HASH_HALF_MD4:
+        for (i = 0; i < len; i += 32) {
+            ext4_str2hashbuf(name + i, len - i, in, 8, unsign);
+            ext4_half_md4(buf, in);
+        }
+        hash = buf[1];
+        break;
+    case EXT4_DX_HASH_TEA:
+        for (i = 0; i < len; i += 16) {
+            ext4_str2hashbuf(name + i, len - i, in, 4, unsign);
+            ext4_tea(buf, in);
+        }
+        hash = buf[0];
+        break;
+    }
+
+    hash &= ~1U;
+    if (hash == (0x7FFFFFFFU << 1))
+        hash = (0x7FFFFFFFU - 1) << 1;
+    return hash;
+}
+
+/*
+ * Search one directory block for 'name'.
+ */
+static BOOLEAN
+ext4_block_find(UINT8 *buf, UINTN size, const UINT8 *name, UINTN len, UINT32 *ino_out)
+{
+    struct ext4_dirent *de;
+    UINTN off = 0;
+
+    while (ext4_dir_next(buf, size, &off, &de)) {
+        if (de->name_len == len && CompareMem(de->name, name, len) == 0) {
+            *ino_out = de->inode;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Look 'name' up in a hashed directory. The index is descended to the
+ * one leaf block that can hold the name, so a lookup costs one read per
+ * index level plus one, whatever the size of the directory. Returns
+ * EFI_UNSUPPORTED for an index this reader does not understand, so the
+ * caller can fall back to a linear search.
+ */
+static EFI_STATUS
+ext4_dx_lookup(struct ext4_file *dir, const UINT8 *name, UINTN len, UINT32 *ino_out)
+{
+    struct ext4_mount *mnt = dir->mnt;
+    struct ext4_dx_root_info *info;
+    struct ext4_dx_countlimit *cl;
+    struct ext4_dx_entry *e[EXT4_DX_MAX_LEVELS];
+    UINT16 count[EXT4_DX_MAX_LEVELS], at[EXT4_DX_MAX_LEVELS];
+    UINTN levels, l, lo, hi, mid, hdr;
+    UINT8 version, *buf;
+    UINT32 hash, blk;
+    EFI_STATUS Status;
+
+    /* one block per index level, and one for the leaf */
+    buf = AllocatePool((EXT4_DX_MAX_LEVELS + 1) * mnt->blksize);
+    if (!buf)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = ext4_read(dir, 0, buf, mnt->blksize);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    /* "." and ".." take 12 bytes each in front of the root info */
+    info = (struct ext4_dx_root_info *)(buf + 24);
+    levels = info->indirect_levels + 1;
+    version = info->hash_version;
+    if (info->reserved_zero != 0 || info->info_length != sizeof(*info) || version > EXT4_DX_HASH_TEA ||
+        levels > ((mnt->sb.s_feature_incompat & EXT4_FEATURE_INCOMPAT_LARGEDIR) ? 3 : 2)) {
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    hash = ext4_dx_hash(mnt, version + mnt->hash_unsigned, name, len);
+
+    hdr = 24 + sizeof(*info);
+    for (l = 0; ; l++) {
+        cl = (struct ext4_dx_countlimit *)(buf + l * mnt->blksize + hdr);
+        e[l] = (struct ext4_dx_entry *)cl;
+        count[l] = cl->count;
+        if (count[l] == 0 || count[l] > cl->limit || hdr + (UINTN)cl->limit * sizeof(*e[l]) > mnt->blksize) {
+            Status = EFI_UNSUPPORTED;
+            goto out;
+        }
+
+        /* last entry whose hash is <= ours; entry 0 covers everything below entry 1 */
+        lo = 1;
+        hi = count[l];
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (e[l][mid].hash > hash)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        at[l] = lo - 1;
+
+descend:
+        blk = e[l][at[l]].block & 0x0FFFFFFF;
+        if ((UINT64)blk * mnt->blksize >= dir->size) {
+            Status = EFI_VOLUME_CORRUPTED;
+            goto out;
+        }
+
+        Status = ext4_read(dir, (UINT64)blk * mnt->blksize, buf + (l + 1) * mnt->blksize, mnt->blksize);
+        if (EFI_ERROR(Status))
+            goto out;
+
+        if (l + 1 < levels) {
+            /* interior node: a fake empty entry spanning the block, then entries */
+            hdr = EXT4_DIRENT_BASE;
+            continue;
+        }
+
+        if (ext4_block_find(buf + levels * mnt->blksize, mnt->blksize, name, len, ino_out)) {
+            Status = EFI_SUCCESS;
+            goto out;
+        }
+
+        /* the name may continue in the next leaf if its hash collided */
+        while (l != (UINTN)-1 && at[l] + 1 >= count[l])
+            l--;
+        if (l == (UINTN)-1 || (e[l][at[l] + 1].hash & ~1U) != hash) {
+            Status = EFI_NOT_FOUND;
+            goto out;
+        }
+        at[l]++;
+        for (; l + 1 < levels; l++) {
+            /* this level's block changed; restart the levels below at their first entry */
+            blk = e[l][at[l]].block & 0x0FFFFFFF;
+            if ((UINT64)blk * mnt->blksize >= dir->size) {
+                Status = EFI_VOLUME_CORRUPTED;
+                goto out;
+            }
+            Status = ext4_read(dir, (UINT64)blk * mnt->blksize, buf + (l + 1) * mnt->blksize, mnt->blksize);
+            if (EFI_ERROR(Status))
+                goto out;
+            cl = (struct ext4_dx_countlimit *)(buf + (l + 1) * mnt->blksize + EXT4_DIRENT_BASE);
+            e[l + 1] = (struct ext4_dx_entry *)cl;
+            count[l + 1] = cl->count;
+            at[l + 1] = 0;
+            if (count[l + 1] == 0 || count[l + 1] > cl->limit) {
+                Status = EFI_VOLUME_CORRUPTED;
+                goto out;
+            }
+        }
+        goto descend;
+    }
+
+out:
+    FreePool(buf);
+    return Status;
+}
+
+/*
+ * Find 'comp' (of 'len' characters) in a directory.
+ */
+static EFI_STATUS
+ext4_lookup(struct ext4_mount *mnt, struct ext4_inode *dinode, const CHAR16 *comp, UINTN len, UINT32 *ino_out)
+{
+    struct ext4_file *dir;
+    EFI_STATUS Status;
+    UINT8 name[EXT4_NAME_LEN];
+    UINT8 *buf = NULL;
+    UINTN n;
+    UINT64 pos;
+
+    n = ext4_name_to_utf8(comp, len, name);
+    if (n == 0)
+        return EFI_NOT_FOUND;
+
+    Status = ext4_file_new(mnt, dinode, &dir);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    /* case-folded directories hash a normalised name; search those linearly */
+    if ((mnt->sb.s_feature_compat & EXT4_FEATURE_COMPAT_DIR_INDEX) && (dinode->i_flags & EXT4_INDEX_FL) &&
+        !(dinode->i_flags & EXT4_CASEFOLD_FL)) {
+        Status = ext4_dx_lookup(dir, name, n, ino_out);
+        if (Status != EFI_UNSUPPORTED)
+            goto out;
+    }
+
+    buf = AllocatePool(mnt->blksize);
+    if (!buf) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto out;
+    }
+
+    Status = EFI_NOT_FOUND;
+    for (pos = 0; pos + mnt->blksize <= dir->size; pos += mnt->blksize) {
+        Status = ext4_read(dir, pos, buf, mnt->blksize);
+        if (EFI_ERROR(Status))
+            break;
+        if (ext4_block_find(buf, mnt->blksize, name, n, ino_out))
+            break;
+        Status = EFI_NOT_FOUND;
+    }
+
+out:
+    if (buf)
+        FreePool(buf);
+    ext4_file_free(dir);
+    return Status;
+}
+
+/*
+ * Build the path to continue a walk with after reaching a symbolic link:
+ * the link target, followed by the rest of the original path.
+ */
+static EFI_STATUS
+ext4_symlink_path(struct ext4_mount *mnt, struct ext4_inode *inode, const CHAR16 *rest, CHAR16 **path_out)
+{
+    struct ext4_file *ef;
+    EFI_STATUS Status;
+    UINT64 size = ext4_inode_size(inode);
+    UINTN max;
+    UINT8 *target;
+    CHAR16 *path;
+
+    if (size == 0 || size >= EXT4_PATH_MAX)
+        return EFI_NOT_FOUND;
+
+    target = AllocatePool(size);
+    if (!target)
+        return EFI_OUT_OF_RESOURCES;
+
+    /* short targets are stored in i_block itself */
+    if (size < sizeof(inode->i_block) && !(inode->i_flags & (EXT4_EXTENTS_FL | EXT4_INLINE_DATA_FL))) {
+        CopyMem(target, inode->i_block, size);
+    } else {
+        Status = ext4_file_new(mnt, inode, &ef);
+        if (EFI_ERROR(Status)) {
+            FreePool(target);
+            return Status;
+        }
+        Status = ext4_read(ef, 0, target, size);
+        ext4_file_free(ef);
+        if (EFI_ERROR(Status)) {
+            FreePool(target);
+            return Status;
+        }
+    }
+
+    max = size + 1 + StrLen(rest);
+    path = AllocatePool((max + 1) * sizeof(CHAR16));
+    if (!path) {
+        FreePool(target);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    ext4_name_to_ucs2(target, size, path, max);
+    FreePool(target);
+    if (*rest) {
+        StrCat(path, L"/");
+        StrCat(path, rest);
+    }
+
+    *path_out = path;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Walk 'path' from the root directory, following symbolic links. On
+ * success 'inode_out' holds the inode of the last component and
+ * 'name_out' (EXT4_NAME_LEN + 1 characters) its name.
+ */
+static EFI_STATUS
+ext4_walk(struct ext4_mount *mnt, const CHAR16 *path, struct ext4_inode *inode_out, CHAR16 *name_out)
+{
+    EFI_STATUS Status;
+    struct ext4_inode dir;
+    const CHAR16 *p = path;
+    CHAR16 *link = NULL, *next;
+    UINT32 ino;
+    UINTN len, nlinks = 0;
+
+    Status = ext4_read_inode(mnt, EXT4_ROOT_INO, inode_out);
+    if (EFI_ERROR(Status))
+        return Status;
+    StrCpy(name_out, L"\\");
+
+    while (*p == L'/' || *p == L'\\')
+        p++;
+
+    while (*p) {
+        for (len = 0; p[len] && p[len] != L'/' && p[len] != L'\\'; len++)
+            ;
+
+        if ((inode_out->i_mode & EXT4_S_IFMT) != EXT4_S_IFDIR || len > EXT4_NAME_LEN) {
+            Status = EFI_NOT_FOUND;
+            break;
+        }
+
+        CopyMem(&dir, inode_out, sizeof(dir));
+        Status = ext4_lookup(mnt, &dir, p, len, &ino);
+        if (!EFI_ERROR(Status))
+            Status = ext4_read_inode(mnt, ino, inode_out);
+        if (EFI_ERROR(Status))
+            break;
+
+        CopyMem(name_out, p, len * sizeof(CHAR16));
+        name_out[len] = L'\0';
+
+        p += len;
+        while (*p == L'/' || *p == L'\\')
+            p++;
+
+        if ((inode_out->i_mode & EXT4_S_IFMT) == EXT4_S_IFLNK) {
+            if (++nlinks > EXT4_SYMLINK_MAX) {
+                Status = EFI_NOT_FOUND;
+                break;
+            }
+
+            Status = ext4_symlink_path(mnt, inode_out, p, &next);
+            if (EFI_ERROR(Status))
+                break;
+            if (link)
+                FreePool(link);
+            link = next;
+            p = link;
+
+            /* absolute targets restart at the root, relative ones in 'dir' */
+            if (*p == L'/') {
+                Status = ext4_read_inode(mnt, EXT4_ROOT_INO, inode_out);
+                if (EFI_ERROR(Status))
+                    break;
+            } else {
+                CopyMem(inode_out, &dir, sizeof(dir));
+            }
+
+            while (*p == L'/' || *p == L'\\')
+                p++;
+        }
+    }
+
+    if (link)
+        FreePool(link);
+    return Status;
+}
+
+/*
+ * ReadEXT4Dir: list directory contents for the provided path.
+ */
+EFI_STATUS
+ReadEXT4Dir(void *mount_ctx, const CHAR16 *path)
+{
+    struct ext4_mount *mnt = (struct ext4_mount *)mount_ctx;
+    struct ext4_inode dir, inode;
+    struct ext4_dirent *de;
+    EFI_STATUS Status;
+    CHAR16 *name;
+    UINT8 *buf;
+    UINTN size, off = 0;
+
+    if (!mnt || !path)
+        return EFI_INVALID_PARAMETER;
+
+    name = AllocatePool((EXT4_NAME_LEN + 1) * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = ext4_walk(mnt, path, &dir, name);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"No such file or directory: %s\n", path);
+        goto out;
+    }
+
+    if ((dir.i_mode & EXT4_S_IFMT) != EXT4_S_IFDIR) {
+        PrintToScreen(L"Not a directory\n");
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    Status = ext4_dir_load(mnt, &dir, &buf, &size);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    PrintToScreen(L"Listing ext4 directory: %s\n", path);
+
+    while (ext4_dir_next(buf, size, &off, &de)) {
+        ext4_name_to_ucs2((UINT8 *)de->name, de->name_len, name, EXT4_NAME_LEN);
+        if (EFI_ERROR(ext4_read_inode(mnt, de->inode, &inode))) {
+            PrintToScreen(L"     ???    %s\n", name);
+            continue;
+        }
+
+        switch (inode.i_mode & EXT4_S_IFMT) {
+        case EXT4_S_IFDIR:
+            PrintToScreen(L"   <DIR>    %s\n", name);
+            break;
+        case EXT4_S_IFLNK:
+            PrintToScreen(L"  <LINK>    %s\n", name);
+            break;
+        default:
+            PrintToScreen(L"  <FILE>    %s  %lu bytes\n", name, ext4_inode_size(&inode));
+            break;
+        }
+    }
+
+    FreePool(buf);
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    struct ext4_file *ef = (struct ext4_file *)This;
+    EFI_STATUS Status;
+    UINTN to_read;
+
+    if (!This || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (ef->pos >= ef->size) {
+        *BufferSize = 0; /* EOF */
+        return EFI_SUCCESS;
+    }
+
+    to_read = *BufferSize;
+    if ((UINT64)to_read > ef->size - ef->pos)
+        to_read = (UINTN)(ef->size - ef->pos);
+
+    Status = ext4_read(ef, ef->pos, Buffer, to_read);
+    if (EFI_ERROR(Status)) {
+        *BufferSize = 0;
+        return Status;
+    }
+
+    ef->pos += to_read;
+    *BufferSize = to_read;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+    struct ext4_file *ef = (struct ext4_file *)This;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    /* UEFI uses (UINT64)-1 to set position to EOF */
+    if (Position == (UINT64)-1)
+        Position = ef->size;
+
+    if (Position > ef->size)
+        return EFI_INVALID_PARAMETER;
+
+    ef->pos = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct ext4_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    struct ext4_file *ef = (struct ext4_file *)This;
+
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+        return EFI_UNSUPPORTED;
+
+    return FillFileInfo(ef->name, ef->size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* only regular files are handed out */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_close(EFI_FILE_PROTOCOL *This)
+{
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    ext4_file_free((struct ext4_file *)This);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+ext4_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    ext4_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * OpenEXT4:
+ * - walk the path, following symbolic links
+ * - verify the target is a regular file
+ * - map the file to physical runs and create an in-memory file handle
+ */
+EFI_STATUS
+OpenEXT4(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
+    struct ext4_mount *mnt = mount_ctx;
+    struct ext4_file *ef;
+    struct ext4_inode inode;
+    EFI_STATUS Status;
+    CHAR16 *name;
+
+    if (!mnt || !filename || !file_out)
+        return EFI_INVALID_PARAMETER;
+
+    /* Only support read-only */
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_UNSUPPORTED;
+
+    name = AllocatePool((EXT4_NAME_LEN + 1) * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = ext4_walk(mnt, filename, &inode, name);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    if ((inode.i_mode & EXT4_S_IFMT) != EXT4_S_IFREG) {
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    Status = ext4_file_new(mnt, &inode, &ef);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    StrCpy(ef->name, name);
+
+    ef->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+    ef->File.Open = ext4_file_open;
+    ef->File.Close = ext4_file_close;
+    ef->File.Delete = ext4_file_delete;
+    ef->File.Read = ext4_file_read;
+    ef->File.Write = ext4_file_write;
+    ef->File.GetPosition = ext4_file_getpos;
+    ef->File.SetPosition = ext4_file_setpos;
+    ef->File.GetInfo = ext4_file_getinfo;
+    ef->File.SetInfo = ext4_file_setinfo;
+    ef->File.Flush = ext4_file_flush;
+
+    *file_out = &ef->File;
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+/*
+ * Directory iterator. The directory is read into memory once, when it is
+ * opened; the position is the byte offset of the next entry. Hash tree
+ * interior blocks read as unused entries and are skipped.
+ */
+struct ext4_dir {
+    struct ext4_mount *mnt;
+    UINT8 *buf;
+    UINTN size;
+    UINTN off;
+    CHAR16 name[EXT4_NAME_LEN + 1];
+};
+
+EFI_STATUS
+OpenEXT4Dir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct ext4_mount *mnt = mount_ctx;
+    struct ext4_inode inode;
+    struct ext4_dir *ed;
+    EFI_STATUS Status;
+
+    if (!mnt || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    ed = AllocateZeroPool(sizeof(*ed));
+    if (!ed)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = ext4_walk(mnt, path, &inode, ed->name);
+    if (!EFI_ERROR(Status) && (inode.i_mode & EXT4_S_IFMT) != EXT4_S_IFDIR)
+        Status = EFI_UNSUPPORTED;
+    if (!EFI_ERROR(Status))
+        Status = ext4_dir_load(mnt, &inode, &ed->buf, &ed->size);
+    if (EFI_ERROR(Status)) {
+        FreePool(ed);
+        return Status;
+    }
+
+    ed->mnt = mnt;
+    *dir_out = ed;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReadEXT4DirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct ext4_dir *ed = dir;
+    struct ext4_dirent *de;
+    struct ext4_inode inode;
+    EFI_STATUS Status;
+    UINTN off = ed->off;
+
+    while (ext4_dir_next(ed->buf, ed->size, &off, &de)) {
+        if (de->name[0] == '.' && (de->name_len == 1 || (de->name_len == 2 && de->name[1] == '.'))) {
+            ed->off = off;
+            continue;
+        }
+
+        Status = ext4_read_inode(ed->mnt, de->inode, &inode);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        ext4_name_to_ucs2((UINT8 *)de->name, de->name_len, ed->name, EXT4_NAME_LEN);
+        Status = FillFileInfo(ed->name, ext4_inode_size(&inode), EFI_FILE_READ_ONLY |
+            ((inode.i_mode & EXT4_S_IFMT) == EXT4_S_IFDIR ? EFI_FILE_DIRECTORY : 0), size, buf);
+        if (!EFI_ERROR(Status))
+            ed->off = off;
+        return Status;
+    }
+
+    *size = 0;
+    return EFI_SUCCESS;
+}
+
+void
+CloseEXT4Dir(void *dir)
+{
+    struct ext4_dir *ed = dir;
+
+    if (!ed)
+        return;
+
+    FreePool(ed->buf);
+    FreePool(ed);
+}
@@ -0,0 +1,945 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * fat.c
+ * Read-only FAT32 filesystem plugin.
+ *
+ * The firmware's FAT driver on some boards reads one cluster per call and
+ * re-reads FAT sectors for every cluster it follows. This driver reads the
+ * whole FAT once at mount time, turns each cluster chain into runs of
+ * contiguous clusters when a file is opened, and reads every run that falls
+ * inside a request with a single ReadBlocks() call.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "fat.h"
+
+/*
+ * In-memory file handle. Directories use the same structure internally
+ * while they are being read.
+ */
+struct fat_file {
+    EFI_FILE_PROTOCOL File;
+    struct fat_mount *mnt;
+    UINT64 size;                /* file size in bytes */
+    UINT64 pos;                 /* current file position */
+    struct fat_run *runs;       /* cluster runs of the file */
+    UINTN nruns;
+    UINTN run;                  /* run holding the last byte read */
+    UINT64 runbase;             /* file offset of that run */
+    UINT8 *bounce;              /* one cluster, for partial and unaligned reads */
+    UINT8 attr;                 /* FAT attributes */
+    CHAR16 name[FAT_MAXNAMELEN + 1];    /* file name, for GetInfo */
+};
+
+static BOOLEAN
+fat_is_pow2(UINT32 v)
+{
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+static EFI_STATUS
+fat_read_sectors(struct fat_mount *mnt, UINT64 sec, UINTN count, VOID *buf)
+{
+    EFI_BLOCK_IO_PROTOCOL *bio = mnt->bio;
+    UINT64 lba = (UINT64)mnt->slice_start_lba + sec * mnt->lbaspersec;
+
+    return uefi_call_wrapper(bio->ReadBlocks, 5, bio, bio->Media->MediaId, lba, count * mnt->secsize, buf);
+}
+
+EFI_STATUS
+DetectFAT(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void)
+{
+    EFI_STATUS Status;
+    UINTN BlockSize = BlockIo->Media->BlockSize;
+    struct fat_bootsector *bs = (struct fat_bootsector *)sb_void;
+    UINT32 totsec, datastart, nclusters;
+    VOID *Buffer;
+
+    if (BlockSize < sizeof(*bs))
+        return EFI_UNSUPPORTED;
+
+    Buffer = AllocateZeroPool(BlockSize);
+    if (!Buffer)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = uefi_call_wrapper(BlockIo->ReadBlocks, 5, BlockIo, BlockIo->Media->MediaId, SliceStartLBA, BlockSize, Buffer);
+    if (EFI_ERROR(Status)) {
+        FreePool(Buffer);
+        return Status;
+    }
+
+    MemMove(bs, Buffer, sizeof(*bs));
+    FreePool(Buffer);
+
+    if (bs->bs_signature != FAT_SIGNATURE || bs->bpb_bytspersec < 512 || bs->bpb_bytspersec > 4096 ||
+        !fat_is_pow2(bs->bpb_bytspersec) || !fat_is_pow2(bs->bpb_secperclus) ||
+        bs->bpb_rsvdseccnt == 0 || bs->bpb_numfats == 0)
+        return EFI_NOT_FOUND;
+
+    if (bs->bpb_fatsz16 != 0 || bs->bpb_rootentcnt != 0 || bs->bpb_fatsz32 == 0) {
+        PrintToScreen(L"FAT12/FAT16 volumes are not supported\n");
+        return EFI_UNSUPPORTED;
+    }
+
+    if (bs->bpb_fsver != 0 || bs->bpb_bytspersec % BlockSize != 0) {
+        PrintToScreen(L"Unsupported FAT32 volume (version 0x%04x, %u byte sectors)\n", bs->bpb_fsver, bs->bpb_bytspersec);
+        return EFI_UNSUPPORTED;
+    }
+
+    totsec = bs->bpb_totsec16 ? bs->bpb_totsec16 : bs->bpb_totsec32;
+    datastart = bs->bpb_rsvdseccnt + bs->bpb_numfats * bs->bpb_fatsz32;
+    if (datastart >= totsec)
+        return EFI_VOLUME_CORRUPTED;
+
+    nclusters = (totsec - datastart) / bs->bpb_secperclus;
+    if ((UINT64)bs->bpb_fatsz32 * bs->bpb_bytspersec / sizeof(UINT32) < (UINT64)nclusters + 2 ||
+        bs->bpb_rootclus < 2 || bs->bpb_rootclus >= nclusters + 2) {
+        PrintToScreen(L"Error: Inconsistent FAT32 BPB\n");
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * MountFAT: compute the volume geometry and read the active FAT into memory.
+ */
+EFI_STATUS
+MountFAT(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out)
+{
+    struct fat_mount *mnt;
+    struct fat_bootsector *bs = (struct fat_bootsector *)sb_buffer;
+    EFI_STATUS Status;
+    UINT32 totsec, fatsecs, active = 0;
+
+    if (!bs || !mount_out)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = AllocateZeroPool(sizeof(*mnt));
+    if (!mnt)
+        return EFI_OUT_OF_RESOURCES;
+
+    MemMove(&mnt->bs, bs, sizeof(mnt->bs));
+    bs = &mnt->bs;
+
+    mnt->bio = BlockIo;
+    mnt->slice_start_lba = SliceStartLBA;
+    mnt->secsize = bs->bpb_bytspersec;
+    mnt->lbaspersec = bs->bpb_bytspersec / BlockIo->Media->BlockSize;
+    mnt->clussize = bs->bpb_bytspersec * bs->bpb_secperclus;
+
+    /* bit 7 set: mirroring off, bits 0-3 select the only active FAT */
+    if (bs->bpb_extflags & 0x80)
+        active = bs->bpb_extflags & 0x0F;
+    if (active >= bs->bpb_numfats)
+        active = 0;
+
+    totsec = bs->bpb_totsec16 ? bs->bpb_totsec16 : bs->bpb_totsec32;
+    mnt->fatstart = bs->bpb_rsvdseccnt + active * bs->bpb_fatsz32;
+    mnt->datastart = bs->bpb_rsvdseccnt + bs->bpb_numfats * bs->bpb_fatsz32;
+    mnt->nclusters = (totsec - mnt->datastart) / bs->bpb_secperclus;
+
+    /* only the part of the FAT that maps data clusters is needed */
+    fatsecs = ((mnt->nclusters + 2) * sizeof(UINT32) + mnt->secsize - 1) / mnt->secsize;
+    mnt->fat = AllocatePool((UINTN)fatsecs * mnt->secsize);
+    if (!mnt->fat) {
+        FreePool(mnt);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = fat_read_sectors(mnt, mnt->fatstart, fatsecs, mnt->fat);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot read FAT: %r\n", Status);
+        FreePool(mnt->fat);
+        FreePool(mnt);
+        return Status;
+    }
+
+    *mount_out = mnt;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+UmountFAT(void *mount)
+{
+    struct fat_mount *mnt = (struct fat_mount *)mount;
+
+    if (!mnt)
+        return EFI_INVALID_PARAMETER;
+
+    FreePool(mnt->fat);
+    FreePool(mnt);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Turn the cluster chain starting at 'first' into runs of contiguous
+ * clusters. The chain is walked twice, once to count the runs and once to
+ * fill them in; both walks only touch the cached FAT.
+ */
+static EFI_STATUS
+fat_chain_runs(struct fat_mount *mnt, UINT32 first, struct fat_run **runs_out, UINTN *nruns_out, UINT32 *nclus_out)
+{
+    struct fat_run *runs;
+    UINT32 c, next, n = 0;
+    UINTN nruns = 1, r = 0;
+
+    *runs_out = NULL;
+    *nruns_out = 0;
+    *nclus_out = 0;
+
+    if (first == 0)
+        return EFI_SUCCESS;
+
+    /* count, and reject chains that leave the volume or loop */
+    for (c = first; ; c = next) {
+        if (c < 2 || c >= mnt->nclusters + 2 || n == mnt->nclusters)
+            return EFI_VOLUME_CORRUPTED;
+        n++;
+        next = mnt->fat[c] & FAT32_MASK;
+        if (next >= FAT32_EOC)
+            break;
+        if (next != c + 1)
+            nruns++;
+    }
+
+    runs = AllocatePool(nruns * sizeof(*runs));
+    if (!runs)
+        return EFI_OUT_OF_RESOURCES;
+
+    runs[0].cluster = first;
+    runs[0].count = 0;
+    for (c = first; ; c = next) {
+        runs[r].count++;
+        next = mnt->fat[c] & FAT32_MASK;
+        if (next >= FAT32_EOC)
+            break;
+        if (next != c + 1) {
+            r++;
+            runs[r].cluster = next;
+            runs[r].count = 0;
+        }
+    }
+
+    *runs_out = runs;
+    *nruns_out = nruns;
+    *nclus_out = n;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read 'len' bytes at offset 'pos' of a file. Whole sectors inside a run go
+ * straight to the caller's buffer in one transfer per run; the unaligned
+ * head and tail, and buffers that do not meet the device's IoAlign, go
+ * through the bounce buffer.
+ */
+static EFI_STATUS
+fat_read(struct fat_file *ff, UINT64 pos, UINT8 *out, UINTN len)
+{
+    struct fat_mount *mnt = ff->mnt;
+    UINT32 ioalign = mnt->bio->Media->IoAlign;
+    EFI_STATUS Status;
+    UINT64 off, avail, sec;
+    UINTN chunk, soff, n;
+
+    while (len > 0) {
+        if (pos < ff->runbase) {
+            ff->run = 0;
+            ff->runbase = 0;
+        }
+        while (ff->run < ff->nruns && pos >= ff->runbase + (UINT64)ff->runs[ff->run].count * mnt->clussize) {
+            ff->runbase += (UINT64)ff->runs[ff->run].count * mnt->clussize;
+            ff->run++;
+        }
+        if (ff->run == ff->nruns)
+            return EFI_VOLUME_CORRUPTED;    /* file is larger than its chain */
+
+        off = pos - ff->runbase;
+        avail = (UINT64)ff->runs[ff->run].count * mnt->clussize - off;
+        chunk = len < avail ? len : (UINTN)avail;
+        sec = mnt->datastart + (UINT64)(ff->runs[ff->run].cluster - 2) * mnt->bs.bpb_secperclus + off / mnt->secsize;
+        soff = off % mnt->secsize;
+
+        if (soff == 0 && chunk >= mnt->secsize && (ioalign <= 1 || ((UINTN)out & (ioalign - 1)) == 0)) {
+            n = chunk / mnt->secsize;
+            Status = fat_read_sectors(mnt, sec, n, out);
+            if (EFI_ERROR(Status))
+                return Status;
+            chunk = n * mnt->secsize;
+        } else {
+            if (!ff->bounce) {
+                ff->bounce = AllocatePool(mnt->clussize);
+                if (!ff->bounce)
+                    return EFI_OUT_OF_RESOURCES;
+            }
+
+            /* up to the end of the cluster, or of the request */
+            n = (mnt->clussize - off % mnt->clussize + soff + mnt->secsize - 1) / mnt->secsize;
+            if (n > (soff + chunk + mnt->secsize - 1) / mnt->secsize)
+                n = (soff + chunk + mnt->secsize - 1) / mnt->secsize;
+            Status = fat_read_sectors(mnt, sec, n, ff->bounce);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (chunk > n * mnt->secsize - soff)
+                chunk = n * mnt->secsize - soff;
+            CopyMem(out, ff->bounce + soff, chunk);
+        }
+
+        pos += chunk;
+        out += chunk;
+        len -= chunk;
+    }
+
+    return EFI_SUCCESS;
+}
+
+static struct fat_file *
+fat_file_new(struct fat_mount *mnt, UINT32 first, UINT64 size, UINT8 attr)
+{
+    struct fat_file *ff;
+    UINT32 nclus;
+
+    ff = AllocateZeroPool(sizeof(*ff));
+    if (!ff)
+        return NULL;
+
+    ff->mnt = mnt;
+    ff->attr = attr;
+    if (EFI_ERROR(fat_chain_runs(mnt, first, &ff->runs, &ff->nruns, &nclus))) {
+        FreePool(ff);
+        return NULL;
+    }
+
+    /* directories have no size of their own */
+    if (attr & FAT_ATTR_DIRECTORY)
+        size = (UINT64)nclus * mnt->clussize;
+    ff->size = size;
+    return ff;
+}
+
+static void
+fat_file_free(struct fat_file *ff)
+{
+    if (ff->runs)
+        FreePool(ff->runs);
+    if (ff->bounce)
+        FreePool(ff->bounce);
+    FreePool(ff);
+}
+
+/*
+ * Read a whole directory into memory. FAT limits directories to 65536
+ * entries, so this is bounded.
+ */
+static EFI_STATUS
+fat_dir_load(struct fat_mount *mnt, UINT32 cluster, UINT8 **buf_out, UINTN *size_out)
+{
+    struct fat_file *dir;
+    EFI_STATUS Status;
+    UINT8 *buf;
+
+    dir = fat_file_new(mnt, cluster, 0, FAT_ATTR_DIRECTORY);
+    if (!dir)
+        return EFI_VOLUME_CORRUPTED;
+
+    if (dir->size > FAT_MAX_DIRSIZE)
+        dir->size = FAT_MAX_DIRSIZE;
+
+    buf = AllocatePool(dir->size);
+    if (!buf) {
+        fat_file_free(dir);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = fat_read(dir, 0, buf, dir->size);
+    *size_out = dir->size;
+    fat_file_free(dir);
+    if (EFI_ERROR(Status)) {
+        FreePool(buf);
+        return Status;
+    }
+
+    *buf_out = buf;
+    return EFI_SUCCESS;
+}
+
+static UINT8
+fat_lfn_chksum(const INT8 *shortname)
+{
+    UINT8 sum = 0;
+    UINTN i;
+
+    for (i = 0; i < 11; i++)
+        sum = ((sum & 1) << 7) + (sum >> 1) + (UINT8)shortname[i];
+    return sum;
+}
+
+/*
+ * Format an 8.3 name as "NAME.EXT", honouring the lower case flags.
+ */
+static void
+fat_short_name(const struct fat_dirent *de, CHAR16 *name)
+{
+    UINTN i, len, n = 0;
+    CHAR8 c;
+
+    for (len = 8; len > 0 && de->dir_name[len - 1] == ' '; len--)
+        ;
+    for (i = 0; i < len; i++) {
+        c = de->dir_name[i];
+        if (i == 0 && (UINT8)c == 0x05)
+            c = (CHAR8)0xE5;
+        if ((de->dir_ntres & FAT_NTRES_LOWER_BASE) && c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        name[n++] = (UINT8)c;
+    }
+
+    for (len = 3; len > 0 && de->dir_name[8 + len - 1] == ' '; len--)
+        ;
+    if (len > 0) {
+        name[n++] = L'.';
+        for (i = 0; i < len; i++) {
+            c = de->dir_name[8 + i];
+            if ((de->dir_ntres & FAT_NTRES_LOWER_EXT) && c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            name[n++] = (UINT8)c;
+        }
+    }
+
+    name[n] = L'\0';
+}
+
+/*
+ * Return the next live entry of a directory buffer, starting at *idx.
+ * 'name' (FAT_NAMEBUF characters) receives the long name if a valid one
+ * precedes the entry, and 'sname' the 8.3 name. Volume labels are skipped.
+ */
+static BOOLEAN
+fat_dir_next(UINT8 *buf, UINTN size, UINTN *idx, struct fat_dirent **de_out, CHAR16 *name, CHAR16 *sname)
+{
+    UINTN count = size / sizeof(struct fat_dirent);
+    UINTN i, k, seq = 0;
+    UINT8 chksum = 0;
+    struct fat_dirent *de;
+    struct fat_lfn *lfn;
+
+    name[0] = L'\0';
+
+    for (i = *idx; i < count; i++) {
+        de = (struct fat_dirent *)buf + i;
+
+        if ((UINT8)de->dir_name[0] == FAT_DIRENT_END)
+            break;
+        if ((UINT8)de->dir_name[0] == FAT_DIRENT_FREE) {
+            seq = 0;
+            continue;
+        }
+
+        if ((de->dir_attr & 0x3F) == FAT_ATTR_LFN) {
+            lfn = (struct fat_lfn *)de;
+            if (lfn->ldir_ord & FAT_LFN_LAST) {
+                seq = lfn->ldir_ord & 0x1F;
+                chksum = lfn->ldir_chksum;
+                if (seq == 0 || seq > FAT_LFN_MAXPARTS) {
+                    seq = 0;
+                    continue;
+                }
+                name[seq * FAT_LFN_CHARS] = L'\0';
+            } else if (seq == 0 || lfn->ldir_ord != seq - 1 || lfn->ldir_chksum != chksum) {
+                seq = 0;
+                continue;
+            }
+            seq = lfn->ldir_ord & 0x1F;
+
+            k = (seq - 1) * FAT_LFN_CHARS;
+            CopyMem(&name[k], lfn->ldir_name1, sizeof(lfn->ldir_name1));
+            CopyMem(&name[k + 5], lfn->ldir_name2, sizeof(lfn->ldir_name2));
+            CopyMem(&name[k + 11], lfn->ldir_name3, sizeof(lfn->ldir_name3));
+            continue;
+        }
+
+        if (de->dir_attr & FAT_ATTR_VOLUME_ID) {
+            seq = 0;
+            continue;
+        }
+
+        fat_short_name(de, sname);
+
+        /* the last LFN part must have been #1 and belong to this entry */
+        if (seq != 1 || fat_lfn_chksum(de->dir_name) != chksum)
+            StrCpy(name, sname);
+        else {
+            /* the name is NUL terminated and 0xFFFF padded when short */
+            for (k = 0; k < FAT_MAXNAMELEN && name[k] != L'\0' && name[k] != 0xFFFF; k++)
+                ;
+            name[k] = L'\0';
+        }
+
+        *de_out = de;
+        *idx = i + 1;
+        return TRUE;
+    }
+
+    *idx = count;
+    return FALSE;
+}
+
+static CHAR16
+fat_toupper(CHAR16 c)
+{
+    return (c >= L'a' && c <= L'z') ? c - (L'a' - L'A') : c;
+}
+
+/*
+ * Case-insensitive compare of a path component with a directory name.
+ */
+static BOOLEAN
+fat_name_eq(const CHAR16 *comp, UINTN len, const CHAR16 *name)
+{
+    UINTN k;
+
+    for (k = 0; k < len; k++) {
+        if (name[k] == L'\0' || fat_toupper(comp[k]) != fat_toupper(name[k]))
+            return FALSE;
+    }
+    return name[len] == L'\0';
+}
+
+static UINT32
+fat_dirent_cluster(const struct fat_dirent *de)
+{
+    return ((UINT32)de->dir_fstclushi << 16) | de->dir_fstcluslo;
+}
+
+/*
+ * Walk 'path' from the root directory. On success 'de_out' holds the entry
+ * of the last component and 'name_out' (FAT_NAMEBUF characters) its name;
+ * the root directory itself is returned as a synthetic directory entry.
+ */
+static EFI_STATUS
+fat_walk(struct fat_mount *mnt, const CHAR16 *path, struct fat_dirent *de_out, CHAR16 *name_out)
+{
+    EFI_STATUS Status = EFI_SUCCESS;
+    CHAR16 sname[13];
+    UINT32 cluster = mnt->bs.bpb_rootclus;
+    const CHAR16 *p = path;
+    struct fat_dirent *de;
+    UINT8 *buf;
+    UINTN len, size, idx;
+    BOOLEAN found;
+
+    SetMem(de_out, sizeof(*de_out), 0);
+    de_out->dir_attr = FAT_ATTR_DIRECTORY;
+    de_out->dir_fstclushi = cluster >> 16;
+    de_out->dir_fstcluslo = cluster & 0xFFFF;
+    StrCpy(name_out, L"\\");
+
+    while (*p == L'/' || *p == L'\\')
+        p++;
+
+    while (*p) {
+        for (len = 0; p[len] && p[len] != L'/' && p[len] != L'\\'; len++)
+            ;
+
+        if (!(de_out->dir_attr & FAT_ATTR_DIRECTORY)) {
+            Status = EFI_NOT_FOUND;
+            break;
+        }
+
+        Status = fat_dir_load(mnt, cluster, &buf, &size);
+        if (EFI_ERROR(Status))
+            break;
+
+        found = FALSE;
+        idx = 0;
+        while (fat_dir_next(buf, size, &idx, &de, name_out, sname)) {
+            if (fat_name_eq(p, len, name_out) || fat_name_eq(p, len, sname)) {
+                CopyMem(de_out, de, sizeof(*de));
+                found = TRUE;
+                break;
+            }
+        }
+        FreePool(buf);
+
+        if (!found) {
+            Status = EFI_NOT_FOUND;
+            break;
+        }
+
+        /* ".." of a first level directory points at cluster 0 */
+        cluster = fat_dirent_cluster(de_out);
+        if (cluster == 0 && (de_out->dir_attr & FAT_ATTR_DIRECTORY))
+            cluster = mnt->bs.bpb_rootclus;
+
+        p += len;
+        while (*p == L'/' || *p == L'\\')
+            p++;
+    }
+
+    return Status;
+}
+
+/*
+ * ReadFATDir: list directory contents for the provided path.
+ */
+EFI_STATUS
+ReadFATDir(void *mount_ctx, const CHAR16 *path)
+{
+    struct fat_mount *mnt = (struct fat_mount *)mount_ctx;
+    EFI_STATUS Status;
+    struct fat_dirent dir, *de;
+    CHAR16 *name, sname[13];
+    UINT32 cluster;
+    UINT8 *buf;
+    UINTN size, idx = 0;
+
+    if (!mnt || !path)
+        return EFI_INVALID_PARAMETER;
+
+    name = AllocatePool(FAT_NAMEBUF * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = fat_walk(mnt, path, &dir, name);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"No such file or directory: %s\n", path);
+        goto out;
+    }
+
+    if (!(dir.dir_attr & FAT_ATTR_DIRECTORY)) {
+        PrintToScreen(L"Not a directory\n");
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    cluster = fat_dirent_cluster(&dir);
+    if (cluster == 0)
+        cluster = mnt->bs.bpb_rootclus;
+
+    Status = fat_dir_load(mnt, cluster, &buf, &size);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    PrintToScreen(L"Listing FAT directory: %s\n", path);
+
+    while (fat_dir_next(buf, size, &idx, &de, name, sname)) {
+        if (de->dir_attr & FAT_ATTR_DIRECTORY)
+            PrintToScreen(L"   <DIR>    %s\n", name);
+        else
+            PrintToScreen(L"  <FILE>    %s  %u bytes\n", name, de->dir_filesize);
+    }
+
+    FreePool(buf);
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    struct fat_file *ff = (struct fat_file *)This;
+    EFI_STATUS Status;
+    UINTN to_read;
+
+    if (!This || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (ff->pos >= ff->size) {
+        *BufferSize = 0; /* EOF */
+        return EFI_SUCCESS;
+    }
+
+    to_read = *BufferSize;
+    if ((UINT64)to_read > ff->size - ff->pos)
+        to_read = (UINTN)(ff->size - ff->pos);
+
+    Status = fat_read(ff, ff->pos, Buffer, to_read);
+    if (EFI_ERROR(Status)) {
+        *BufferSize = 0;
+        return Status;
+    }
+
+    ff->pos += to_read;
+    *BufferSize = to_read;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+    struct fat_file *ff = (struct fat_file *)This;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    /* UEFI uses (UINT64)-1 to set position to EOF */
+    if (Position == (UINT64)-1)
+        Position = ff->size;
+
+    if (Position > ff->size)
+        return EFI_INVALID_PARAMETER;
+
+    ff->pos = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct fat_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    struct fat_file *ff = (struct fat_file *)This;
+    UINT64 attr;
+
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+        return EFI_UNSUPPORTED;
+
+    /* the FAT hidden, system and archive bits match the EFI ones */
+    attr = EFI_FILE_READ_ONLY | (ff->attr & (FAT_ATTR_HIDDEN | FAT_ATTR_SYSTEM | FAT_ATTR_ARCHIVE));
+    return FillFileInfo(ff->name, ff->size, attr, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+fat_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* only regular files are handed out */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_close(EFI_FILE_PROTOCOL *This)
+{
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    fat_file_free((struct fat_file *)This);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fat_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    fat_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * OpenFAT:
+ * - walk the path from the root directory
+ * - verify the final entry is a file
+ * - compute its cluster runs and create an in-memory file handle
+ */
+EFI_STATUS
+OpenFAT(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
+    struct fat_mount *mnt = mount_ctx;
+    struct fat_file *ff;
+    struct fat_dirent de;
+    EFI_STATUS Status;
+    CHAR16 *name;
+
+    if (!mnt || !filename || !file_out)
+        return EFI_INVALID_PARAMETER;
+
+    /* Only support read-only */
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_UNSUPPORTED;
+
+    name = AllocatePool(FAT_NAMEBUF * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = fat_walk(mnt, filename, &de, name);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    if (de.dir_attr & FAT_ATTR_DIRECTORY) {
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    ff = fat_file_new(mnt, fat_dirent_cluster(&de), de.dir_filesize, de.dir_attr);
+    if (!ff) {
+        Status = EFI_VOLUME_CORRUPTED;
+        goto out;
+    }
+
+    if (ff->nruns == 0 && ff->size != 0) {
+        fat_file_free(ff);
+        Status = EFI_VOLUME_CORRUPTED;
+        goto out;
+    }
+
+    StrCpy(ff->name, name);
+
+    ff->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+    ff->File.Open = fat_file_open;
+    ff->File.Close = fat_file_close;
+    ff->File.Delete = fat_file_delete;
+    ff->File.Read = fat_file_read;
+    ff->File.Write = fat_file_write;
+    ff->File.GetPosition = fat_file_getpos;
+    ff->File.SetPosition = fat_file_setpos;
+    ff->File.GetInfo = fat_file_getinfo;
+    ff->File.SetInfo = fat_file_setinfo;
+    ff->File.Flush = fat_file_flush;
+
+    *file_out = &ff->File;
+    Status = EFI_SUCCESS;
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+/*
+ * Directory iterator. The directory is read into memory once, when it is
+ * opened; the position is the index of the next 32-byte entry.
+ */
+struct fat_dir {
+    UINT8 *buf;
+    UINTN size;
+    UINTN idx;
+    CHAR16 name[FAT_NAMEBUF];
+    CHAR16 sname[13];
+};
+
+EFI_STATUS
+OpenFATDir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct fat_mount *mnt = mount_ctx;
+    struct fat_dirent de;
+    struct fat_dir *fd;
+    EFI_STATUS Status;
+    UINT32 cluster;
+
+    if (!mnt || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    fd = AllocateZeroPool(sizeof(*fd));
+    if (!fd)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = fat_walk(mnt, path, &de, fd->name);
+    if (!EFI_ERROR(Status) && !(de.dir_attr & FAT_ATTR_DIRECTORY))
+        Status = EFI_UNSUPPORTED;
+    if (!EFI_ERROR(Status)) {
+        cluster = fat_dirent_cluster(&de);
+        if (cluster == 0)
+            cluster = mnt->bs.bpb_rootclus;
+        Status = fat_dir_load(mnt, cluster, &fd->buf, &fd->size);
+    }
+    if (EFI_ERROR(Status)) {
+        FreePool(fd);
+        return Status;
+    }
+
+    *dir_out = fd;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReadFATDirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct fat_dir *fd = dir;
+    struct fat_dirent *de;
+    EFI_STATUS Status;
+    UINTN idx = fd->idx;
+    UINT64 attr;
+
+    while (fat_dir_next(fd->buf, fd->size, &idx, &de, fd->name, fd->sname)) {
+        if (fd->name[0] == L'.' && (fd->name[1] == L'\0' || (fd->name[1] == L'.' && fd->name[2] == L'\0'))) {
+            fd->idx = idx;
+            continue;
+        }
+
+        attr = EFI_FILE_READ_ONLY | (de->dir_attr & (FAT_ATTR_HIDDEN | FAT_ATTR_SYSTEM | FAT_ATTR_ARCHIVE));
+        if (de->dir_attr & FAT_ATTR_DIRECTORY)
+            attr |= EFI_FILE_DIRECTORY;
+        Status = FillFileInfo(fd->name, (de->dir_attr & FAT_ATTR_DIRECTORY) ? 0 : de->dir_filesize, attr, size, buf);
+        if (!EFI_ERROR(Status))
+            fd->idx = idx;
+        return Status;
+    }
+
+    *size = 0;
+    return EFI_SUCCESS;
+}
+
+void
+CloseFATDir(void *dir)
+{
+    struct fat_dir *fd = dir;
+
+    if (!fd)
+        return;
+
+    FreePool(fd->buf);
+    FreePool(fd);
+}
@@ -38,11 +38,17 @@
 
 /*
  * Filesystem table entry table.
- * Does not include FAT, as it is handled by UEFI natively.
+ * FAT32 is normally handled by UEFI natively; the built-in driver is used
+ * for the boot volume only when enabled in the config file. It comes last
+ * so that it is never tried before the SysV filesystems.
  */
 struct fs_tab_entry fs_tab[] = {
-    { L"bfs", DetectBFS, MountBFS, ReadBFSDir, UmountBFS, OpenBFS, sizeof(struct bfs_superblock) },
-    { L"s5", DetectS5, MountS5, ReadS5Dir, UmountS5, OpenS5, sizeof(struct s5_superblock) },
-    { L"ufs", DetectUFS, MountUFS, ReadUFSDir, UmountUFS, OpenUFS, sizeof(struct ufs_superblock) },
-    { NULL, NULL, NULL, NULL, NULL, NULL, 0 }
+    { L"bfs", DetectBFS, MountBFS, ReadBFSDir, UmountBFS, OpenBFS, OpenBFSDir, ReadBFSDirEntry, CloseBFSDir, sizeof(struct bfs_superblock) },
+    { L"s5", DetectS5, MountS5, ReadS5Dir, UmountS5, OpenS5, OpenS5Dir, ReadS5DirEntry, CloseS5Dir, sizeof(struct s5_superblock) },
+    { L"ufs", DetectUFS, MountUFS, ReadUFSDir, UmountUFS, OpenUFS, NULL, NULL, NULL, sizeof(struct ufs_superblock) },
+    { L"ext4", DetectEXT4, MountEXT4, ReadEXT4Dir, UmountEXT4, OpenEXT4, OpenEXT4Dir, ReadEXT4DirEntry, CloseEXT4Dir, sizeof(struct ext4_superblock) },
+    { L"squashfs", DetectSQFS, MountSQFS, ReadSQFSDir, UmountSQFS, OpenSQFS, OpenSQFSDir, ReadSQFSDirEntry, CloseSQFSDir, sizeof(struct sqfs_superblock) },
+    { L"iso9660", DetectISO, MountISO, ReadISODir, UmountISO, OpenISO, OpenISODir, ReadISODirEntry, CloseISODir, sizeof(struct iso_pvd) },
+    { L"fat32", DetectFAT, MountFAT, ReadFATDir, UmountFAT, OpenFAT, OpenFATDir, ReadFATDirEntry, CloseFATDir, sizeof(struct fat_bootsector) },
+    { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0 }
 };
@@ -0,0 +1,396 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * heap.c
+ * Accounting for pool and page allocations.
+ *
+ * Every tracked allocation is entered into an open-addressed table keyed
+ * by its address, together with its size and the return address of the
+ * caller, which serves as the call-site ID. Per-site counters give the
+ * current and peak footprint of each caller. The Command Monitor takes a
+ * checkpoint after each command; a site whose live count keeps growing
+ * from one command to the next is reported as a likely leak.
+ *
+ * Buffers the firmware hands back (LocateHandleBuffer and friends) are not
+ * in the table and are passed straight through on free.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "heap.h"
+
+struct heap_site {
+	VOID *Caller;		/* return address of the allocating call */
+	UINT64 Live;		/* allocations outstanding */
+	UINT64 Bytes;		/* bytes outstanding */
+	UINT64 Peak;		/* high-water mark of Bytes */
+	UINT64 Allocs;		/* allocations ever made */
+	UINT64 LastLive;	/* Live at the previous checkpoint */
+	UINT32 Strikes;		/* consecutive checkpoints at which Live had grown */
+	BOOLEAN Pages;
+};
+
+struct heap_slot {
+	UINT64 Addr;		/* 0 if the slot is free */
+	UINT64 Size;
+	UINT16 Site;
+	BOOLEAN Pages;
+};
+
+/* The real gnu-efi routines, renamed by the linker. */
+extern VOID *__real_AllocatePool(UINTN Size);
+extern VOID *__real_AllocateZeroPool(UINTN Size);
+extern VOID __real_FreePool(VOID *Buffer);
+
+VOID *__wrap_AllocatePool(UINTN Size);
+VOID *__wrap_AllocateZeroPool(UINTN Size);
+VOID *__wrap_ReallocatePool(VOID *OldPool, UINTN OldSize, UINTN NewSize);
+VOID __wrap_FreePool(VOID *Buffer);
+
+static struct heap_site Sites[HEAP_SITES];
+static struct heap_slot Slots[HEAP_SLOTS];
+
+static UINT64 PoolBytes, PoolPeak, PageBytes, PagePeak;
+static UINT64 Untracked, Commands;
+
+static UINTN
+heap_hash(UINT64 Addr)
+{
+	return (UINTN)(((Addr >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) & (HEAP_SLOTS - 1);
+}
+
+/*
+ * Find or create the counters for a call site. If the table fills up,
+ * everything else is charged to the last entry.
+ */
+static UINT16
+heap_site(VOID *Caller, BOOLEAN Pages)
+{
+	UINTN i, n;
+
+	i = (UINTN)heap_hash((UINT64)(UINTN)Caller) % (HEAP_SITES - 1);
+	for (n = 0; n < HEAP_SITES - 1; n++, i = (i + 1) % (HEAP_SITES - 1)) {
+		if (Sites[i].Caller == Caller)
+			return (UINT16)i;
+		if (!Sites[i].Caller) {
+			Sites[i].Caller = Caller;
+			Sites[i].Pages = Pages;
+			return (UINT16)i;
+		}
+	}
+
+	return HEAP_SITES - 1;
+}
+
+static VOID
+heap_insert(UINT64 Addr, UINT64 Size, BOOLEAN Pages, VOID *Caller)
+{
+	struct heap_site *Site;
+	UINTN i, n;
+
+	for (i = heap_hash(Addr), n = 0; n < HEAP_SLOTS; n++, i = (i + 1) & (HEAP_SLOTS - 1)) {
+		if (Slots[i].Addr == 0)
+			break;
+	}
+	if (n == HEAP_SLOTS) {
+		Untracked++;
+		return;
+	}
+
+	Slots[i].Addr = Addr;
+	Slots[i].Size = Size;
+	Slots[i].Site = heap_site(Caller, Pages);
+	Slots[i].Pages = Pages;
+
+	Site = &Sites[Slots[i].Site];
+	Site->Live++;
+	Site->Allocs++;
+	Site->Bytes += Size;
+	if (Site->Bytes > Site->Peak)
+		Site->Peak = Site->Bytes;
+
+	if (Pages) {
+		PageBytes += Size;
+		if (PageBytes > PagePeak)
+			PagePeak = PageBytes;
+	} else {
+		PoolBytes += Size;
+		if (PoolBytes > PoolPeak)
+			PoolPeak = PoolBytes;
+	}
+}
+
+/*
+ * Drop the entry for Addr, if there is one. Linear probing lets us shift
+ * later members of the cluster back instead of leaving tombstones.
+ */
+static VOID
+heap_remove(UINT64 Addr)
+{
+	struct heap_site *Site;
+	UINTN i, j, k, n;
+
+	for (i = heap_hash(Addr), n = 0; n < HEAP_SLOTS; n++, i = (i + 1) & (HEAP_SLOTS - 1)) {
+		if (Slots[i].Addr == 0)
+			return;
+		if (Slots[i].Addr == Addr)
+			break;
+	}
+	if (n == HEAP_SLOTS)
+		return;
+
+	Site = &Sites[Slots[i].Site];
+	Site->Live--;
+	Site->Bytes -= Slots[i].Size;
+	if (Slots[i].Pages)
+		PageBytes -= Slots[i].Size;
+	else
+		PoolBytes -= Slots[i].Size;
+
+	for (j = (i + 1) & (HEAP_SLOTS - 1); Slots[j].Addr != 0; j = (j + 1) & (HEAP_SLOTS - 1)) {
+		k = heap_hash(Slots[j].Addr);
+		/* Leave j alone if its home slot lies cyclically in (i, j]. */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		Slots[i] = Slots[j];
+		i = j;
+	}
+	Slots[i].Addr = 0;
+}
+
+VOID *
+__wrap_AllocatePool(UINTN Size)
+{
+	VOID *Buffer = __real_AllocatePool(Size);
+
+	if (Buffer)
+		heap_insert((UINT64)(UINTN)Buffer, Size, FALSE, __builtin_return_address(0));
+
+	return Buffer;
+}
+
+VOID *
+__wrap_AllocateZeroPool(UINTN Size)
+{
+	VOID *Buffer = __real_AllocateZeroPool(Size);
+
+	if (Buffer)
+		heap_insert((UINT64)(UINTN)Buffer, Size, FALSE, __builtin_return_address(0));
+
+	return Buffer;
+}
+
+/* Same contract as gnu-efi: the old buffer is always released. */
+VOID *
+__wrap_ReallocatePool(VOID *OldPool, UINTN OldSize, UINTN NewSize)
+{
+	VOID *NewPool = NULL;
+
+	if (NewSize) {
+		NewPool = __real_AllocatePool(NewSize);
+		if (NewPool)
+			heap_insert((UINT64)(UINTN)NewPool, NewSize, FALSE, __builtin_return_address(0));
+	}
+
+	if (OldPool) {
+		if (NewPool)
+			CopyMem(NewPool, OldPool, MIN(OldSize, NewSize));
+		__wrap_FreePool(OldPool);
+	}
+
+	return NewPool;
+}
+
+VOID
+__wrap_FreePool(VOID *Buffer)
+{
+	heap_remove((UINT64)(UINTN)Buffer);
+	__real_FreePool(Buffer);
+}
+
+EFI_STATUS
+HeapAllocatePages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN Pages, EFI_PHYSICAL_ADDRESS *Memory)
+{
+	EFI_STATUS Status;
+
+	Status = uefi_call_wrapper(BS->AllocatePages, 4, Type, MemoryType, Pages, Memory);
+	if (!EFI_ERROR(Status))
+		heap_insert(*Memory, (UINT64)Pages * EFI_PAGE_SIZE, TRUE, __builtin_return_address(0));
+
+	return Status;
+}
+
+EFI_STATUS
+HeapFreePages(EFI_PHYSICAL_ADDRESS Memory, UINTN Pages)
+{
+	heap_remove(Memory);
+	return uefi_call_wrapper(BS->FreePages, 2, Memory, Pages);
+}
+
+/*
+ * Give back the pages of an allocation past its first Pages, keeping the
+ * rest allocated at the same address.
+ */
+EFI_STATUS
+HeapTrimPages(EFI_PHYSICAL_ADDRESS Memory, UINTN OldPages, UINTN Pages)
+{
+	EFI_STATUS Status;
+	UINT64 Freed;
+	UINTN i, n;
+
+	if (Pages >= OldPages)
+		return EFI_SUCCESS;
+
+	Status = uefi_call_wrapper(BS->FreePages, 2, Memory + (UINT64)Pages * EFI_PAGE_SIZE, OldPages - Pages);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	Freed = (UINT64)(OldPages - Pages) * EFI_PAGE_SIZE;
+	for (i = heap_hash(Memory), n = 0; n < HEAP_SLOTS && Slots[i].Addr != 0; n++, i = (i + 1) & (HEAP_SLOTS - 1)) {
+		if (Slots[i].Addr == Memory) {
+			Slots[i].Size -= Freed;
+			Sites[Slots[i].Site].Bytes -= Freed;
+			PageBytes -= Freed;
+			break;
+		}
+	}
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Extend an allocation downwards by More pages, if the pages just below it
+ * are free, and move its entry to the new base. This lets a buffer that
+ * has already been filled become the tail of a larger one.
+ */
+EFI_STATUS
+HeapGrowPagesDown(EFI_MEMORY_TYPE MemoryType, EFI_PHYSICAL_ADDRESS *Memory, UINTN *Pages, UINTN More)
+{
+	EFI_PHYSICAL_ADDRESS Below;
+	EFI_STATUS Status;
+	VOID *Caller = __builtin_return_address(0);
+	UINTN i, n;
+
+	if ((UINT64)More * EFI_PAGE_SIZE > *Memory)
+		return EFI_OUT_OF_RESOURCES;
+
+	Below = *Memory - (UINT64)More * EFI_PAGE_SIZE;
+	Status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAddress, MemoryType, More, &Below);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	// Keep the charge with the site that made the original allocation.
+	for (i = heap_hash(*Memory), n = 0; n < HEAP_SLOTS && Slots[i].Addr != 0; n++, i = (i + 1) & (HEAP_SLOTS - 1)) {
+		if (Slots[i].Addr == *Memory) {
+			Caller = Sites[Slots[i].Site].Caller;
+			Sites[Slots[i].Site].Allocs--;
+			heap_remove(*Memory);
+			break;
+		}
+	}
+	heap_insert(Below, (UINT64)(*Pages + More) * EFI_PAGE_SIZE, TRUE, Caller);
+
+	*Memory = Below;
+	*Pages += More;
+	return EFI_SUCCESS;
+}
+
+/*
+ * Called at command boundaries. A site earns a strike each time its live
+ * count has gone up since the last checkpoint, and loses them all when it
+ * has not; caches settle after a few commands, while a leak keeps growing.
+ */
+VOID
+HeapCheckpoint(VOID)
+{
+	UINTN i;
+
+	Commands++;
+
+	for (i = 0; i < HEAP_SITES; i++) {
+		struct heap_site *Site = &Sites[i];
+
+		if (!Site->Allocs)
+			continue;
+		if (Site->Live > Site->LastLive) {
+			Site->Strikes++;
+			if (Site->Strikes == HEAP_LEAK_STRIKES)
+				PrintToScreen(L"Warning: possible leak at site %u (%lu allocations, %lu bytes live)\n",
+					i, Site->Live, Site->Bytes);
+		} else {
+			Site->Strikes = 0;
+		}
+		Site->LastLive = Site->Live;
+	}
+}
+
+/*
+ * Call sites are printed as offsets into the loaded image, which match
+ * the addresses in boot.so for addr2line.
+ */
+VOID
+HeapReport(BOOLEAN All)
+{
+	EFI_LOADED_IMAGE *LoadedImage;
+	UINTN Base = 0;
+	UINTN i, Leaks = 0;
+
+	if (!EFI_ERROR(uefi_call_wrapper(BS->HandleProtocol, 3, gImageHandle, &gEfiLoadedImageProtocolGuid,
+	    (VOID **)&LoadedImage)))
+		Base = (UINTN)LoadedImage->ImageBase;
+
+	PrintToScreen(L"Pool:      %lu KB in use, %lu KB peak\n", PoolBytes / 1024, PoolPeak / 1024);
+	PrintToScreen(L"Pages:     %lu KB in use, %lu KB peak\n", PageBytes / 1024, PagePeak / 1024);
+	PrintToScreen(L"Commands:  %lu\n", Commands);
+	if (Untracked)
+		PrintToScreen(L"Untracked: %lu allocations (table full)\n", Untracked);
+
+	PrintToScreen(L"\nSite        Caller       Live      Bytes       Peak   Allocs\n");
+	for (i = 0; i < HEAP_SITES; i++) {
+		struct heap_site *Site = &Sites[i];
+
+		if (!Site->Allocs || (!All && !Site->Live))
+			continue;
+		PrintToScreen(L"%4u  %12lx %8lu %10lu %10lu %8lu%s%s\n", i, (UINTN)Site->Caller - Base,
+			Site->Live, Site->Bytes, Site->Peak, Site->Allocs, Site->Pages ? L" pages" : L"",
+			Site->Strikes >= HEAP_LEAK_STRIKES ? L" LEAK?" : L"");
+		if (Site->Strikes >= HEAP_LEAK_STRIKES)
+			Leaks++;
+	}
+
+	if (Leaks)
+		PrintToScreen(L"\n%lu call site(s) kept growing across commands.\n", Leaks);
+}
@@ -36,6 +36,8 @@
 #include <stdarg.h>
 
 #include "boot.h"
+#include "clock.h"
+#include "memmap.h"
 #include "part.h"
 
 InputFunc InputFunction;
@@ -141,53 +143,582 @@ SwapBytes16(UINT16 val)
     return (val >> 8) | (val << 8);
 }
 
-INTN
-MemCmp(const void *p1, const void *p2, UINTN Size)
+UINT64
+GetTimeSeconds(void)
 {
-    const UINT8 *a = (const UINT8 *)p1;
-    const UINT8 *b = (const UINT8 *)p2;
+	return GetTimeMicroseconds() / 1000000;
+}
 
-    while (Size--) {
-        if (*a != *b)
-            return (INTN)*a - (INTN)*b;
-        a++;
-        b++;
-    }
-    return 0;
+/*
+ * Memory routines.
+ *
+ * MemMove, MemCopy, MemSet and MemCmp call through 'Mem'. It starts out
+ * with the portable word-wide routines; InitMemRoutines() switches to the
+ * fastest set the CPU supports, once that set has passed a self-check
+ * against the byte-wise reference routines.
+ */
+typedef UINTN MemWord __attribute__((__may_alias__));
+
+typedef void (*MemCopyFn)(UINT8 *d, const UINT8 *s, UINTN n);
+typedef void (*MemSetFn)(UINT8 *d, UINT8 c, UINTN n);
+typedef INTN (*MemCmpFn)(const UINT8 *a, const UINT8 *b, UINTN n);
+
+struct mem_routines {
+	const CHAR16 *Name;
+	MemCopyFn CopyFwd;	// ascending copy; also correct when d < s overlap
+	MemCopyFn CopyBwd;	// descending copy, for d > s overlap
+	MemSetFn Set;
+	MemCmpFn Cmp;
+};
+
+#define WORD_MASK	(sizeof(UINTN) - 1)
+
+static void
+CopyFwdByte(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	while (n--)
+		*d++ = *s++;
 }
 
-UINT64
-GetTimeSeconds(void)
+static void
+CopyBwdByte(UINT8 *d, const UINT8 *s, UINTN n)
 {
-	EFI_STATUS Status;
-	EFI_TIME Time;
+	while (n--)
+		d[n] = s[n];
+}
 
-	Status = uefi_call_wrapper(RT->GetTime, 2, &Time, NULL);
-	if (EFI_ERROR(Status))
-		return 0;
+static void
+SetByte(UINT8 *d, UINT8 c, UINTN n)
+{
+	while (n--)
+		*d++ = c;
+}
+
+static INTN
+CmpByte(const UINT8 *a, const UINT8 *b, UINTN n)
+{
+	for (; n; n--, a++, b++) {
+		if (*a != *b)
+			return (INTN)*a - (INTN)*b;
+	}
+	return 0;
+}
+
+/*
+ * Word-wide routines. Words are only used when both pointers can be
+ * aligned at once, as some CPUs trap on misaligned accesses.
+ */
+static void
+CopyFwdWord(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if ((((UINTN)d ^ (UINTN)s) & WORD_MASK) == 0) {
+		for (; n && ((UINTN)d & WORD_MASK); n--)
+			*d++ = *s++;
+		for (; n >= sizeof(UINTN); n -= sizeof(UINTN)) {
+			*(MemWord *)d = *(const MemWord *)s;
+			d += sizeof(UINTN);
+			s += sizeof(UINTN);
+		}
+	}
+	CopyFwdByte(d, s, n);
+}
+
+static void
+CopyBwdWord(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if ((((UINTN)d ^ (UINTN)s) & WORD_MASK) == 0) {
+		for (; n && ((UINTN)(d + n) & WORD_MASK); n--)
+			d[n - 1] = s[n - 1];
+		for (; n >= sizeof(UINTN); n -= sizeof(UINTN))
+			*(MemWord *)(d + n - sizeof(UINTN)) = *(const MemWord *)(s + n - sizeof(UINTN));
+	}
+	CopyBwdByte(d, s, n);
+}
+
+static void
+SetWord(UINT8 *d, UINT8 c, UINTN n)
+{
+	UINTN w = ((UINTN)-1 / 0xFF) * c;
+
+	for (; n && ((UINTN)d & WORD_MASK); n--)
+		*d++ = c;
+	for (; n >= sizeof(UINTN); n -= sizeof(UINTN)) {
+		*(MemWord *)d = w;
+		d += sizeof(UINTN);
+	}
+	SetByte(d, c, n);
+}
+
+static INTN
+CmpWord(const UINT8 *a, const UINT8 *b, UINTN n)
+{
+	if ((((UINTN)a ^ (UINTN)b) & WORD_MASK) == 0) {
+		for (; n && ((UINTN)a & WORD_MASK); n--, a++, b++) {
+			if (*a != *b)
+				return (INTN)*a - (INTN)*b;
+		}
+		// stop at the first differing word and let the byte loop find the byte
+		for (; n >= sizeof(UINTN) && *(const MemWord *)a == *(const MemWord *)b; n -= sizeof(UINTN)) {
+			a += sizeof(UINTN);
+			b += sizeof(UINTN);
+		}
+	}
+	return CmpByte(a, b, n);
+}
+
+#if defined(X86_64_BLD)
+/*
+ * SSE2 is part of x86_64, so these need no check. The loops move 64
+ * bytes per iteration, loading a whole chunk before storing any of it, so
+ * overlapping moves in the loop's direction are safe.
+ */
+static void
+CopyFwdSse2(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if (n >= 64) {
+		__asm__ volatile (
+			"1:\n\t"
+			"movdqu   (%[s]), %%xmm0\n\t"
+			"movdqu 16(%[s]), %%xmm1\n\t"
+			"movdqu 32(%[s]), %%xmm2\n\t"
+			"movdqu 48(%[s]), %%xmm3\n\t"
+			"movdqu %%xmm0,   (%[d])\n\t"
+			"movdqu %%xmm1, 16(%[d])\n\t"
+			"movdqu %%xmm2, 32(%[d])\n\t"
+			"movdqu %%xmm3, 48(%[d])\n\t"
+			"add $64, %[s]\n\t"
+			"add $64, %[d]\n\t"
+			"sub $64, %[n]\n\t"
+			"cmp $64, %[n]\n\t"
+			"jae 1b\n\t"
+			: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+			:
+			: "xmm0", "xmm1", "xmm2", "xmm3", "cc", "memory");
+	}
+	CopyFwdWord(d, s, n);
+}
+
+static void
+CopyBwdSse2(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	UINT8 *de = d + n;
+	const UINT8 *se = s + n;
+
+	if (n >= 64) {
+		__asm__ volatile (
+			"1:\n\t"
+			"sub $64, %[s]\n\t"
+			"sub $64, %[d]\n\t"
+			"movdqu   (%[s]), %%xmm0\n\t"
+			"movdqu 16(%[s]), %%xmm1\n\t"
+			"movdqu 32(%[s]), %%xmm2\n\t"
+			"movdqu 48(%[s]), %%xmm3\n\t"
+			"movdqu %%xmm0,   (%[d])\n\t"
+			"movdqu %%xmm1, 16(%[d])\n\t"
+			"movdqu %%xmm2, 32(%[d])\n\t"
+			"movdqu %%xmm3, 48(%[d])\n\t"
+			"sub $64, %[n]\n\t"
+			"cmp $64, %[n]\n\t"
+			"jae 1b\n\t"
+			: [d] "+r" (de), [s] "+r" (se), [n] "+r" (n)
+			:
+			: "xmm0", "xmm1", "xmm2", "xmm3", "cc", "memory");
+	}
+	CopyBwdWord(d, s, n);
+}
+
+static void
+SetSse2(UINT8 *d, UINT8 c, UINTN n)
+{
+	UINT8 Pattern[16];
+
+	if (n >= 64) {
+		SetWord(Pattern, c, sizeof(Pattern));
+		__asm__ volatile (
+			"movdqu (%[p]), %%xmm0\n\t"
+			"1:\n\t"
+			"movdqu %%xmm0,   (%[d])\n\t"
+			"movdqu %%xmm0, 16(%[d])\n\t"
+			"movdqu %%xmm0, 32(%[d])\n\t"
+			"movdqu %%xmm0, 48(%[d])\n\t"
+			"add $64, %[d]\n\t"
+			"sub $64, %[n]\n\t"
+			"cmp $64, %[n]\n\t"
+			"jae 1b\n\t"
+			: [d] "+r" (d), [n] "+r" (n)
+			: [p] "r" (Pattern)
+			: "xmm0", "cc", "memory");
+	}
+	SetWord(d, c, n);
+}
+
+/*
+ * AVX2 versions, 128 bytes per iteration. The remainder goes through the
+ * SSE2 routines.
+ */
+static void
+CopyFwdAvx2(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if (n >= 128) {
+		__asm__ volatile (
+			"1:\n\t"
+			"vmovdqu   (%[s]), %%ymm0\n\t"
+			"vmovdqu 32(%[s]), %%ymm1\n\t"
+			"vmovdqu 64(%[s]), %%ymm2\n\t"
+			"vmovdqu 96(%[s]), %%ymm3\n\t"
+			"vmovdqu %%ymm0,   (%[d])\n\t"
+			"vmovdqu %%ymm1, 32(%[d])\n\t"
+			"vmovdqu %%ymm2, 64(%[d])\n\t"
+			"vmovdqu %%ymm3, 96(%[d])\n\t"
+			"add $128, %[s]\n\t"
+			"add $128, %[d]\n\t"
+			"sub $128, %[n]\n\t"
+			"cmp $128, %[n]\n\t"
+			"jae 1b\n\t"
+			"vzeroupper\n\t"
+			: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+			:
+			: "xmm0", "xmm1", "xmm2", "xmm3", "cc", "memory");
+	}
+	CopyFwdSse2(d, s, n);
+}
+
+static void
+CopyBwdAvx2(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	UINT8 *de = d + n;
+	const UINT8 *se = s + n;
+
+	if (n >= 128) {
+		__asm__ volatile (
+			"1:\n\t"
+			"sub $128, %[s]\n\t"
+			"sub $128, %[d]\n\t"
+			"vmovdqu   (%[s]), %%ymm0\n\t"
+			"vmovdqu 32(%[s]), %%ymm1\n\t"
+			"vmovdqu 64(%[s]), %%ymm2\n\t"
+			"vmovdqu 96(%[s]), %%ymm3\n\t"
+			"vmovdqu %%ymm0,   (%[d])\n\t"
+			"vmovdqu %%ymm1, 32(%[d])\n\t"
+			"vmovdqu %%ymm2, 64(%[d])\n\t"
+			"vmovdqu %%ymm3, 96(%[d])\n\t"
+			"sub $128, %[n]\n\t"
+			"cmp $128, %[n]\n\t"
+			"jae 1b\n\t"
+			"vzeroupper\n\t"
+			: [d] "+r" (de), [s] "+r" (se), [n] "+r" (n)
+			:
+			: "xmm0", "xmm1", "xmm2", "xmm3", "cc", "memory");
+	}
+	CopyBwdSse2(d, s, n);
+}
+
+static void
+SetAvx2(UINT8 *d, UINT8 c, UINTN n)
+{
+	if (n >= 128) {
+		__asm__ volatile (
+			"vpbroadcastb %[c], %%ymm0\n\t"
+			"1:\n\t"
+			"vmovdqu %%ymm0,   (%[d])\n\t"
+			"vmovdqu %%ymm0, 32(%[d])\n\t"
+			"vmovdqu %%ymm0, 64(%[d])\n\t"
+			"vmovdqu %%ymm0, 96(%[d])\n\t"
+			"add $128, %[d]\n\t"
+			"sub $128, %[n]\n\t"
+			"cmp $128, %[n]\n\t"
+			"jae 1b\n\t"
+			"vzeroupper\n\t"
+			: [d] "+r" (d), [n] "+r" (n)
+			: [c] "m" (c)
+			: "xmm0", "cc", "memory");
+	}
+	SetSse2(d, c, n);
+}
+
+/*
+ * Enhanced REP MOVSB/STOSB: the microcode beats vector loops on large
+ * blocks but has a startup cost, so short ones still use the loops.
+ */
+#define ERMS_THRESHOLD	512
+
+static MemCopyFn ErmsSmallCopy = CopyFwdSse2;
+static MemSetFn ErmsSmallSet = SetSse2;
+
+static void
+CopyFwdErms(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if (n < ERMS_THRESHOLD) {
+		ErmsSmallCopy(d, s, n);
+		return;
+	}
+	__asm__ volatile ("rep movsb" : "+D" (d), "+S" (s), "+c" (n) : : "memory");
+}
+
+static void
+SetErms(UINT8 *d, UINT8 c, UINTN n)
+{
+	if (n < ERMS_THRESHOLD) {
+		ErmsSmallSet(d, c, n);
+		return;
+	}
+	__asm__ volatile ("rep stosb" : "+D" (d), "+c" (n) : "a" (c) : "memory");
+}
+
+static BOOLEAN
+CpuHasAvx2(void)
+{
+	UINT32 MaxLeaf, Ebx, Ecx, XcrLo, XcrHi;
+
+	AsmCpuid(0, 0, &MaxLeaf, NULL, NULL, NULL);
+	if (MaxLeaf < 7)
+		return FALSE;
+
+	// AVX, and the firmware must have enabled the YMM state (OSXSAVE, XCR0)
+	AsmCpuid(1, 0, NULL, NULL, &Ecx, NULL);
+	if (!(Ecx & (1 << 27)) || !(Ecx & (1 << 28)))
+		return FALSE;
+	__asm__ volatile ("xgetbv" : "=a" (XcrLo), "=d" (XcrHi) : "c" (0));
+	if ((XcrLo & 6) != 6)
+		return FALSE;
+
+	AsmCpuid(7, 0, NULL, &Ebx, NULL, NULL);
+	return (Ebx & (1 << 5)) != 0;
+}
+
+static BOOLEAN
+CpuHasErms(void)
+{
+	UINT32 MaxLeaf, Ebx;
+
+	AsmCpuid(0, 0, &MaxLeaf, NULL, NULL, NULL);
+	if (MaxLeaf < 7)
+		return FALSE;
+	AsmCpuid(7, 0, NULL, &Ebx, NULL, NULL);
+	return (Ebx & (1 << 9)) != 0;
+}
+#endif /* X86_64_BLD */
+
+#if defined(AARCH64_BLD)
+/*
+ * Advanced SIMD versions, 64 bytes per iteration. The copies only take
+ * the vector loop when both pointers can be 16-byte aligned at once, and
+ * align them first, because framebuffer memory mapped as device memory
+ * faults on unaligned accesses; other copies go to the word routines.
+ */
+static void
+CopyFwdNeon(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	if (n < 64 || (((UINTN)d ^ (UINTN)s) & 15) != 0) {
+		CopyFwdWord(d, s, n);
+		return;
+	}
+
+	for (; (UINTN)d & 15; n--)
+		*d++ = *s++;
+	if (n >= 64) {
+		__asm__ volatile (
+			"1:\n\t"
+			"ldp q0, q1, [%[s]], #32\n\t"
+			"ldp q2, q3, [%[s]], #32\n\t"
+			"stp q0, q1, [%[d]], #32\n\t"
+			"stp q2, q3, [%[d]], #32\n\t"
+			"sub %[n], %[n], #64\n\t"
+			"cmp %[n], #64\n\t"
+			"b.hs 1b\n\t"
+			: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+			:
+			: "v0", "v1", "v2", "v3", "cc", "memory");
+	}
+	CopyFwdWord(d, s, n);
+}
+
+static void
+CopyBwdNeon(UINT8 *d, const UINT8 *s, UINTN n)
+{
+	UINT8 *de;
+	const UINT8 *se;
+
+	if (n < 64 || (((UINTN)d ^ (UINTN)s) & 15) != 0) {
+		CopyBwdWord(d, s, n);
+		return;
+	}
+
+	for (; (UINTN)(d + n) & 15; n--)
+		d[n - 1] = s[n - 1];
+	if (n >= 64) {
+		de = d + n;
+		se = s + n;
+		__asm__ volatile (
+			"1:\n\t"
+			"ldp q0, q1, [%[s], #-32]!\n\t"
+			"ldp q2, q3, [%[s], #-32]!\n\t"
+			"stp q0, q1, [%[d], #-32]!\n\t"
+			"stp q2, q3, [%[d], #-32]!\n\t"
+			"sub %[n], %[n], #64\n\t"
+			"cmp %[n], #64\n\t"
+			"b.hs 1b\n\t"
+			: [d] "+r" (de), [s] "+r" (se), [n] "+r" (n)
+			:
+			: "v0", "v1", "v2", "v3", "cc", "memory");
+	}
+	CopyBwdWord(d, s, n);
+}
+
+static void
+SetNeon(UINT8 *d, UINT8 c, UINTN n)
+{
+	if (n >= 64) {
+		for (; (UINTN)d & 15; n--)
+			*d++ = c;
+		__asm__ volatile (
+			"dup v0.16b, %w[c]\n\t"
+			"mov v1.16b, v0.16b\n\t"
+			"1:\n\t"
+			"stp q0, q1, [%[d]], #32\n\t"
+			"stp q0, q1, [%[d]], #32\n\t"
+			"sub %[n], %[n], #64\n\t"
+			"cmp %[n], #64\n\t"
+			"b.hs 1b\n\t"
+			: [d] "+r" (d), [n] "+r" (n)
+			: [c] "r" ((UINT32)c)
+			: "v0", "v1", "cc", "memory");
+	}
+	SetWord(d, c, n);
+}
+
+static BOOLEAN
+CpuHasNeon(void)
+{
+	UINT64 Pfr0;
+
+	// ID_AA64PFR0_EL1.AdvSIMD is 0xF when Advanced SIMD is not implemented
+	__asm__ volatile ("mrs %0, id_aa64pfr0_el1" : "=r" (Pfr0));
+	return ((Pfr0 >> 20) & 0xF) != 0xF;
+}
+#endif /* AARCH64_BLD */
+
+static const struct mem_routines MemBytes = { L"byte", CopyFwdByte, CopyBwdByte, SetByte, CmpByte };
+static const struct mem_routines MemWords = { L"word", CopyFwdWord, CopyBwdWord, SetWord, CmpWord };
+#if defined(X86_64_BLD)
+static const struct mem_routines MemSse2 = { L"SSE2", CopyFwdSse2, CopyBwdSse2, SetSse2, CmpWord };
+static const struct mem_routines MemAvx2 = { L"AVX2", CopyFwdAvx2, CopyBwdAvx2, SetAvx2, CmpWord };
+#endif
+#if defined(AARCH64_BLD)
+static const struct mem_routines MemNeon = { L"NEON", CopyFwdNeon, CopyBwdNeon, SetNeon, CmpWord };
+#endif
+
+static struct mem_routines Mem = { L"word", CopyFwdWord, CopyBwdWord, SetWord, CmpWord };
+
+#define MEM_CHECK_SIZE	640
+#define MEM_CHECK_SHIFT	5	// distance between source and destination in overlapping moves
+
+/*
+ * Run a set of routines over every alignment and a range of lengths,
+ * including overlapping moves in both directions, and compare the results
+ * (and the bytes around them) with the byte-wise routines.
+ */
+static BOOLEAN
+MemSelfCheck(const struct mem_routines *R)
+{
+	UINT8 Src[MEM_CHECK_SIZE], Dst[MEM_CHECK_SIZE], Ref[MEM_CHECK_SIZE];
+	UINTN Len, Off, i;
+	INTN r1, r2;
+
+	for (i = 0; i < MEM_CHECK_SIZE; i++)
+		Src[i] = (UINT8)(i * 7 + 1);
+
+	for (Len = 0; Len <= 620; Len += (Len < 80 ? 1 : 45)) {
+		for (Off = 0; Off < 16; Off++) {
+			SetByte(Dst, 0xA5, MEM_CHECK_SIZE);
+			SetByte(Ref, 0xA5, MEM_CHECK_SIZE);
+			R->CopyFwd(Dst + Off, Src + 15 - Off, Len);
+			CopyFwdByte(Ref + Off, Src + 15 - Off, Len);
+			if (CmpByte(Dst, Ref, MEM_CHECK_SIZE) != 0)
+				return FALSE;
+
+			CopyFwdByte(Dst, Src, MEM_CHECK_SIZE);
+			CopyFwdByte(Ref, Src, MEM_CHECK_SIZE);
+			R->CopyBwd(Dst + Off + MEM_CHECK_SHIFT, Dst + Off, Len);
+			CopyBwdByte(Ref + Off + MEM_CHECK_SHIFT, Ref + Off, Len);
+			if (CmpByte(Dst, Ref, MEM_CHECK_SIZE) != 0)
+				return FALSE;
+
+			R->CopyFwd(Dst + Off, Dst + Off + MEM_CHECK_SHIFT, Len);
+			CopyFwdByte(Ref + Off, Ref + Off + MEM_CHECK_SHIFT, Len);
+			if (CmpByte(Dst, Ref, MEM_CHECK_SIZE) != 0)
+				return FALSE;
+
+			R->Set(Dst + Off, (UINT8)Len, Len);
+			SetByte(Ref + Off, (UINT8)Len, Len);
+			if (CmpByte(Dst, Ref, MEM_CHECK_SIZE) != 0)
+				return FALSE;
+
+			CopyFwdByte(Dst, Src, MEM_CHECK_SIZE);
+			if (R->Cmp(Dst + Off, Src + Off, Len) != 0)
+				return FALSE;
+			if (Len) {
+				Dst[Off + Len - 1] ^= 0x80;
+				r1 = R->Cmp(Dst + Off, Src + Off, Len);
+				r2 = CmpByte(Dst + Off, Src + Off, Len);
+				if ((r1 < 0) != (r2 < 0) || (r1 > 0) != (r2 > 0))
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * Select the memory routines for this CPU. Called once at startup.
+ */
+void
+InitMemRoutines(void)
+{
+	struct mem_routines New = MemWords;
 
-	return (UINT64)Time.Hour * 3600 + (UINT64)Time.Minute * 60 + (UINT64)Time.Second;
+#if defined(X86_64_BLD)
+	New = CpuHasAvx2() ? MemAvx2 : MemSse2;
+	if (CpuHasErms()) {
+		ErmsSmallCopy = New.CopyFwd;
+		ErmsSmallSet = New.Set;
+		New.Name = New.CopyFwd == CopyFwdAvx2 ? L"ERMS/AVX2" : L"ERMS/SSE2";
+		New.CopyFwd = CopyFwdErms;
+		New.Set = SetErms;
+	}
+#elif defined(AARCH64_BLD)
+	if (CpuHasNeon())
+		New = MemNeon;
+#endif
+
+	if (!MemSelfCheck(&New)) {
+		New = MemSelfCheck(&MemWords) ? MemWords : MemBytes;
+		New.Name = New.CopyFwd == CopyFwdWord ? L"word (SIMD self-check failed)" : L"byte (self-check failed)";
+	}
+
+	Mem = New;
+}
+
+const CHAR16 *
+GetMemRoutinesName(void)
+{
+	return Mem.Name;
 }
 
 void *
 MemMove(void *dst, const void *src, UINTN len)
 {
-	UINTN i;
 	UINT8 *d = (UINT8 *)dst;
 	const UINT8 *s = (const UINT8 *)src;
 
 	if (d == s || len == 0)
 		return dst;
 
-	if (d < s) {
-		// Forward copy
-		for (i = 0; i < len; i++)
-			d[i] = s[i];
-	} else {
-		// Backward copy
-		for (i = len; i != 0; i--)
-			d[i - 1] = s[i - 1];
-	}
+	if (d < s || d >= s + len)
+		Mem.CopyFwd(d, s, len);
+	else
+		Mem.CopyBwd(d, s, len);
 
 	return dst;
 }
@@ -195,24 +726,21 @@ MemMove(void *dst, const void *src, UINTN len)
 void *
 MemCopy(void *Dest, const void *Src, UINTN Length)
 {
-	UINT8 *d = (UINT8 *)Dest;
-	const UINT8 *s = (const UINT8 *)Src;
-
-	while (Length--)
-		*d++ = *s++;
-
+	Mem.CopyFwd((UINT8 *)Dest, (const UINT8 *)Src, Length);
 	return Dest;
 }
 
 void *
 MemSet(void *dst, UINT8 value, UINTN size)
 {
-    UINT8 *p = (UINT8 *)dst;
-
-    while (size--)
-        *p++ = value;
+	Mem.Set((UINT8 *)dst, value, size);
+	return dst;
+}
 
-    return dst;
+INTN
+MemCmp(const void *p1, const void *p2, UINTN Size)
+{
+	return Mem.Cmp((const UINT8 *)p1, (const UINT8 *)p2, Size);
 }
 
 CHAR16 *
@@ -265,55 +793,10 @@ AsmCpuid(UINT32 Leaf, UINT32 subleaf, UINT32 *Eax, UINT32 *Ebx, UINT32 *Ecx, UIN
 UINT64
 GetTotalMemoryBytes(void)
 {
-	EFI_STATUS Status;
-	EFI_MEMORY_DESCRIPTOR *MemMap = NULL;
-	EFI_MEMORY_DESCRIPTOR *Desc;
-	UINTN MemMapSize = 0;
-	UINTN MapKey;
-	UINTN DescSize;
-	UINT32 DescVersion;
-	UINT64 Total = 0;
-	UINTN i;
-
-	// Initial probe.
-	Status = uefi_call_wrapper(BS->GetMemoryMap, 5, &MemMapSize, NULL,
-		&MapKey, &DescSize, &DescVersion);
-	if (Status != EFI_BUFFER_TOO_SMALL)
+	if (EFI_ERROR(MemMapRefresh()))
 		return 0;
 
-	/*
-	 * Some computers with older firmware REQUIRE more space.
-	 * This code has been tested with an early 2009 A1181 MacBook,
-	 * with EFI revision 1.10.
-	 */
-	MemMapSize += 2 * DescSize;
-
-	for (;;) {
-		MemMap = AllocatePool(MemMapSize);
-		if (!MemMap)
-			return 0;
-		Status = uefi_call_wrapper(BS->GetMemoryMap, 5, &MemMapSize, MemMap,
-			&MapKey, &DescSize, &DescVersion);
-		if (Status == EFI_BUFFER_TOO_SMALL) {
-			FreePool(MemMap);
-			MemMapSize += 2 * DescSize;
-			continue;
-		}
-		if (EFI_ERROR(Status)) {
-			FreePool(MemMap);
-			return 0;
-		}
-		break;
-	}
-
-	for (i = 0; i < MemMapSize / DescSize; i++) {
-		Desc = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemMap + (i * DescSize));
-		if (Desc->Type == EfiConventionalMemory)
-			Total += Desc->NumberOfPages * EFI_PAGE_SIZE;
-	}
-
-	FreePool(MemMap);
-	return Total;
+	return MemMapTotal(EfiConventionalMemory);
 }
 
 CHAR16 *
@@ -368,3 +851,44 @@ DestinationAddress(void)
 {
 	return (UINT8 *)ActualDestinationAddress;
 }
+
+/*
+ * Function:
+ * FillFileInfo()
+ *
+ * Description:
+ * Build an EFI_FILE_INFO record for the file handles of the filesystem plugins.
+ * Time stamps are left zeroed.
+ *
+ * Arguments:
+ * Name: File name, without any path.
+ * FileSize: File size in bytes.
+ * Attribute: EFI_FILE_* attribute bits.
+ * BufferSize: On input the size of Buffer, on output the size of the record.
+ * Buffer: Receives the record.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_BUFFER_TOO_SMALL if Buffer cannot hold the record.
+ */
+EFI_STATUS
+FillFileInfo(const CHAR16 *Name, UINT64 FileSize, UINT64 Attribute, UINTN *BufferSize, VOID *Buffer)
+{
+	EFI_FILE_INFO *Info = Buffer;
+	UINTN NameSize = (StrLen(Name) + 1) * sizeof(CHAR16);
+	UINTN Needed = SIZE_OF_EFI_FILE_INFO + NameSize;
+
+	if (*BufferSize < Needed || !Buffer) {
+		*BufferSize = Needed;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	SetMem(Info, Needed, 0);
+	Info->Size = Needed;
+	Info->FileSize = FileSize;
+	Info->PhysicalSize = FileSize;
+	Info->Attribute = Attribute;
+	CopyMem(Info->FileName, (VOID *)Name, NameSize);
+
+	*BufferSize = Needed;
+	return EFI_SUCCESS;
+}
@@ -1,918 +1,707 @@
-/* inflate.c -- Not copyrighted 1992 by Mark Adler
-   version c10p1, 10 January 1993 */
-
-/* You can do whatever you like with this source file, though I would
-   prefer that if you modify it and redistribute it that you include
-   comments to that effect with your name and the date.  Thank you.
-   [The history has been moved to the file ChangeLog.]
- */
-
 /*
-   Inflate deflated (PKZIP's method 8 compressed) data.  The compression
-   method searches for as much of the current string of bytes (up to a
-   length of 258) in the previous 32K bytes.  If it doesn't find any
-   matches (of at least length 3), it codes the next byte.  Otherwise, it
-   codes the length of the matched string and its distance backwards from
-   the current position.  There is a single Huffman code that codes both
-   single bytes (called "literals") and match lengths.  A second Huffman
-   code codes the distance information, which follows a length code.  Each
-   length or distance code actually represents a base value and a number
-   of "extra" (sometimes zero) bits to get to add to the base value.  At
-   the end of each deflated block is a special end-of-block (EOB) literal/
-   length code.  The decoding process is basically: get a literal/length
-   code; if EOB then done; if a literal, emit the decoded byte; if a
-   length then get the distance and emit the referred-to bytes from the
-   sliding window of previously emitted data.
-
-   There are (currently) three kinds of inflate blocks: stored, fixed, and
-   dynamic.  The compressor deals with some chunk of data at a time, and
-   decides which method to use on a chunk-by-chunk basis.  A chunk might
-   typically be 32K or 64K.  If the chunk is uncompressible, then the
-   "stored" method is used.  In this case, the bytes are simply stored as
-   is, eight bits per byte, with none of the above coding.  The bytes are
-   preceded by a count, since there is no longer an EOB code.
-
-   If the data is compressible, then either the fixed or dynamic methods
-   are used.  In the dynamic method, the compressed data is preceded by
-   an encoding of the literal/length and distance Huffman codes that are
-   to be used to decode this block.  The representation is itself Huffman
-   coded, and so is preceded by a description of that code.  These code
-   descriptions take up a little space, and so for small blocks, there is
-   a predefined set of codes, called the fixed codes.  The fixed method is
-   used if the block codes up smaller that way (usually for quite small
-   chunks), otherwise the dynamic method is used.  In the latter case, the
-   codes are customized to the probabilities in the current block, and so
-   can code it much better than the pre-determined fixed codes.
- 
-   The Huffman codes themselves are decoded using a mutli-level table
-   lookup, in order to maximize the speed of decoding plus the speed of
-   building the decoding tables.  See the comments below that precede the
-   lbits and dbits tuning parameters.
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-
 /*
-   Notes beyond the 1.93a appnote.txt:
-
-   1. Distance pointers never point before the beginning of the output
-      stream.
-   2. Distance pointers can point back across blocks, up to 32k away.
-   3. There is an implied maximum of 7 bits for the bit length table and
-      15 bits for the actual data.
-   4. If only one code exists, then it is encoded using one bit.  (Zero
-      would be more efficient, but perhaps a little confusing.)  If two
-      codes exist, they are coded using one bit each (0 and 1).
-   5. There is no way of sending zero distance codes--a dummy must be
-      sent if there are none.  (History: a pre 2.0 version of PKZIP would
-      store blocks with no distance codes, but this was discovered to be
-      too harsh a criterion.)  Valid only for 1.93a.  2.04c does allow
-      zero distance codes, which is sent as one code of zero bits in
-      length.
-   6. There are up to 286 literal/length codes.  Code 256 represents the
-      end-of-block.  Note however that the static length tree defines
-      288 codes just to fill out the Huffman codes.  Codes 286 and 287
-      cannot be used though, since there is no length base or extra bits
-      defined for them.  Similarly, there are up to 30 distance codes.
-      However, static trees define 32 codes (all 5 bits) to fill out the
-      Huffman codes, but the last two had better not show up in the data.
-   7. Unzip can check dynamic Huffman blocks for complete code sets.
-      The exception is that a single code would not be complete (see #4).
-   8. The five bits following the block type is really the number of
-      literal codes sent minus 257.
-   9. Length codes 8,16,16 are interpreted as 13 length codes of 8 bits
-      (1+6+6).  Therefore, to output three times the length, you output
-      three codes (1+1+1), whereas to output four times the same length,
-      you only need two codes (1+3).  Hmm.
-  10. In the tree reconstruction algorithm, Code = Code + Increment
-      only if BitLength(i) is not zero.  (Pretty obvious.)
-  11. Correction: 4 Bits: # of Bit Length codes - 4     (4 - 19)
-  12. Note: length code 284 can represent 227-258, but length code 285
-      really is 258.  The last length deserves its own, short code
-      since it gets used a lot in very redundant files.  The length
-      258 is special since 258 - 3 (the min match length) is 255.
-  13. The literal/length and distance code bit lengths are read as a
-      single stream of lengths.  It is possible (and advantageous) for
-      a repeat code (16, 17, or 18) to go across the boundary between
-      the two sets of lengths.
+ * inflate.c
+ * Deflate (RFC 1951) decoder.
+ *
+ * Huffman codes are decoded with one table lookup: a primary table indexed
+ * by the next LITLEN_BITS (or DIST_BITS) bits of input, with the rare longer
+ * codes sent on to a subtable. The input is kept in a 64-bit bit buffer
+ * that is refilled a whole word at a time, which leaves enough bits after
+ * each refill for a length and distance pair, or for up to three literals.
+ *
+ * Most of the stream goes through a fast loop that is only entered while
+ * at least a word of input and a maximal match of output space remain, so
+ * it needs no bounds checks beyond the match distance. The rest, i.e. the
+ * last few bytes of each input piece and of the output, is decoded a
+ * symbol at a time, pulling input a byte at a time through fill_inbuf().
+ *
+ * The decoder's window is the output buffer itself, and the tables for a
+ * dynamic block are rebuilt in place in one static arena, so decoding a
+ * stream of any length allocates nothing and its footprint is fixed at
+ * build time.
  */
 
 #include "inflate.h"
 
-extern void* memcpy(void*, const void*, unsigned);
-extern void* memset(void*, int, unsigned);
-
-/* Huffman code lookup table entry--this entry is four bytes for machines
-   that have 16-bit pointers (e.g. PC's in the small or medium model).
-   Valid extra bits are 0..13.  e == 15 is EOB (end of block), e == 16
-   means that v is a literal, 16 < e < 32 means that v is a pointer to
-   the next table, which codes e - 16 bits, and lastly e == 99 indicates
-   an unused code.  If a code with e == 99 is looked up, this implies an
-   error in the data. */
-struct huft {
-  uch e;                /* number of extra bits or operation */
-  uch b;                /* number of bits in this code or subcode */
-  union {
-    ush n;              /* literal, length base, or distance base */
-    struct huft *t;     /* pointer to next level of table */
-  } v;
-};
+extern void* memcpy(void*, const void*, __SIZE_TYPE__);
 
+typedef unsigned int huff_t;            /* decode table entry */
+typedef unsigned long long bitbuf_t;
 
-/* Function prototypes */
-int huft_build(unsigned *, unsigned, unsigned, const ush *, const ush *,
-                   struct huft **, int *);
-int huft_free(struct huft *);
-int inflate_codes(struct huft *, struct huft *, int, int);
-int inflate_stored(void);
-int inflate_fixed(void);
-int inflate_dynamic(void);
-int inflate_block(int *);
-int inflate(void);
-
-
-/* The inflate algorithm uses a sliding 32K byte window on the uncompressed
-   stream to find repeated byte strings.  This is implemented here as a
-   circular buffer.  The index is updated simply by incrementing and then
-   and'ing with 0x7fff (32K-1). */
-/* It is left to other modules to supply the 32K area.  It is assumed
-   to be usable as if it were declared "uch slide[32768];" or as just
-   "uch *slide;" and then malloc'ed in the latter case.  The definition
-   must be in unzip.h, included above. */
-/* unsigned wp;             current position in slide */
-/*#define wp outcnt*/
-/*#define flush_output(w) (wp=(w),flush_window())*/
-
-/* Tables for deflate from PKZIP's appnote.txt. */
-static const unsigned border[] = {    /* Order of the bit length code lengths */
-        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
-static const ush cplens[] = {         /* Copy lengths for literal codes 257..285 */
-        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
-        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0};
-        /* note: see note #13 above about the 258 in this list. */
-static const ush cplext[] = {         /* Extra bits for literal codes 257..285 */
-        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
-        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 99, 99}; /* 99==invalid */
-static const ush cpdist[] = {         /* Copy offsets for distance codes 0..29 */
-        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
-        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
-        8193, 12289, 16385, 24577};
-static const ush cpdext[] = {         /* Extra bits for distance codes */
-        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
-        7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
-        12, 12, 13, 13};
-
-
-
-/* Macros for inflate() bit peeking and grabbing.
-   The usage is:
-   
-        NEEDBITS(j)
-        x = b & mask_bits[j];
-        DUMPBITS(j)
-
-   where NEEDBITS makes sure that b has at least j bits in it, and
-   DUMPBITS removes the bits from b.  The macros use the variable k
-   for the number of bits in b.  Normally, b and k are register
-   variables for speed, and are initialized at the beginning of a
-   routine that uses these macros from a global bit buffer and count.
-
-   If we assume that EOB will be the longest code, then we will never
-   ask for bits with NEEDBITS that are beyond the end of the stream.
-   So, NEEDBITS should not read any more bytes than are needed to
-   meet the request.  Then no bytes need to be "returned" to the buffer
-   at the end of the last block.
-
-   However, this assumption is not true for fixed blocks--the EOB code
-   is 7 bits, but the other literal/length codes can be 8 or 9 bits.
-   (The EOB code is shorter than other codes because fixed blocks are
-   generally short.  So, while a block always has an EOB, many other
-   literal/length codes have a significantly lower probability of
-   showing up at all.)  However, by making the first table have a
-   lookup of seven bits, the EOB code will be found in that first
-   lookup, and so will not require that too many bits be pulled from
-   the stream.
- */
+#define MAX_CODE_LEN        15
+#define MAX_MATCH           258
 
-ulg bb;                         /* bit buffer */
-unsigned bk;                    /* bits in bit buffer */
-
-static const ush mask_bits[] = {
-    0x0000,
-    0x0001, 0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
-    0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff, 0xffff
-};
-
-#define get_byte()  (inptr < inbuf_end ? *inptr++ : fill_inbuf())
-#define NEXTBYTE()  (uch)get_byte()
-#define NEEDBITS(n) {while(k<(n)){b|=((ulg)NEXTBYTE())<<k;k+=8;}}
-#define DUMPBITS(n) {b>>=(n);k-=(n);}
+#define LITLEN_SYMS         288
+#define DIST_SYMS           32
+#define PRECODE_SYMS        19
 
+/*
+ * Primary table sizes, and the most entries a table plus its subtables
+ * can need for any complete code (zlib's examples/enough.c).
+ */
+#define LITLEN_BITS         11
+#define DIST_BITS           8
+#define PRECODE_BITS        7
+#define LITLEN_ENOUGH       2342    /* enough 288 11 15 */
+#define DIST_ENOUGH         402     /* enough 32 8 15 */
+#define PRECODE_ENOUGH      128     /* enough 19 7 7 */
 
 /*
-   Huffman code decoding is performed using a multi-level table lookup.
-   The fastest way to decode is to simply build a lookup table whose
-   size is determined by the longest code.  However, the time it takes
-   to build this table can also be a factor if the data being decoded
-   is not very long.  The most common codes are necessarily the
-   shortest codes, so those codes dominate the decoding time, and hence
-   the speed.  The idea is you can have a shorter table that decodes the
-   shorter, more probable codes, and then point to subsidiary tables for
-   the longer codes.  The time it costs to decode the longer codes is
-   then traded against the time it takes to make longer tables.
-
-   This results of this trade are in the variables lbits and dbits
-   below.  lbits is the number of bits the first level table for literal/
-   length codes can decode in one step, and dbits is the same thing for
-   the distance codes.  Subsequent tables are also less than or equal to
-   those sizes.  These values may be adjusted either when all of the
-   codes are shorter than that, in which case the longest code length in
-   bits is used, or when the shortest code is *longer* than the requested
-   table size, in which case the length of the shortest code in bits is
-   used.
-
-   There are two different values for the two tables, since they code a
-   different number of possibilities each.  The literal/length table
-   codes 286 possible values, or in a flat code, a little over eight
-   bits.  The distance table codes 30 possible values, or a little less
-   than five bits, flat.  The optimum values for speed end up being
-   about one bit more than those, so lbits is 8+1 and dbits is 5+1.
-   The optimum values may differ though from machine to machine, and
-   possibly even between compilers.  Your mileage may vary.
+ * Decode table entries:
+ *   bits 0-3    code length, or the primary table bits for a subtable link
+ *   bits 4-7    extra bits for a length or distance, or subtable index bits
+ *   bits 8-11   flags
+ *   bits 16-31  literal, length or distance base, symbol, or subtable start
  */
+#define HUFF_LEN(e)         ((e) & 0xF)
+#define HUFF_EXTRA(e)       (((e) >> 4) & 0xF)
+#define HUFF_VALUE(e)       ((e) >> 16)
+#define HUFF_LITERAL        0x100
+#define HUFF_EOB            0x200
+#define HUFF_SUBTABLE       0x400
+#define HUFF_INVALID        0x800
+#define HUFF_ENTRY(v, x)    (((huff_t)(v) << 16) | ((x) << 4))
+
+/* Bounds the fast loop may run up to without checking. */
+#define FAST_IN_MARGIN      8
+#define FAST_OUT_MARGIN     (MAX_MATCH + 2 * 8)
+
+#include "inflate_fixed.h"
+
+struct inflate_tables {
+    huff_t litlen[LITLEN_ENOUGH];
+    huff_t dist[DIST_ENOUGH];
+    huff_t precode[PRECODE_ENOUGH];
+};
 
+/* LITLEN_ENOUGH etc. bound every table a valid header can build. */
+static struct inflate_tables tables;
 
-static const int lbits = 9;          /* bits in base literal/length lookup table */
-static const int dbits = 6;          /* bits in base distance lookup table */
+ulg bb;                         /* bit buffer */
+unsigned bk;                    /* bits in bit buffer */
 
+/* Order in which the precode lengths are sent. */
+static const uch precode_order[PRECODE_SYMS] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
 
-/* If BMAX needs to be larger than 16, then h and x[] should be ulg. */
-#define BMAX 16         /* maximum bit length of any code (16 for explode) */
-#define N_MAX 288       /* maximum number of codes in any set */
+static const ush length_base[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uch length_extra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const ush dist_base[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uch dist_extra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
 
+#define BITMASK(n)          (((bitbuf_t)1 << (n)) - 1)
 
-unsigned hufts;         /* track memory usage */
+/*
+ * Byte-at-a-time bit access for the careful paths. The fast loop keeps
+ * its own copy of the input pointer and writes it back before these are
+ * used.
+ */
+#define get_byte()          (inptr < inbuf_end ? *inptr++ : fill_inbuf())
+#define NEEDBITS(n)         while (k < (n)) { b |= (bitbuf_t)get_byte() << k; k += 8; }
+#define DUMPBITS(n)         { b >>= (n); k -= (n); }
 
+/*
+ * Top the bit buffer up to 56-63 bits with one unaligned word load. Only
+ * whole bytes are counted as consumed; the bits loaded above k are the
+ * following input bytes and are simply loaded again next time.
+ */
+#define REFILL_FAST() { \
+    bitbuf_t w; \
+    __builtin_memcpy(&w, in, sizeof(w)); \
+    b |= w << k; \
+    in += (63 - k) >> 3; \
+    k |= 56; \
+}
 
-int huft_build(
-unsigned *b,            /* code lengths in bits (all assumed <= BMAX) */
-unsigned n,             /* number of codes (assumed <= N_MAX) */
-unsigned s,             /* number of simple-valued codes (0..s-1) */
-const ush *d,                 /* list of base values for non-simple codes */
-const ush *e,                 /* list of extra bits for non-simple codes */
-struct huft **t,        /* result: starting table */
-int *m                 /* maximum lookup bits, returns actual */
-)
-/* Given a list of code lengths and a maximum table size, make a set of
-   tables to decode that set of codes.  Return zero on success, one if
-   the given code set is incomplete (the tables are still built in this
-   case), two if the input is invalid (all zero length codes or an
-   oversubscribed set of lengths), and three if not enough memory. */
+/*
+ * Build a decode table for a canonical Huffman code. results[] holds the
+ * entry for each symbol minus its length. As in zlib, a code may only be
+ * incomplete if allow_incomplete is set and it has a single one-bit code
+ * or none at all; the unused slots decode as HUFF_INVALID.
+ * Returns zero on success.
+ */
+static int
+build_table(huff_t *table, const uch *lens, unsigned nsyms, const huff_t *results,
+    unsigned tablebits, unsigned enough, int allow_incomplete)
 {
-  unsigned a;                   /* counter for codes of length k */
-  unsigned c[BMAX+1];           /* bit length count table */
-  unsigned f;                   /* i repeats in table every f entries */
-  int g;                        /* maximum code length */
-  int h;                        /* table level */
-  register unsigned i;          /* counter, current code */
-  register unsigned j;          /* counter */
-  register int k;               /* number of bits in current code */
-  int l;                        /* bits per table (returned in m) */
-  register unsigned *p;         /* pointer into c[], b[], or v[] */
-  register struct huft *q;      /* points to current table */
-  struct huft r;                /* table entry for structure assignment */
-  struct huft *u[BMAX];         /* table stack */
-  unsigned v[N_MAX];            /* values in order of bit length */
-  register int w;               /* bits before this table == (l * h) */
-  unsigned x[BMAX+1];           /* bit offsets, then code stack */
-  unsigned *xp;                 /* pointer into x */
-  int y;                        /* number of dummy codes added */
-  unsigned z;                   /* number of entries in current table */
-
-
-  /* Generate counts for each bit length */
-  memset(c, 0, sizeof(c));
-  p = b;  i = n;
-  do {
-/*    Tracecv(*p, (stderr, (n-i >= ' ' && n-i <= '~' ? "%c %d\n" : "0x%x %d\n"), 
-	    n-i, *p));*/
-    c[*p]++;                    /* assume all entries <= BMAX */
-    p++;                      /* Can't combine with above line (Solaris bug) */
-  } while (--i);
-  if (c[0] == n)                /* null input--all zero length codes */
-  {
-    *t = (struct huft *)NULL;
-    *m = 0;
-    return 0;
-  }
-
-
-  /* Find minimum and maximum length, bound *m by those */
-  l = *m;
-  for (j = 1; j <= BMAX; j++)
-    if (c[j])
-      break;
-  k = j;                        /* minimum code length */
-  if ((unsigned)l < j)
-    l = j;
-  for (i = BMAX; i; i--)
-    if (c[i])
-      break;
-  g = i;                        /* maximum code length */
-  if ((unsigned)l > i)
-    l = i;
-  *m = l;
-
-
-  /* Adjust last length count to fill out codes, if needed */
-  for (y = 1 << j; j < i; j++, y <<= 1)
-    if ((y -= c[j]) < 0)
-      return 2;                 /* bad input: more codes than bits */
-  if ((y -= c[i]) < 0)
-    return 2;
-  c[i] += y;
-
-
-  /* Generate starting offsets into the value table for each length */
-  x[1] = j = 0;
-  p = c + 1;  xp = x + 2;
-  while (--i) {                 /* note that i == g from above */
-    *xp++ = (j += *p++);
-  }
-
-
-  /* Make a table of values in order of bit lengths */
-  p = b;  i = 0;
-  do {
-    if ((j = *p++) != 0)
-      v[x[j]++] = i;
-  } while (++i < n);
-
-
-  /* Generate the Huffman codes and for each, make the table entries */
-  x[0] = i = 0;                 /* first Huffman code is zero */
-  p = v;                        /* grab values in bit order */
-  h = -1;                       /* no tables yet--level -1 */
-  w = -l;                       /* bits decoded == (l * h) */
-  u[0] = (struct huft *)NULL;   /* just to keep compilers happy */
-  q = (struct huft *)NULL;      /* ditto */
-  z = 0;                        /* ditto */
-
-  /* go through the bit lengths (k already is bits in shortest code) */
-  for (; k <= g; k++)
-  {
-    a = c[k];
-    while (a--)
-    {
-      /* here i is the Huffman code of length k bits for value *p */
-      /* make tables up to required level */
-      while (k > w + l)
-      {
-        h++;
-        w += l;                 /* previous table always l bits */
-
-        /* compute minimum size table less than or equal to l bits */
-        z = (z = g - w) > (unsigned)l ? l : z;  /* upper limit on table size */
-        if ((f = 1 << (j = k - w)) > a + 1)     /* try a k-w bit table */
-        {                       /* too few codes for k-w bit table */
-          f -= a + 1;           /* deduct codes from patterns left */
-          xp = c + k;
-          while (++j < z)       /* try smaller tables up to z bits */
-          {
-            if ((f <<= 1) <= *++xp)
-              break;            /* enough codes to use up j bits */
-            f -= *xp;           /* else deduct codes from patterns */
-          }
-        }
-        z = 1 << j;             /* table entries for j-bit table */
+    unsigned count[MAX_CODE_LEN + 1];
+    unsigned offs[MAX_CODE_LEN + 1];
+    ush sorted[LITLEN_SYMS];
+    unsigned len, sym, maxlen, i, end, stride;
+    unsigned codeword, bit, prefix, start, subbits, used;
+    huff_t entry;
+    int left;
+
+    for (len = 0; len <= MAX_CODE_LEN; len++)
+        count[len] = 0;
+    for (sym = 0; sym < nsyms; sym++)
+        count[lens[sym]]++;
+
+    maxlen = 0;
+    left = 1;
+    for (len = 1; len <= MAX_CODE_LEN; len++) {
+        left = (left << 1) - (int)count[len];
+        if (left < 0)
+            return 1;           /* over-subscribed */
+        if (count[len])
+            maxlen = len;
+    }
 
-        /* allocate and link in new table */
-        if ((q = (struct huft *)malloc((z + 1)*sizeof(struct huft))) ==
-            (struct huft *)NULL)
-        {
-          if (h)
-            huft_free(u[0]);
-          return 3;             /* not enough memory */
-        }
-        hufts += z + 1;         /* track memory usage */
-        *t = q + 1;             /* link to list for huft_free() */
-        *(t = &(q->v.t)) = (struct huft *)NULL;
-        u[h] = ++q;             /* table starts after link */
+    if (left > 0) {
+        if (!allow_incomplete || maxlen > 1)
+            return 1;
+        for (i = 0; i < (1U << tablebits); i++)
+            table[i] = HUFF_INVALID;
+        if (maxlen == 0)
+            return 0;
+        /* a single one-bit code: codeword 0 */
+        for (sym = 0; lens[sym] == 0; sym++)
+            ;
+        for (i = 0; i < (1U << tablebits); i += 2)
+            table[i] = results[sym] | 1;
+        return 0;
+    }
 
-        /* connect to last table, if there is one */
-        if (h)
-        {
-          x[h] = i;             /* save pattern for backing up */
-          r.b = (uch)l;         /* bits to dump before this table */
-          r.e = (uch)(16 + j);  /* bits in this table */
-          r.v.t = q;            /* pointer to this table */
-          j = i >> (w - l);     /* (get around Turbo C bug) */
-          u[h-1][j] = r;        /* connect to last table */
+    /* sort the symbols by code length, then by value */
+    offs[1] = 0;
+    for (len = 1; len < MAX_CODE_LEN; len++)
+        offs[len + 1] = offs[len] + count[len];
+    for (sym = 0; sym < nsyms; sym++)
+        if (lens[sym])
+            sorted[offs[lens[sym]]++] = (ush)sym;
+
+    /*
+     * Hand out codewords in canonical order. They are kept bit-reversed,
+     * since the decoder sees the first bit of a code in the low bit of its
+     * index. Primary table entries for short codes are written for the
+     * code length and then doubled up as the length grows.
+     */
+    i = 0;
+    codeword = 0;
+    for (len = 1; count[len] == 0; len++)
+        ;
+    end = 1U << len;
+
+    while (len <= tablebits) {
+        for (sym = count[len]; sym > 0; sym--) {
+            table[codeword] = results[sorted[i++]] | len;
+            if (codeword == end - 1) {
+                /* that was the last code */
+                for (; len < tablebits; len++) {
+                    memcpy(&table[end], table, end * sizeof(huff_t));
+                    end <<= 1;
+                }
+                return 0;
+            }
+            for (bit = 1U << (len - 1); codeword & bit; bit >>= 1)
+                codeword ^= bit;
+            codeword |= bit;
         }
-      }
-
-      /* set up table entry in r */
-      r.b = (uch)(k - w);
-      if (p >= v + n)
-        r.e = 99;               /* out of values--invalid code */
-      else if (*p < s)
-      {
-        r.e = (uch)(*p < 256 ? 16 : 15);    /* 256 is end-of-block code */
-        r.v.n = (ush)(*p);             /* simple code is just the value */
-	p++;                           /* one compiler does not like *p++ */
-      }
-      else
-      {
-        r.e = (uch)e[*p - s];   /* non-simple--look up in lists */
-        r.v.n = d[*p++ - s];
-      }
-
-      /* fill code-like entries with r */
-      f = 1 << (k - w);
-      for (j = i >> w; j < z; j += f)
-        q[j] = r;
-
-      /* backwards increment the k-bit code i */
-      for (j = 1 << (k - 1); i & j; j >>= 1)
-        i ^= j;
-      i ^= j;
-
-      /* backup over finished tables */
-      while ((i & ((1 << w) - 1)) != x[h])
-      {
-        h--;                    /* don't need to update q */
-        w -= l;
-      }
+        do {
+            if (++len <= tablebits) {
+                memcpy(&table[end], table, end * sizeof(huff_t));
+                end <<= 1;
+            }
+        } while (count[len] == 0);
     }
-  }
 
+    /* codes longer than tablebits go to subtables after the primary table */
+    end = 1U << tablebits;
+    prefix = ~0U;
+    start = 0;
+    sym = count[len];
+    for (;;) {
+        if ((codeword & ((1U << tablebits) - 1)) != prefix) {
+            prefix = codeword & ((1U << tablebits) - 1);
+            start = end;
+            subbits = len - tablebits;
+            used = sym;
+            while (used < (1U << subbits)) {
+                subbits++;
+                used = (used << 1) + count[tablebits + subbits];
+            }
+            end = start + (1U << subbits);
+            if (end > enough)
+                return 1;
+            table[prefix] = HUFF_ENTRY(start, subbits) | HUFF_SUBTABLE | tablebits;
+        }
 
-  /* Return true (1) if we were given an incomplete table */
-  return y != 0 && g != 1;
-}
+        entry = results[sorted[i++]] | (len - tablebits);
+        stride = 1U << (len - tablebits);
+        for (bit = start + (codeword >> tablebits); bit < end; bit += stride)
+            table[bit] = entry;
 
+        if (codeword == (1U << len) - 1)
+            return 0;
+        for (bit = 1U << (len - 1); codeword & bit; bit >>= 1)
+            codeword ^= bit;
+        codeword |= bit;
 
+        sym--;
+        while (sym == 0)
+            sym = count[++len];
+    }
+}
 
-int huft_free(struct huft *t)
-/* Free the malloc'ed tables built by huft_build(), which makes a linked
-   list of the tables it made, with the links in a dummy first entry of
-   each table. */
+/* Per-symbol decode results for the literal/length code. */
+static huff_t
+litlen_result(unsigned sym)
 {
-  register struct huft *p, *q;
-
-
-  /* Go through linked list, freeing from the malloced (t[-1]) address. */
-  p = t;
-  while (p != (struct huft *)NULL)
-  {
-    q = (--p)->v.t;
-    free((char*)p);
-    p = q;
-  } 
-  return 0;
+    if (sym < 256)
+        return HUFF_ENTRY(sym, 0) | HUFF_LITERAL;
+    if (sym == 256)
+        return HUFF_EOB;
+    if (sym < 286)
+        return HUFF_ENTRY(length_base[sym - 257], length_extra[sym - 257]);
+    return HUFF_INVALID;
 }
 
+static huff_t
+dist_result(unsigned sym)
+{
+    if (sym < 30)
+        return HUFF_ENTRY(dist_base[sym], dist_extra[sym]);
+    return HUFF_INVALID;
+}
 
-int inflate_codes(
-struct huft *tl,
-struct huft *td,   /* literal/length and distance decoder tables */
-int bl,
-int bd             /* number of bits decoded by tl[] and td[] */
-)
-/* inflate (decompress) the codes in a deflated (compressed) block.
-   Return an error code or zero if it all goes ok. */
+static int
+build_litlen(huff_t *table, const uch *lens, unsigned n)
 {
-  register unsigned e;  /* table entry flag/number of extra bits */
-  unsigned n, d;        /* length and index for copy */
-  struct huft *t;       /* pointer to table entry */
-  unsigned ml, md;      /* masks for bl and bd bits */
-  register ulg b=bb;       /* bit buffer */
-  register unsigned k=bk;  /* number of bits in bit buffer */
-  register uch* p=(uch*)outptr;
-
-  /* inflate the coded data */
-  ml = mask_bits[bl];           /* precompute masks for speed */
-  md = mask_bits[bd];
-  for (;;)                      /* do until end of block */
-  {
-    NEEDBITS((unsigned)bl)
-    if ((e = (t = tl + ((unsigned)b & ml))->e) > 16)
-      do {
-        if (e == 99)
-          return 1;
-        DUMPBITS(t->b)
-        e -= 16;
-        NEEDBITS(e)
-      } while ((e = (t = t->v.t + ((unsigned)b & mask_bits[e]))->e) > 16);
-    DUMPBITS(t->b)
-    if (e == 16)                /* then it's a literal */
-    {
-      *p++ = (uch)t->v.n;
-    }
-    else                        /* it's an EOB or a length */
-    {
-      /* exit if end of block */
-      if (e == 15)
-        break;
-
-      /* get length of block to copy */
-      NEEDBITS(e)
-      n = t->v.n + ((unsigned)b & mask_bits[e]);
-      DUMPBITS(e);
-
-      /* decode distance of block to copy */
-      NEEDBITS((unsigned)bd)
-      if ((e = (t = td + ((unsigned)b & md))->e) > 16)
-        do {
-          if (e == 99)
-            return 1;
-          DUMPBITS(t->b)
-          e -= 16;
-          NEEDBITS(e)
-        } while ((e = (t = t->v.t + ((unsigned)b & mask_bits[e]))->e) > 16);
-      DUMPBITS(t->b)
-      NEEDBITS(e)
-      d = t->v.n + ((unsigned)b & mask_bits[e]);
-	  d &= ZIP_WINDOW_SIZE-1;
-      DUMPBITS(e)
-
-      /* do the copy */
-	  if (d>=n)
-		  {
-		  memcpy(p, p-d, n);
-		  p+=n;
-		  }
-	  else
-		  {
-		  uch* q=p-d;
-		  while(n--) *p++=*q++;
-		  }
-    }
-  }
+    huff_t results[LITLEN_SYMS];
+    unsigned i;
 
+    for (i = 0; i < n; i++)
+        results[i] = litlen_result(i);
+    return build_table(table, lens, n, results, LITLEN_BITS, LITLEN_ENOUGH, 1);
+}
 
-  /* restore the globals from the locals */
-  outptr=p;
-  bb = b;                       /* restore global bit buffer */
-  bk = k;
+static int
+build_dist(huff_t *table, const uch *lens, unsigned n)
+{
+    huff_t results[DIST_SYMS];
+    unsigned i;
 
-  /* done */
-  return 0;
+    for (i = 0; i < n; i++)
+        results[i] = dist_result(i);
+    return build_table(table, lens, n, results, DIST_BITS, DIST_ENOUGH, 1);
 }
 
+/*
+ * Copy a match of len bytes from dist back. Stores are whole words, so
+ * this may write up to 2 * sizeof(bitbuf_t) - 1 bytes past the match;
+ * the fast loop leaves room for that.
+ */
+static inline __attribute__((always_inline)) void
+copy_match_fast(uch *out, unsigned len, unsigned dist)
+{
+    const uch *src = out - dist;
+    uch *end = out + len;
+    bitbuf_t w, w2;
 
+    if (dist >= 2 * sizeof(bitbuf_t)) {
+        do {
+            __builtin_memcpy(&w, src, sizeof(w));
+            __builtin_memcpy(&w2, src + sizeof(w), sizeof(w2));
+            __builtin_memcpy(out, &w, sizeof(w));
+            __builtin_memcpy(out + sizeof(w), &w2, sizeof(w2));
+            src += 2 * sizeof(w);
+            out += 2 * sizeof(w);
+        } while (out < end);
+    } else if (dist >= sizeof(bitbuf_t)) {
+        /* each word read was completely written by an earlier store */
+        do {
+            __builtin_memcpy(&w, src, sizeof(w));
+            __builtin_memcpy(out, &w, sizeof(w));
+            src += sizeof(w);
+            out += sizeof(w);
+        } while (out < end);
+    } else if (dist == 1) {
+        /* a run of one byte */
+        w = (bitbuf_t)*src * 0x0101010101010101ULL;
+        do {
+            __builtin_memcpy(out, &w, sizeof(w));
+            __builtin_memcpy(out + sizeof(w), &w, sizeof(w));
+            out += 2 * sizeof(w);
+        } while (out < end);
+    } else {
+        while (out < end)
+            *out++ = *src++;
+    }
+}
 
-int inflate_stored()
-/* "decompress" an inflated type 0 (stored) block. */
+/*
+ * Decode the codes of one compressed block up to its end-of-block code.
+ * Returns zero on success.
+ */
+static int
+inflate_codes(const huff_t *lt, unsigned lbits, const huff_t *dt, unsigned dbits)
 {
-  unsigned n;           /* number of bytes in block */
-  register ulg b;       /* bit buffer */
-  register unsigned k;  /* number of bits in bit buffer */
-
-  register uch* p=(uch*)outptr;
+    bitbuf_t b = bb;
+    unsigned k = bk;
+    uch *out = (uch *)outptr;
+    uch *out_start = (uch *)outbuf_start;
+    uch *out_end = (uch *)outbuf_end;
+    const uch *in, *in_end;
+    unsigned lmask = (1U << lbits) - 1;
+    unsigned dmask = (1U << dbits) - 1;
+    unsigned len, dist;
+    huff_t e;
+
+    for (;;) {
+        in = inptr;
+        in_end = inbuf_end;
+
+        while (in_end - in >= FAST_IN_MARGIN && out_end - out >= FAST_OUT_MARGIN) {
+            REFILL_FAST()
+
+            e = lt[b & lmask];
+            if (e & HUFF_SUBTABLE) {
+                DUMPBITS(HUFF_LEN(e))
+                e = lt[HUFF_VALUE(e) + (b & BITMASK(HUFF_EXTRA(e)))];
+            }
+            DUMPBITS(HUFF_LEN(e))
+
+            if (e & HUFF_LITERAL) {
+                /* at least 41 bits are left: room for two more literals */
+                *out++ = (uch)HUFF_VALUE(e);
+                e = lt[b & lmask];
+                if (!(e & HUFF_LITERAL))
+                    continue;
+                DUMPBITS(HUFF_LEN(e))
+                *out++ = (uch)HUFF_VALUE(e);
+                e = lt[b & lmask];
+                if (!(e & HUFF_LITERAL))
+                    continue;
+                DUMPBITS(HUFF_LEN(e))
+                *out++ = (uch)HUFF_VALUE(e);
+                continue;
+            }
+
+            if (e & (HUFF_EOB | HUFF_INVALID)) {
+                if (e & HUFF_INVALID)
+                    return 1;
+                inptr = (uch *)in;
+                goto done;
+            }
+
+            /* a length and distance take at most 48 bits */
+            len = HUFF_VALUE(e) + (unsigned)(b & BITMASK(HUFF_EXTRA(e)));
+            DUMPBITS(HUFF_EXTRA(e))
+
+            e = dt[b & dmask];
+            if (e & HUFF_SUBTABLE) {
+                DUMPBITS(HUFF_LEN(e))
+                e = dt[HUFF_VALUE(e) + (b & BITMASK(HUFF_EXTRA(e)))];
+            }
+            if (e & HUFF_INVALID)
+                return 1;
+            DUMPBITS(HUFF_LEN(e))
+            dist = HUFF_VALUE(e) + (unsigned)(b & BITMASK(HUFF_EXTRA(e)));
+            DUMPBITS(HUFF_EXTRA(e))
+
+            if (dist > (unsigned)(out - out_start))
+                return 1;
+            copy_match_fast(out, len, dist);
+            out += len;
+        }
 
+        /*
+         * Near the end of the input piece or the output: one symbol,
+         * checking everything. Drop the look-ahead bits above k first so
+         * that the byte-wise refill starts from a clean buffer, and make
+         * the output so far visible to fill_inbuf().
+         */
+        inptr = (uch *)in;
+        outptr = out;
+        b &= BITMASK(k);
+        if (inbuf_overrun)
+            return 1;
 
-  /* make local copies of globals */
-  b = bb;                       /* initialize bit buffer */
-  k = bk;
+        NEEDBITS(lbits)
+        e = lt[b & lmask];
+        if (e & HUFF_SUBTABLE) {
+            DUMPBITS(HUFF_LEN(e))
+            NEEDBITS(HUFF_EXTRA(e))
+            e = lt[HUFF_VALUE(e) + (b & BITMASK(HUFF_EXTRA(e)))];
+        }
+        DUMPBITS(HUFF_LEN(e))
 
+        if (e & HUFF_LITERAL) {
+            if (out >= out_end)
+                return 1;
+            *out++ = (uch)HUFF_VALUE(e);
+            continue;
+        }
+        if (e & HUFF_INVALID)
+            return 1;
+        if (e & HUFF_EOB)
+            goto done;
+
+        NEEDBITS(HUFF_EXTRA(e))
+        len = HUFF_VALUE(e) + (unsigned)(b & BITMASK(HUFF_EXTRA(e)));
+        DUMPBITS(HUFF_EXTRA(e))
+
+        NEEDBITS(dbits)
+        e = dt[b & dmask];
+        if (e & HUFF_SUBTABLE) {
+            DUMPBITS(HUFF_LEN(e))
+            NEEDBITS(HUFF_EXTRA(e))
+            e = dt[HUFF_VALUE(e) + (b & BITMASK(HUFF_EXTRA(e)))];
+        }
+        if (e & HUFF_INVALID)
+            return 1;
+        DUMPBITS(HUFF_LEN(e))
+        NEEDBITS(HUFF_EXTRA(e))
+        dist = HUFF_VALUE(e) + (unsigned)(b & BITMASK(HUFF_EXTRA(e)));
+        DUMPBITS(HUFF_EXTRA(e))
 
-  /* go to byte boundary */
-  n = k & 7;
-  DUMPBITS(n);
+        /* the whole output is the window; stay inside it */
+        if (len > (unsigned)(out_end - out) || dist > (unsigned)(out - out_start))
+            return 1;
+        {
+            const uch *src = out - dist;
+            while (len--)
+                *out++ = *src++;
+        }
+    }
 
+done:
+    outptr = out;
+    bb = b & BITMASK(k);
+    bk = k;
+    return 0;
+}
 
-  /* get the length and its complement */
-  NEEDBITS(16)
-  n = ((unsigned)b & 0xffff);
-  DUMPBITS(16)
-  NEEDBITS(16)
-  if (n != (unsigned)((~b) & 0xffff))
-    return 1;                   /* error in compressed data */
-  DUMPBITS(16)
+/* Copy out a stored (uncompressed) block. */
+static int
+inflate_stored(void)
+{
+    bitbuf_t b = bb;
+    unsigned k = bk;
+    uch *out = (uch *)outptr;
+    unsigned n, avail;
+
+    /* go to a byte boundary, then get the length and its complement */
+    DUMPBITS(k & 7)
+    NEEDBITS(32)
+    n = (unsigned)b & 0xFFFF;
+    if (n != (~(unsigned)(b >> 16) & 0xFFFF))
+        return 1;
+    DUMPBITS(32)
 
+    if (n > (unsigned)(outbuf_end - out))
+        return 1;
 
-  /* read and output the compressed data */
-  while (n--)
-  {
-    NEEDBITS(8)
-	*p++=(uch)b;
-    DUMPBITS(8)
-  }
+    /* bytes already in the bit buffer come first */
+    while (n && k) {
+        *out++ = (uch)b;
+        DUMPBITS(8)
+        n--;
+    }
 
+    while (n) {
+        avail = (unsigned)(inbuf_end - inptr);
+        if (avail == 0) {
+            if (inbuf_overrun)
+                return 1;
+            *out++ = fill_inbuf();
+            n--;
+            continue;
+        }
+        if (avail > n)
+            avail = n;
+        memcpy(out, inptr, avail);
+        inptr += avail;
+        out += avail;
+        n -= avail;
+    }
 
-  /* restore the globals from the locals */
-  outptr=p;
-  bb = b;                       /* restore global bit buffer */
-  bk = k;
-  return 0;
+    outptr = out;
+    bb = b;
+    bk = k;
+    return 0;
 }
 
-
-
-int inflate_fixed()
-/* decompress an inflated type 1 (fixed Huffman codes) block.  We should
-   either replace this with a custom decoder, or at least precompute the
-   Huffman tables. */
+/* Decode a block with the fixed codes, whose tables are prebuilt. */
+static int
+inflate_fixed(void)
 {
-  int i;                /* temporary variable */
-  struct huft *tl;      /* literal/length code table */
-  struct huft *td;      /* distance code table */
-  int bl;               /* lookup bits for tl */
-  int bd;               /* lookup bits for td */
-  unsigned l[288];      /* length list for huft_build */
-
-
-  /* set up literal table */
-  for (i = 0; i < 144; i++)
-    l[i] = 8;
-  for (; i < 256; i++)
-    l[i] = 9;
-  for (; i < 280; i++)
-    l[i] = 7;
-  for (; i < 288; i++)          /* make a complete, but wrong code set */
-    l[i] = 8;
-  bl = 7;
-  // coverity[overrun-call]
-  // Coverity seems to get confused - there is nothing wrong with this code
-  if ((i = huft_build(l, 288, 257, cplens, cplext, &tl, &bl)) != 0)
-    return i;
-
-
-  /* set up distance table */
-  for (i = 0; i < 30; i++)      /* make an incomplete code set */
-    l[i] = 5;
-  bd = 5;
-  if ((i = huft_build(l, 30, 0, cpdist, cpdext, &td, &bd)) > 1)
-  {
-    huft_free(tl);
-    return i;
-  }
-
-
-  /* decompress until an end-of-block code */
-  if (inflate_codes(tl, td, bl, bd))
-    return 1;
-
-
-  /* free the decoding tables, return */
-  huft_free(tl);
-  huft_free(td);
-  return 0;
+    return inflate_codes(fixed_litlen, FIXED_LITLEN_BITS, fixed_dist, FIXED_DIST_BITS);
 }
 
-
-
-int inflate_dynamic()
-/* decompress an inflated type 2 (dynamic Huffman codes) block. */
+/* Read the code descriptions of a dynamic block, then decode it. */
+static int
+inflate_dynamic(void)
 {
-  int i;                /* temporary variables */
-  unsigned j;
-  unsigned l;           /* last length */
-  unsigned m;           /* mask for bit lengths table */
-  unsigned n;           /* number of lengths to get */
-  struct huft *tl;      /* literal/length code table */
-  struct huft *td;      /* distance code table */
-  int bl;               /* lookup bits for tl */
-  int bd;               /* lookup bits for td */
-  unsigned nb;          /* number of bit length codes */
-  unsigned nl;          /* number of literal/length codes */
-  unsigned nd;          /* number of distance codes */
-#ifdef PKZIP_BUG_WORKAROUND
-  unsigned ll[288+32];  /* literal/length and distance code lengths */
-#else
-  unsigned ll[286+30];  /* literal/length and distance code lengths */
-#endif
-  register ulg b;       /* bit buffer */
-  register unsigned k;  /* number of bits in bit buffer */
-
-
-  /* make local bit buffer */
-  b = bb;
-  k = bk;
-
-
-  /* read in table lengths */
-  NEEDBITS(5)
-  nl = 257 + ((unsigned)b & 0x1f);      /* number of literal/length codes */
-  DUMPBITS(5)
-  NEEDBITS(5)
-  nd = 1 + ((unsigned)b & 0x1f);        /* number of distance codes */
-  DUMPBITS(5)
-  NEEDBITS(4)
-  nb = 4 + ((unsigned)b & 0xf);         /* number of bit length codes */
-  DUMPBITS(4)
-#ifdef PKZIP_BUG_WORKAROUND
-  if (nl > 288 || nd > 32)
-#else
-  if (nl > 286 || nd > 30)
-#endif
-    return 1;                   /* bad lengths */
-
-
-  /* read in bit-length-code lengths */
-  for (j = 0; j < nb; j++)
-  {
-    NEEDBITS(3)
-    ll[border[j]] = (unsigned)b & 7;
-    DUMPBITS(3)
-  }
-  for (; j < 19; j++)
-    ll[border[j]] = 0;
-
-
-  /* build decoding table for trees--single level, 7 bit lookup */
-  bl = 7;
-  if ((i = huft_build(ll, 19, 19, NULL, NULL, &tl, &bl)) != 0)
-  {
-    if (i == 1)
-      huft_free(tl);
-    return i;                   /* incomplete code set */
-  }
-
-
-  /* read in literal and distance code lengths */
-  n = nl + nd;
-  m = mask_bits[bl];
-  i = l = 0;
-  while ((unsigned)i < n)
-  {
-    NEEDBITS((unsigned)bl)
-    j = (td = tl + ((unsigned)b & m))->b;
-    DUMPBITS(j)
-    j = td->v.n;
-    if (j < 16)                 /* length of code in bits (0..15) */
-      ll[i++] = l = j;          /* save last length in l */
-    else if (j == 16)           /* repeat last length 3 to 6 times */
-    {
-      NEEDBITS(2)
-      j = 3 + ((unsigned)b & 3);
-      DUMPBITS(2)
-      if ((unsigned)i + j > n)
+    uch lens[LITLEN_SYMS + DIST_SYMS];
+    huff_t results[PRECODE_SYMS];
+    bitbuf_t b = bb;
+    unsigned k = bk;
+    unsigned nl, nd, nb, n, i, j, rep;
+    uch prev;
+    huff_t e;
+
+    NEEDBITS(14)
+    nl = 257 + ((unsigned)b & 0x1F);
+    nd = 1 + ((unsigned)(b >> 5) & 0x1F);
+    nb = 4 + ((unsigned)(b >> 10) & 0xF);
+    DUMPBITS(14)
+    if (nl > 286 || nd > 30)
         return 1;
-      while (j--)
-        ll[i++] = l;
-    }
-    else if (j == 17)           /* 3 to 10 zero length codes */
-    {
-      NEEDBITS(3)
-      j = 3 + ((unsigned)b & 7);
-      DUMPBITS(3)
-      if ((unsigned)i + j > n)
-        return 1;
-      while (j--)
-        ll[i++] = 0;
-      l = 0;
+
+    for (i = 0; i < PRECODE_SYMS; i++)
+        lens[i] = 0;
+    for (i = 0; i < nb; i++) {
+        NEEDBITS(3)
+        lens[precode_order[i]] = (uch)(b & 7);
+        DUMPBITS(3)
     }
-    else                        /* j == 18: 11 to 138 zero length codes */
-    {
-      NEEDBITS(7)
-      j = 11 + ((unsigned)b & 0x7f);
-      DUMPBITS(7)
-      if ((unsigned)i + j > n)
+    for (i = 0; i < PRECODE_SYMS; i++)
+        results[i] = HUFF_ENTRY(i, 0);
+    if (build_table(tables.precode, lens, PRECODE_SYMS, results,
+        PRECODE_BITS, PRECODE_ENOUGH, 0))
         return 1;
-      while (j--)
-        ll[i++] = 0;
-      l = 0;
-    }
-  }
-
-
-  /* free decoding table for trees */
-  huft_free(tl);
-
 
-  /* restore the global bit buffer */
-  bb = b;
-  bk = k;
-
-
-  /* build the decoding tables for literal/length and distance codes */
-  bl = lbits;
-  if ((i = huft_build(ll, nl, 257, cplens, cplext, &tl, &bl)) != 0)
-  {
-    if (i == 1) {
-/*      fprintf(stderr, " incomplete literal tree\n");*/
-      huft_free(tl);
-    }
-    return i;                   /* incomplete code set */
-  }
-  bd = dbits;
-  if ((i = huft_build(ll + nl, nd, 0, cpdist, cpdext, &td, &bd)) != 0)
-  {
-    if (i == 1) {
-/*      fprintf(stderr, " incomplete distance tree\n");*/
-#ifdef PKZIP_BUG_WORKAROUND
-      i = 0;
-    }
-#else
-      huft_free(td);
+    /* the literal/length and distance lengths form one sequence */
+    n = nl + nd;
+    prev = 0;
+    for (i = 0; i < n; ) {
+        NEEDBITS(PRECODE_BITS)
+        e = tables.precode[b & BITMASK(PRECODE_BITS)];
+        DUMPBITS(HUFF_LEN(e))
+        j = HUFF_VALUE(e);
+        if (j < 16) {
+            lens[i++] = prev = (uch)j;
+            continue;
+        }
+        if (j == 16) {
+            if (i == 0)
+                return 1;
+            NEEDBITS(2)
+            rep = 3 + ((unsigned)b & 3);
+            DUMPBITS(2)
+        } else if (j == 17) {
+            NEEDBITS(3)
+            rep = 3 + ((unsigned)b & 7);
+            DUMPBITS(3)
+            prev = 0;
+        } else {
+            NEEDBITS(7)
+            rep = 11 + ((unsigned)b & 0x7F);
+            DUMPBITS(7)
+            prev = 0;
+        }
+        if (i + rep > n)
+            return 1;
+        while (rep--)
+            lens[i++] = prev;
     }
-    huft_free(tl);
-    return i;                   /* incomplete code set */
-#endif
-  }
 
+    if (lens[256] == 0)
+        return 1;               /* no end-of-block code */
 
-  /* decompress until an end-of-block code */
-  if (inflate_codes(tl, td, bl, bd))
-    return 1;
+    bb = b;
+    bk = k;
 
+    if (build_litlen(tables.litlen, lens, nl) || build_dist(tables.dist, lens + nl, nd))
+        return 1;
 
-  /* free the decoding tables, return */
-  huft_free(tl);
-  huft_free(td);
-  return 0;
+    return inflate_codes(tables.litlen, LITLEN_BITS, tables.dist, DIST_BITS);
 }
 
-
-
-int inflate_block(int* e)
-/* decompress an inflated block */
+/* Decode one block; *last is set if it is the final one. */
+static int
+inflate_block(int *last)
 {
-  unsigned t;           /* block type */
-  register ulg b;       /* bit buffer */
-  register unsigned k;  /* number of bits in bit buffer */
-
+    bitbuf_t b = bb;
+    unsigned k = bk;
+    unsigned t;
 
-  /* make local bit buffer */
-  b = bb;
-  k = bk;
-
-
-  /* read in last block bit */
-  NEEDBITS(1)
-  *e = (int)b & 1;
-  DUMPBITS(1)
-
-
-  /* read in block type */
-  NEEDBITS(2)
-  t = (unsigned)b & 3;
-  DUMPBITS(2)
-
-
-  /* restore the global bit buffer */
-  bb = b;
-  bk = k;
-
-
-  /* inflate that block type */
-  if (t == 2)
-    return inflate_dynamic();
-  if (t == 0)
-    return inflate_stored();
-  if (t == 1)
-    return inflate_fixed();
+    NEEDBITS(3)
+    *last = (int)b & 1;
+    t = ((unsigned)b >> 1) & 3;
+    DUMPBITS(3)
+    bb = b;
+    bk = k;
 
+    if (t == 2)
+        return inflate_dynamic();
+    if (t == 0)
+        return inflate_stored();
+    if (t == 1)
+        return inflate_fixed();
 
-  /* bad block type */
-  return 2;
+    /* bad block type */
+    return 2;
 }
 
-
-
-int inflate()
-/* decompress an inflated entry */
+/*
+ * Decode a deflate stream from inptr into outptr. Returns zero on
+ * success. Afterwards bb/bk hold whatever input was read ahead.
+ */
+int
+inflate(void)
 {
-  int e;                /* last block flag */
-  int r;                /* result code */
-  unsigned h;           /* maximum struct huft's malloc'ed */
-
-
-  /* initialize window, bit buffer */
-/*  wp = 0;*/
-  bk = 0;
-  bb = 0;
-
-
-  /* decompress until the last block */
-  h = 0;
-  do {
-    hufts = 0;
-	r=inflate_block(&e);
-	process_block(r);
-	if (r!=0)
-		return r;
-    if (hufts > h)
-      h = hufts;
-  } while (!e);
-
-  /* Undo too much lookahead. The next read will be byte aligned so we
-   * can discard unused bits in the last meaningful byte.
-   */
-/*  while (bk >= 8) {
-    bk -= 8;
-    inptr--;
-  }*/
-
-  /* flush out slide */
-/*  flush_output(wp);*/
-
-
-  /* return success */
-#ifdef DEBUG
-/*  fprintf(stderr, "<%u> ", h);*/
-#endif /* DEBUG */
-
-  return 0;
+    int last, r;
+
+    bb = 0;
+    bk = 0;
+    inbuf_overrun = 0;
+
+    do {
+        r = inflate_block(&last);
+        if (r == 0 && inbuf_overrun)
+            r = 1;
+        process_block(r);
+        if (r != 0)
+            break;
+    } while (!last);
+
+    return r;
 }
@@ -0,0 +1,947 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * iso9660.c
+ * Read-only ISO 9660 filesystem plugin, with Rock Ridge names.
+ *
+ * Every file on an ISO 9660 volume is one contiguous extent, so reads go
+ * straight from the medium into the caller's buffer, one request for all
+ * the whole blocks of a read. The path table is cached at mount time and
+ * used to find directories without reading their parents.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "iso9660.h"
+
+#define ISO_MAX_DIRSIZE     (16 * 1024 * 1024)
+
+/*
+ * In-memory file handle.
+ */
+struct iso_file {
+    EFI_FILE_PROTOCOL File;
+    struct iso_mount *mnt;
+    UINT32 extent;              /* first logical block of the file */
+    UINT64 size;                /* file size in bytes */
+    UINT64 pos;                 /* current file position */
+    UINT8 *bounce;              /* one logical block, for partial and unaligned reads */
+    CHAR16 name[ISO_MAXNAMELEN + 1];    /* file name, for GetInfo */
+};
+
+/*
+ * Read 'count' device blocks starting 'lba' device blocks into the volume.
+ */
+static EFI_STATUS
+iso_read_lbas(struct iso_mount *mnt, UINT64 lba, UINTN count, VOID *buf)
+{
+    EFI_BLOCK_IO_PROTOCOL *bio = mnt->bio;
+
+    return uefi_call_wrapper(bio->ReadBlocks, 5, bio, bio->Media->MediaId, (UINT64)mnt->slice_start_lba + lba,
+        count * bio->Media->BlockSize, buf);
+}
+
+static EFI_STATUS
+iso_read_blocks(struct iso_mount *mnt, UINT32 blk, UINTN count, VOID *buf)
+{
+    return iso_read_lbas(mnt, (UINT64)blk * mnt->lbasperblk, count * mnt->lbasperblk, buf);
+}
+
+EFI_STATUS
+DetectISO(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void)
+{
+    EFI_STATUS Status;
+    UINTN BlockSize = BlockIo->Media->BlockSize;
+    struct iso_pvd *pvd = (struct iso_pvd *)sb_void;
+    struct iso_dirrec *root;
+    UINT8 *Buffer;
+    UINTN i;
+
+    if (BlockSize == 0 || BlockSize > ISO_SECTOR_SIZE || ISO_SECTOR_SIZE % BlockSize != 0)
+        return EFI_UNSUPPORTED;
+
+    Buffer = AllocatePool(ISO_SECTOR_SIZE);
+    if (!Buffer)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = EFI_NOT_FOUND;
+    for (i = ISO_VD_START; i < ISO_VD_START + ISO_VD_MAX; i++) {
+        Status = uefi_call_wrapper(BlockIo->ReadBlocks, 5, BlockIo, BlockIo->Media->MediaId,
+            SliceStartLBA + i * (ISO_SECTOR_SIZE / BlockSize), ISO_SECTOR_SIZE, Buffer);
+        if (EFI_ERROR(Status))
+            break;
+
+        if (CompareMem(Buffer + 1, ISO_STANDARD_ID, 5) != 0 || Buffer[0] == ISO_VD_TERMINATOR) {
+            Status = EFI_NOT_FOUND;
+            break;
+        }
+
+        if (Buffer[0] == ISO_VD_PRIMARY) {
+            MemMove(pvd, Buffer, sizeof(*pvd));
+            Status = EFI_SUCCESS;
+            break;
+        }
+    }
+
+    FreePool(Buffer);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    root = (struct iso_dirrec *)pvd->root;
+    if (pvd->version != 1 || pvd->logical_block_size < BlockSize || pvd->logical_block_size > ISO_SECTOR_SIZE ||
+        pvd->logical_block_size % BlockSize != 0 || !(root->flags & ISO_FLAG_DIRECTORY)) {
+        PrintToScreen(L"Unsupported ISO 9660 volume (block size %u)\n", pvd->logical_block_size);
+        return EFI_UNSUPPORTED;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Find the first path table entry whose parent is 'parent' (0-based).
+ * The path table is sorted by parent, so children are contiguous and a
+ * lookup costs this binary search plus a scan of the siblings.
+ */
+static UINTN
+iso_first_child(struct iso_mount *mnt, UINTN parent)
+{
+    UINTN lo = 1, hi = mnt->ndirs, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (mnt->dirs[mid].parent < parent)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static EFI_STATUS
+iso_load_path_table(struct iso_mount *mnt)
+{
+    UINT32 size = mnt->pvd.path_table_size;
+    UINTN off, n, nblks;
+    struct iso_ptrec *pt;
+    EFI_STATUS Status;
+
+    if (size < ISO_PTREC_BASE + 1)
+        return EFI_VOLUME_CORRUPTED;
+
+    nblks = (size + mnt->blksize - 1) / mnt->blksize;
+    mnt->ptbuf = AllocatePool(nblks * mnt->blksize);
+    if (!mnt->ptbuf)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = iso_read_blocks(mnt, mnt->pvd.path_table_l, nblks, mnt->ptbuf);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    /* count, then fill in */
+    for (n = 0, off = 0; off + ISO_PTREC_BASE <= size; n++) {
+        pt = (struct iso_ptrec *)(mnt->ptbuf + off);
+        if (pt->name_len == 0)
+            break;
+        off += ISO_PTREC_BASE + pt->name_len + (pt->name_len & 1);
+    }
+
+    if (n == 0 || n > 0xFFFF)
+        return EFI_VOLUME_CORRUPTED;
+
+    mnt->dirs = AllocatePool(n * sizeof(*mnt->dirs));
+    if (!mnt->dirs)
+        return EFI_OUT_OF_RESOURCES;
+
+    for (n = 0, off = 0; off + ISO_PTREC_BASE <= size; n++) {
+        pt = (struct iso_ptrec *)(mnt->ptbuf + off);
+        if (pt->name_len == 0)
+            break;
+        if (pt->parent == 0 || pt->parent > n + 1)
+            return EFI_VOLUME_CORRUPTED;
+        mnt->dirs[n].extent = pt->extent + pt->ext_attr_length;
+        mnt->dirs[n].parent = pt->parent - 1;
+        mnt->dirs[n].name_len = pt->name_len;
+        mnt->dirs[n].name = (CHAR8 *)pt->name;
+        off += ISO_PTREC_BASE + pt->name_len + (pt->name_len & 1);
+    }
+    mnt->ndirs = n;
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Return the system use area of a directory record, after any SUSP skip.
+ */
+static UINT8 *
+iso_sysuse(struct iso_mount *mnt, struct iso_dirrec *rec, UINTN *len_out)
+{
+    UINTN off = ISO_DIRREC_BASE + rec->name_len + !(rec->name_len & 1);
+
+    off += mnt->susp_skip;
+    if (off >= rec->length) {
+        *len_out = 0;
+        return NULL;
+    }
+
+    *len_out = rec->length - off;
+    return (UINT8 *)rec + off;
+}
+
+/*
+ * Read a directory into the one-entry directory cache. 'size' may be 0
+ * when the caller only knows the extent from the path table; the size is
+ * then taken from the "." record in the first block.
+ */
+static EFI_STATUS
+iso_dir_load(struct iso_mount *mnt, UINT32 extent, UINT32 size, UINT8 **buf_out, UINT32 *size_out)
+{
+    EFI_STATUS Status;
+    UINT32 nblks;
+    UINT8 *buf;
+
+    if (mnt->dcache && mnt->dcache_extent == extent) {
+        *buf_out = mnt->dcache;
+        *size_out = mnt->dcache_size;
+        return EFI_SUCCESS;
+    }
+
+    if (mnt->dcache) {
+        FreePool(mnt->dcache);
+        mnt->dcache = NULL;
+    }
+
+    if (size == 0) {
+        buf = AllocatePool(mnt->blksize);
+        if (!buf)
+            return EFI_OUT_OF_RESOURCES;
+
+        Status = iso_read_blocks(mnt, extent, 1, buf);
+        if (EFI_ERROR(Status) || buf[0] < ISO_DIRREC_BASE) {
+            FreePool(buf);
+            return EFI_ERROR(Status) ? Status : EFI_VOLUME_CORRUPTED;
+        }
+
+        size = ((struct iso_dirrec *)buf)->size;
+        if (size <= mnt->blksize) {
+            mnt->dcache = buf;
+            goto done;
+        }
+        FreePool(buf);
+    }
+
+    if (size > ISO_MAX_DIRSIZE)
+        return EFI_VOLUME_CORRUPTED;
+
+    nblks = (size + mnt->blksize - 1) / mnt->blksize;
+    buf = AllocatePool(nblks * mnt->blksize);
+    if (!buf)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = iso_read_blocks(mnt, extent, nblks, buf);
+    if (EFI_ERROR(Status)) {
+        FreePool(buf);
+        return Status;
+    }
+    mnt->dcache = buf;
+
+done:
+    mnt->dcache_extent = extent;
+    mnt->dcache_size = size;
+    *buf_out = mnt->dcache;
+    *size_out = size;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Build the name of a directory record: the Rock Ridge name if 'rr' is set
+ * and there is one, otherwise the ISO identifier without its version and trailing dot.
+ */
+static void
+iso_rec_name(struct iso_mount *mnt, struct iso_dirrec *rec, BOOLEAN rr, CHAR16 *name)
+{
+    UINT8 *su, *e;
+    UINTN sulen, n = 0, k, len;
+    BOOLEAN have_nm = FALSE;
+
+    if (rr && mnt->rockridge) {
+        su = iso_sysuse(mnt, rec, &sulen);
+        while (su && sulen >= 4) {
+            e = su;
+            if (e[2] < 4 || e[2] > sulen)
+                break;
+
+            if (SUSP_SIG(e[0], e[1]) == SUSP_ST)
+                break;
+
+            if (SUSP_SIG(e[0], e[1]) == RRIP_NM && e[2] >= 5) {
+                if (e[4] & RRIP_NM_CURRENT) {
+                    StrCpy(name, L".");
+                    return;
+                }
+                if (e[4] & RRIP_NM_PARENT) {
+                    StrCpy(name, L"..");
+                    return;
+                }
+                for (k = 5; k < e[2] && n < ISO_MAXNAMELEN; k++)
+                    name[n++] = e[k];
+                have_nm = TRUE;
+                if (!(e[4] & RRIP_NM_CONTINUE))
+                    break;
+            }
+
+            su += e[2];
+            sulen -= e[2];
+        }
+
+        if (have_nm) {
+            name[n] = L'\0';
+            return;
+        }
+    }
+
+    if (rec->name_len == 1 && (UINT8)rec->name[0] <= 1) {
+        StrCpy(name, rec->name[0] ? L".." : L".");
+        return;
+    }
+
+    len = rec->name_len;
+    for (k = 0; k < len && rec->name[k] != ';'; k++)
+        name[k] = (UINT8)rec->name[k];
+    if (k > 0 && name[k - 1] == L'.' && !(rec->flags & ISO_FLAG_DIRECTORY))
+        k--;
+    name[k] = L'\0';
+}
+
+/*
+ * Return the next directory record at or after *off.
+ */
+static BOOLEAN
+iso_dir_next(struct iso_mount *mnt, UINT8 *buf, UINT32 size, UINT32 *off, struct iso_dirrec **rec_out)
+{
+    struct iso_dirrec *rec;
+
+    while (*off < size) {
+        rec = (struct iso_dirrec *)(buf + *off);
+
+        /* records do not cross blocks; a zero length pads to the next one */
+        if (rec->length == 0) {
+            *off = (*off / mnt->blksize + 1) * mnt->blksize;
+            continue;
+        }
+
+        if (rec->length < ISO_DIRREC_BASE || *off + rec->length > size ||
+            ISO_DIRREC_BASE + rec->name_len > rec->length)
+            return FALSE;
+
+        *off += rec->length;
+        *rec_out = rec;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static CHAR16
+iso_toupper(CHAR16 c)
+{
+    return (c >= L'a' && c <= L'z') ? c - (L'a' - L'A') : c;
+}
+
+/*
+ * Compare a path component with a record name. ISO identifiers are upper
+ * case d-characters, so they are matched without regard to case; Rock
+ * Ridge names are POSIX names and must match exactly.
+ */
+static BOOLEAN
+iso_name_eq(const CHAR16 *comp, UINTN len, const CHAR16 *name, BOOLEAN fold)
+{
+    UINTN k;
+
+    for (k = 0; k < len; k++) {
+        if (name[k] == L'\0')
+            return FALSE;
+        if (fold ? iso_toupper(comp[k]) != iso_toupper(name[k]) : comp[k] != name[k])
+            return FALSE;
+    }
+    return name[len] == L'\0';
+}
+
+/*
+ * Walk 'path' from the root. Directories are looked up in the cached path
+ * table first, which costs no I/O; the parent directory is only read when
+ * the table has no match (for example a Rock Ridge name) or for the last
+ * component. On success 'rec_out' holds the first 33 bytes of the final
+ * record and 'name_out' its name.
+ */
+static EFI_STATUS
+iso_walk(struct iso_mount *mnt, const CHAR16 *path, struct iso_dirrec *rec_out, CHAR16 *name_out)
+{
+    EFI_STATUS Status;
+    const CHAR16 *p = path;
+    struct iso_dirrec *rec;
+    UINT32 extent, size, dsize, off;
+    UINTN cur = 0, i, k, len;
+    UINT8 *buf;
+    BOOLEAN found;
+
+    CopyMem(rec_out, mnt->pvd.root, ISO_DIRREC_BASE);
+    StrCpy(name_out, L"\\");
+    extent = rec_out->extent + rec_out->ext_attr_length;
+    size = rec_out->size;
+
+    while (*p == L'/' || *p == L'\\')
+        p++;
+
+    while (*p) {
+        for (len = 0; p[len] && p[len] != L'/' && p[len] != L'\\'; len++)
+            ;
+
+        if (!(rec_out->flags & ISO_FLAG_DIRECTORY))
+            return EFI_NOT_FOUND;
+
+        found = FALSE;
+
+        /* intermediate directories: path table */
+        if (p[len] != L'\0') {
+            for (i = iso_first_child(mnt, cur); i < mnt->ndirs && mnt->dirs[i].parent == cur; i++) {
+                if (mnt->dirs[i].name_len != len)
+                    continue;
+                for (k = 0; k < len && iso_toupper(p[k]) == iso_toupper((UINT8)mnt->dirs[i].name[k]); k++)
+                    ;
+                if (k == len)
+                    break;
+            }
+
+            if (i < mnt->ndirs && mnt->dirs[i].parent == cur) {
+                cur = i;
+                extent = mnt->dirs[i].extent;
+                size = 0;
+                SetMem(rec_out, ISO_DIRREC_BASE, 0);
+                rec_out->flags = ISO_FLAG_DIRECTORY;
+                rec_out->extent = extent;
+                for (k = 0; k < len; k++)
+                    name_out[k] = p[k];
+                name_out[k] = L'\0';
+                found = TRUE;
+            }
+        }
+
+        if (!found) {
+            Status = iso_dir_load(mnt, extent, size, &buf, &dsize);
+            if (EFI_ERROR(Status))
+                return Status;
+
+            off = 0;
+            while (iso_dir_next(mnt, buf, dsize, &off, &rec)) {
+                if (mnt->rockridge) {
+                    iso_rec_name(mnt, rec, TRUE, name_out);
+                    if (iso_name_eq(p, len, name_out, FALSE)) {
+                        found = TRUE;
+                        break;
+                    }
+                }
+
+                /* like the path table, accept the ISO name too */
+                iso_rec_name(mnt, rec, FALSE, name_out);
+                if (iso_name_eq(p, len, name_out, TRUE)) {
+                    found = TRUE;
+                    break;
+                }
+            }
+
+            if (!found)
+                return EFI_NOT_FOUND;
+
+            CopyMem(rec_out, rec, ISO_DIRREC_BASE);
+            extent = rec->extent + rec->ext_attr_length;
+            size = rec->size;
+
+            /* keep the path table position in step */
+            if (rec->flags & ISO_FLAG_DIRECTORY) {
+                if (name_out[0] == L'.' && name_out[1] == L'.' && name_out[2] == L'\0')
+                    cur = mnt->dirs[cur].parent;
+                else if (!(name_out[0] == L'.' && name_out[1] == L'\0')) {
+                    for (i = iso_first_child(mnt, cur); i < mnt->ndirs && mnt->dirs[i].parent == cur; i++) {
+                        if (mnt->dirs[i].extent == extent)
+                            break;
+                    }
+                    if (i == mnt->ndirs || mnt->dirs[i].parent != cur)
+                        return EFI_VOLUME_CORRUPTED;
+                    cur = i;
+                }
+            }
+        }
+
+        p += len;
+        while (*p == L'/' || *p == L'\\')
+            p++;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * MountISO: cache the path table and look for Rock Ridge.
+ */
+EFI_STATUS
+MountISO(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out)
+{
+    struct iso_mount *mnt;
+    struct iso_dirrec *root, *dot;
+    EFI_STATUS Status;
+    UINT8 *buf, *su;
+    UINT32 dsize;
+    UINTN sulen;
+
+    if (!sb_buffer || !mount_out)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = AllocateZeroPool(sizeof(*mnt));
+    if (!mnt)
+        return EFI_OUT_OF_RESOURCES;
+
+    MemMove(&mnt->pvd, sb_buffer, sizeof(mnt->pvd));
+    mnt->bio = BlockIo;
+    mnt->slice_start_lba = SliceStartLBA;
+    mnt->blksize = mnt->pvd.logical_block_size;
+    mnt->lbasperblk = mnt->blksize / BlockIo->Media->BlockSize;
+
+    Status = iso_load_path_table(mnt);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"Cannot read ISO 9660 path table: %r\n", Status);
+        goto fail;
+    }
+
+    /* a SUSP "SP" entry in the root's "." record announces Rock Ridge */
+    root = (struct iso_dirrec *)mnt->pvd.root;
+    Status = iso_dir_load(mnt, root->extent + root->ext_attr_length, root->size, &buf, &dsize);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    dot = (struct iso_dirrec *)buf;
+    su = iso_sysuse(mnt, dot, &sulen);
+    if (su && sulen >= 7 && SUSP_SIG(su[0], su[1]) == SUSP_SP && su[4] == 0xBE && su[5] == 0xEF) {
+        mnt->rockridge = TRUE;
+        mnt->susp_skip = su[6];
+    }
+
+    *mount_out = mnt;
+    return EFI_SUCCESS;
+
+fail:
+    UmountISO(mnt);
+    return Status;
+}
+
+EFI_STATUS
+UmountISO(void *mount)
+{
+    struct iso_mount *mnt = (struct iso_mount *)mount;
+
+    if (!mnt)
+        return EFI_INVALID_PARAMETER;
+
+    if (mnt->dcache)
+        FreePool(mnt->dcache);
+    if (mnt->dirs)
+        FreePool(mnt->dirs);
+    if (mnt->ptbuf)
+        FreePool(mnt->ptbuf);
+    FreePool(mnt);
+    return EFI_SUCCESS;
+}
+
+/*
+ * ReadISODir: list directory contents for the provided path.
+ */
+EFI_STATUS
+ReadISODir(void *mount_ctx, const CHAR16 *path)
+{
+    struct iso_mount *mnt = (struct iso_mount *)mount_ctx;
+    struct iso_dirrec dir, *rec;
+    EFI_STATUS Status;
+    CHAR16 *name;
+    UINT32 dsize, off = 0;
+    UINT8 *buf;
+
+    if (!mnt || !path)
+        return EFI_INVALID_PARAMETER;
+
+    name = AllocatePool((ISO_MAXNAMELEN + 1) * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = iso_walk(mnt, path, &dir, name);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"No such file or directory: %s\n", path);
+        goto out;
+    }
+
+    if (!(dir.flags & ISO_FLAG_DIRECTORY)) {
+        PrintToScreen(L"Not a directory\n");
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    Status = iso_dir_load(mnt, dir.extent + dir.ext_attr_length, dir.size, &buf, &dsize);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    PrintToScreen(L"Listing ISO 9660 directory: %s\n", path);
+
+    while (iso_dir_next(mnt, buf, dsize, &off, &rec)) {
+        iso_rec_name(mnt, rec, TRUE, name);
+        if (rec->flags & ISO_FLAG_DIRECTORY)
+            PrintToScreen(L"   <DIR>    %s\n", name);
+        else
+            PrintToScreen(L"  <FILE>    %s  %u bytes\n", name, rec->size);
+    }
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+/*
+ * Read part of the extent. Whole device blocks go directly into the
+ * caller's buffer in one request; the head and tail blocks, and buffers
+ * that miss the device's IoAlign, are copied through the bounce buffer.
+ */
+static EFI_STATUS EFIAPI
+iso_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    struct iso_file *isf = (struct iso_file *)This;
+    struct iso_mount *mnt;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT8 *out = Buffer;
+    UINT32 bsize, ioalign;
+    UINT64 lba;
+    UINTN to_read, done = 0, boff, chunk, n;
+
+    if (!This || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = isf->mnt;
+    bsize = mnt->bio->Media->BlockSize;
+    ioalign = mnt->bio->Media->IoAlign;
+
+    if (isf->pos >= isf->size) {
+        *BufferSize = 0; /* EOF */
+        return EFI_SUCCESS;
+    }
+
+    to_read = *BufferSize;
+    if ((UINT64)to_read > isf->size - isf->pos)
+        to_read = (UINTN)(isf->size - isf->pos);
+
+    while (done < to_read) {
+        lba = (UINT64)isf->extent * mnt->lbasperblk + isf->pos / bsize;
+        boff = isf->pos % bsize;
+        chunk = to_read - done;
+
+        if (boff == 0 && chunk >= bsize && (ioalign <= 1 || ((UINTN)(out + done) & (ioalign - 1)) == 0)) {
+            n = chunk / bsize;
+            Status = iso_read_lbas(mnt, lba, n, out + done);
+            if (EFI_ERROR(Status))
+                break;
+            chunk = n * bsize;
+        } else {
+            if (!isf->bounce) {
+                isf->bounce = AllocatePool(mnt->blksize);
+                if (!isf->bounce) {
+                    Status = EFI_OUT_OF_RESOURCES;
+                    break;
+                }
+            }
+
+            /* as much as fits in the bounce buffer */
+            n = (boff + chunk + bsize - 1) / bsize;
+            if (n > mnt->lbasperblk)
+                n = mnt->lbasperblk;
+            Status = iso_read_lbas(mnt, lba, n, isf->bounce);
+            if (EFI_ERROR(Status))
+                break;
+            if (chunk > n * bsize - boff)
+                chunk = n * bsize - boff;
+            CopyMem(out + done, isf->bounce + boff, chunk);
+        }
+
+        done += chunk;
+        isf->pos += chunk;
+    }
+
+    *BufferSize = done;
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+    struct iso_file *isf = (struct iso_file *)This;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    /* UEFI uses (UINT64)-1 to set position to EOF */
+    if (Position == (UINT64)-1)
+        Position = isf->size;
+
+    if (Position > isf->size)
+        return EFI_INVALID_PARAMETER;
+
+    isf->pos = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct iso_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    struct iso_file *isf = (struct iso_file *)This;
+
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+        return EFI_UNSUPPORTED;
+
+    return FillFileInfo(isf->name, isf->size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+iso_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* only regular files are handed out */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_close(EFI_FILE_PROTOCOL *This)
+{
+    struct iso_file *isf = (struct iso_file *)This;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    if (isf->bounce)
+        FreePool(isf->bounce);
+    FreePool(isf);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+iso_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    iso_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * OpenISO:
+ * - walk the path, using the path table for directories
+ * - verify the final record is a single-extent, non-interleaved file
+ * - create an in-memory file handle
+ */
+EFI_STATUS
+OpenISO(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
+    struct iso_mount *mnt = mount_ctx;
+    struct iso_file *isf;
+    struct iso_dirrec rec;
+    EFI_STATUS Status;
+
+    if (!mnt || !filename || !file_out)
+        return EFI_INVALID_PARAMETER;
+
+    /* Only support read-only */
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_UNSUPPORTED;
+
+    isf = AllocateZeroPool(sizeof(*isf));
+    if (!isf)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = iso_walk(mnt, filename, &rec, isf->name);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    /* files over 4 GiB span several records; interleaving is obsolete */
+    if ((rec.flags & (ISO_FLAG_DIRECTORY | ISO_FLAG_MULTIEXT)) || rec.file_unit_size || rec.interleave) {
+        Status = EFI_UNSUPPORTED;
+        goto fail;
+    }
+
+    isf->mnt = mnt;
+    isf->extent = rec.extent + rec.ext_attr_length;
+    isf->size = rec.size;
+    isf->pos = 0;
+
+    isf->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+    isf->File.Open = iso_file_open;
+    isf->File.Close = iso_file_close;
+    isf->File.Delete = iso_file_delete;
+    isf->File.Read = iso_file_read;
+    isf->File.Write = iso_file_write;
+    isf->File.GetPosition = iso_file_getpos;
+    isf->File.SetPosition = iso_file_setpos;
+    isf->File.GetInfo = iso_file_getinfo;
+    isf->File.SetInfo = iso_file_setinfo;
+    isf->File.Flush = iso_file_flush;
+
+    *file_out = &isf->File;
+    return EFI_SUCCESS;
+
+fail:
+    FreePool(isf);
+    return Status;
+}
+
+/*
+ * Directory iterator. The listing lives in the mount's directory cache,
+ * which other lookups may replace, so only its extent and the offset of
+ * the next record are kept here and the listing is reloaded on demand.
+ */
+struct iso_dir_handle {
+    struct iso_mount *mnt;
+    UINT32 extent;
+    UINT32 size;
+    UINT32 off;
+    CHAR16 name[ISO_MAXNAMELEN + 1];
+};
+
+EFI_STATUS
+OpenISODir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct iso_mount *mnt = mount_ctx;
+    struct iso_dir_handle *dh;
+    struct iso_dirrec rec;
+    EFI_STATUS Status;
+
+    if (!mnt || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    dh = AllocateZeroPool(sizeof(*dh));
+    if (!dh)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = iso_walk(mnt, path, &rec, dh->name);
+    if (!EFI_ERROR(Status) && !(rec.flags & ISO_FLAG_DIRECTORY))
+        Status = EFI_UNSUPPORTED;
+    if (EFI_ERROR(Status)) {
+        FreePool(dh);
+        return Status;
+    }
+
+    dh->mnt = mnt;
+    dh->extent = rec.extent + rec.ext_attr_length;
+    dh->size = rec.size;
+    *dir_out = dh;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReadISODirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct iso_dir_handle *dh = dir;
+    struct iso_dirrec *rec;
+    EFI_STATUS Status;
+    UINT32 dsize, off;
+    UINT8 *dbuf;
+
+    Status = iso_dir_load(dh->mnt, dh->extent, dh->size, &dbuf, &dsize);
+    if (EFI_ERROR(Status))
+        return Status;
+    dh->size = dsize;
+
+    off = dh->off;
+    while (iso_dir_next(dh->mnt, dbuf, dsize, &off, &rec)) {
+        /* only the final extent of a multi-extent file is listed */
+        if (rec->flags & ISO_FLAG_MULTIEXT) {
+            dh->off = off;
+            continue;
+        }
+
+        iso_rec_name(dh->mnt, rec, TRUE, dh->name);
+        if (dh->name[0] == L'.' && (dh->name[1] == L'\0' || (dh->name[1] == L'.' && dh->name[2] == L'\0'))) {
+            dh->off = off;
+            continue;
+        }
+
+        Status = FillFileInfo(dh->name, (rec->flags & ISO_FLAG_DIRECTORY) ? 0 : rec->size,
+            EFI_FILE_READ_ONLY | ((rec->flags & ISO_FLAG_DIRECTORY) ? EFI_FILE_DIRECTORY : 0) |
+            ((rec->flags & ISO_FLAG_HIDDEN) ? EFI_FILE_HIDDEN : 0), size, buf);
+        if (!EFI_ERROR(Status))
+            dh->off = off;
+        return Status;
+    }
+
+    *size = 0;
+    return EFI_SUCCESS;
+}
+
+void
+CloseISODir(void *dir)
+{
+    if (dir)
+        FreePool(dir);
+}
@@ -42,9 +42,367 @@
 
 #include "aout.h"
 #include "boot.h"
+#include "clock.h"
+#include "config.h"
+#include "decompress.h"
 #include "disk.h"
 #include "fs.h"
+#include "heap.h"
+#include "mount.h"
 #include "vtoc.h"
+#include "zip.h"
+
+/*
+ * An executable decoded into memory. The loaders see it through the same
+ * file protocol as one read from disk; closing it frees the image.
+ */
+struct mem_file {
+	EFI_FILE_PROTOCOL File;
+	UINT8 *Data;
+	UINTN Pages;		/* pages allocated for Data */
+	UINT64 Size;
+	UINT64 Pos;
+};
+
+static EFI_STATUS EFIAPI
+mem_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+	struct mem_file *mf = (struct mem_file *)This;
+	UINT64 Left;
+
+	if (!This || !BufferSize)
+		return EFI_INVALID_PARAMETER;
+
+	Left = mf->Size - mf->Pos;
+	if ((UINT64)*BufferSize > Left)
+		*BufferSize = (UINTN)Left;
+
+	CopyMem(Buffer, mf->Data + mf->Pos, *BufferSize);
+	mf->Pos += *BufferSize;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+	struct mem_file *mf = (struct mem_file *)This;
+
+	if (!This)
+		return EFI_INVALID_PARAMETER;
+
+	/* UEFI uses (UINT64)-1 to set position to EOF */
+	if (Position == (UINT64)-1)
+		Position = mf->Size;
+	if (Position > mf->Size)
+		return EFI_INVALID_PARAMETER;
+
+	mf->Pos = Position;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+	if (!This || !Position)
+		return EFI_INVALID_PARAMETER;
+
+	*Position = ((struct mem_file *)This)->Pos;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+	if (!This || !InformationType || !BufferSize)
+		return EFI_INVALID_PARAMETER;
+
+	if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+		return EFI_UNSUPPORTED;
+
+	return FillFileInfo(L"", ((struct mem_file *)This)->Size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+mem_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+	return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_flush(EFI_FILE_PROTOCOL *This)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_close(EFI_FILE_PROTOCOL *This)
+{
+	struct mem_file *mf = (struct mem_file *)This;
+
+	if (!This)
+		return EFI_INVALID_PARAMETER;
+
+	HeapFreePages((EFI_PHYSICAL_ADDRESS)(UINTN)mf->Data, mf->Pages);
+	FreePool(mf);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mem_file_delete(EFI_FILE_PROTOCOL *This)
+{
+	mem_file_close(This);
+	return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * Swap *File for a handle on the Size bytes at Data, which it takes over
+ * along with the Pages they were allocated in.
+ */
+static EFI_STATUS
+OpenMemFile(EFI_FILE_HANDLE *File, UINT8 *Data, UINTN Pages, UINTN Size)
+{
+	struct mem_file *mf;
+
+	mf = AllocateZeroPool(sizeof(*mf));
+	if (!mf)
+		return EFI_OUT_OF_RESOURCES;
+
+	mf->Data = Data;
+	mf->Pages = Pages;
+	mf->Size = Size;
+	mf->Pos = 0;
+	mf->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+	mf->File.Open = mem_file_open;
+	mf->File.Close = mem_file_close;
+	mf->File.Delete = mem_file_delete;
+	mf->File.Read = mem_file_read;
+	mf->File.Write = mem_file_write;
+	mf->File.GetPosition = mem_file_getpos;
+	mf->File.SetPosition = mem_file_setpos;
+	mf->File.GetInfo = mem_file_getinfo;
+	mf->File.SetInfo = mem_file_setinfo;
+	mf->File.Flush = mem_file_flush;
+
+	uefi_call_wrapper((*File)->Close, 1, *File);
+	*File = &mf->File;
+	return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * OpenCompressedImage()
+ *
+ * Description:
+ * Decode an LZ4, zstd or xz compressed executable into memory and swap *File
+ * for a handle on the decoded image, so that the loaders read it like any
+ * other file. The compressed file is read whole, so that blocks are decoded
+ * straight from it, and the output is sized from the frames, then trimmed.
+ *
+ * Where the pages below the compressed data are free, they are added to it
+ * and the image is decoded in place, as Linux's boot decompressor does: the
+ * output starts at the new base and grows towards the data, which ends the
+ * decoder's in-place margin past the end of the decoded bound, so that
+ * the output never catches up with input still to be read. That needs
+ * memory for the image and the margin rather than for both files. The
+ * data's pages past the image are given back afterwards.
+ *
+ * Arguments:
+ * File: The open compressed file; on success, the decoded image.
+ * Image: Receives the decoded image, for loaders that take a buffer.
+ * ImageSize: Receives its size.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, any other code on failure. On failure *File is
+ * left open and unchanged.
+ */
+static EFI_STATUS
+OpenCompressedImage(EFI_FILE_HANDLE *File, VOID **Image, UINTN *ImageSize)
+{
+	EFI_STATUS Status;
+	EFI_STATUS (*Bounder)(const VOID *, UINTN, UINT64 *);
+	UINTN (*Margin)(UINTN);
+	decompress_fn Decoder;
+	EFI_FILE_INFO *Info;
+	EFI_PHYSICAL_ADDRESS InAddr = 0, OutAddr = 0;
+	UINTN InfoSize, InLen, InPages, OutPages = 0, Len, Got, OutLen, Slack, Below;
+	UINT8 *In;
+	UINT64 Bound;
+
+	InfoSize = SIZE_OF_EFI_FILE_INFO + 512;
+	Info = AllocatePool(InfoSize);
+	if (!Info)
+		return EFI_OUT_OF_RESOURCES;
+	Status = uefi_call_wrapper((*File)->GetInfo, 4, *File, &gEfiFileInfoGuid, &InfoSize, Info);
+	InLen = EFI_ERROR(Status) ? 0 : (UINTN)Info->FileSize;
+	FreePool(Info);
+	if (EFI_ERROR(Status))
+		return Status;
+	if (InLen < 4)
+		return EFI_COMPROMISED_DATA;
+
+	InPages = EFI_SIZE_TO_PAGES(InLen);
+	Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, InPages, &InAddr);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	for (Got = 0; Got < InLen; Got += Len) {
+		Len = InLen - Got;
+		Status = uefi_call_wrapper((*File)->Read, 3, *File, &Len, (UINT8 *)(UINTN)InAddr + Got);
+		if (EFI_ERROR(Status))
+			goto cleanup;
+		if (Len == 0) {
+			Status = EFI_END_OF_FILE;
+			goto cleanup;
+		}
+	}
+	BootCounterAdd(BOOT_CTR_FILE_READ, InLen);
+
+	if (IsZstd((VOID *)(UINTN)InAddr)) {
+		Bounder = ZstdDecodedBound;
+		Margin = ZstdInPlaceMargin;
+		Decoder = ZstdBuffer;
+	} else if (InLen >= 6 && IsXz((VOID *)(UINTN)InAddr)) {
+		Bounder = XzDecodedBound;
+		Margin = XzInPlaceMargin;
+		Decoder = XzBuffer;
+	} else {
+		Bounder = Lz4DecodedBound;
+		Margin = Lz4InPlaceMargin;
+		Decoder = Lz4Buffer;
+	}
+
+	Status = Bounder((VOID *)(UINTN)InAddr, InLen, &Bound);
+	if (EFI_ERROR(Status))
+		goto cleanup;
+	Slack = Margin(InLen);
+	if (Bound > (UINTN)-1 - EFI_PAGE_SIZE - Slack) {
+		Status = EFI_OUT_OF_RESOURCES;
+		goto cleanup;
+	}
+
+	// The image, then the margin, must fit below the end of the data.
+	Below = (UINTN)Bound + Slack > InLen ? EFI_SIZE_TO_PAGES((UINTN)Bound + Slack - InLen) : 1;
+	In = (UINT8 *)(UINTN)InAddr;
+	OutAddr = InAddr;
+	OutPages = InPages;
+	if (!EFI_ERROR(HeapGrowPagesDown(EfiLoaderData, &OutAddr, &OutPages, Below))) {
+		InAddr = 0;		/* now the tail of the output's pages */
+	} else {
+		OutPages = MAX(EFI_SIZE_TO_PAGES((UINTN)Bound), 1);
+		Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, OutPages, &OutAddr);
+		if (EFI_ERROR(Status)) {
+			OutAddr = 0;
+			goto cleanup;
+		}
+	}
+
+	Status = Decoder(In, InLen, (VOID *)(UINTN)OutAddr, (UINTN)Bound, &OutLen);
+	if (EFI_ERROR(Status))
+		goto cleanup;
+
+	// Hand back what the bound over-estimated.
+	if (!EFI_ERROR(HeapTrimPages(OutAddr, OutPages, MAX(EFI_SIZE_TO_PAGES(OutLen), 1))))
+		OutPages = MAX(EFI_SIZE_TO_PAGES(OutLen), 1);
+
+	Status = OpenMemFile(File, (UINT8 *)(UINTN)OutAddr, OutPages, OutLen);
+	if (EFI_ERROR(Status))
+		goto cleanup;
+
+	*Image = (VOID *)(UINTN)OutAddr;
+	*ImageSize = OutLen;
+	OutAddr = 0;
+
+cleanup:
+	if (InAddr)
+		HeapFreePages(InAddr, InPages);
+	if (OutAddr)
+		HeapFreePages(OutAddr, OutPages);
+	return Status;
+}
+
+/*
+ * Function:
+ * OpenZipEntry()
+ *
+ * Description:
+ * Extract one entry of a zip file into memory and swap *File for a handle
+ * on it, as OpenCompressedImage() does for a compressed file. The entry is
+ * found through the archive's central directory, so of the whole archive
+ * only the directory and the entry itself are read. Without a Name, the
+ * archive must hold a single file; otherwise its contents are listed.
+ *
+ * Arguments:
+ * File: The open zip file; on success, the extracted entry.
+ * Name: The entry to extract, or NULL.
+ * Image: Receives the extracted entry, for loaders that take a buffer.
+ * ImageSize: Receives its size.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, any other code on failure. On failure *File is
+ * left open and unchanged.
+ */
+static EFI_STATUS
+OpenZipEntry(EFI_FILE_HANDLE *File, CHAR16 *Name, VOID **Image, UINTN *ImageSize)
+{
+	EFI_STATUS Status;
+	struct ZipIndex *Index;
+	struct ZipEntry *Entry;
+	EFI_PHYSICAL_ADDRESS OutAddr = 0;
+	UINTN OutPages = 0, OutLen, i;
+
+	Status = ZipOpenIndex(*File, &Index);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	Entry = ZipFindEntry(Index, Name);
+	if (!Entry) {
+		if (Name && *Name)
+			PrintToScreen(L"No entry %s in the zip file, which holds:\n", Name);
+		else
+			PrintToScreen(L"Name the entry to load (file.zip:entry); the zip file holds:\n");
+		for (i = 0; i < Index->Count; i++)
+			PrintToScreen(L"  %a (%u bytes)\n", Index->Entries[i].Name, (UINTN)Index->Entries[i].UncompressedSize);
+		Status = EFI_NOT_FOUND;
+		goto cleanup;
+	}
+
+	OutPages = MAX(EFI_SIZE_TO_PAGES((UINTN)Entry->UncompressedSize), 1);
+	Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, OutPages, &OutAddr);
+	if (EFI_ERROR(Status)) {
+		OutAddr = 0;
+		goto cleanup;
+	}
+
+	Status = ZipExtractEntry(Index, Entry, (UINT8 *)(UINTN)OutAddr, (UINTN)Entry->UncompressedSize, &OutLen);
+	if (EFI_ERROR(Status))
+		goto cleanup;
+
+	Status = OpenMemFile(File, (UINT8 *)(UINTN)OutAddr, OutPages, OutLen);
+	if (EFI_ERROR(Status))
+		goto cleanup;
+
+	*Image = (VOID *)(UINTN)OutAddr;
+	*ImageSize = OutLen;
+	OutAddr = 0;
+
+cleanup:
+	ZipCloseIndex(Index);
+	if (OutAddr)
+		HeapFreePages(OutAddr, OutPages);
+	return Status;
+}
 
 /*
  * Function:
@@ -57,10 +415,21 @@
  *	- ELF
  *	- EFI PE/COFF
  *
+ * Any of them may be LZ4, zstd or xz compressed; such a file is decoded into
+ * memory and loaded from there.
+ *
+ * The file may also be an entry of a zip file, named after a colon, as in
+ * sd(0,1)\boot.zip:vmlinuz. Only that entry is read and extracted, and it
+ * may itself be compressed.
+ *
  * The filesystem types supported are:
- *	- FAT32
+ *	- FAT32, through the firmware or the built-in driver (config field 10)
  *	- The filesystems listed in 'fs_table.c'. View that file for details.
  *
+ * Plugin filesystems are mounted through MountSlice(), so the file is always
+ * read through a Simple File System protocol, and EFI binaries are loaded by
+ * the firmware straight from the slice.
+ *
  * Large portions of code are shared with the 'ls' command. In particular, the VTOC routines,
  * the filesystem handling code, and the block device enumeration routine.
  *
@@ -74,23 +443,25 @@ EFI_STATUS
 LoadFile(CHAR16 *args)
 {
 	EFI_STATUS Status;
-	EFI_FILE_HANDLE File, RootFS;
+	EFI_FILE_HANDLE File = NULL, RootFS = NULL;
+	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *SimpleFs;
 	EFI_LOADED_IMAGE *LoadedImage;
 	EFI_BLOCK_IO_PROTOCOL *BlockIo = NULL;
+	EFI_HANDLE DiskHandle = NULL, DeviceHandle;
 	UINTN ReadSize;
 	UINT8 Header[64];
+	VOID *Image = NULL;
+	UINTN ImageSize = 0;
 	CHAR16 *Path;
+	CHAR16 *ZipEntry = NULL;
 	CHAR16 *ProgArgs = NULL;
 	UINTN DriveIndex = 0;
 	UINTN SliceIndex = 0;
 	UINT32 PartitionStart = 0;
-	UINT32 SliceLBA, SectorStart;
+	UINT32 SliceLBA, SliceSize, SectorStart;
 	struct svr4_vtoc *Vtoc = NULL;
 	struct mbr_partition *Partitions = NULL;
-	struct fs_tab_entry *fs_entry_ptr;
-	VOID *sb = NULL;
-	VOID *mount_ctx = NULL;
-	BOOLEAN detected_by_plugin = FALSE;
+	struct slice_mount *Mount;
 
 	// Process sd(x,y) only.
 	if (!args || StrnCmp(args, L"sd(", 3) != 0) {
@@ -160,6 +531,14 @@ LoadFile(CHAR16 *args)
 			PathBuf[ARRAY_SIZE(PathBuf) - 1] = L'\0';
 			Path = PathBuf;
 		}
+
+		// file.zip:entry names an entry of a zip file.
+		for (q = Path; *q != L'\0' && *q != L':'; q++)
+			;
+		if (*q == L':') {
+			*q++ = L'\0';
+			ZipEntry = q;
+		}
 	}
 
 	Status = uefi_call_wrapper(gBS->HandleProtocol, 3, gImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
@@ -168,20 +547,31 @@ LoadFile(CHAR16 *args)
 		return Status;
 	}
 
-	Status = uefi_call_wrapper(gBS->HandleProtocol, 3, LoadedImage->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&RootFS);
-	if (EFI_ERROR(Status)) {
-		PrintToScreen(L"Cannot get Simple File System protocol: %r\n", Status);
-		return Status;
-	}
-
-	Status = GetWholeDiskByIndex(DriveIndex, &BlockIo);
+	Status = GetWholeDiskByIndex(DriveIndex, &BlockIo, &DiskHandle);
 	if (EFI_ERROR(Status)) {
 		PrintToScreen(L"Cannot get whole disk by index: %r\n", Status);
 		return Status;
 	}
 
-	if (BlockIo->Media->RemovableMedia && !BlockIo->Media->LogicalPartition)
+	if (BlockIo->Media->RemovableMedia && !BlockIo->Media->LogicalPartition) {
+		DeviceHandle = LoadedImage->DeviceHandle;
+
+		// Optical media: read the ISO 9660 filesystem itself, not the El Torito image.
+		if (BlockIo->Media->BlockSize == ISO_SECTOR_SIZE && !EFI_ERROR(MountVolume(DiskHandle, &Mount))) {
+			DeviceHandle = Mount->Handle;
+			goto open_volume;
+		}
+
+		// Use the built-in FAT32 driver if enabled, falling back to the firmware's.
+		if (UseNativeFat) {
+			Status = MountVolume(DeviceHandle, &Mount);
+			if (!EFI_ERROR(Status))
+				DeviceHandle = Mount->Handle;
+			else
+				PrintToScreen(L"Built-in FAT32 driver unavailable (%r), using firmware driver\n", Status);
+		}
 		goto open_volume;
+	}
 
 	Partitions = AllocateZeroPool(sizeof(struct mbr_partition) * 4);
     if (!Partitions) {
@@ -197,8 +587,12 @@ LoadFile(CHAR16 *args)
 
 	Status = FindSysVPartition(Partitions, &PartitionStart);
 	if (EFI_ERROR(Status)) {
-		PrintToScreen(L"No System V partition detected.\n");
-		goto cleanup;
+		// Without a VTOC, sd(d,p) names MBR partition p if it holds a Linux filesystem.
+		if (EFI_ERROR(FindLinuxPartition(Partitions, SliceIndex, &SliceLBA, &SliceSize))) {
+			PrintToScreen(L"No System V partition detected.\n");
+			goto cleanup;
+		}
+		goto mount_slice;
 	}
 
 	Vtoc = AllocateZeroPool(sizeof(struct svr4_vtoc));
@@ -266,85 +660,44 @@ LoadFile(CHAR16 *args)
 		goto cleanup;
 	}
 
-	// Run through all supported filesystems to detect one.
-	for (fs_entry_ptr = fs_tab; fs_entry_ptr && fs_entry_ptr->fs_name != NULL; fs_entry_ptr++) {
-		if (fs_entry_ptr->sb_size == 0 || fs_entry_ptr->detect_fs == NULL)
-			continue;
-
-		sb = AllocateZeroPool(fs_entry_ptr->sb_size);
-		if (!sb) {
-			PrintToScreen(L"Failed to allocate memory for superblock\n");
-			continue;
-		}
+	SliceSize = Vtoc->v_part[SliceIndex].p_size;
 
-		Status = fs_entry_ptr->detect_fs(BlockIo, SliceLBA, sb);
-		if (EFI_ERROR(Status)) {
-			FreePool(sb);
-			sb = NULL;
-			continue;
-		}
-
-		PrintToScreen(L"Detected filesystem: %s\n", fs_entry_ptr->fs_name);
-
-		if (fs_entry_ptr->mount_fs) {
-			Status = fs_entry_ptr->mount_fs(BlockIo, SliceLBA, sb, &mount_ctx);
-			if (EFI_ERROR(Status)) {
-				PrintToScreen(L"Failed to mount %s: %r\n", fs_entry_ptr->fs_name, Status);
-				FreePool(sb);
-				sb = NULL;
-				continue;
-			}
-		}
-
-		FreePool(sb);
-		sb = NULL;
-		detected_by_plugin = TRUE;
-
-		if (fs_entry_ptr->open && mount_ctx) {
-			if (!Path) {
-                PrintToScreen(L"No file path specified!\n");
-                break;
-            }
-			/* fs_open_file_fn should return an EFI_FILE_HANDLE in file_out */
-			Status = fs_entry_ptr->open(mount_ctx, Path, EFI_FILE_MODE_READ, (void **)&File);
-			if (EFI_ERROR(Status)) {
-				PrintToScreen(L"Failed to open file: %r\n", Status);
-			} else {
-				/* Read header for format detection like open_volume path */
-				ReadSize = sizeof(Header);
-				Status = uefi_call_wrapper(File->Read, 3, File, &ReadSize, Header);
-				if (EFI_ERROR(Status)) {
-					PrintToScreen(L"Cannot read file %s: %r\n", Path, Status);
-					uefi_call_wrapper(File->Close, 1, File);
-					File = NULL;
-				} else {
-					uefi_call_wrapper(File->SetPosition, 2, File, 0);
-				}
-			}
-        }
+mount_slice:
+	// Mount the slice, or reuse an existing mount of it.
+	Status = MountSlice(DiskHandle, BlockIo, SliceIndex, SliceLBA, SliceSize, &Mount);
+	if (EFI_ERROR(Status)) {
+		if (Status == EFI_NOT_FOUND)
+			PrintToScreen(L"No supported filesystem found at sd(%d,%d)\n", DriveIndex, SliceIndex);
+		else
+			PrintToScreen(L"Cannot mount sd(%d,%d): %r\n", DriveIndex, SliceIndex, Status);
+		goto cleanup;
+	}
 
-		PrintToScreen(L"Loaded file: %s\n", Path);
+	DeviceHandle = Mount->Handle;
 
-		if (fs_entry_ptr->umount_fs && mount_ctx) {
-			fs_entry_ptr->umount_fs(mount_ctx);
-			mount_ctx = NULL;
-		}
+	// The partition table and VTOC were only needed to find the slice.
+	FreePool(Partitions);
+	Partitions = NULL;
+	if (Vtoc) {
+		FreePool(Vtoc);
+		Vtoc = NULL;
+	}
 
-		if (detected_by_plugin)
-			break;
+open_volume:
+	Status = uefi_call_wrapper(gBS->HandleProtocol, 3, DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&SimpleFs);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot get Simple File System protocol: %r\n", Status);
+		return Status;
 	}
 
-	// A filesystem was detected and the executable was loaded by a plugin.
-	// Clean up and exit if there wasn't one.
-	if (detected_by_plugin)
-		goto check_exec;
-	else {
-		PrintToScreen(L"No supported filesystem found at sd(%d,%d)\n", DriveIndex, SliceIndex);
-		goto cleanup;
+	Status = uefi_call_wrapper(SimpleFs->OpenVolume, 2, SimpleFs, &RootFS);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot open volume: %r\n", Status);
+		return Status;
 	}
 
-open_volume:
 	Status = uefi_call_wrapper(RootFS->Open, 5, RootFS, &File, Path, EFI_FILE_MODE_READ, 0);
+	uefi_call_wrapper(RootFS->Close, 1, RootFS);
 	if (EFI_ERROR(Status)) {
 		PrintToScreen(L"Cannot open file %s: %r\n", Path, Status);
 		return Status;
@@ -360,7 +713,29 @@ open_volume:
 
 	uefi_call_wrapper(File->SetPosition, 2, File, 0);
 
-check_exec:
+	if (ZipEntry || (ReadSize >= 4 && IsZip(Header))) {
+		Status = OpenZipEntry(&File, ZipEntry, &Image, &ImageSize);
+		if (EFI_ERROR(Status)) {
+			PrintToScreen(L"Cannot unzip %s: %r\n", Path, Status);
+			uefi_call_wrapper(File->Close, 1, File);
+			return Status;
+		}
+		ReadSize = MIN(ImageSize, sizeof(Header));
+		SetMem(Header, sizeof(Header), 0);
+		CopyMem(Header, Image, ReadSize);
+	}
+
+	if ((ReadSize >= 4 && (IsLz4(Header) || IsZstd(Header))) || (ReadSize >= 6 && IsXz(Header))) {
+		Status = OpenCompressedImage(&File, &Image, &ImageSize);
+		if (EFI_ERROR(Status)) {
+			PrintToScreen(L"Cannot decompress %s: %r\n", Path, Status);
+			uefi_call_wrapper(File->Close, 1, File);
+			return Status;
+		}
+		SetMem(Header, sizeof(Header), 0);
+		CopyMem(Header, Image, MIN(ImageSize, sizeof(Header)));
+	}
+
 	if (IsAOut(Header)) {
 		Status = LoadAOutBinary(File);
 		if (EFI_ERROR(Status)) {
@@ -375,7 +750,7 @@ check_exec:
 		}
 	} else if (IsEfiBinary(Header)) {
 		/* Pass ProgArgs to the EFI loader so it can set LoadOptions */
-		Status = LoadEfiBinary(Path, LoadedImage, LoadedImage->DeviceHandle, ProgArgs);
+		Status = LoadEfiBinary(Path, LoadedImage, DeviceHandle, ProgArgs, Image, ImageSize);
         if (EFI_ERROR(Status)) {
 			PrintToScreen(L"Failed to load EFI binary %s: %r\n", Path, Status);
 			return Status;
@@ -389,5 +764,11 @@ cleanup:
 	if (File)
 		uefi_call_wrapper(File->Close, 1, File);
 
+	if (Partitions)
+		FreePool(Partitions);
+
+	if (Vtoc)
+		FreePool(Vtoc);
+
 	return EFI_SUCCESS;
 }
@@ -0,0 +1,747 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * lz4.c
+ * LZ4 block and frame decoder.
+ *
+ * An LZ4 block is a series of sequences, each a token, a run of literals
+ * and a match of at least MIN_MATCH bytes at most 64K back. Literals and
+ * matches are copied in whole 16 or 8 byte chunks, which may write past
+ * their end; that is only done while the output has WILD_MARGIN bytes to
+ * spare, so the last few sequences of a block are copied exactly.
+ *
+ * As in inflate.c, the decoder's window is the output buffer itself: a
+ * frame of linked blocks needs no history of its own, and blocks are
+ * decoded straight from the caller's input whenever a whole block sits in
+ * one piece of it.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "clock.h"
+#include "decompress.h"
+
+#define LZ4_MAGIC               0x184D2204
+#define LZ4_LEGACY_MAGIC        0x184C2102
+
+#define LZ4_FLG_VERSION_MASK    0xC0
+#define LZ4_FLG_VERSION         0x40
+#define LZ4_FLG_BLOCK_INDEP     0x20
+#define LZ4_FLG_BLOCK_CHECKSUM  0x10
+#define LZ4_FLG_CONTENT_SIZE    0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_RESERVED        0x02
+#define LZ4_FLG_DICT_ID         0x01
+#define LZ4_BD_RESERVED         0x8F
+#define LZ4_BD_MAX_SIZE(bd)     ((UINTN)1 << (2 * (((bd) >> 4) & 7) + 8))
+#define LZ4_BD_MIN              0x40    /* 64K blocks */
+
+#define LZ4_BLOCK_RAW           0x80000000
+#define LZ4_LEGACY_BLOCK_SIZE   (8 << 20)
+#define LZ4_LEGACY_BOUND        (LZ4_LEGACY_BLOCK_SIZE + LZ4_LEGACY_BLOCK_SIZE / 255 + 16)
+
+#define MIN_MATCH               4
+#define WILD_MARGIN             16      /* output room for chunked copies */
+#define SHORTCUT_MARGIN         64      /* output room for the shortcut's copies */
+
+#define XXH_PRIME1              0x9E3779B1U
+#define XXH_PRIME2              0x85EBCA77U
+#define XXH_PRIME3              0xC2B2AE3DU
+#define XXH_PRIME4              0x27D4EB2FU
+#define XXH_PRIME5              0x165667B1U
+
+#define LZ4_GET32(p)            ((UINT32)(p)[0] | ((UINT32)(p)[1] << 8) | \
+                                 ((UINT32)(p)[2] << 16) | ((UINT32)(p)[3] << 24))
+
+/* Piecewise input, with a staging buffer for blocks split across pieces. */
+struct lz4_input {
+    inflate_input_fn Input;
+    VOID *Context;
+    UINT8 *Piece;
+    UINTN Left;             /* bytes of Piece not yet used */
+    UINTN Fed;              /* bytes handed over by Input */
+    UINT8 *Block;
+    UINTN BlockSize;
+};
+
+static inline UINT32
+rotl32(UINT32 x, unsigned r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline UINT32
+read32(const UINT8 *p)
+{
+    UINT32 v;
+
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* XXH32 of one buffer, as used for the frame's header and checksums. */
+static UINT32
+xxh32(const VOID *Buf, UINTN Len, UINT32 Seed)
+{
+    const UINT8 *p = Buf;
+    const UINT8 *end = p + Len;
+    UINT32 v1, v2, v3, v4, h;
+
+    if (Len >= 16) {
+        v1 = Seed + XXH_PRIME1 + XXH_PRIME2;
+        v2 = Seed + XXH_PRIME2;
+        v3 = Seed;
+        v4 = Seed - XXH_PRIME1;
+        do {
+            v1 = rotl32(v1 + read32(p) * XXH_PRIME2, 13) * XXH_PRIME1;
+            v2 = rotl32(v2 + read32(p + 4) * XXH_PRIME2, 13) * XXH_PRIME1;
+            v3 = rotl32(v3 + read32(p + 8) * XXH_PRIME2, 13) * XXH_PRIME1;
+            v4 = rotl32(v4 + read32(p + 12) * XXH_PRIME2, 13) * XXH_PRIME1;
+            p += 16;
+        } while (end - p >= 16);
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = Seed + XXH_PRIME5;
+    }
+
+    h += (UINT32)Len;
+    for (; end - p >= 4; p += 4)
+        h = rotl32(h + read32(p) * XXH_PRIME3, 17) * XXH_PRIME4;
+    for (; p < end; p++)
+        h = rotl32(h + *p * XXH_PRIME5, 11) * XXH_PRIME1;
+
+    h ^= h >> 15;
+    h *= XXH_PRIME2;
+    h ^= h >> 13;
+    h *= XXH_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline __attribute__((always_inline)) void
+copy8(UINT8 *out, const UINT8 *src)
+{
+    UINT64 w;
+
+    __builtin_memcpy(&w, src, sizeof(w));
+    __builtin_memcpy(out, &w, sizeof(w));
+}
+
+static inline __attribute__((always_inline)) void
+copy16(UINT8 *out, const UINT8 *src)
+{
+    UINT64 w, w2;
+
+    __builtin_memcpy(&w, src, sizeof(w));
+    __builtin_memcpy(&w2, src + sizeof(w), sizeof(w2));
+    __builtin_memcpy(out, &w, sizeof(w));
+    __builtin_memcpy(out + sizeof(w), &w2, sizeof(w2));
+}
+
+/*
+ * For an offset below 8, the smallest multiple of it that is at least 8:
+ * once the first 8 bytes of the match are in place, copying from that far
+ * back repeats the same pattern a whole word at a time.
+ */
+static const UINT8 short_stride[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+
+/*
+ * Copy a match of len bytes from offset back. Stores are whole chunks,
+ * so this may write up to WILD_MARGIN - 1 bytes past the match.
+ */
+static inline __attribute__((always_inline)) void
+copy_match_wild(UINT8 *out, UINTN len, UINTN offset)
+{
+    const UINT8 *src = out - offset;
+    UINT8 *end = out + len;
+    UINTN i;
+
+    if (offset >= 16) {
+        do {
+            copy16(out, src);
+            src += 16;
+            out += 16;
+        } while (out < end);
+        return;
+    }
+
+    if (offset < 8) {
+        for (i = 0; i < 8; i++)
+            out[i] = src[i];
+        out += 8;
+        src = out - short_stride[offset];
+        if (out >= end)
+            return;
+    }
+
+    /* each word read was completely written by an earlier store */
+    do {
+        copy8(out, src);
+        src += 8;
+        out += 8;
+    } while (out < end);
+}
+
+/*
+ * Decode one block from [in, in_end) to out, going no further than
+ * out_end. Matches may reach back as far as window. Returns the end of
+ * the output, or NULL if the block is corrupt or does not fit.
+ */
+static UINT8 *
+lz4_block(const UINT8 *in, const UINT8 *in_end, UINT8 *out, UINT8 *out_end, const UINT8 *window)
+{
+    UINTN token, len, offset;
+    UINT8 *end;
+    UINT8 c;
+
+    for (;;) {
+        if (in >= in_end)
+            return NULL;
+        token = *in++;
+
+        /*
+         * Shortcut for the usual sequence of under 15 literals and a match
+         * of under 19 bytes: fixed-size copies after one bounds check. With
+         * 18 bytes of input left, this cannot be the last sequence.
+         */
+        len = token >> 4;
+        if (len < 15 && (UINTN)(in_end - in) >= 16 + 2 && (UINTN)(out_end - out) >= SHORTCUT_MARGIN) {
+            copy16(out, in);
+            in += len;
+            out += len;
+            offset = in[0] | ((UINTN)in[1] << 8);
+            in += 2;
+            len = token & 15;
+            if (len < 15 && offset >= 8 && (UINTN)(out - window) >= offset) {
+                copy8(out, out - offset);
+                copy8(out + 8, out - offset + 8);
+                copy8(out + 16, out - offset + 16);
+                out += len + MIN_MATCH;
+                continue;
+            }
+            goto match;
+        }
+
+        if (len == 15) {
+            do {
+                if (in >= in_end)
+                    return NULL;
+                c = *in++;
+                len += c;
+            } while (c == 255);
+        }
+
+        if ((UINTN)(in_end - in) >= len + 16 && (UINTN)(out_end - out) >= len + WILD_MARGIN) {
+            end = out + len;
+            do {
+                copy16(out, in);
+                in += 16;
+                out += 16;
+            } while (out < end);
+            in -= out - end;
+            out = end;
+        } else {
+            if ((UINTN)(in_end - in) < len || (UINTN)(out_end - out) < len)
+                return NULL;
+            CopyMem(out, (VOID *)in, len);
+            in += len;
+            out += len;
+        }
+
+        /* the last sequence is literals only */
+        if (in == in_end)
+            return out;
+
+        if (in_end - in < 2)
+            return NULL;
+        offset = in[0] | ((UINTN)in[1] << 8);
+        in += 2;
+        len = token & 15;
+
+match:
+        if (offset == 0 || (UINTN)(out - window) < offset)
+            return NULL;
+        if (len == 15) {
+            do {
+                if (in >= in_end)
+                    return NULL;
+                c = *in++;
+                len += c;
+            } while (c == 255);
+        }
+        len += MIN_MATCH;
+
+        if ((UINTN)(out_end - out) >= len + WILD_MARGIN) {
+            copy_match_wild(out, len, offset);
+            out += len;
+        } else {
+            if ((UINTN)(out_end - out) < len)
+                return NULL;
+            end = out + len;
+            while (out < end) {
+                *out = *(out - offset);
+                out++;
+            }
+        }
+    }
+}
+
+/* Get the next piece of input. */
+static EFI_STATUS
+lz4_next(struct lz4_input *s)
+{
+    EFI_STATUS Status;
+
+    Status = s->Input(s->Context, &s->Piece, &s->Left);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (s->Left == 0)
+        return EFI_END_OF_FILE;
+    s->Fed += s->Left;
+    return EFI_SUCCESS;
+}
+
+/* Copy the next Len bytes of input to Buf. */
+static EFI_STATUS
+lz4_read(struct lz4_input *s, VOID *Buf, UINTN Len)
+{
+    UINT8 *p = Buf;
+    UINTN n;
+    EFI_STATUS Status;
+
+    while (Len > 0) {
+        if (s->Left == 0) {
+            Status = lz4_next(s);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+        n = Len < s->Left ? Len : s->Left;
+        CopyMem(p, s->Piece, n);
+        s->Piece += n;
+        s->Left -= n;
+        p += n;
+        Len -= n;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Point *Data at the next Len bytes of input: in place when they are in
+ * the current piece, otherwise gathered into the staging buffer.
+ */
+static EFI_STATUS
+lz4_data(struct lz4_input *s, UINTN Len, const UINT8 **Data)
+{
+    if (s->Left >= Len) {
+        *Data = s->Piece;
+        s->Piece += Len;
+        s->Left -= Len;
+        return EFI_SUCCESS;
+    }
+
+    if (s->BlockSize < Len) {
+        if (s->Block)
+            FreePool(s->Block);
+        s->BlockSize = 0;
+        s->Block = AllocatePool(Len);
+        if (!s->Block)
+            return EFI_OUT_OF_RESOURCES;
+        s->BlockSize = Len;
+    }
+
+    *Data = s->Block;
+    return lz4_read(s, s->Block, Len);
+}
+
+/*
+ * Legacy frames, as made by "lz4 -l" for Linux kernels and initramfs:
+ * independent blocks of up to 8M each, each preceded by its size, until
+ * the input ends. Another legacy magic number starts a new frame.
+ */
+static EFI_STATUS
+lz4_legacy(struct lz4_input *s, inflate_progress_fn Progress, UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos)
+{
+    EFI_STATUS Status;
+    const UINT8 *Data;
+    UINT8 Word[4];
+    UINT8 *out = Out;
+    UINT8 *end;
+    UINT32 Size;
+
+    for (;;) {
+        *OutPos = out;
+
+        Status = lz4_read(s, Word, sizeof(Word));
+        if (Status == EFI_END_OF_FILE)
+            return EFI_SUCCESS;
+        if (EFI_ERROR(Status))
+            return Status;
+
+        // Kernel builds append the decoded size; it is the last word.
+        if (s->Left == 0) {
+            Status = lz4_next(s);
+            if (Status == EFI_END_OF_FILE)
+                return EFI_SUCCESS;
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+
+        // Zero padding, as at the end of a partition, ends it too.
+        Size = LZ4_GET32(Word);
+        if (Size == 0)
+            return EFI_SUCCESS;
+        if (Size == LZ4_LEGACY_MAGIC)
+            continue;
+        if (Size > LZ4_LEGACY_BOUND)
+            return EFI_COMPROMISED_DATA;
+
+        Status = lz4_data(s, Size, &Data);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        end = (UINTN)(OutEnd - out) > LZ4_LEGACY_BLOCK_SIZE ? out + LZ4_LEGACY_BLOCK_SIZE : OutEnd;
+        out = lz4_block(Data, Data + Size, out, end, out);
+        if (!out)
+            return EFI_COMPROMISED_DATA;
+
+        if (Progress)
+            Progress(s->Context, (UINTN)(out - Out));
+    }
+}
+
+/*
+ * Decode one frame. *OutPos tracks the end of the output decoded so far.
+ */
+static EFI_STATUS
+lz4_frame(struct lz4_input *s, inflate_progress_fn Progress, UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos)
+{
+    EFI_STATUS Status;
+    const UINT8 *Data;
+    UINT8 Desc[11];
+    UINT8 Word[4];
+    UINT8 *out = Out;
+    UINT8 *end;
+    const UINT8 *window;
+    UINTN n, BlockMax;
+    UINT64 ContentSize = 0;
+    UINT32 Size;
+    UINT8 Flags;
+
+    *OutPos = out;
+
+    Status = lz4_read(s, Desc, 2);
+    if (EFI_ERROR(Status))
+        return Status;
+    Flags = Desc[0];
+    if ((Flags & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION || (Flags & LZ4_FLG_RESERVED) ||
+        (Desc[1] & LZ4_BD_RESERVED) || Desc[1] < LZ4_BD_MIN)
+        return EFI_COMPROMISED_DATA;
+    if (Flags & LZ4_FLG_DICT_ID)
+        return EFI_UNSUPPORTED;
+    BlockMax = LZ4_BD_MAX_SIZE(Desc[1]);
+
+    n = 2;
+    if (Flags & LZ4_FLG_CONTENT_SIZE) {
+        Status = lz4_read(s, Desc + n, 8);
+        if (EFI_ERROR(Status))
+            return Status;
+        ContentSize = LZ4_GET32(Desc + n) | ((UINT64)LZ4_GET32(Desc + n + 4) << 32);
+        n += 8;
+        if (ContentSize > (UINT64)(OutEnd - Out))
+            return EFI_COMPROMISED_DATA;
+    }
+
+    Status = lz4_read(s, Desc + n, 1);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (Desc[n] != (UINT8)(xxh32(Desc, n, 0) >> 8))
+        return EFI_CRC_ERROR;
+
+    for (;;) {
+        Status = lz4_read(s, Word, sizeof(Word));
+        if (EFI_ERROR(Status))
+            return Status;
+        Size = LZ4_GET32(Word);
+        if (Size == 0)
+            break;
+
+        n = Size & ~LZ4_BLOCK_RAW;
+        if (n > BlockMax)
+            return EFI_COMPROMISED_DATA;
+
+        Status = lz4_data(s, n, &Data);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        if (Flags & LZ4_FLG_BLOCK_CHECKSUM) {
+            Status = lz4_read(s, Word, sizeof(Word));
+            if (EFI_ERROR(Status))
+                return Status;
+            if (xxh32(Data, n, 0) != LZ4_GET32(Word))
+                return EFI_CRC_ERROR;
+        }
+
+        if (Size & LZ4_BLOCK_RAW) {
+            if ((UINTN)(OutEnd - out) < n)
+                return EFI_COMPROMISED_DATA;
+            CopyMem(out, (VOID *)Data, n);
+            out += n;
+        } else {
+            window = (Flags & LZ4_FLG_BLOCK_INDEP) ? out : Out;
+            end = (UINTN)(OutEnd - out) > BlockMax ? out + BlockMax : OutEnd;
+            out = lz4_block(Data, Data + n, out, end, window);
+            if (!out)
+                return EFI_COMPROMISED_DATA;
+        }
+        *OutPos = out;
+
+        if (Progress)
+            Progress(s->Context, (UINTN)(out - Out));
+    }
+
+    if ((Flags & LZ4_FLG_CONTENT_SIZE) && ContentSize != (UINT64)(out - Out))
+        return EFI_COMPROMISED_DATA;
+
+    if (Flags & LZ4_FLG_CONTENT_CHECKSUM) {
+        Status = lz4_read(s, Word, sizeof(Word));
+        if (EFI_ERROR(Status))
+            return Status;
+        if (xxh32(Out, (UINTN)(out - Out), 0) != LZ4_GET32(Word))
+            return EFI_CRC_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+BOOLEAN
+IsLz4(const VOID *Header)
+{
+    const UINT8 *p = Header;
+    UINT32 Magic = LZ4_GET32(p);
+
+    return Magic == LZ4_MAGIC || Magic == LZ4_LEGACY_MAGIC;
+}
+
+/*
+ * Lz4Stream: decode one LZ4 frame, or a legacy stream, whose input
+ * arrives in pieces from Input. As with InflateStream(), the output must
+ * be one contiguous buffer; anything after the frame is left unread.
+ */
+EFI_STATUS
+Lz4Stream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct lz4_input s;
+    EFI_STATUS Status;
+    UINT8 Word[4];
+    UINT8 *OutPos = Out;
+    UINT32 Magic;
+
+    if (!Input || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    s.Input = Input;
+    s.Context = Context;
+    s.Piece = NULL;
+    s.Left = 0;
+    s.Fed = 0;
+    s.Block = NULL;
+    s.BlockSize = 0;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    Status = lz4_read(&s, Word, sizeof(Word));
+    if (!EFI_ERROR(Status)) {
+        Magic = LZ4_GET32(Word);
+        if (Magic == LZ4_MAGIC)
+            Status = lz4_frame(&s, Progress, Out, (UINT8 *)Out + OutSize, &OutPos);
+        else if (Magic == LZ4_LEGACY_MAGIC)
+            Status = lz4_legacy(&s, Progress, Out, (UINT8 *)Out + OutSize, &OutPos);
+        else
+            Status = EFI_UNSUPPORTED;
+    }
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+
+    if (s.Block)
+        FreePool(s.Block);
+
+    *OutLen = (UINTN)(OutPos - (UINT8 *)Out);
+    BootCounterAdd(BOOT_CTR_LZ4_IN, s.Fed - s.Left);
+    BootCounterAdd(BOOT_CTR_LZ4_OUT, *OutLen);
+
+    // The input ending inside the frame means it was cut short.
+    if (Status == EFI_END_OF_FILE)
+        return EFI_COMPROMISED_DATA;
+    return Status;
+}
+
+struct lz4_buffer {
+    const UINT8 *Buf;
+    UINTN Len;
+};
+
+/* inflate_input_fn: the whole buffer, then the end of the input. */
+static EFI_STATUS
+lz4_buffer_input(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct lz4_buffer *b = Context;
+
+    *Buf = (UINT8 *)b->Buf;
+    *Len = b->Len;
+    b->Len = 0;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Lz4Buffer: decode an LZ4 frame, or a legacy stream, that is all in
+ * memory.
+ */
+EFI_STATUS
+Lz4Buffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct lz4_buffer b;
+
+    if (!In)
+        return EFI_INVALID_PARAMETER;
+
+    b.Buf = In;
+    b.Len = InLen;
+    return Lz4Stream(lz4_buffer_input, NULL, &b, Out, OutSize, OutLen);
+}
+
+/*
+ * Lz4DecodedBound: an upper bound on the decoded size of the LZ4 frame or
+ * legacy stream in memory at In, from its content size if it records one,
+ * otherwise from the number of blocks and their maximum size.
+ */
+EFI_STATUS
+Lz4DecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound)
+{
+    const UINT8 *p = In;
+    const UINT8 *end = p + InLen;
+    UINT64 Total = 0;
+    UINTN BlockMax, n;
+    UINT32 Size;
+    UINT8 Flags;
+
+    if (!In || !Bound || InLen < 4)
+        return EFI_INVALID_PARAMETER;
+
+    if (LZ4_GET32(p) == LZ4_LEGACY_MAGIC) {
+        // As in lz4_legacy(), a last word on its own is not a block.
+        for (p += 4; end - p > 4; p += 4 + Size) {
+            Size = LZ4_GET32(p);
+            if (Size == 0)
+                break;
+            if (Size == LZ4_LEGACY_MAGIC) {
+                Size = 0;
+                continue;
+            }
+            if (Size > LZ4_LEGACY_BOUND)
+                return EFI_COMPROMISED_DATA;
+            if ((UINTN)(end - p - 4) < Size)
+                break;
+            Total += LZ4_LEGACY_BLOCK_SIZE;
+        }
+        *Bound = Total;
+        return EFI_SUCCESS;
+    }
+
+    if (LZ4_GET32(p) != LZ4_MAGIC || InLen < 7)
+        return EFI_UNSUPPORTED;
+
+    Flags = p[4];
+    if ((Flags & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION || p[5] < LZ4_BD_MIN)
+        return EFI_COMPROMISED_DATA;
+    if (Flags & LZ4_FLG_CONTENT_SIZE) {
+        if (InLen < 14)
+            return EFI_COMPROMISED_DATA;
+        *Bound = LZ4_GET32(p + 6) | ((UINT64)LZ4_GET32(p + 10) << 32);
+        return EFI_SUCCESS;
+    }
+    BlockMax = LZ4_BD_MAX_SIZE(p[5]);
+
+    p += 7 + ((Flags & LZ4_FLG_DICT_ID) ? 4 : 0);
+    while (end - p >= 4) {
+        Size = LZ4_GET32(p);
+        if (Size == 0)
+            break;
+        n = Size & ~LZ4_BLOCK_RAW;
+        if (n > BlockMax)
+            return EFI_COMPROMISED_DATA;
+        Total += (Size & LZ4_BLOCK_RAW) ? n : BlockMax;
+        p += 4 + n + ((Flags & LZ4_FLG_BLOCK_CHECKSUM) ? 4 : 0);
+    }
+
+    *Bound = Total;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Lz4InPlaceMargin: how far the end of InLen bytes of compressed data must
+ * lie past the end of the decoded bound for Lz4Buffer() to decode them in
+ * place, writing the output over the front of the same buffer. Blocks are
+ * read front to back, so the output only has to stay behind the input:
+ * literal run lengths cost at most one byte in 255, plus the block and
+ * frame headers and the chunked copies' overrun.
+ */
+UINTN
+Lz4InPlaceMargin(UINTN InLen)
+{
+    return (InLen >> 8) + 256 + WILD_MARGIN;
+}
+
+/*
+ * Lz4Decompress: decode a single raw LZ4 block, as SquashFS stores them.
+ */
+EFI_STATUS
+Lz4Decompress(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    UINT8 *end;
+
+    if (!In || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    end = lz4_block(In, (const UINT8 *)In + InLen, Out, (UINT8 *)Out + OutSize, Out);
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+    if (!end)
+        return EFI_COMPROMISED_DATA;
+
+    *OutLen = (UINTN)(end - (UINT8 *)Out);
+    BootCounterAdd(BOOT_CTR_LZ4_IN, InLen);
+    BootCounterAdd(BOOT_CTR_LZ4_OUT, *OutLen);
+    return EFI_SUCCESS;
+}
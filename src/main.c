@@ -34,11 +34,16 @@
 #include <efi.h>
 #include <efilib.h>
 
+#include "arena.h"
 #include "boot.h"
+#include "clock.h"
 #include "cmd.h"
 #include "config.h"
+#include "decompress.h"
 #include "disk.h"
+#include "heap.h"
 #include "menu.h"
+#include "mount.h"
 #include "serial.h"
 
 static CHAR16 filepath[256] = {0};			// bootloader file path
@@ -53,29 +58,6 @@ UINT64 *ActualDestinationAddress;
 UINT32 *ActualDestinationAddress;
 #endif
 
-#define KRamTargetSize  (8 * 1024 * 1024)		// 8 megabytes.
-
-EFI_STATUS
-GetChunk(void)
-{
-    EFI_STATUS Status;
-    EFI_PHYSICAL_ADDRESS PhysAddr = 0;
-
-    Status = uefi_call_wrapper(gBS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, EFI_SIZE_TO_PAGES(KRamTargetSize), &PhysAddr);
-    if (EFI_ERROR(Status)) {
-        Print(L"FAULT due to AllocatePages (%r)\n", Status);
-        return Status;
-    }
-
-#if _LP64
-    ActualDestinationAddress = (UINT64 *)(UINTN)PhysAddr;
-#else
-    ActualDestinationAddress = (UINT32 *)(UINTN)PhysAddr;
-#endif
-
-    return EFI_SUCCESS;
-}
-
 EFI_STATUS EFIAPI
 efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 {
@@ -89,13 +71,17 @@ efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 	// Disable UEFI watchdog timer.
 	uefi_call_wrapper(BS->SetWatchdogTimer, 4, 0, 0, 0, NULL);
 
-	// Get the memory download area mapped into a chunk.
-	Status = GetChunk();
-	if (EFI_ERROR(Status))
-		HeliumBootPanic(Status, L"GetChunk() failed!\n");
+	// Pick the memory copy routines before anything moves large blocks.
+	InitMemRoutines();
+	InitCrc32();
+
+	// Start the boot clock; everything after this is profiled.
+	InitClock();
 
 	// Initialize video output, so that we can use graphics.
+	BootPhaseBegin(BOOT_PHASE_VIDEO);
 	Status = InitVideo();
+	BootPhaseEnd(BOOT_PHASE_VIDEO);
 	if (EFI_ERROR(Status))
 		HeliumBootPanic(Status, L"Could not initialize video!\n");
 
@@ -121,12 +107,17 @@ efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 #endif /* _LP64 */
 #endif /* DEBUG_BLD */
 
+	BootPhaseBegin(BOOT_PHASE_CONFIG);
 	Status = ReadConfig(CONFIG_FILE, NULL);
+	BootPhaseEnd(BOOT_PHASE_CONFIG);
 	if (EFI_ERROR(Status))
 		HeliumBootPanic(Status, L"Cannot load config file!\n");
 
-	if (!NoMenuLoad)
+	if (!NoMenuLoad) {
+		BootPhaseBegin(BOOT_PHASE_MENU);
 		StartMenu();
+		BootPhaseEnd(BOOT_PHASE_MENU);
+	}
 
 	IsInternalBoot = BootedFromInternalFlash();
 	if (IsInternalBoot) {
@@ -193,8 +184,13 @@ CommandMonitor(void)
 			}
 		}
 
+		// Scratch memory handed out during the command is no longer needed.
+		CmdArenaReset();
+		HeapCheckpoint();
+
 		if (exit_flag) {
 			exit_flag = FALSE;	// Reset the exit flag.
+			UnmountAllSlices();
 			break;
 		}
 
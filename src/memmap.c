@@ -0,0 +1,286 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * memmap.c
+ * Cached view of the firmware memory map.
+ *
+ * The raw map is fetched into a page buffer that is kept between calls and
+ * has room to spare, so refreshing it normally does not allocate (and so
+ * does not change the map it is reading). From the raw map we derive the
+ * total size of each memory type and a sorted, coalesced list of free
+ * regions, rebuilt only when the firmware's map key changes.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "heap.h"
+#include "memmap.h"
+
+static EFI_MEMORY_DESCRIPTOR *MapBuf;
+static UINTN MapBufPages;
+static UINTN MapSize, MapKey, DescSize;
+static UINT32 DescVersion;
+
+static BOOLEAN Valid;		/* derived data matches BuiltKey */
+static UINTN BuiltKey;
+static UINT64 Totals[EfiMaxMemoryType];
+static struct mem_region FreeRegions[MEMMAP_MAX_FREE];
+static UINTN NumFree;
+
+/*
+ * Insert a free run, keeping the list sorted by address. Maps come from
+ * the firmware mostly sorted, so this is usually an append. If the table
+ * is full the run is dropped; it still counts towards the totals.
+ */
+static VOID
+memmap_add_free(EFI_PHYSICAL_ADDRESS Start, UINT64 Pages)
+{
+	UINTN i;
+
+	if (NumFree == MEMMAP_MAX_FREE)
+		return;
+
+	for (i = NumFree; i > 0 && FreeRegions[i - 1].Start > Start; i--)
+		FreeRegions[i] = FreeRegions[i - 1];
+
+	FreeRegions[i].Start = Start;
+	FreeRegions[i].Pages = Pages;
+	NumFree++;
+}
+
+static VOID
+memmap_build(VOID)
+{
+	EFI_MEMORY_DESCRIPTOR *Desc;
+	UINTN i, j;
+
+	SetMem(Totals, sizeof(Totals), 0);
+	NumFree = 0;
+
+	for (i = 0; i < MapSize / DescSize; i++) {
+		Desc = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MapBuf + i * DescSize);
+		if (Desc->Type < EfiMaxMemoryType)
+			Totals[Desc->Type] += Desc->NumberOfPages * EFI_PAGE_SIZE;
+		if (Desc->Type == EfiConventionalMemory && Desc->NumberOfPages)
+			memmap_add_free(Desc->PhysicalStart, Desc->NumberOfPages);
+	}
+
+	/* Coalesce neighbours. */
+	for (i = 0, j = 1; j < NumFree; j++) {
+		if (FreeRegions[i].Start + FreeRegions[i].Pages * EFI_PAGE_SIZE == FreeRegions[j].Start)
+			FreeRegions[i].Pages += FreeRegions[j].Pages;
+		else
+			FreeRegions[++i] = FreeRegions[j];
+	}
+	if (NumFree)
+		NumFree = i + 1;
+
+	BuiltKey = MapKey;
+	Valid = TRUE;
+}
+
+EFI_STATUS
+MemMapRefresh(VOID)
+{
+	EFI_STATUS Status;
+	EFI_PHYSICAL_ADDRESS Addr;
+	UINTN Size;
+
+	for (;;) {
+		Size = MapBufPages * EFI_PAGE_SIZE;
+		Status = uefi_call_wrapper(BS->GetMemoryMap, 5, &Size, MapBuf, &MapKey, &DescSize, &DescVersion);
+		if (Status != EFI_BUFFER_TOO_SMALL)
+			break;
+
+		/*
+		 * Allocating the buffer may split a free region, so leave room
+		 * for that and for whatever else changes before the next call.
+		 */
+		if (MapBuf)
+			HeapFreePages((EFI_PHYSICAL_ADDRESS)(UINTN)MapBuf, MapBufPages);
+		MapBuf = NULL;
+		MapBufPages = EFI_SIZE_TO_PAGES(Size + MEMMAP_SLACK * DescSize);
+		Status = HeapAllocatePages(AllocateAnyPages, EfiLoaderData, MapBufPages, &Addr);
+		if (EFI_ERROR(Status)) {
+			MapBufPages = 0;
+			Valid = FALSE;
+			return Status;
+		}
+		MapBuf = (EFI_MEMORY_DESCRIPTOR *)(UINTN)Addr;
+	}
+
+	if (EFI_ERROR(Status)) {
+		Valid = FALSE;
+		return Status;
+	}
+
+	MapSize = Size;
+	if (!Valid || MapKey != BuiltKey)
+		memmap_build();
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Fresh copy of the raw map, e.g. for ExitBootServices. The buffer belongs
+ * to this module and stays valid until the next refresh.
+ */
+EFI_STATUS
+MemMapGetRaw(EFI_MEMORY_DESCRIPTOR **Map, UINTN *Size, UINTN *Key, UINTN *DescriptorSize, UINT32 *DescriptorVersion)
+{
+	EFI_STATUS Status;
+
+	Status = MemMapRefresh();
+	if (EFI_ERROR(Status))
+		return Status;
+
+	*Map = MapBuf;
+	*Size = MapSize;
+	*Key = MapKey;
+	*DescriptorSize = DescSize;
+	*DescriptorVersion = DescVersion;
+	return EFI_SUCCESS;
+}
+
+static BOOLEAN
+memmap_ensure(VOID)
+{
+	return Valid || !EFI_ERROR(MemMapRefresh());
+}
+
+UINT64
+MemMapTotal(EFI_MEMORY_TYPE Type)
+{
+	if (Type >= EfiMaxMemoryType || !memmap_ensure())
+		return 0;
+
+	return Totals[Type];
+}
+
+UINTN
+MemMapFreeRegions(const struct mem_region **Regions)
+{
+	if (!memmap_ensure())
+		return 0;
+
+	*Regions = FreeRegions;
+	return NumFree;
+}
+
+BOOLEAN
+MemMapLargestFree(struct mem_region *Region)
+{
+	UINTN i, Best = 0;
+
+	if (!memmap_ensure() || NumFree == 0)
+		return FALSE;
+
+	for (i = 1; i < NumFree; i++) {
+		if (FreeRegions[i].Pages > FreeRegions[Best].Pages)
+			Best = i;
+	}
+
+	*Region = FreeRegions[Best];
+	return TRUE;
+}
+
+/*
+ * Lowest free address at or above Min where Size bytes fit with the given
+ * alignment (a power of two, at least a page). Page zero is never handed
+ * out so that a result is never mistaken for NULL.
+ */
+BOOLEAN
+MemMapFindFree(EFI_PHYSICAL_ADDRESS Min, UINT64 Size, UINT64 Align, EFI_PHYSICAL_ADDRESS *Addr)
+{
+	EFI_PHYSICAL_ADDRESS Start, End;
+	UINTN i;
+
+	if (!memmap_ensure() || Size == 0)
+		return FALSE;
+
+	if (Align < EFI_PAGE_SIZE)
+		Align = EFI_PAGE_SIZE;
+	if (Min < EFI_PAGE_SIZE)
+		Min = EFI_PAGE_SIZE;
+	Size = EFI_SIZE_TO_PAGES(Size) * EFI_PAGE_SIZE;
+
+	for (i = 0; i < NumFree; i++) {
+		End = FreeRegions[i].Start + FreeRegions[i].Pages * EFI_PAGE_SIZE;
+		if (End <= Min)
+			continue;
+
+		Start = MAX(FreeRegions[i].Start, Min);
+		Start = (Start + Align - 1) & ~(Align - 1);
+		if (Start < End && End - Start >= Size) {
+			*Addr = Start;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * Allocate Size bytes at the lowest suitable free address at or above Min.
+ * The cached view is refreshed first, and once more if the firmware turns
+ * down the address because the map moved under us.
+ */
+EFI_STATUS
+MemMapAllocatePages(EFI_PHYSICAL_ADDRESS Min, UINT64 Size, UINT64 Align, EFI_MEMORY_TYPE Type,
+	EFI_PHYSICAL_ADDRESS *Addr)
+{
+	EFI_STATUS Status;
+	EFI_PHYSICAL_ADDRESS Found;
+	UINTN Attempt;
+
+	for (Attempt = 0; Attempt < 2; Attempt++) {
+		Status = MemMapRefresh();
+		if (EFI_ERROR(Status))
+			return Status;
+
+		if (!MemMapFindFree(Min, Size, Align, &Found))
+			return EFI_OUT_OF_RESOURCES;
+
+		Status = HeapAllocatePages(AllocateAddress, Type, EFI_SIZE_TO_PAGES(Size), &Found);
+		if (!EFI_ERROR(Status)) {
+			Valid = FALSE;
+			*Addr = Found;
+			return EFI_SUCCESS;
+		}
+	}
+
+	return Status;
+}
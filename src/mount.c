@@ -0,0 +1,641 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Slice mount layer.
+ *
+ * A System V slice that is recognised by one of the filesystem plugins is
+ * published on a child handle of its disk with three protocols:
+ *	- EFI_DEVICE_PATH_PROTOCOL: the disk's device path plus a vendor media node.
+ *	- EFI_BLOCK_IO_PROTOCOL: a read-only window covering the slice.
+ *	- EFI_SIMPLE_FILE_SYSTEM_PROTOCOL: backed by the plugin's open and open_dir routines.
+ *
+ * The firmware's LoadImage() can then read files from the slice directly,
+ * other UEFI applications can list its directories, and the plugin mount
+ * stays alive between Command Monitor commands.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "clock.h"
+#include "fs.h"
+#include "mount.h"
+
+/*
+ * Directory handle returned by OpenVolume() and by Open() on a directory.
+ * Path is relative to the root of the slice, '\\' separated, with "." and
+ * ".." already resolved; the root is "".
+ */
+struct slice_dir {
+	EFI_FILE_PROTOCOL File;
+	struct slice_mount *Mount;
+	void *Dir;			// Plugin directory iterator.
+	CHAR16 *Path;
+};
+
+static EFI_GUID SliceGuid = HELIUMBOOT_SLICE_GUID;
+static struct slice_mount *SliceMounts = NULL;
+
+static EFI_STATUS EFIAPI
+slice_bio_reset(EFI_BLOCK_IO_PROTOCOL *This, BOOLEAN ExtendedVerification)
+{
+	struct slice_mount *Mount = _CR(This, struct slice_mount, BlockIo);
+
+	return uefi_call_wrapper(Mount->ParentBio->Reset, 2, Mount->ParentBio, ExtendedVerification);
+}
+
+static EFI_STATUS EFIAPI
+slice_bio_read(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+{
+	struct slice_mount *Mount = _CR(This, struct slice_mount, BlockIo);
+	EFI_BLOCK_IO_PROTOCOL *Parent = Mount->ParentBio;
+	UINTN BlockSize = Mount->Media.BlockSize;
+
+	if (MediaId != Mount->Media.MediaId)
+		return EFI_MEDIA_CHANGED;
+
+	if (!Buffer)
+		return EFI_INVALID_PARAMETER;
+
+	if (BufferSize == 0)
+		return EFI_SUCCESS;
+
+	if (BufferSize % BlockSize)
+		return EFI_BAD_BUFFER_SIZE;
+
+	if (Lba > Mount->Media.LastBlock || BufferSize / BlockSize > Mount->Media.LastBlock - Lba + 1)
+		return EFI_INVALID_PARAMETER;
+
+	BootCounterAdd(BOOT_CTR_DISK_READ, BufferSize);
+	return uefi_call_wrapper(Parent->ReadBlocks, 5, Parent, Parent->Media->MediaId, Mount->SliceLBA + Lba, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+slice_bio_write(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+slice_bio_flush(EFI_BLOCK_IO_PROTOCOL *This)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI slice_dir_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+
+static EFI_STATUS EFIAPI
+slice_dir_close(EFI_FILE_PROTOCOL *This)
+{
+	struct slice_dir *Dir = (struct slice_dir *)This;
+
+	if (Dir->Dir)
+		Dir->Mount->fs->close_dir(Dir->Dir);
+	FreePool(Dir->Path);
+	FreePool(Dir);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_delete(EFI_FILE_PROTOCOL *This)
+{
+	slice_dir_close(This);
+	return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * Return the next entry as an EFI_FILE_INFO, or a zero size at the end.
+ * The root handle and a rewound handle open the plugin iterator on the
+ * first read, so a root that is only used to open files costs no
+ * directory I/O.
+ */
+static EFI_STATUS EFIAPI
+slice_dir_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+	struct slice_dir *Dir = (struct slice_dir *)This;
+	struct fs_tab_entry *fs = Dir->Mount->fs;
+	EFI_STATUS Status;
+
+	if (!BufferSize)
+		return EFI_INVALID_PARAMETER;
+
+	if (!fs->open_dir)
+		return EFI_UNSUPPORTED;
+
+	if (!Dir->Dir) {
+		Status = fs->open_dir(Dir->Mount->mount_ctx, Dir->Path, &Dir->Dir);
+		if (EFI_ERROR(Status)) {
+			Dir->Dir = NULL;
+			return Status;
+		}
+	}
+
+	return fs->read_dir(Dir->Dir, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+	if (!Position)
+		return EFI_INVALID_PARAMETER;
+
+	*Position = 0;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+	struct slice_dir *Dir = (struct slice_dir *)This;
+
+	// Only a rewind is meaningful for a directory.
+	if (Position != 0)
+		return EFI_UNSUPPORTED;
+
+	if (Dir->Dir) {
+		Dir->Mount->fs->close_dir(Dir->Dir);
+		Dir->Dir = NULL;
+	}
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+	struct slice_dir *Dir = (struct slice_dir *)This;
+	struct slice_mount *Mount = Dir->Mount;
+	EFI_FILE_SYSTEM_INFO *FsInfo;
+	CHAR16 *Name;
+	UINTN NameSize, Needed;
+
+	if (!InformationType || !BufferSize)
+		return EFI_INVALID_PARAMETER;
+
+	if (CompareGuid(InformationType, &gEfiFileInfoGuid) == 0) {
+		for (Name = Dir->Path + StrLen(Dir->Path); Name > Dir->Path && Name[-1] != L'\\'; Name--)
+			;
+		return FillFileInfo(Name, 0, EFI_FILE_DIRECTORY | EFI_FILE_READ_ONLY, BufferSize, Buffer);
+	}
+
+	if (CompareGuid(InformationType, &gEfiFileSystemInfoGuid) != 0)
+		return EFI_UNSUPPORTED;
+
+	NameSize = (StrLen(Mount->fs->fs_name) + 1) * sizeof(CHAR16);
+	Needed = SIZE_OF_EFI_FILE_SYSTEM_INFO + NameSize;
+	if (*BufferSize < Needed || !Buffer) {
+		*BufferSize = Needed;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	FsInfo = Buffer;
+	SetMem(FsInfo, Needed, 0);
+	FsInfo->Size = Needed;
+	FsInfo->ReadOnly = TRUE;
+	FsInfo->VolumeSize = MultU64x32(Mount->SliceSize, Mount->Media.BlockSize);
+	FsInfo->FreeSpace = 0;
+	FsInfo->BlockSize = Mount->Media.BlockSize;
+	CopyMem(FsInfo->VolumeLabel, Mount->fs->fs_name, NameSize);
+
+	*BufferSize = Needed;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+slice_dir_flush(EFI_FILE_PROTOCOL *This)
+{
+	return EFI_SUCCESS;
+}
+
+/*
+ * Create a directory handle. 'Path' and the plugin iterator 'Iter', which
+ * may be NULL, are taken over by the handle.
+ */
+static EFI_STATUS
+slice_new_dir(struct slice_mount *Mount, CHAR16 *Path, void *Iter, EFI_FILE_PROTOCOL **NewHandle)
+{
+	struct slice_dir *Dir;
+
+	Dir = AllocateZeroPool(sizeof(*Dir));
+	if (!Dir) {
+		if (Iter)
+			Mount->fs->close_dir(Iter);
+		FreePool(Path);
+		return EFI_OUT_OF_RESOURCES;
+	}
+
+	Dir->Mount = Mount;
+	Dir->Dir = Iter;
+	Dir->Path = Path;
+	Dir->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+	Dir->File.Open = slice_dir_open;
+	Dir->File.Close = slice_dir_close;
+	Dir->File.Delete = slice_dir_delete;
+	Dir->File.Read = slice_dir_read;
+	Dir->File.Write = slice_dir_write;
+	Dir->File.GetPosition = slice_dir_getpos;
+	Dir->File.SetPosition = slice_dir_setpos;
+	Dir->File.GetInfo = slice_dir_getinfo;
+	Dir->File.SetInfo = slice_dir_setinfo;
+	Dir->File.Flush = slice_dir_flush;
+
+	*NewHandle = &Dir->File;
+	return EFI_SUCCESS;
+}
+
+/*
+ * Resolve 'Name' against the directory 'Base'. A leading separator starts
+ * from the root; "." and ".." are resolved here, so the plugins only see
+ * plain paths, and ".." at the root stays at the root.
+ */
+static CHAR16 *
+slice_path_join(const CHAR16 *Base, const CHAR16 *Name)
+{
+	CHAR16 *Path;
+	UINTN n = 0, len;
+
+	Path = AllocatePool((StrLen(Base) + StrLen(Name) + 2) * sizeof(CHAR16));
+	if (!Path)
+		return NULL;
+
+	if (*Name != L'\\' && *Name != L'/') {
+		StrCpy(Path, Base);
+		n = StrLen(Path);
+	}
+
+	while (*Name) {
+		while (*Name == L'\\' || *Name == L'/')
+			Name++;
+		for (len = 0; Name[len] && Name[len] != L'\\' && Name[len] != L'/'; len++)
+			;
+
+		if (len == 0 || (len == 1 && Name[0] == L'.')) {
+			// Nothing to add.
+		} else if (len == 2 && Name[0] == L'.' && Name[1] == L'.') {
+			while (n > 0 && Path[n - 1] != L'\\')
+				n--;
+			if (n > 0)
+				n--;
+		} else {
+			if (n > 0)
+				Path[n++] = L'\\';
+			CopyMem(&Path[n], Name, len * sizeof(CHAR16));
+			n += len;
+		}
+		Name += len;
+	}
+
+	Path[n] = L'\0';
+	return Path;
+}
+
+/*
+ * Paths are resolved relative to the directory handle. Files get the
+ * plugin's own file handle, so reads go straight from the disk into the
+ * caller's buffer; the plugin refuses directories with EFI_UNSUPPORTED,
+ * and those get a directory handle backed by its open_dir routine.
+ */
+static EFI_STATUS EFIAPI
+slice_dir_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+	struct slice_dir *Dir = (struct slice_dir *)This;
+	struct slice_mount *Mount = Dir->Mount;
+	EFI_STATUS Status;
+	CHAR16 *Path;
+	void *Iter;
+
+	if (!NewHandle || !FileName)
+		return EFI_INVALID_PARAMETER;
+
+	if (OpenMode != EFI_FILE_MODE_READ)
+		return EFI_WRITE_PROTECTED;
+
+	Path = slice_path_join(Dir->Path, FileName);
+	if (!Path)
+		return EFI_OUT_OF_RESOURCES;
+
+	if (*Path == L'\0')
+		return slice_new_dir(Mount, Path, NULL, NewHandle);
+
+	Status = EFI_UNSUPPORTED;
+	if (Mount->fs->open)
+		Status = Mount->fs->open(Mount->mount_ctx, Path, EFI_FILE_MODE_READ, (void **)NewHandle);
+
+	if (Status == EFI_UNSUPPORTED && Mount->fs->open_dir) {
+		Status = Mount->fs->open_dir(Mount->mount_ctx, Path, &Iter);
+		if (!EFI_ERROR(Status))
+			return slice_new_dir(Mount, Path, Iter, NewHandle);
+	}
+
+	FreePool(Path);
+	return Status;
+}
+
+static EFI_STATUS EFIAPI
+slice_open_volume(EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *This, EFI_FILE_PROTOCOL **Root)
+{
+	struct slice_mount *Mount = _CR(This, struct slice_mount, SimpleFs);
+	CHAR16 *Path;
+
+	if (!Root)
+		return EFI_INVALID_PARAMETER;
+
+	Path = AllocateZeroPool(sizeof(CHAR16));
+	if (!Path)
+		return EFI_OUT_OF_RESOURCES;
+
+	return slice_new_dir(Mount, Path, NULL, Root);
+}
+
+/*
+ * Run through all supported filesystems and mount the first one that
+ * recognises the slice.
+ */
+static EFI_STATUS
+slice_detect(EFI_BLOCK_IO_PROTOCOL *DiskBio, UINT32 SliceLBA, struct fs_tab_entry **fs_out, void **mount_out)
+{
+	EFI_STATUS Status;
+	struct fs_tab_entry *fs_entry_ptr;
+	VOID *sb;
+
+	for (fs_entry_ptr = fs_tab; fs_entry_ptr->fs_name != NULL; fs_entry_ptr++) {
+		if (fs_entry_ptr->sb_size == 0 || fs_entry_ptr->detect_fs == NULL || fs_entry_ptr->mount_fs == NULL)
+			continue;
+
+		sb = AllocateZeroPool(fs_entry_ptr->sb_size);
+		if (!sb) {
+			PrintToScreen(L"Failed to allocate memory for superblock\n");
+			return EFI_OUT_OF_RESOURCES;
+		}
+
+		Status = fs_entry_ptr->detect_fs(DiskBio, SliceLBA, sb);
+		if (EFI_ERROR(Status)) {
+			FreePool(sb);
+			continue;
+		}
+
+		PrintToScreen(L"Detected filesystem: %s\n", fs_entry_ptr->fs_name);
+
+		Status = fs_entry_ptr->mount_fs(DiskBio, SliceLBA, sb, mount_out);
+		FreePool(sb);
+		if (EFI_ERROR(Status)) {
+			PrintToScreen(L"Failed to mount %s: %r\n", fs_entry_ptr->fs_name, Status);
+			continue;
+		}
+
+		*fs_out = fs_entry_ptr;
+		return EFI_SUCCESS;
+	}
+
+	return EFI_NOT_FOUND;
+}
+
+/*
+ * Function:
+ * MountSlice()
+ *
+ * Description:
+ * Mount a VTOC slice and publish it on a child handle of the disk. A slice
+ * that is already mounted is returned from the mount list without touching
+ * the disk again.
+ *
+ * Arguments:
+ * DiskHandle: Handle of the whole disk. May be NULL if it has no device path.
+ * DiskBio: Block I/O protocol of the whole disk.
+ * SliceIndex: VTOC slice number.
+ * SliceLBA: First sector of the slice.
+ * SliceSize: Slice size in sectors.
+ * MountOut: Receives the slice mount.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_NOT_FOUND if no plugin recognises the slice,
+ * any other code on failure.
+ */
+EFI_STATUS
+MountSlice(EFI_HANDLE DiskHandle, EFI_BLOCK_IO_PROTOCOL *DiskBio, UINT32 SliceIndex, UINT32 SliceLBA, UINT32 SliceSize, struct slice_mount **MountOut)
+{
+	EFI_STATUS Status;
+	EFI_DEVICE_PATH *ParentPath = NULL;
+	struct slice_device_path Node;
+	struct slice_mount *Mount;
+
+	if (!DiskBio || !MountOut || SliceSize == 0)
+		return EFI_INVALID_PARAMETER;
+
+	for (Mount = SliceMounts; Mount; Mount = Mount->Next) {
+		if (Mount->ParentBio == DiskBio && Mount->SliceLBA == SliceLBA) {
+			*MountOut = Mount;
+			return EFI_SUCCESS;
+		}
+	}
+
+	Mount = AllocateZeroPool(sizeof(*Mount));
+	if (!Mount)
+		return EFI_OUT_OF_RESOURCES;
+
+	BootPhaseBegin(BOOT_PHASE_MOUNT);
+	Status = slice_detect(DiskBio, SliceLBA, &Mount->fs, &Mount->mount_ctx);
+	if (EFI_ERROR(Status)) {
+		BootPhaseEnd(BOOT_PHASE_MOUNT);
+		FreePool(Mount);
+		return Status;
+	}
+
+	Mount->ParentBio = DiskBio;
+	Mount->SliceIndex = SliceIndex;
+	Mount->SliceLBA = SliceLBA;
+	Mount->SliceSize = SliceSize;
+
+	CopyMem(&Mount->Media, DiskBio->Media, sizeof(Mount->Media));
+	Mount->Media.LogicalPartition = TRUE;
+	Mount->Media.ReadOnly = TRUE;
+	Mount->Media.LastBlock = SliceSize - 1;
+
+	Mount->BlockIo.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION;
+	Mount->BlockIo.Media = &Mount->Media;
+	Mount->BlockIo.Reset = slice_bio_reset;
+	Mount->BlockIo.ReadBlocks = slice_bio_read;
+	Mount->BlockIo.WriteBlocks = slice_bio_write;
+	Mount->BlockIo.FlushBlocks = slice_bio_flush;
+
+	Mount->SimpleFs.Revision = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION;
+	Mount->SimpleFs.OpenVolume = slice_open_volume;
+
+	SetMem(&Node, sizeof(Node), 0);
+	Node.Vendor.Header.Type = MEDIA_DEVICE_PATH;
+	Node.Vendor.Header.SubType = MEDIA_VENDOR_DP;
+	SetDevicePathNodeLength(&Node.Vendor.Header, sizeof(Node));
+	CopyMem(&Node.Vendor.Guid, &SliceGuid, sizeof(EFI_GUID));
+	Node.SliceIndex = SliceIndex;
+	Node.SliceLBA = SliceLBA;
+	Node.SliceSize = SliceSize;
+
+	if (DiskHandle)
+		ParentPath = DevicePathFromHandle(DiskHandle);
+
+	Mount->DevicePath = AppendDevicePathNode(ParentPath, &Node.Vendor.Header);
+	if (!Mount->DevicePath) {
+		Status = EFI_OUT_OF_RESOURCES;
+		goto fail;
+	}
+
+	Status = uefi_call_wrapper(BS->InstallMultipleProtocolInterfaces, 8, &Mount->Handle,
+		&gEfiDevicePathProtocolGuid, Mount->DevicePath,
+		&gEfiBlockIoProtocolGuid, &Mount->BlockIo,
+		&gEfiSimpleFileSystemProtocolGuid, &Mount->SimpleFs,
+		NULL);
+	if (EFI_ERROR(Status)) {
+		PrintToScreen(L"Cannot install slice protocols: %r\n", Status);
+		goto fail;
+	}
+
+	Mount->Next = SliceMounts;
+	SliceMounts = Mount;
+
+	BootPhaseEnd(BOOT_PHASE_MOUNT);
+	*MountOut = Mount;
+	return EFI_SUCCESS;
+
+fail:
+	BootPhaseEnd(BOOT_PHASE_MOUNT);
+	if (Mount->DevicePath)
+		FreePool(Mount->DevicePath);
+	if (Mount->fs->umount_fs)
+		Mount->fs->umount_fs(Mount->mount_ctx);
+	FreePool(Mount);
+	return Status;
+}
+
+/*
+ * Function:
+ * MountVolume()
+ *
+ * Description:
+ * Mount a whole partition handle, such as the ESP, through the filesystem
+ * plugins instead of the firmware's driver. The volume is published the
+ * same way as a slice, as slice 0 starting at LBA 0 of the partition.
+ *
+ * Arguments:
+ * Handle: Partition handle with a Block I/O protocol.
+ * MountOut: Receives the mount.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_NOT_FOUND if no plugin recognises the volume,
+ * any other code on failure.
+ */
+EFI_STATUS
+MountVolume(EFI_HANDLE Handle, struct slice_mount **MountOut)
+{
+	EFI_STATUS Status;
+	EFI_BLOCK_IO_PROTOCOL *BlockIo;
+
+	Status = uefi_call_wrapper(BS->HandleProtocol, 3, Handle, &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	if (BlockIo->Media->LastBlock >= 0xFFFFFFFF)
+		return EFI_UNSUPPORTED;
+
+	return MountSlice(Handle, BlockIo, 0, 0, (UINT32)BlockIo->Media->LastBlock + 1, MountOut);
+}
+
+/*
+ * Function:
+ * UnmountSlice()
+ *
+ * Description:
+ * Remove the protocols of a mounted slice, unmount the plugin and free the
+ * mount. Fails if the firmware still holds the protocols open.
+ *
+ * Arguments:
+ * Mount: Slice mount returned by MountSlice().
+ *
+ * Return value:
+ * EFI_SUCCESS on success, any other code on failure.
+ */
+EFI_STATUS
+UnmountSlice(struct slice_mount *Mount)
+{
+	EFI_STATUS Status;
+	struct slice_mount **Link;
+
+	if (!Mount)
+		return EFI_INVALID_PARAMETER;
+
+	Status = uefi_call_wrapper(BS->UninstallMultipleProtocolInterfaces, 8, Mount->Handle,
+		&gEfiDevicePathProtocolGuid, Mount->DevicePath,
+		&gEfiBlockIoProtocolGuid, &Mount->BlockIo,
+		&gEfiSimpleFileSystemProtocolGuid, &Mount->SimpleFs,
+		NULL);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	for (Link = &SliceMounts; *Link; Link = &(*Link)->Next) {
+		if (*Link == Mount) {
+			*Link = Mount->Next;
+			break;
+		}
+	}
+
+	if (Mount->fs->umount_fs)
+		Mount->fs->umount_fs(Mount->mount_ctx);
+
+	FreePool(Mount->DevicePath);
+	FreePool(Mount);
+	return EFI_SUCCESS;
+}
+
+void
+UnmountAllSlices(void)
+{
+	struct slice_mount *Mount, *Next;
+
+	for (Mount = SliceMounts; Mount; Mount = Next) {
+		Next = Mount->Next;
+		if (EFI_ERROR(UnmountSlice(Mount)))
+			PrintToScreen(L"Slice %u is still in use, leaving it mounted\n", Mount->SliceIndex);
+	}
+}
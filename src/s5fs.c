@@ -34,6 +34,7 @@
 #include <efi.h>
 #include <efilib.h>
 
+#include "arena.h"
 #include "boot.h"
 #include "s5fs.h"
 #include "vnode.h"
@@ -101,13 +102,13 @@ s5_read_inode(struct s5_mount *mnt, UINT32 ino, struct s5_dinode *din)
 {
     EFI_STATUS Status;
     UINT32 blk = FsITOD(mnt, ino);
-    VOID *buf = AllocatePool(mnt->bsize);
+    VOID *buf = ArenaAlloc(mnt->bsize);
     if (!buf)
         return EFI_OUT_OF_RESOURCES;
 
     Status = s5_read_block(mnt, blk, buf);
     if (EFI_ERROR(Status)) {
-        FreePool(buf);
+        ArenaFree(buf);
         return Status;
     }
 
@@ -115,12 +116,12 @@ s5_read_inode(struct s5_mount *mnt, UINT32 ino, struct s5_dinode *din)
     UINT32 idx = FsITOO(mnt, ino);
     UINT32 offset = idx * sizeof(struct s5_dinode);
     if (offset + sizeof(struct s5_dinode) > mnt->bsize) {
-        FreePool(buf);
+        ArenaFree(buf);
         return EFI_DEVICE_ERROR;
     }
 
     MemMove(din, (UINT8 *)buf + offset, sizeof(struct s5_dinode));
-    FreePool(buf);
+    ArenaFree(buf);
     return EFI_SUCCESS;
 }
 
@@ -178,6 +179,10 @@ MountS5(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, v
         mnt->inoshift++;
 
     mnt->nindir = mnt->bsize / sizeof(INT32);
+    mnt->nmask = mnt->nindir - 1;
+    mnt->nshift = 0;
+    while ((1U << mnt->nshift) < mnt->nindir)
+        mnt->nshift++;
     mnt->bmask = mnt->bsize - 1;
     mnt->bio = BlockIo;
     mnt->slice_start_lba = SliceStartLBA;
@@ -239,13 +244,13 @@ ReadS5Dir(void *mount_ctx, const CHAR16 *path)
                 if (b == 0)
                     continue;
 
-                VOID *dbuf = AllocatePool(mnt->bsize);
+                VOID *dbuf = ArenaAlloc(mnt->bsize);
                 if (!dbuf)
                     return EFI_OUT_OF_RESOURCES;
 
                 Status = s5_read_block(mnt, b, dbuf);
                 if (EFI_ERROR(Status)) {
-                    FreePool(dbuf);
+                    ArenaFree(dbuf);
                     return Status;
                 }
 
@@ -289,7 +294,7 @@ ReadS5Dir(void *mount_ctx, const CHAR16 *path)
                     }
                 }
 
-                FreePool(dbuf);
+                ArenaFree(dbuf);
                 if (found_ino != 0)
                     break;
             } /* for each block */
@@ -337,13 +342,13 @@ ReadS5Dir(void *mount_ctx, const CHAR16 *path)
             if (b == 0)
                 continue;
 
-            VOID *dbuf = AllocatePool(mnt->bsize);
+            VOID *dbuf = ArenaAlloc(mnt->bsize);
             if (!dbuf)
                 return EFI_OUT_OF_RESOURCES;
 
             Status = s5_read_block(mnt, b, dbuf);
             if (EFI_ERROR(Status)) {
-                FreePool(dbuf);
+                ArenaFree(dbuf);
                 return Status;
             }
 
@@ -391,7 +396,7 @@ ReadS5Dir(void *mount_ctx, const CHAR16 *path)
                     PrintToScreen(L"   <UNK>    %s\n", namew);
                 }
             }
-            FreePool(dbuf);
+            ArenaFree(dbuf);
         }
     }
 
@@ -415,101 +420,554 @@ UmountS5(void *mount)
     return EFI_SUCCESS;
 }
 
-EFI_STATUS
-OpenS5(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+/*
+ * In-memory file handle for s5. It implements the read-only subset of the
+ * EFI file methods used by the loader and by the firmware's LoadImage().
+ */
+struct s5_file {
+    EFI_FILE_PROTOCOL File;
+    struct s5_mount *mnt;
+    struct s5_dinode din;       /* on-disk inode of the file */
+    UINT32 ino;                 /* inode number */
+    UINT64 pos;                 /* current file position */
+    INT32 indblk[3];            /* cached indirect block number per level */
+    INT32 *ind[3];              /* cached indirect block contents per level */
+    CHAR16 name[DIRSIZ + 1];    /* file name, for GetInfo */
+};
+
+/*
+ * Map logical block 'lbn' of a file to a filesystem block number. The first
+ * NADDR-3 addresses are direct; the last three are single, double and triple
+ * indirect. A result of 0 denotes a hole.
+ */
+static EFI_STATUS
+s5_bmap(struct s5_file *sf, UINT32 lbn, INT32 *blk_out)
 {
-    struct s5_mount *fs = mount_ctx;
-    struct s5_dinode cur;
+    struct s5_mount *mnt = sf->mnt;
+    UINT64 span = mnt->nindir;
+    UINT32 level;
+    UINT32 i;
+    INT32 blk;
     EFI_STATUS Status;
-    CHAR8 name[DIRSIZ + 1];
-    const CHAR16 *p = filename;
-    UINTN i;
-    BOOLEAN found = FALSE;
-    BOOLEAN match = TRUE;
 
-    /* Only support read-only */
-    if (mode != EFI_FILE_MODE_READ)
+    if (lbn < NADDR - 3) {
+        *blk_out = s5_daddr(&sf->din, lbn);
+        return EFI_SUCCESS;
+    }
+
+    lbn -= NADDR - 3;
+    for (level = 1; level <= 3; level++) {
+        if (lbn < span)
+            break;
+        lbn -= span;
+        span *= mnt->nindir;
+    }
+
+    if (level > 3)
+        return EFI_INVALID_PARAMETER;
+
+    blk = s5_daddr(&sf->din, NADDR - 4 + level);
+    for (i = 0; i < level && blk != 0; i++) {
+        if (!sf->ind[i]) {
+            sf->ind[i] = AllocatePool(mnt->bsize);
+            if (!sf->ind[i])
+                return EFI_OUT_OF_RESOURCES;
+            sf->indblk[i] = 0;
+        }
+
+        if (sf->indblk[i] != blk) {
+            Status = s5_read_block(mnt, blk, sf->ind[i]);
+            if (EFI_ERROR(Status)) {
+                sf->indblk[i] = 0;
+                return Status;
+            }
+            sf->indblk[i] = blk;
+        }
+
+        span /= mnt->nindir;
+        blk = sf->ind[i][lbn / span];
+        lbn %= span;
+    }
+
+    *blk_out = blk;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Look up a single path component in directory 'dir'.
+ */
+static EFI_STATUS
+s5_lookup(struct s5_mount *mnt, struct s5_file *dir, const CHAR8 *name, UINTN len, UINT32 *ino_out)
+{
+    EFI_STATUS Status;
+    UINT32 nblocks = ((UINT32)dir->din.di_size + mnt->bsize - 1) / mnt->bsize;
+    UINT32 lbn;
+    UINTN e, k;
+    INT32 blk;
+    UINT8 *dbuf;
+
+    dbuf = ArenaAlloc(mnt->bsize);
+    if (!dbuf)
+        return EFI_OUT_OF_RESOURCES;
+
+    for (lbn = 0; lbn < nblocks; lbn++) {
+        Status = s5_bmap(dir, lbn, &blk);
+        if (EFI_ERROR(Status))
+            goto out;
+        if (blk == 0)
+            continue;
+
+        Status = s5_read_block(mnt, blk, dbuf);
+        if (EFI_ERROR(Status))
+            goto out;
+
+        for (e = 0; e < mnt->bsize / SDSIZ; e++) {
+            struct s5_direct *de = (struct s5_direct *)(dbuf + e * SDSIZ);
+
+            if ((UINT64)lbn * mnt->bsize + (e + 1) * SDSIZ > (UINT32)dir->din.di_size)
+                break;
+            if (de->d_ino == 0)
+                continue;
+
+            /* d_name is NUL padded, but not terminated when 14 chars long */
+            for (k = 0; k < len; k++) {
+                if ((CHAR8)de->d_name[k] != name[k])
+                    break;
+            }
+            if (k == len && (len == DIRSIZ || de->d_name[len] == '\0')) {
+                *ino_out = de->d_ino;
+                Status = EFI_SUCCESS;
+                goto out;
+            }
+        }
+    }
+
+    Status = EFI_NOT_FOUND;
+
+out:
+    ArenaFree(dbuf);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    struct s5_file *sf = (struct s5_file *)This;
+    struct s5_mount *mnt;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT8 *out = Buffer;
+    UINT8 *bbuf = NULL;
+    UINT64 size;
+    UINTN to_read, done = 0;
+
+    if (!This || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = sf->mnt;
+    size = (UINT32)sf->din.di_size;
+
+    if (sf->pos >= size) {
+        *BufferSize = 0; /* EOF */
+        return EFI_SUCCESS;
+    }
+
+    to_read = *BufferSize;
+    if ((UINT64)to_read > size - sf->pos)
+        to_read = (UINTN)(size - sf->pos);
+
+    while (done < to_read) {
+        UINT32 lbn = (UINT32)(sf->pos / mnt->bsize);
+        UINTN boff = (UINTN)(sf->pos % mnt->bsize);
+        UINTN chunk = mnt->bsize - boff;
+        INT32 blk;
+
+        if (chunk > to_read - done)
+            chunk = to_read - done;
+
+        Status = s5_bmap(sf, lbn, &blk);
+        if (EFI_ERROR(Status))
+            break;
+
+        if (blk == 0) {
+            /* hole */
+            SetMem(out + done, chunk, 0);
+        } else if (boff == 0 && chunk == mnt->bsize) {
+            /* whole block, straight into the caller's buffer */
+            Status = s5_read_block(mnt, blk, out + done);
+            if (EFI_ERROR(Status))
+                break;
+        } else {
+            if (!bbuf) {
+                bbuf = ArenaAlloc(mnt->bsize);
+                if (!bbuf) {
+                    Status = EFI_OUT_OF_RESOURCES;
+                    break;
+                }
+            }
+            Status = s5_read_block(mnt, blk, bbuf);
+            if (EFI_ERROR(Status))
+                break;
+            CopyMem(out + done, bbuf + boff, chunk);
+        }
+
+        done += chunk;
+        sf->pos += chunk;
+    }
+
+    if (bbuf)
+        ArenaFree(bbuf);
+
+    *BufferSize = done;
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+    struct s5_file *sf = (struct s5_file *)This;
+    UINT64 size;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    size = (UINT32)sf->din.di_size;
+
+    /* UEFI uses (UINT64)-1 to set position to EOF */
+    if (Position == (UINT64)-1)
+        Position = size;
+
+    if (Position > size)
+        return EFI_INVALID_PARAMETER;
+
+    sf->pos = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct s5_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    struct s5_file *sf = (struct s5_file *)This;
+
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
         return EFI_UNSUPPORTED;
 
+    return FillFileInfo(sf->name, (UINT32)sf->din.di_size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+s5_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* only regular files are handed out */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
+static void
+s5_file_free(struct s5_file *sf)
+{
+    UINTN i;
+
+    for (i = 0; i < 3; i++) {
+        if (sf->ind[i])
+            FreePool(sf->ind[i]);
+    }
+    FreePool(sf);
+}
+
+static EFI_STATUS EFIAPI
+s5_file_close(EFI_FILE_PROTOCOL *This)
+{
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    s5_file_free((struct s5_file *)This);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+s5_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    s5_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * Walk 'path' from the root inode, one component at a time. On success
+ * sf->din and sf->ino describe the last component and *last_out points at
+ * its name in 'path'.
+ */
+static EFI_STATUS
+s5_walk(struct s5_file *sf, const CHAR16 *path, const CHAR16 **last_out)
+{
+    struct s5_mount *fs = sf->mnt;
+    EFI_STATUS Status;
+    CHAR8 name[DIRSIZ + 1];
+    const CHAR16 *p = path;
+    UINT32 ino = S5ROOTINO;
+    UINTN len, k;
+
+    *last_out = path;
+
     /* Start at root inode */
-    Status = s5_read_inode(fs, S5ROOTINO, &cur);
+    Status = s5_read_inode(fs, ino, &sf->din);
     if (EFI_ERROR(Status))
         return Status;
 
-    /* Skip leading '/' */
-    while (*p == L'/')
+    while (*p == L'/' || *p == L'\\')
         p++;
 
     while (*p) {
-        UINT32 off = 0;
-
         /* Extract next path component */
-        UINTN len = 0;
-        while (p[len] && p[len] != L'/' && len < DIRSIZ) {
+        *last_out = p;
+        len = 0;
+        while (p[len] && p[len] != L'/' && p[len] != L'\\') {
+            if (len == DIRSIZ || p[len] > 0x7f)
+                return EFI_NOT_FOUND;
             name[len] = (CHAR8)p[len];
             len++;
         }
         name[len] = '\0';
         p += len;
-        while (*p == L'/')
+        while (*p == L'/' || *p == L'\\')
             p++;
 
         /* Must be directory */
-        if ((cur.di_mode & 0170000) != 0040000)
+        if (IFTOVT(sf->din.di_mode) != VDIR)
             return EFI_NOT_FOUND;
 
-        /* Scan directory entries */
-        while (off + sizeof(struct s5_direct) <= cur.di_size) {
-            struct s5_direct d;
-            UINT32 lbn = off / fs->bsize;
-            UINT32 boff = off % fs->bsize;
-            UINT8 block[FsMAXBSIZE];
+        Status = s5_lookup(fs, sf, name, len, &ino);
+        if (EFI_ERROR(Status))
+            return Status;
 
-            INT32 fsblk = s5_daddr(&cur, lbn);
-            if (fsblk == 0)
-                return EFI_DEVICE_ERROR;
+        Status = s5_read_inode(fs, ino, &sf->din);
+        if (EFI_ERROR(Status))
+            return Status;
 
-            Status = s5_read_block(fs, fsblk, block);
-            if (EFI_ERROR(Status))
-                return Status;
+        /* indirect blocks cached so far belong to the directory */
+        for (k = 0; k < 3; k++)
+            sf->indblk[k] = 0;
+    }
 
-            CopyMem(&d, block + boff, sizeof(d));
-            off += sizeof(d);
+    sf->ino = ino;
+    return EFI_SUCCESS;
+}
 
-            if (d.d_ino == 0)
-                continue;
+/*
+ * OpenS5:
+ * - walk the path from the root inode, one component at a time
+ * - verify the final inode is a regular file
+ * - create an in-memory file handle that implements the EFI file methods
+ */
+EFI_STATUS
+OpenS5(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
+    struct s5_mount *fs = mount_ctx;
+    struct s5_file *sf;
+    EFI_STATUS Status;
+    const CHAR16 *last;
+    UINTN k;
 
-            for (i = 0; i < DIRSIZ; i++) {
-                CHAR8 a = d.d_name[i];
-                CHAR8 b = (i < AsciiStrLen(name)) ? name[i] : '\0';
+    if (!fs || !filename || !file_out)
+        return EFI_INVALID_PARAMETER;
 
-                if (a == '\0' || a == ' ') {
-                    if (b != '\0')
-                        match = FALSE;
-                    break;
-                }
+    /* Only support read-only */
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_UNSUPPORTED;
 
-                if (a != b) {
-                    match = FALSE;
-                    break;
-                }
-            }
+    sf = AllocateZeroPool(sizeof(*sf));
+    if (!sf)
+        return EFI_OUT_OF_RESOURCES;
 
-            if (match) {
-                Status = s5_read_inode(fs, d.d_ino, &cur);
-                if (EFI_ERROR(Status))
-                    return Status;
-                found = TRUE;
-                break;
-            }
-        }
+    sf->mnt = fs;
+
+    Status = s5_walk(sf, filename, &last);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    if (IFTOVT(sf->din.di_mode) != VREG) {
+        Status = EFI_UNSUPPORTED;
+        goto fail;
     }
 
-    /* Success: return inode as file handle */
-    *file_out = AllocatePool(sizeof(struct s5_inode));
-    if (!*file_out)
+    sf->pos = 0;
+    for (k = 0; k < DIRSIZ && last[k] && last[k] != L'/' && last[k] != L'\\'; k++)
+        sf->name[k] = last[k];
+    sf->name[k] = L'\0';
+
+    sf->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+    sf->File.Open = s5_file_open;
+    sf->File.Close = s5_file_close;
+    sf->File.Delete = s5_file_delete;
+    sf->File.Read = s5_file_read;
+    sf->File.Write = s5_file_write;
+    sf->File.GetPosition = s5_file_getpos;
+    sf->File.SetPosition = s5_file_setpos;
+    sf->File.GetInfo = s5_file_getinfo;
+    sf->File.SetInfo = s5_file_setinfo;
+    sf->File.Flush = s5_file_flush;
+
+    *file_out = &sf->File;
+    return EFI_SUCCESS;
+
+fail:
+    s5_file_free(sf);
+    return Status;
+}
+
+/*
+ * Directory iterator. The directory is read through an s5_file so that
+ * s5_bmap() and its indirect block cache can be used; its position is
+ * the byte offset of the next entry.
+ */
+struct s5_dir {
+    struct s5_file *sf;
+    UINT8 *buf;                 /* directory block holding the position */
+    INT32 bufblk;               /* its block number, 0 if none */
+};
+
+EFI_STATUS
+OpenS5Dir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct s5_mount *fs = mount_ctx;
+    struct s5_dir *sd;
+    const CHAR16 *last;
+    EFI_STATUS Status;
+
+    if (!fs || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    sd = AllocateZeroPool(sizeof(*sd));
+    if (!sd)
         return EFI_OUT_OF_RESOURCES;
 
-    CopyMem(*file_out, &cur, sizeof(cur));
+    sd->sf = AllocateZeroPool(sizeof(*sd->sf));
+    sd->buf = AllocatePool(fs->bsize);
+    if (!sd->sf || !sd->buf) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto fail;
+    }
+    sd->sf->mnt = fs;
+
+    Status = s5_walk(sd->sf, path, &last);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    if (IFTOVT(sd->sf->din.di_mode) != VDIR) {
+        Status = EFI_UNSUPPORTED;
+        goto fail;
+    }
+
+    *dir_out = sd;
+    return EFI_SUCCESS;
+
+fail:
+    CloseS5Dir(sd);
+    return Status;
+}
+
+EFI_STATUS
+ReadS5DirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct s5_dir *sd = dir;
+    struct s5_file *sf = sd->sf;
+    struct s5_mount *mnt = sf->mnt;
+    UINT64 dsize = (UINT32)sf->din.di_size;
+    struct s5_direct *de;
+    struct s5_dinode din;
+    CHAR16 name[DIRSIZ + 1];
+    EFI_STATUS Status;
+    UINTN off, k;
+    INT32 blk;
+
+    while (sf->pos + SDSIZ <= dsize) {
+        off = (UINTN)(sf->pos % mnt->bsize);
+        Status = s5_bmap(sf, (UINT32)(sf->pos / mnt->bsize), &blk);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        /* a hole holds no entries */
+        if (blk == 0) {
+            sf->pos += mnt->bsize - off;
+            continue;
+        }
+
+        if (sd->bufblk != blk) {
+            Status = s5_read_block(mnt, blk, sd->buf);
+            if (EFI_ERROR(Status)) {
+                sd->bufblk = 0;
+                return Status;
+            }
+            sd->bufblk = blk;
+        }
+
+        de = (struct s5_direct *)(sd->buf + off);
+        if (de->d_ino == 0 || (de->d_name[0] == '.' &&
+            (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0')))) {
+            sf->pos += SDSIZ;
+            continue;
+        }
+
+        /* d_name is NUL padded, but not terminated when 14 chars long */
+        for (k = 0; k < DIRSIZ && de->d_name[k] != '\0'; k++)
+            name[k] = (UINT8)de->d_name[k];
+        name[k] = L'\0';
+
+        Status = s5_read_inode(mnt, de->d_ino, &din);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        Status = FillFileInfo(name, (UINT32)din.di_size,
+            EFI_FILE_READ_ONLY | (IFTOVT(din.di_mode) == VDIR ? EFI_FILE_DIRECTORY : 0), size, buf);
+        if (!EFI_ERROR(Status))
+            sf->pos += SDSIZ;
+        return Status;
+    }
+
+    *size = 0;
     return EFI_SUCCESS;
 }
+
+void
+CloseS5Dir(void *dir)
+{
+    struct s5_dir *sd = dir;
+
+    if (!sd)
+        return;
+
+    if (sd->sf)
+        s5_file_free(sd->sf);
+    if (sd->buf)
+        FreePool(sd->buf);
+    FreePool(sd);
+}
@@ -324,10 +324,16 @@ InitSerial(UINTN Port, UINTN Baud)
     UINTN Count;
 
     Status = uefi_call_wrapper(gBS->LocateHandleBuffer, 5, ByProtocol, &gEfiSerialIoProtocolGuid, NULL, &Count, &Handles);
-    if (EFI_ERROR(Status) || Port >= Count)
+    if (EFI_ERROR(Status))
+        return EFI_NOT_FOUND;
+
+    if (Port >= Count) {
+        FreePool(Handles);
         return EFI_NOT_FOUND;
+    }
 
     Status = uefi_call_wrapper(gBS->HandleProtocol, 3, Handles[Port], &gEfiSerialIoProtocolGuid, (VOID **)&gSerial);
+    FreePool(Handles);
     if (EFI_ERROR(Status))
         return Status;
 
@@ -338,6 +344,43 @@ InitSerial(UINTN Port, UINTN Baud)
     return EFI_SUCCESS;
 }
 
+/*
+ * Write a buffer to the port opened by InitSerial(), retrying partial
+ * writes and timeouts until all of it has gone out.
+ */
+EFI_STATUS
+SerialWrite(const VOID *Buffer, UINTN Length)
+{
+    const UINT8 *p = Buffer;
+    UINTN chunk;
+    UINTN stalls = 0;
+    EFI_STATUS Status;
+
+    if (!gSerial)
+        return EFI_NOT_READY;
+
+    while (Length > 0) {
+        chunk = Length;
+        Status = uefi_call_wrapper(gSerial->Write, 3, gSerial, &chunk, (VOID *)p);
+        if (EFI_ERROR(Status) && Status != EFI_TIMEOUT)
+            return Status;
+
+        if (chunk == 0) {
+            /* give up if the other end stops draining the FIFO for 5s */
+            if (++stalls > 500)
+                return EFI_TIMEOUT;
+            uefi_call_wrapper(gBS->Stall, 1, 10000);
+            continue;
+        }
+
+        stalls = 0;
+        p += chunk;
+        Length -= chunk;
+    }
+
+    return EFI_SUCCESS;
+}
+
 /* Convert of Symbian TInt YModem::StartDownload(TBool aG, TInt& aLength, TDes& aName)
  * to a UEFI-friendly function that returns EFI_STATUS and outputs size/name.
  */
@@ -387,7 +430,6 @@ EFI_STATUS
 InitSerialDownload(UINTN Port)
 {
     EFI_STATUS Status;
-    UINTN FileSize = 0;
     CHAR16 Name[ARRAY_SIZE(FileName)];
 
     // Use the configured baud rate if set, otherwise default to 115200.
@@ -401,6 +443,8 @@ InitSerialDownload(UINTN Port)
 
     SerialDownloadPort = (UINT32)Port;
 
+    // The announced size lets DoDownload() size the download buffer.
+    FileSize = 0;
     Status = StartYModemDownload(Port, &FileSize, Name, ARRAY_SIZE(Name));
     if (EFI_ERROR(Status)) {
         PrintToScreen(L"YModem download failed: %r\n", Status);
@@ -425,9 +469,9 @@ InitSerialDownload(UINTN Port)
         FlashBootLoader = FALSE;
     }
 
-    // If not zip, determine inner compression (implement GetInnerCompression to analyze data buffer)
+    // If not zip, the name tells whether the image is deflated.
     if (!ImageZip) {
-        Status = GetInnerCompression();
+        Status = GetInnerCompression(Name);
         if (EFI_ERROR(Status)) {
             PrintToScreen(L"Cannot get inner compression: %r\n", Status);
             return Status;
@@ -0,0 +1,1428 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * squashfs.c
+ * Read-only SquashFS 4.0 filesystem plugin.
+ *
+ * Metadata (inodes, directories, the fragment table) is stored in small
+ * compressed blocks; the most recently used ones are kept decompressed in
+ * a fixed-size cache, as are fragment blocks and data blocks that are
+ * only partly read. Whole data blocks are read in long runs and
+ * decompressed straight into the caller's buffer.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "squashfs.h"
+
+#define SQFS_STAGE_MIN      (1024 * 1024)   /* raw read size for file data */
+#define SQFS_META_AHEAD     (32 * 1024)     /* raw read size for metadata */
+#define SQFS_PATH_MAX       4096
+#define SQFS_NO_POS         ((UINT64)-1)
+
+/*
+ * Compression methods, by superblock id. Volumes using a method without
+ * a decompressor are rejected at detection time.
+ */
+static const struct {
+    UINT16 id;
+    CHAR16 *name;
+    decompress_fn decompress;
+} sqfs_codecs[] = {
+    { SQFS_COMP_GZIP, L"gzip", ZlibDecompress },
+    { SQFS_COMP_LZMA, L"lzma", NULL },
+    { SQFS_COMP_LZO, L"lzo", NULL },
+    { SQFS_COMP_XZ, L"xz", XzBuffer },
+    { SQFS_COMP_LZ4, L"lz4", Lz4Decompress },
+    { SQFS_COMP_ZSTD, L"zstd", ZstdBuffer },
+    { 0, NULL, NULL }
+};
+
+/*
+ * Decoded inode.
+ */
+struct sqfs_inode {
+    UINT16 type;
+    UINT64 size;                /* file size, listing size + 3, or target length */
+    UINT64 start;               /* first data block, or directory listing block */
+    UINT32 offset;              /* listing offset in that block */
+    UINT32 fragment;
+    UINT32 frag_off;
+    UINT16 i_count;             /* directory index entries */
+    struct sqfs_cursor tail;    /* block list, directory index or link target */
+};
+
+/*
+ * Directory listing iterator.
+ */
+struct sqfs_dir {
+    struct sqfs_cursor cur;
+    UINT64 remaining;           /* listing bytes left */
+    UINT32 left;                /* entries left under the current header */
+    UINT32 start_block;         /* inode block of those entries */
+};
+
+/*
+ * In-memory file handle.
+ */
+struct sqfs_file {
+    EFI_FILE_PROTOCOL File;
+    struct sqfs_mount *mnt;
+    UINT64 size;                /* file size in bytes */
+    UINT64 pos;                 /* current file position */
+    UINT32 nblocks;             /* data blocks, not counting a fragment tail */
+    UINT32 *bsize;              /* on-disk size word of each block */
+    UINT64 *bpos;               /* image position of each block */
+    UINT64 frag_pos;            /* fragment block holding the tail */
+    UINT32 frag_size;
+    UINT32 frag_off;
+    CHAR16 name[SQFS_NAME_LEN + 1];     /* file name, for GetInfo */
+};
+
+static decompress_fn
+sqfs_codec(UINT16 id, CHAR16 **name_out)
+{
+    UINTN i;
+
+    for (i = 0; sqfs_codecs[i].name; i++) {
+        if (sqfs_codecs[i].id == id) {
+            *name_out = sqfs_codecs[i].name;
+            return sqfs_codecs[i].decompress;
+        }
+    }
+    *name_out = L"unknown";
+    return NULL;
+}
+
+/*
+ * Make the image bytes [pos, pos + len) available in the staging buffer.
+ * Up to 'ahead' bytes are read, so that neighbouring requests are served
+ * from the buffer without further I/O. The data stays valid until the
+ * next call.
+ */
+static EFI_STATUS
+sqfs_read_raw(struct sqfs_mount *mnt, UINT64 pos, UINTN len, UINTN ahead, UINT8 **out)
+{
+    EFI_BLOCK_IO_PROTOCOL *bio = mnt->bio;
+    EFI_STATUS Status;
+    UINT64 first, end, limit;
+
+    if (pos >= mnt->stage_pos && pos + len <= mnt->stage_pos + mnt->stage_len) {
+        *out = mnt->stage + (pos - mnt->stage_pos);
+        return EFI_SUCCESS;
+    }
+
+    if (pos > mnt->sb.bytes_used || len > mnt->sb.bytes_used - pos || len > mnt->stage_size - 2 * mnt->devbs)
+        return EFI_VOLUME_CORRUPTED;
+
+    if (ahead < len)
+        ahead = len;
+    first = pos - pos % mnt->devbs;
+    end = (pos + ahead + mnt->devbs - 1) / mnt->devbs * mnt->devbs;
+    limit = (mnt->sb.bytes_used + mnt->devbs - 1) / mnt->devbs * mnt->devbs;
+    if (end > limit)
+        end = limit;
+    if (end - first > mnt->stage_size)
+        end = first + mnt->stage_size / mnt->devbs * mnt->devbs;
+
+    Status = uefi_call_wrapper(bio->ReadBlocks, 5, bio, bio->Media->MediaId,
+        mnt->slice_start_lba + first / mnt->devbs, (UINTN)(end - first), mnt->stage);
+    if (EFI_ERROR(Status)) {
+        mnt->stage_len = 0;
+        return Status;
+    }
+
+    mnt->stage_pos = first;
+    mnt->stage_len = (UINTN)(end - first);
+    *out = mnt->stage + (pos - first);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Decompress, or copy, one block whose on-disk form is 'len' bytes at
+ * 'raw' into at most 'size' bytes at 'out'.
+ */
+static EFI_STATUS
+sqfs_unpack(struct sqfs_mount *mnt, const UINT8 *raw, UINTN len, BOOLEAN compressed, UINT8 *out, UINTN size,
+    UINTN *outlen)
+{
+    EFI_STATUS Status;
+
+    if (!compressed) {
+        if (len > size)
+            return EFI_VOLUME_CORRUPTED;
+        CopyMem(out, raw, len);
+        *outlen = len;
+        return EFI_SUCCESS;
+    }
+
+    Status = mnt->decompress(raw, len, out, size, outlen);
+    if (EFI_ERROR(Status))
+        PrintToScreen(L"SquashFS: bad compressed block: %r\n", Status);
+    return EFI_ERROR(Status) ? EFI_VOLUME_CORRUPTED : EFI_SUCCESS;
+}
+
+static struct sqfs_cache_entry *
+sqfs_cache_find(struct sqfs_cache *c, UINT64 pos)
+{
+    struct sqfs_cache_entry *e;
+    UINTN i;
+
+    for (i = 0; i < c->nentries; i++) {
+        e = &c->entries[i];
+        if (e->data && e->pos == pos) {
+            e->stamp = ++c->clock;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Pick the entry for a new block: an unused one, else the least recently
+ * used. Buffers are allocated on first use.
+ */
+static struct sqfs_cache_entry *
+sqfs_cache_victim(struct sqfs_cache *c)
+{
+    struct sqfs_cache_entry *e, *victim = &c->entries[0];
+    UINTN i;
+
+    for (i = 0; i < c->nentries; i++) {
+        e = &c->entries[i];
+        if (!e->data) {
+            victim = e;
+            break;
+        }
+        if (e->stamp < victim->stamp)
+            victim = e;
+    }
+
+    if (!victim->data) {
+        victim->data = AllocatePool(c->size);
+        if (!victim->data)
+            return NULL;
+    }
+
+    victim->pos = SQFS_NO_POS;
+    victim->stamp = ++c->clock;
+    return victim;
+}
+
+static EFI_STATUS
+sqfs_cache_init(struct sqfs_cache *c, UINTN nentries, UINTN size)
+{
+    UINTN i;
+
+    c->entries = AllocateZeroPool(nentries * sizeof(*c->entries));
+    if (!c->entries)
+        return EFI_OUT_OF_RESOURCES;
+    for (i = 0; i < nentries; i++)
+        c->entries[i].pos = SQFS_NO_POS;
+    c->nentries = nentries;
+    c->size = size;
+    c->clock = 0;
+    return EFI_SUCCESS;
+}
+
+static void
+sqfs_cache_free(struct sqfs_cache *c)
+{
+    UINTN i;
+
+    if (!c->entries)
+        return;
+    for (i = 0; i < c->nentries; i++) {
+        if (c->entries[i].data)
+            FreePool(c->entries[i].data);
+    }
+    FreePool(c->entries);
+    c->entries = NULL;
+}
+
+/*
+ * Get the metadata block at image position 'pos'.
+ */
+static EFI_STATUS
+sqfs_meta_block(struct sqfs_mount *mnt, UINT64 pos, struct sqfs_cache_entry **ent_out)
+{
+    struct sqfs_cache_entry *e;
+    EFI_STATUS Status;
+    UINT8 *raw;
+    UINTN len, outlen;
+    UINT16 hdr;
+
+    e = sqfs_cache_find(&mnt->meta, pos);
+    if (e) {
+        *ent_out = e;
+        return EFI_SUCCESS;
+    }
+
+    Status = sqfs_read_raw(mnt, pos, 2, SQFS_META_AHEAD, &raw);
+    if (EFI_ERROR(Status))
+        return Status;
+    hdr = raw[0] | (raw[1] << 8);
+    len = hdr & ~SQFS_META_UNCOMPRESSED;
+    if (len == 0 || len > SQFS_METADATA_SIZE)
+        return EFI_VOLUME_CORRUPTED;
+
+    Status = sqfs_read_raw(mnt, pos + 2, len, SQFS_META_AHEAD, &raw);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    e = sqfs_cache_victim(&mnt->meta);
+    if (!e)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_unpack(mnt, raw, len, !(hdr & SQFS_META_UNCOMPRESSED), e->data, SQFS_METADATA_SIZE, &outlen);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (outlen == 0)
+        return EFI_VOLUME_CORRUPTED;
+
+    e->pos = pos;
+    e->next = pos + 2 + len;
+    e->len = (UINT32)outlen;
+    *ent_out = e;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read 'len' bytes of metadata at 'cur' and advance it. A NULL 'buf'
+ * skips the bytes.
+ */
+static EFI_STATUS
+sqfs_meta_read(struct sqfs_mount *mnt, struct sqfs_cursor *cur, VOID *buf, UINTN len)
+{
+    struct sqfs_cache_entry *e;
+    EFI_STATUS Status;
+    UINT8 *out = buf;
+    UINTN n;
+
+    while (len > 0) {
+        Status = sqfs_meta_block(mnt, cur->block, &e);
+        if (EFI_ERROR(Status))
+            return Status;
+        if (cur->offset > e->len)
+            return EFI_VOLUME_CORRUPTED;
+
+        n = e->len - cur->offset;
+        if (n > len)
+            n = len;
+        if (out) {
+            CopyMem(out, e->data + cur->offset, n);
+            out += n;
+        }
+        cur->offset += n;
+        len -= n;
+
+        if (cur->offset == e->len) {
+            cur->block = e->next;
+            cur->offset = 0;
+        }
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Get the decompressed data or fragment block at 'pos', whose size word
+ * is 'size', through the data cache.
+ */
+static EFI_STATUS
+sqfs_data_block(struct sqfs_mount *mnt, UINT64 pos, UINT32 size, struct sqfs_cache_entry **ent_out)
+{
+    struct sqfs_cache_entry *e;
+    EFI_STATUS Status;
+    UINT8 *raw;
+    UINTN len, outlen;
+
+    e = sqfs_cache_find(&mnt->data, pos);
+    if (e) {
+        *ent_out = e;
+        return EFI_SUCCESS;
+    }
+
+    len = SQFS_DATA_SIZE(size);
+    if (len == 0 || len > mnt->sb.block_size)
+        return EFI_VOLUME_CORRUPTED;
+
+    Status = sqfs_read_raw(mnt, pos, len, len, &raw);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    e = sqfs_cache_victim(&mnt->data);
+    if (!e)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_unpack(mnt, raw, len, !(size & SQFS_DATA_UNCOMPRESSED), e->data, mnt->sb.block_size, &outlen);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    e->pos = pos;
+    e->len = (UINT32)outlen;
+    *ent_out = e;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+DetectSQFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void)
+{
+    EFI_STATUS Status;
+    UINTN BlockSize = BlockIo->Media->BlockSize;
+    struct sqfs_superblock *sb = (struct sqfs_superblock *)sb_void;
+    CHAR16 *name;
+    UINTN count;
+    UINT8 *Buffer;
+
+    if (BlockSize == 0)
+        return EFI_UNSUPPORTED;
+
+    count = (sizeof(*sb) + BlockSize - 1) / BlockSize;
+    Buffer = AllocatePool(count * BlockSize);
+    if (!Buffer)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = uefi_call_wrapper(BlockIo->ReadBlocks, 5, BlockIo, BlockIo->Media->MediaId, SliceStartLBA,
+        count * BlockSize, Buffer);
+    if (EFI_ERROR(Status)) {
+        FreePool(Buffer);
+        return Status;
+    }
+
+    MemMove(sb, Buffer, sizeof(*sb));
+    FreePool(Buffer);
+
+    if (sb->s_magic != SQFS_MAGIC)
+        return EFI_NOT_FOUND;
+
+    if (sb->s_major != SQFS_MAJOR) {
+        PrintToScreen(L"Unsupported SquashFS version %u.%u\n", sb->s_major, sb->s_minor);
+        return EFI_UNSUPPORTED;
+    }
+
+    if (sb->block_log < SQFS_MIN_BLOCK_LOG || sb->block_log > SQFS_MAX_BLOCK_LOG ||
+        sb->block_size != (1U << sb->block_log) || sb->bytes_used < sizeof(*sb)) {
+        PrintToScreen(L"Error: Invalid SquashFS superblock\n");
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    if (!sqfs_codec(sb->compression, &name)) {
+        PrintToScreen(L"Unsupported SquashFS compression: %s\n", name);
+        return EFI_UNSUPPORTED;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * MountSQFS: set up the caches and read the fragment table index.
+ */
+EFI_STATUS
+MountSQFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out)
+{
+    struct sqfs_mount *mnt;
+    EFI_STATUS Status;
+    CHAR16 *name;
+    UINTN nidx;
+    UINT8 *raw;
+
+    if (!sb_buffer || !mount_out)
+        return EFI_INVALID_PARAMETER;
+
+    mnt = AllocateZeroPool(sizeof(*mnt));
+    if (!mnt)
+        return EFI_OUT_OF_RESOURCES;
+
+    MemMove(&mnt->sb, sb_buffer, sizeof(mnt->sb));
+    mnt->bio = BlockIo;
+    mnt->slice_start_lba = SliceStartLBA;
+    mnt->devbs = BlockIo->Media->BlockSize;
+    mnt->decompress = sqfs_codec(mnt->sb.compression, &name);
+
+    /* room for a whole block, or a long run of them, plus the unaligned ends */
+    mnt->stage_size = (mnt->sb.block_size > SQFS_STAGE_MIN ? mnt->sb.block_size : SQFS_STAGE_MIN) + 2 * mnt->devbs;
+    mnt->stage = AllocatePool(mnt->stage_size);
+    if (!mnt->stage) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto fail;
+    }
+
+    Status = sqfs_cache_init(&mnt->meta, SQFS_META_CACHE, SQFS_METADATA_SIZE);
+    if (!EFI_ERROR(Status))
+        Status = sqfs_cache_init(&mnt->data, SQFS_DATA_CACHE, mnt->sb.block_size);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    if (mnt->sb.fragments) {
+        nidx = (mnt->sb.fragments + SQFS_FRAGS_PER_META - 1) / SQFS_FRAGS_PER_META;
+        mnt->frag_index = AllocatePool(nidx * sizeof(UINT64));
+        if (!mnt->frag_index) {
+            Status = EFI_OUT_OF_RESOURCES;
+            goto fail;
+        }
+
+        Status = sqfs_read_raw(mnt, mnt->sb.fragment_table_start, nidx * sizeof(UINT64), 0, &raw);
+        if (EFI_ERROR(Status)) {
+            PrintToScreen(L"Cannot read SquashFS fragment table: %r\n", Status);
+            goto fail;
+        }
+        CopyMem(mnt->frag_index, raw, nidx * sizeof(UINT64));
+    }
+
+    *mount_out = mnt;
+    return EFI_SUCCESS;
+
+fail:
+    UmountSQFS(mnt);
+    return Status;
+}
+
+EFI_STATUS
+UmountSQFS(void *mount)
+{
+    struct sqfs_mount *mnt = (struct sqfs_mount *)mount;
+
+    if (!mnt)
+        return EFI_INVALID_PARAMETER;
+
+    sqfs_cache_free(&mnt->meta);
+    sqfs_cache_free(&mnt->data);
+    if (mnt->frag_index)
+        FreePool(mnt->frag_index);
+    if (mnt->stage)
+        FreePool(mnt->stage);
+    FreePool(mnt);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+sqfs_read_inode(struct sqfs_mount *mnt, UINT64 ref, struct sqfs_inode *inode)
+{
+    struct sqfs_cursor cur;
+    struct sqfs_base_inode base;
+    EFI_STATUS Status;
+    union {
+        struct sqfs_dir_inode dir;
+        struct sqfs_ldir_inode ldir;
+        struct sqfs_reg_inode reg;
+        struct sqfs_lreg_inode lreg;
+        struct sqfs_symlink_inode link;
+    } u;
+
+    cur.block = mnt->sb.inode_table_start + (ref >> 16);
+    cur.offset = ref & 0xFFFF;
+
+    Status = sqfs_meta_read(mnt, &cur, &base, sizeof(base));
+    if (EFI_ERROR(Status))
+        return Status;
+
+    ZeroMem(inode, sizeof(*inode));
+    inode->type = base.inode_type;
+    inode->fragment = SQFS_INVALID_FRAG;
+
+    switch (base.inode_type) {
+    case SQFS_DIR_TYPE:
+        Status = sqfs_meta_read(mnt, &cur, &u.dir, sizeof(u.dir));
+        inode->size = u.dir.file_size;
+        inode->start = mnt->sb.directory_table_start + u.dir.start_block;
+        inode->offset = u.dir.offset;
+        break;
+    case SQFS_LDIR_TYPE:
+        Status = sqfs_meta_read(mnt, &cur, &u.ldir, sizeof(u.ldir));
+        inode->size = u.ldir.file_size;
+        inode->start = mnt->sb.directory_table_start + u.ldir.start_block;
+        inode->offset = u.ldir.offset;
+        inode->i_count = u.ldir.i_count;
+        break;
+    case SQFS_REG_TYPE:
+        Status = sqfs_meta_read(mnt, &cur, &u.reg, sizeof(u.reg));
+        inode->size = u.reg.file_size;
+        inode->start = u.reg.start_block;
+        inode->fragment = u.reg.fragment;
+        inode->frag_off = u.reg.offset;
+        break;
+    case SQFS_LREG_TYPE:
+        Status = sqfs_meta_read(mnt, &cur, &u.lreg, sizeof(u.lreg));
+        inode->size = u.lreg.file_size;
+        inode->start = u.lreg.start_block;
+        inode->fragment = u.lreg.fragment;
+        inode->frag_off = u.lreg.offset;
+        break;
+    case SQFS_SYMLINK_TYPE:
+    case SQFS_LSYMLINK_TYPE:
+        Status = sqfs_meta_read(mnt, &cur, &u.link, sizeof(u.link));
+        inode->size = u.link.symlink_size;
+        break;
+    default:
+        /* devices, fifos and sockets have nothing we use */
+        break;
+    }
+
+    inode->tail = cur;
+    return Status;
+}
+
+static BOOLEAN
+sqfs_is_dir(struct sqfs_inode *inode)
+{
+    return inode->type == SQFS_DIR_TYPE || inode->type == SQFS_LDIR_TYPE;
+}
+
+static BOOLEAN
+sqfs_is_symlink(struct sqfs_inode *inode)
+{
+    return inode->type == SQFS_SYMLINK_TYPE || inode->type == SQFS_LSYMLINK_TYPE;
+}
+
+static void
+sqfs_dir_open(struct sqfs_inode *inode, struct sqfs_dir *dir)
+{
+    dir->cur.block = inode->start;
+    dir->cur.offset = inode->offset;
+    /* the size counts the "." and ".." entries, which are not stored */
+    dir->remaining = inode->size > 3 ? inode->size - 3 : 0;
+    dir->left = 0;
+    dir->start_block = 0;
+}
+
+/*
+ * Return the next directory entry, its NUL terminated name (at least
+ * SQFS_NAME_LEN + 1 bytes) and its inode reference. EFI_NOT_FOUND marks
+ * the end of the listing.
+ */
+static EFI_STATUS
+sqfs_dir_next(struct sqfs_mount *mnt, struct sqfs_dir *dir, struct sqfs_dir_entry *de, UINT8 *name, UINT64 *ref_out)
+{
+    struct sqfs_dir_header hdr;
+    EFI_STATUS Status;
+    UINTN len;
+
+    if (dir->left == 0) {
+        if (dir->remaining < sizeof(hdr) + sizeof(*de))
+            return EFI_NOT_FOUND;
+        Status = sqfs_meta_read(mnt, &dir->cur, &hdr, sizeof(hdr));
+        if (EFI_ERROR(Status))
+            return Status;
+        if (hdr.count >= 256)
+            return EFI_VOLUME_CORRUPTED;
+        dir->remaining -= sizeof(hdr);
+        dir->left = hdr.count + 1;
+        dir->start_block = hdr.start_block;
+    }
+
+    if (dir->remaining < sizeof(*de))
+        return EFI_VOLUME_CORRUPTED;
+    Status = sqfs_meta_read(mnt, &dir->cur, de, sizeof(*de));
+    if (EFI_ERROR(Status))
+        return Status;
+    dir->remaining -= sizeof(*de);
+
+    len = de->size + 1;
+    if (len > SQFS_NAME_LEN || len > dir->remaining)
+        return EFI_VOLUME_CORRUPTED;
+    Status = sqfs_meta_read(mnt, &dir->cur, name, len);
+    if (EFI_ERROR(Status))
+        return Status;
+    dir->remaining -= len;
+    name[len] = '\0';
+
+    dir->left--;
+    *ref_out = ((UINT64)dir->start_block << 16) | de->offset;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Compare names the way the listings are sorted (strcmp order).
+ */
+static INTN
+sqfs_namecmp(const UINT8 *a, UINTN alen, const UINT8 *b, UINTN blen)
+{
+    UINTN i;
+
+    for (i = 0; i < alen && i < blen; i++) {
+        if (a[i] != b[i])
+            return (INTN)a[i] - (INTN)b[i];
+    }
+    return (INTN)alen - (INTN)blen;
+}
+
+/*
+ * Find 'name' in a directory. The index of an extended directory gives
+ * the metadata block where the entry must be, so the listing is only
+ * scanned from there.
+ */
+static EFI_STATUS
+sqfs_lookup(struct sqfs_mount *mnt, struct sqfs_inode *dinode, const UINT8 *name, UINTN len, UINT64 *ref_out)
+{
+    struct sqfs_dir dir;
+    struct sqfs_dir_index idx;
+    struct sqfs_dir_entry de;
+    struct sqfs_cursor cur;
+    EFI_STATUS Status;
+    UINT8 ent[SQFS_NAME_LEN + 1];
+    UINT64 ref;
+    UINTN i;
+    INTN cmp;
+
+    sqfs_dir_open(dinode, &dir);
+
+    cur = dinode->tail;
+    for (i = 0; i < dinode->i_count; i++) {
+        Status = sqfs_meta_read(mnt, &cur, &idx, sizeof(idx));
+        if (EFI_ERROR(Status))
+            return Status;
+        if (idx.size >= SQFS_NAME_LEN)
+            return EFI_VOLUME_CORRUPTED;
+        Status = sqfs_meta_read(mnt, &cur, ent, idx.size + 1);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        if (sqfs_namecmp(ent, idx.size + 1, name, len) > 0)
+            break;
+        if (dinode->size <= 3 || idx.index >= dinode->size - 3)
+            return EFI_VOLUME_CORRUPTED;
+
+        dir.cur.block = mnt->sb.directory_table_start + idx.start_block;
+        dir.cur.offset = (dinode->offset + idx.index) % SQFS_METADATA_SIZE;
+        dir.remaining = dinode->size - 3 - idx.index;
+    }
+
+    while (!EFI_ERROR(Status = sqfs_dir_next(mnt, &dir, &de, ent, &ref))) {
+        cmp = sqfs_namecmp(ent, de.size + 1, name, len);
+        if (cmp == 0) {
+            *ref_out = ref;
+            return EFI_SUCCESS;
+        }
+        /* listings are sorted, so the name cannot come later */
+        if (cmp > 0)
+            return EFI_NOT_FOUND;
+    }
+
+    return Status;
+}
+
+/*
+ * Convert a UTF-8 name to UCS-2. Bytes that are not valid UTF-8 are taken
+ * as Latin-1; characters outside the BMP become '?'.
+ */
+static void
+sqfs_name_to_ucs2(const UINT8 *s, UINTN len, CHAR16 *out, UINTN max)
+{
+    UINTN i = 0, n = 0;
+    UINT8 c;
+
+    while (i < len && n < max) {
+        c = s[i];
+        if (c >= 0xC2 && c <= 0xDF && i + 1 < len && (s[i + 1] & 0xC0) == 0x80) {
+            out[n++] = ((c & 0x1F) << 6) | (s[i + 1] & 0x3F);
+            i += 2;
+        } else if (c >= 0xE0 && c <= 0xEF && i + 2 < len && (s[i + 1] & 0xC0) == 0x80 && (s[i + 2] & 0xC0) == 0x80) {
+            out[n++] = ((c & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+            i += 3;
+        } else if (c >= 0xF0 && c <= 0xF4 && i + 3 < len) {
+            out[n++] = L'?';
+            i += 4;
+        } else {
+            out[n++] = c;
+            i++;
+        }
+    }
+    out[n] = L'\0';
+}
+
+/*
+ * Convert a path component to UTF-8. Returns the length, or 0 if the name
+ * is longer than SQFS_NAME_LEN bytes.
+ */
+static UINTN
+sqfs_name_to_utf8(const CHAR16 *s, UINTN len, UINT8 *out)
+{
+    UINTN i, n = 0;
+    CHAR16 c;
+
+    for (i = 0; i < len; i++) {
+        c = s[i];
+        if (c < 0x80) {
+            if (n + 1 > SQFS_NAME_LEN)
+                return 0;
+            out[n++] = c;
+        } else if (c < 0x800) {
+            if (n + 2 > SQFS_NAME_LEN)
+                return 0;
+            out[n++] = 0xC0 | (c >> 6);
+            out[n++] = 0x80 | (c & 0x3F);
+        } else {
+            if (n + 3 > SQFS_NAME_LEN)
+                return 0;
+            out[n++] = 0xE0 | (c >> 12);
+            out[n++] = 0x80 | ((c >> 6) & 0x3F);
+            out[n++] = 0x80 | (c & 0x3F);
+        }
+    }
+    return n;
+}
+
+/*
+ * Build the path to continue a walk at after a symbolic link: the link
+ * target followed by the components not yet walked.
+ */
+static EFI_STATUS
+sqfs_symlink_path(struct sqfs_mount *mnt, struct sqfs_inode *inode, const CHAR16 *rest, CHAR16 **path_out)
+{
+    struct sqfs_cursor cur = inode->tail;
+    EFI_STATUS Status;
+    UINTN size = (UINTN)inode->size, max;
+    UINT8 *target;
+    CHAR16 *path;
+
+    if (size == 0 || size >= SQFS_PATH_MAX)
+        return EFI_NOT_FOUND;
+
+    target = AllocatePool(size);
+    if (!target)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_meta_read(mnt, &cur, target, size);
+    if (EFI_ERROR(Status)) {
+        FreePool(target);
+        return Status;
+    }
+
+    max = size + 1 + StrLen(rest);
+    path = AllocatePool((max + 1) * sizeof(CHAR16));
+    if (!path) {
+        FreePool(target);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    sqfs_name_to_ucs2(target, size, path, max);
+    FreePool(target);
+    if (*rest) {
+        StrCat(path, L"/");
+        StrCat(path, rest);
+    }
+
+    *path_out = path;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Walk 'path' from the root directory, following symbolic links. On
+ * success 'inode_out' holds the inode of the last component and
+ * 'name_out' (SQFS_NAME_LEN + 1 characters) its name.
+ */
+static EFI_STATUS
+sqfs_walk(struct sqfs_mount *mnt, const CHAR16 *path, struct sqfs_inode *inode_out, CHAR16 *name_out)
+{
+    EFI_STATUS Status;
+    struct sqfs_inode dir;
+    const CHAR16 *p = path;
+    CHAR16 *link = NULL, *next;
+    UINT8 name[SQFS_NAME_LEN];
+    UINT64 ref;
+    UINTN len, nlen, nlinks = 0;
+
+    Status = sqfs_read_inode(mnt, mnt->sb.root_inode, inode_out);
+    if (EFI_ERROR(Status))
+        return Status;
+    StrCpy(name_out, L"\\");
+
+    while (*p == L'/' || *p == L'\\')
+        p++;
+
+    while (*p) {
+        for (len = 0; p[len] && p[len] != L'/' && p[len] != L'\\'; len++)
+            ;
+
+        nlen = sqfs_name_to_utf8(p, len, name);
+        if (!sqfs_is_dir(inode_out) || nlen == 0) {
+            Status = EFI_NOT_FOUND;
+            break;
+        }
+
+        CopyMem(&dir, inode_out, sizeof(dir));
+        Status = sqfs_lookup(mnt, &dir, name, nlen, &ref);
+        if (!EFI_ERROR(Status))
+            Status = sqfs_read_inode(mnt, ref, inode_out);
+        if (EFI_ERROR(Status))
+            break;
+
+        CopyMem(name_out, p, len * sizeof(CHAR16));
+        name_out[len] = L'\0';
+
+        p += len;
+        while (*p == L'/' || *p == L'\\')
+            p++;
+
+        if (sqfs_is_symlink(inode_out)) {
+            if (++nlinks > SQFS_SYMLINK_MAX) {
+                Status = EFI_NOT_FOUND;
+                break;
+            }
+
+            Status = sqfs_symlink_path(mnt, inode_out, p, &next);
+            if (EFI_ERROR(Status))
+                break;
+            if (link)
+                FreePool(link);
+            link = next;
+            p = link;
+
+            /* absolute targets restart at the root, relative ones in 'dir' */
+            if (*p == L'/') {
+                Status = sqfs_read_inode(mnt, mnt->sb.root_inode, inode_out);
+                if (EFI_ERROR(Status))
+                    break;
+            } else {
+                CopyMem(inode_out, &dir, sizeof(dir));
+            }
+
+            while (*p == L'/' || *p == L'\\')
+                p++;
+        }
+    }
+
+    if (link)
+        FreePool(link);
+    return Status;
+}
+
+/*
+ * ReadSQFSDir: list directory contents for the provided path.
+ */
+EFI_STATUS
+ReadSQFSDir(void *mount_ctx, const CHAR16 *path)
+{
+    struct sqfs_mount *mnt = (struct sqfs_mount *)mount_ctx;
+    struct sqfs_inode dinode, inode;
+    struct sqfs_dir dir;
+    struct sqfs_dir_entry de;
+    EFI_STATUS Status;
+    CHAR16 *name;
+    UINT8 ent[SQFS_NAME_LEN + 1];
+    UINT64 ref;
+
+    if (!mnt || !path)
+        return EFI_INVALID_PARAMETER;
+
+    name = AllocatePool((SQFS_NAME_LEN + 1) * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_walk(mnt, path, &dinode, name);
+    if (EFI_ERROR(Status)) {
+        PrintToScreen(L"No such file or directory: %s\n", path);
+        goto out;
+    }
+
+    if (!sqfs_is_dir(&dinode)) {
+        PrintToScreen(L"Not a directory\n");
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    PrintToScreen(L"Listing SquashFS directory: %s\n", path);
+
+    sqfs_dir_open(&dinode, &dir);
+    while (!EFI_ERROR(Status = sqfs_dir_next(mnt, &dir, &de, ent, &ref))) {
+        sqfs_name_to_ucs2(ent, de.size + 1, name, SQFS_NAME_LEN);
+
+        switch (de.type) {
+        case SQFS_DIR_TYPE:
+            PrintToScreen(L"   <DIR>    %s\n", name);
+            break;
+        case SQFS_SYMLINK_TYPE:
+            PrintToScreen(L"  <LINK>    %s\n", name);
+            break;
+        case SQFS_REG_TYPE:
+            if (EFI_ERROR(sqfs_read_inode(mnt, ref, &inode))) {
+                PrintToScreen(L"     ???    %s\n", name);
+                break;
+            }
+            PrintToScreen(L"  <FILE>    %s  %lu bytes\n", name, inode.size);
+            break;
+        default:
+            PrintToScreen(L"  <FILE>    %s\n", name);
+            break;
+        }
+    }
+    if (Status == EFI_NOT_FOUND)
+        Status = EFI_SUCCESS;
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+/*
+ * Read a run of whole data blocks starting at block 'b' straight into
+ * 'out'. The blocks are stored back to back, so their compressed forms
+ * are fetched in one request. *done receives the bytes produced.
+ */
+static EFI_STATUS
+sqfs_read_blocks(struct sqfs_file *sf, UINT32 b, UINT8 *out, UINTN len, UINTN *done)
+{
+    struct sqfs_mount *mnt = sf->mnt;
+    EFI_STATUS Status;
+    UINT64 bs = mnt->sb.block_size;
+    UINTN raw_len = 0, max = mnt->stage_size - 2 * mnt->devbs, blen, n, outlen;
+    UINT32 e;
+    UINT8 *raw = NULL;
+
+    /* as many blocks as fit the request and the staging buffer */
+    *done = 0;
+    for (e = b; e < sf->nblocks; e++) {
+        blen = (UINTN)(sf->size - e * bs < bs ? sf->size - e * bs : bs);
+        n = SQFS_DATA_SIZE(sf->bsize[e]);
+        if (*done + blen > len || raw_len + n > max)
+            break;
+        *done += blen;
+        raw_len += n;
+    }
+
+    if (raw_len) {
+        Status = sqfs_read_raw(mnt, sf->bpos[b], raw_len, raw_len, &raw);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    for (; b < e; b++) {
+        blen = (UINTN)(sf->size - b * bs < bs ? sf->size - b * bs : bs);
+        n = SQFS_DATA_SIZE(sf->bsize[b]);
+        if (n == 0) {
+            /* sparse block */
+            SetMem(out, blen, 0);
+        } else {
+            Status = sqfs_unpack(mnt, raw, n, !(sf->bsize[b] & SQFS_DATA_UNCOMPRESSED), out, blen, &outlen);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (outlen != blen)
+                return EFI_VOLUME_CORRUPTED;
+            raw += n;
+        }
+        out += blen;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read file data. Whole blocks go straight to the caller; partly read
+ * blocks and the fragment tail come through the data cache.
+ */
+static EFI_STATUS
+sqfs_read(struct sqfs_file *sf, UINT64 pos, UINT8 *out, UINTN len)
+{
+    struct sqfs_mount *mnt = sf->mnt;
+    struct sqfs_cache_entry *e;
+    EFI_STATUS Status;
+    UINT64 bs = mnt->sb.block_size;
+    UINT64 b, off, blen;
+    UINTN chunk;
+
+    while (len > 0) {
+        b = pos / bs;
+        off = pos % bs;
+
+        if (b >= sf->nblocks) {
+            /* the tail end, packed into a fragment block */
+            Status = sqfs_data_block(mnt, sf->frag_pos, sf->frag_size, &e);
+            if (EFI_ERROR(Status))
+                return Status;
+            if ((UINT64)sf->frag_off + off + len > e->len)
+                return EFI_VOLUME_CORRUPTED;
+            CopyMem(out, e->data + sf->frag_off + off, len);
+            return EFI_SUCCESS;
+        }
+
+        blen = sf->size - b * bs < bs ? sf->size - b * bs : bs;
+        chunk = len < blen - off ? len : (UINTN)(blen - off);
+
+        if (off == 0 && chunk == blen) {
+            Status = sqfs_read_blocks(sf, (UINT32)b, out, len, &chunk);
+            if (EFI_ERROR(Status))
+                return Status;
+        } else if (SQFS_DATA_SIZE(sf->bsize[b]) == 0) {
+            SetMem(out, chunk, 0);
+        } else {
+            Status = sqfs_data_block(mnt, sf->bpos[b], sf->bsize[b], &e);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (e->len != blen)
+                return EFI_VOLUME_CORRUPTED;
+            CopyMem(out, e->data + off, chunk);
+        }
+
+        pos += chunk;
+        out += chunk;
+        len -= chunk;
+    }
+
+    return EFI_SUCCESS;
+}
+
+static void
+sqfs_file_free(struct sqfs_file *sf)
+{
+    if (sf->bsize)
+        FreePool(sf->bsize);
+    if (sf->bpos)
+        FreePool(sf->bpos);
+    FreePool(sf);
+}
+
+/*
+ * Create a file handle: load the block list and locate the fragment that
+ * holds the tail end.
+ */
+static EFI_STATUS
+sqfs_file_new(struct sqfs_mount *mnt, struct sqfs_inode *inode, struct sqfs_file **sf_out)
+{
+    struct sqfs_file *sf;
+    struct sqfs_fragment frag;
+    struct sqfs_cursor cur = inode->tail;
+    EFI_STATUS Status;
+    UINT64 bs = mnt->sb.block_size, nblocks;
+    UINTN i;
+
+    if (inode->fragment == SQFS_INVALID_FRAG)
+        nblocks = (inode->size + bs - 1) / bs;
+    else
+        nblocks = inode->size / bs;
+    if (nblocks > 0xFFFFFFFF / sizeof(UINT64))
+        return EFI_VOLUME_CORRUPTED;
+
+    sf = AllocateZeroPool(sizeof(*sf));
+    if (!sf)
+        return EFI_OUT_OF_RESOURCES;
+
+    sf->mnt = mnt;
+    sf->size = inode->size;
+    sf->nblocks = (UINT32)nblocks;
+
+    if (nblocks) {
+        sf->bsize = AllocatePool(nblocks * sizeof(UINT32));
+        sf->bpos = AllocatePool(nblocks * sizeof(UINT64));
+        if (!sf->bsize || !sf->bpos) {
+            Status = EFI_OUT_OF_RESOURCES;
+            goto fail;
+        }
+
+        Status = sqfs_meta_read(mnt, &cur, sf->bsize, nblocks * sizeof(UINT32));
+        if (EFI_ERROR(Status))
+            goto fail;
+
+        sf->bpos[0] = inode->start;
+        for (i = 1; i < nblocks; i++)
+            sf->bpos[i] = sf->bpos[i - 1] + SQFS_DATA_SIZE(sf->bsize[i - 1]);
+    }
+
+    if (inode->fragment != SQFS_INVALID_FRAG && inode->size % bs) {
+        if (inode->fragment >= mnt->sb.fragments || inode->frag_off + inode->size % bs > bs) {
+            Status = EFI_VOLUME_CORRUPTED;
+            goto fail;
+        }
+
+        cur.block = mnt->frag_index[inode->fragment / SQFS_FRAGS_PER_META];
+        cur.offset = (inode->fragment % SQFS_FRAGS_PER_META) * sizeof(frag);
+        Status = sqfs_meta_read(mnt, &cur, &frag, sizeof(frag));
+        if (EFI_ERROR(Status))
+            goto fail;
+
+        sf->frag_pos = frag.start_block;
+        sf->frag_size = frag.size;
+        sf->frag_off = inode->frag_off;
+    }
+
+    *sf_out = sf;
+    return EFI_SUCCESS;
+
+fail:
+    sqfs_file_free(sf);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_read(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    struct sqfs_file *sf = (struct sqfs_file *)This;
+    EFI_STATUS Status;
+    UINTN to_read;
+
+    if (!This || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (sf->pos >= sf->size) {
+        *BufferSize = 0; /* EOF */
+        return EFI_SUCCESS;
+    }
+
+    to_read = *BufferSize;
+    if ((UINT64)to_read > sf->size - sf->pos)
+        to_read = (UINTN)(sf->size - sf->pos);
+
+    Status = sqfs_read(sf, sf->pos, Buffer, to_read);
+    if (EFI_ERROR(Status)) {
+        *BufferSize = 0;
+        return Status;
+    }
+
+    sf->pos += to_read;
+    *BufferSize = to_read;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_setpos(EFI_FILE_PROTOCOL *This, UINT64 Position)
+{
+    struct sqfs_file *sf = (struct sqfs_file *)This;
+
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    /* UEFI uses (UINT64)-1 to set position to EOF */
+    if (Position == (UINT64)-1)
+        Position = sf->size;
+
+    if (Position > sf->size)
+        return EFI_INVALID_PARAMETER;
+
+    sf->pos = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_getpos(EFI_FILE_PROTOCOL *This, UINT64 *Position)
+{
+    if (!This || !Position)
+        return EFI_INVALID_PARAMETER;
+
+    *Position = ((struct sqfs_file *)This)->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_getinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer)
+{
+    struct sqfs_file *sf = (struct sqfs_file *)This;
+
+    if (!This || !InformationType || !BufferSize)
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(InformationType, &gEfiFileInfoGuid) != 0)
+        return EFI_UNSUPPORTED;
+
+    return FillFileInfo(sf->name, sf->size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_open(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes)
+{
+    /* only regular files are handed out */
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_write(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_setinfo(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_flush(EFI_FILE_PROTOCOL *This)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_close(EFI_FILE_PROTOCOL *This)
+{
+    if (!This)
+        return EFI_INVALID_PARAMETER;
+
+    sqfs_file_free((struct sqfs_file *)This);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sqfs_file_delete(EFI_FILE_PROTOCOL *This)
+{
+    sqfs_file_close(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/*
+ * OpenSQFS:
+ * - walk the path, following symbolic links
+ * - verify the target is a regular file
+ * - load its block list and create an in-memory file handle
+ */
+EFI_STATUS
+OpenSQFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
+    struct sqfs_mount *mnt = mount_ctx;
+    struct sqfs_file *sf;
+    struct sqfs_inode inode;
+    EFI_STATUS Status;
+    CHAR16 *name;
+
+    if (!mnt || !filename || !file_out)
+        return EFI_INVALID_PARAMETER;
+
+    /* Only support read-only */
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_UNSUPPORTED;
+
+    name = AllocatePool((SQFS_NAME_LEN + 1) * sizeof(CHAR16));
+    if (!name)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_walk(mnt, filename, &inode, name);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    if (inode.type != SQFS_REG_TYPE && inode.type != SQFS_LREG_TYPE) {
+        Status = EFI_UNSUPPORTED;
+        goto out;
+    }
+
+    Status = sqfs_file_new(mnt, &inode, &sf);
+    if (EFI_ERROR(Status))
+        goto out;
+
+    StrCpy(sf->name, name);
+
+    sf->File.Revision = EFI_FILE_PROTOCOL_REVISION;
+    sf->File.Open = sqfs_file_open;
+    sf->File.Close = sqfs_file_close;
+    sf->File.Delete = sqfs_file_delete;
+    sf->File.Read = sqfs_file_read;
+    sf->File.Write = sqfs_file_write;
+    sf->File.GetPosition = sqfs_file_getpos;
+    sf->File.SetPosition = sqfs_file_setpos;
+    sf->File.GetInfo = sqfs_file_getinfo;
+    sf->File.SetInfo = sqfs_file_setinfo;
+    sf->File.Flush = sqfs_file_flush;
+
+    *file_out = &sf->File;
+
+out:
+    FreePool(name);
+    return Status;
+}
+
+/*
+ * Directory iterator. The listing cursor is copied before each entry is
+ * read so that an entry that does not fit the caller's buffer is read
+ * again on the next call.
+ */
+struct sqfs_dir_handle {
+    struct sqfs_mount *mnt;
+    struct sqfs_dir dir;
+    UINT8 name[SQFS_NAME_LEN + 1];
+    CHAR16 uname[SQFS_NAME_LEN + 1];
+};
+
+EFI_STATUS
+OpenSQFSDir(void *mount_ctx, const CHAR16 *path, void **dir_out)
+{
+    struct sqfs_mount *mnt = mount_ctx;
+    struct sqfs_inode inode;
+    struct sqfs_dir_handle *dh;
+    EFI_STATUS Status;
+
+    if (!mnt || !path || !dir_out)
+        return EFI_INVALID_PARAMETER;
+
+    dh = AllocateZeroPool(sizeof(*dh));
+    if (!dh)
+        return EFI_OUT_OF_RESOURCES;
+
+    Status = sqfs_walk(mnt, path, &inode, dh->uname);
+    if (!EFI_ERROR(Status) && !sqfs_is_dir(&inode))
+        Status = EFI_UNSUPPORTED;
+    if (EFI_ERROR(Status)) {
+        FreePool(dh);
+        return Status;
+    }
+
+    dh->mnt = mnt;
+    sqfs_dir_open(&inode, &dh->dir);
+    *dir_out = dh;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReadSQFSDirEntry(void *dir, UINTN *size, VOID *buf)
+{
+    struct sqfs_dir_handle *dh = dir;
+    struct sqfs_dir saved = dh->dir;
+    struct sqfs_dir_entry de;
+    struct sqfs_inode inode;
+    EFI_STATUS Status;
+    UINT64 ref;
+
+    Status = sqfs_dir_next(dh->mnt, &dh->dir, &de, dh->name, &ref);
+    if (Status == EFI_NOT_FOUND) {
+        *size = 0;
+        return EFI_SUCCESS;
+    }
+    if (!EFI_ERROR(Status))
+        Status = sqfs_read_inode(dh->mnt, ref, &inode);
+    if (!EFI_ERROR(Status)) {
+        sqfs_name_to_ucs2(dh->name, de.size + 1, dh->uname, SQFS_NAME_LEN);
+        Status = FillFileInfo(dh->uname, sqfs_is_dir(&inode) ? 0 : inode.size,
+            EFI_FILE_READ_ONLY | (sqfs_is_dir(&inode) ? EFI_FILE_DIRECTORY : 0), size, buf);
+    }
+
+    if (EFI_ERROR(Status))
+        dh->dir = saved;
+    return Status;
+}
+
+void
+CloseSQFSDir(void *dir)
+{
+    if (dir)
+        FreePool(dir);
+}
@@ -0,0 +1,205 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * trace.c
+ * Function entry/exit tracing for trace builds.
+ *
+ * With -finstrument-functions the compiler calls the two hooks below on
+ * every function entry and exit. They only store the function address
+ * and the raw clock counter into a static ring, so that the cost per
+ * call is a few instructions and never a firmware call; that also keeps
+ * them usable after ExitBootServices(). The hooks, and everything they
+ * call, must not be instrumented themselves.
+ *
+ * "trace dump" streams the ring to the serial download port, and
+ * host/tracesym turns it into folded stacks for a flame graph.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "clock.h"
+#include "serial.h"
+#include "trace.h"
+
+#define NO_TRACE	__attribute__((no_instrument_function))
+
+#if defined(TRACE_BLD)
+static struct trace_entry TraceRing[TRACE_ENTRIES];
+static UINT64 TraceHead;		// records logged since the last reset
+static volatile BOOLEAN TraceOff;
+
+static inline NO_TRACE UINT64
+TraceClock(void)
+{
+#if defined(X86_64_BLD)
+	UINT32 Lo, Hi;
+
+	__asm__ volatile ("rdtsc" : "=a" (Lo), "=d" (Hi));
+	return ((UINT64)Hi << 32) | Lo;
+#elif defined(AARCH64_BLD)
+	UINT64 Cnt;
+
+	__asm__ volatile ("isb; mrs %0, cntvct_el0" : "=r" (Cnt) : : "memory");
+	return Cnt;
+#elif defined(RISCV64_BLD)
+	UINT64 Cnt;
+
+	__asm__ volatile ("rdtime %0" : "=r" (Cnt));
+	return Cnt;
+#else
+	return TraceHead;
+#endif
+}
+
+static inline NO_TRACE void
+TraceLog(void *Fn, UINT64 Flag)
+{
+	struct trace_entry *e;
+
+	if (TraceOff)
+		return;
+
+	e = &TraceRing[TraceHead++ & (TRACE_ENTRIES - 1)];
+	e->Fn = (UINT64)(UINTN)Fn;
+	e->Ticks = (TraceClock() & ~TRACE_EXIT) | Flag;
+}
+
+NO_TRACE void
+__cyg_profile_func_enter(void *Fn, void *CallSite)
+{
+	TraceLog(Fn, 0);
+}
+
+NO_TRACE void
+__cyg_profile_func_exit(void *Fn, void *CallSite)
+{
+	TraceLog(Fn, TRACE_EXIT);
+}
+
+void
+TraceReset(void)
+{
+	TraceHead = 0;
+}
+
+/*
+ * Function:
+ * TraceDump()
+ *
+ * Description:
+ * Send the trace ring over the serial download port, as a
+ * trace_dump_header followed by the records, oldest first. Logging is
+ * paused while the ring is being sent, so that the dump does not
+ * overwrite the part of the ring it has yet to send.
+ *
+ * Return value:
+ * EFI_SUCCESS, or the error from opening or writing the serial port.
+ */
+EFI_STATUS
+TraceDump(void)
+{
+	EFI_STATUS Status;
+	EFI_LOADED_IMAGE *LoadedImage;
+	struct trace_dump_header Hdr;
+	UINT64 Head, First, Count;
+
+	Status = InitSerial(SerialDownloadPort, SerialBaud);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	TraceOff = TRUE;
+	Head = TraceHead;
+	Count = Head < TRACE_ENTRIES ? Head : TRACE_ENTRIES;
+	First = Head - Count;
+
+	SetMem(&Hdr, sizeof(Hdr), 0);
+	Hdr.Magic = TRACE_MAGIC;
+	Hdr.Version = TRACE_VERSION;
+	Hdr.EntrySize = sizeof(struct trace_entry);
+	Hdr.Count = (UINT32)Count;
+	Hdr.Lost = (UINT32)First;
+	Hdr.ClockFrequency = GetClockFrequency();
+	if (!EFI_ERROR(uefi_call_wrapper(BS->HandleProtocol, 3, gImageHandle, &gEfiLoadedImageProtocolGuid,
+	    (VOID **)&LoadedImage)))
+		Hdr.ImageBase = (UINT64)(UINTN)LoadedImage->ImageBase;
+
+	Status = SerialWrite(&Hdr, sizeof(Hdr));
+	if (EFI_ERROR(Status))
+		goto out;
+
+	// The live part of the ring may wrap around its end.
+	First &= TRACE_ENTRIES - 1;
+	if (First + Count > TRACE_ENTRIES) {
+		Status = SerialWrite(&TraceRing[First], (TRACE_ENTRIES - First) * sizeof(struct trace_entry));
+		if (EFI_ERROR(Status))
+			goto out;
+		Count -= TRACE_ENTRIES - First;
+		First = 0;
+	}
+	Status = SerialWrite(&TraceRing[First], Count * sizeof(struct trace_entry));
+
+out:
+	TraceOff = FALSE;
+	return Status;
+}
+
+void
+TraceStatus(void)
+{
+	UINT64 Head = TraceHead;
+
+	PrintToScreen(L"%lu records logged, %lu in the ring (%u max), %lu overwritten\n",
+	    Head, Head < TRACE_ENTRIES ? Head : TRACE_ENTRIES, TRACE_ENTRIES,
+	    Head > TRACE_ENTRIES ? Head - TRACE_ENTRIES : 0);
+}
+#else /* !TRACE_BLD */
+void
+TraceReset(void)
+{
+}
+
+EFI_STATUS
+TraceDump(void)
+{
+	return EFI_UNSUPPORTED;
+}
+
+void
+TraceStatus(void)
+{
+	PrintToScreen(L"Function tracing is only available in trace builds.\n");
+}
+#endif /* TRACE_BLD */
@@ -34,12 +34,39 @@
 #include <efi.h>
 #include <efilib.h>
 
-#include "boot.h"
 #include "ufs.h"
 
+/*
+ * UFS is not implemented yet. Every slice probe walks fs_tab, so these
+ * fail quietly rather than print on each one.
+ */
+
 EFI_STATUS
 DetectUFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_void)
 {
-    PrintToScreen(L"DetectUFS: not implemented yet!\n");
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+MountUFS(EFI_BLOCK_IO_PROTOCOL *BlockIo, UINT32 SliceStartLBA, void *sb_buffer, void **mount_out)
+{
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+ReadUFSDir(void *mount_ctx, const CHAR16 *path)
+{
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+UmountUFS(void *mount)
+{
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+OpenUFS(void *mount_ctx, const CHAR16 *filename, UINTN mode, void **file_out)
+{
     return EFI_UNSUPPORTED;
 }
@@ -77,6 +77,7 @@
 #include <stdarg.h>
 
 #include "boot.h"
+#include "clock.h"
 #include "config.h"
 #include "font.h"
 
@@ -550,7 +551,7 @@ UpdateProgressBar(INTN Id, UINTN NewProgress)
 		UINT64 timenow;
 
 		 if (StartTime == 0) {
-			 StartTime = GetTimeSeconds();
+			 StartTime = GetTimeMilliseconds();
 			 ProgressTime[Id] = StartTime;
 		 }
 
@@ -558,7 +559,7 @@ UpdateProgressBar(INTN Id, UINTN NewProgress)
 		UINT32 bps = 0;
 		UINT32 eta = 0;
 
-		timenow = GetTimeSeconds();
+		timenow = GetTimeMilliseconds();
 
 		UINT64 delta_time = timenow - ProgressTime[Id];
 		ProgressTime[Id] = timenow;
@@ -0,0 +1,1410 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * xz.c
+ * XZ stream decoder: LZMA2, optionally behind the branch converter (BCJ)
+ * for the architecture this loader was built for.
+ *
+ * An xz stream is a header, a series of blocks, an index of the blocks
+ * and a footer. Each block names its filter chain and ends with a check
+ * (none, CRC32, CRC64 or SHA-256) of its decoded data. LZMA2 splits the
+ * data into chunks of at most 64KB compressed and 2MB decoded, each
+ * either stored or LZMA coded; a chunk may reset the dictionary, the
+ * coder state or the properties (lc, lp and pb).
+ *
+ * As with zstd, the dictionary is the output buffer itself, so however
+ * large a dictionary the stream was made with, the decoder needs only
+ * its probability tables and room for one compressed chunk. Once a block
+ * is decoded, which its LZMA2 data has to be from the unconverted bytes,
+ * the BCJ filter undoes the encoder's branch conversion over it in place.
+ *
+ * Only the BCJ filter of the build's architecture is compiled in: x86
+ * for X86_64_BLD, ARM64 for AARCH64_BLD and RISC-V for RISCV64_BLD, or
+ * the compiler's target in the host tools. A stream that asks for another
+ * is refused with EFI_UNSUPPORTED. SHA-256 and the reserved check types
+ * are skipped rather than verified.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "clock.h"
+#include "decompress.h"
+
+#define XZ_HEADER_SIZE          12
+#define XZ_FOOTER_SIZE          12
+#define XZ_BLOCK_HEADER_MAX     1024
+
+#define XZ_CHECK_NONE           0x00
+#define XZ_CHECK_CRC32          0x01
+#define XZ_CHECK_CRC64          0x04
+#define XZ_CHECK_SHA256         0x0A
+#define XZ_CHECK_MAX            0x0F
+
+#define XZ_BLOCK_FILTERS_MASK   0x03
+#define XZ_BLOCK_RESERVED       0x3C
+#define XZ_BLOCK_COMPRESSED     0x40
+#define XZ_BLOCK_UNCOMPRESSED   0x80
+
+#define XZ_FILTER_X86           0x04
+#define XZ_FILTER_ARM64         0x0A
+#define XZ_FILTER_RISCV         0x0B
+#define XZ_FILTER_LZMA2         0x21
+
+#if defined(X86_64_BLD) || (!defined(AARCH64_BLD) && !defined(RISCV64_BLD) && defined(__x86_64__))
+#define XZ_FILTER_BCJ           XZ_FILTER_X86
+#elif defined(AARCH64_BLD) || (!defined(RISCV64_BLD) && defined(__aarch64__))
+#define XZ_FILTER_BCJ           XZ_FILTER_ARM64
+#elif defined(RISCV64_BLD) || defined(__riscv)
+#define XZ_FILTER_BCJ           XZ_FILTER_RISCV
+#endif
+
+#define XZ_VLI_BYTES_MAX        9
+#define XZ_VLI_UNKNOWN          ((UINT64)-1)
+
+#define LZMA2_COMPRESSED_MAX    (64 << 10)
+#define LZMA2_DICT_MAX_BITS     40
+
+/*
+ * Bytes past the end of a compressed chunk that the range decoder may
+ * read before a symbol ends and the overrun is noticed.
+ */
+#define LZMA_IN_MARGIN          64
+
+#define LZMA_STATES             12
+#define LZMA_LIT_STATES         7
+#define LZMA_POS_STATES_MAX     16
+#define LZMA_LITERAL_CODERS_MAX 16
+#define LZMA_LITERAL_SIZE       0x300
+#define LZMA_LC_LP_MAX          4
+#define LZMA_PROPS_MAX          (9 * 5 * 5)
+
+#define LZMA_MATCH_LEN_MIN      2
+#define LZMA_LEN_LOW_BITS       3
+#define LZMA_LEN_MID_BITS       3
+#define LZMA_LEN_HIGH_BITS      8
+#define LZMA_LEN_LOW_SYMBOLS    (1 << LZMA_LEN_LOW_BITS)
+#define LZMA_LEN_MID_SYMBOLS    (1 << LZMA_LEN_MID_BITS)
+
+#define LZMA_DIST_STATES        4
+#define LZMA_DIST_SLOT_BITS     6
+#define LZMA_DIST_MODEL_START   4
+#define LZMA_DIST_MODEL_END     14
+#define LZMA_FULL_DISTANCES     128
+#define LZMA_ALIGN_BITS         4
+
+#define RC_TOP                  (1U << 24)
+#define RC_MODEL_BITS           11
+#define RC_MODEL_TOTAL          (1U << RC_MODEL_BITS)
+#define RC_MOVE_BITS            5
+
+#define XZ_GET32(p) \
+    ((UINT32)(p)[0] | ((UINT32)(p)[1] << 8) | ((UINT32)(p)[2] << 16) | ((UINT32)(p)[3] << 24))
+#define XZ_GET32_BE(p) \
+    (((UINT32)(p)[0] << 24) | ((UINT32)(p)[1] << 16) | ((UINT32)(p)[2] << 8) | (UINT32)(p)[3])
+
+#define CRC64_POLY              0xC96C5795D7870F42ULL
+
+/* Probabilities for one of the two match length coders. */
+struct lzma_len {
+    UINT16 Choice;
+    UINT16 Choice2;
+    UINT16 Low[LZMA_POS_STATES_MAX][LZMA_LEN_LOW_SYMBOLS];
+    UINT16 Mid[LZMA_POS_STATES_MAX][LZMA_LEN_MID_SYMBOLS];
+    UINT16 High[1 << LZMA_LEN_HIGH_BITS];
+};
+
+struct lzma_probs {
+    UINT16 IsMatch[LZMA_STATES][LZMA_POS_STATES_MAX];
+    UINT16 IsRep[LZMA_STATES];
+    UINT16 IsRep0[LZMA_STATES];
+    UINT16 IsRep1[LZMA_STATES];
+    UINT16 IsRep2[LZMA_STATES];
+    UINT16 IsRep0Long[LZMA_STATES][LZMA_POS_STATES_MAX];
+    UINT16 DistSlot[LZMA_DIST_STATES][1 << LZMA_DIST_SLOT_BITS];
+    UINT16 DistSpecial[LZMA_FULL_DISTANCES - LZMA_DIST_MODEL_END];
+    UINT16 DistAlign[1 << LZMA_ALIGN_BITS];
+    struct lzma_len MatchLen;
+    struct lzma_len RepLen;
+    UINT16 Literal[LZMA_LITERAL_CODERS_MAX][LZMA_LITERAL_SIZE];
+};
+
+struct xz_ctx {
+    struct lzma_probs P;
+    UINT32 Rep[4];
+    UINTN State;
+    UINT8 Lc, Lp, Pb;
+    UINT8 *DictStart;       /* output since the last dictionary reset */
+    BOOLEAN NeedDictReset;
+    BOOLEAN NeedProps;
+    BOOLEAN Busy;
+    UINT8 Chunk[LZMA2_COMPRESSED_MAX + LZMA_IN_MARGIN];
+};
+
+struct xz_input {
+    inflate_input_fn Input;
+    VOID *Context;
+    UINT8 *Piece;
+    UINTN Left;             /* bytes of Piece not yet used */
+    UINT64 Fed;             /* bytes handed over by Input */
+};
+
+/* The blocks of a stream, summed to be checked against its index. */
+struct xz_totals {
+    UINT64 Blocks;
+    UINT64 Unpadded;
+    UINT64 Uncompressed;
+};
+
+/* Range decoder over one compressed chunk. */
+struct rc {
+    UINT32 Range;
+    UINT32 Code;
+    const UINT8 *In;
+};
+
+static const UINT8 XzMagic[6] = { 0xFD, '7', 'z', 'X', 'Z', 0x00 };
+static const UINT8 XzFooterMagic[2] = { 'Y', 'Z' };
+
+static struct xz_ctx *CachedCtx;
+static UINT32 Crc32Table[256];
+static UINT64 Crc64Table[8][256];
+
+static VOID
+crc_init(VOID)
+{
+    UINT32 c;
+    UINT64 d;
+    UINTN i, k;
+
+    if (Crc32Table[1])
+        return;
+
+    for (i = 0; i < 256; i++) {
+        c = (UINT32)i;
+        d = i;
+        for (k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (0xEDB88320U & (0U - (c & 1)));
+            d = (d >> 1) ^ (CRC64_POLY & (0ULL - (d & 1)));
+        }
+        Crc32Table[i] = c;
+        Crc64Table[0][i] = d;
+    }
+    for (i = 0; i < 256; i++) {
+        d = Crc64Table[0][i];
+        for (k = 1; k < 8; k++) {
+            d = Crc64Table[0][d & 0xFF] ^ (d >> 8);
+            Crc64Table[k][i] = d;
+        }
+    }
+}
+
+/* The headers and index are summed here as they are read; see xz_check(). */
+static UINT32
+crc32(UINT32 Crc, const UINT8 *p, UINTN Len)
+{
+    Crc = ~Crc;
+    while (Len--)
+        Crc = Crc32Table[(Crc ^ *p++) & 0xFF] ^ (Crc >> 8);
+    return ~Crc;
+}
+
+/*
+ * The CRC64 check covers every output byte, so it goes eight bytes
+ * at a time. All three targets are little-endian.
+ */
+static UINT64
+crc64(UINT64 Crc, const UINT8 *p, UINTN Len)
+{
+    UINT64 v;
+
+    Crc = ~Crc;
+    while (Len >= 8) {
+        __builtin_memcpy(&v, p, sizeof(v));
+        v ^= Crc;
+        Crc = Crc64Table[7][v & 0xFF] ^ Crc64Table[6][(v >> 8) & 0xFF] ^
+              Crc64Table[5][(v >> 16) & 0xFF] ^ Crc64Table[4][(v >> 24) & 0xFF] ^
+              Crc64Table[3][(v >> 32) & 0xFF] ^ Crc64Table[2][(v >> 40) & 0xFF] ^
+              Crc64Table[1][(v >> 48) & 0xFF] ^ Crc64Table[0][v >> 56];
+        p += 8;
+        Len -= 8;
+    }
+    while (Len--)
+        Crc = Crc64Table[0][(Crc ^ *p++) & 0xFF] ^ (Crc >> 8);
+    return ~Crc;
+}
+
+static inline __attribute__((always_inline)) void
+copy8(UINT8 *out, const UINT8 *src)
+{
+    UINT64 w;
+
+    __builtin_memcpy(&w, src, sizeof(w));
+    __builtin_memcpy(out, &w, sizeof(w));
+}
+
+/* Size of the check field, by check type. */
+static UINTN
+xz_check_size(UINTN Check)
+{
+    if (Check == XZ_CHECK_NONE)
+        return 0;
+    return 4U << ((Check - 1) / 3);
+}
+
+/*
+ * Range decoder primitives. Each bit takes at most one input byte, and a
+ * symbol at most 48 bits, so a chunk padded with LZMA_IN_MARGIN bytes can
+ * be decoded without a bounds check on every byte.
+ */
+static inline VOID
+rc_normalize(struct rc *rc)
+{
+    if (rc->Range < RC_TOP) {
+        rc->Range <<= 8;
+        rc->Code = (rc->Code << 8) | *rc->In++;
+    }
+}
+
+static inline UINT32
+rc_bit(struct rc *rc, UINT16 *Prob)
+{
+    UINT32 Bound;
+
+    rc_normalize(rc);
+    Bound = (rc->Range >> RC_MODEL_BITS) * *Prob;
+    if (rc->Code < Bound) {
+        rc->Range = Bound;
+        *Prob += (RC_MODEL_TOTAL - *Prob) >> RC_MOVE_BITS;
+        return 0;
+    }
+    rc->Range -= Bound;
+    rc->Code -= Bound;
+    *Prob -= *Prob >> RC_MOVE_BITS;
+    return 1;
+}
+
+/* A Bits-bit symbol coded most significant bit first with a bit tree. */
+static inline UINT32
+rc_tree(struct rc *rc, UINT16 *Probs, UINTN Bits)
+{
+    UINT32 Symbol = 1;
+
+    do {
+        Symbol = (Symbol << 1) | rc_bit(rc, &Probs[Symbol]);
+    } while (Symbol < (1U << Bits));
+
+    return Symbol - (1U << Bits);
+}
+
+/* The same, least significant bit first. */
+static inline UINT32
+rc_reverse(struct rc *rc, UINT16 *Probs, UINTN Bits)
+{
+    UINT32 Symbol = 1, Value = 0, Bit;
+    UINTN i;
+
+    for (i = 0; i < Bits; i++) {
+        Bit = rc_bit(rc, &Probs[Symbol]);
+        Symbol = (Symbol << 1) | Bit;
+        Value |= Bit << i;
+    }
+
+    return Value;
+}
+
+/* Bits with a fixed probability of one half. */
+static inline UINT32
+rc_direct(struct rc *rc, UINTN Bits)
+{
+    UINT32 Value = 0, Mask;
+
+    do {
+        rc_normalize(rc);
+        rc->Range >>= 1;
+        rc->Code -= rc->Range;
+        Mask = 0U - (rc->Code >> 31);
+        rc->Code += rc->Range & Mask;
+        Value = (Value << 1) + Mask + 1;
+    } while (--Bits);
+
+    return Value;
+}
+
+static inline UINTN
+lzma_len(struct rc *rc, struct lzma_len *l, UINTN PosState)
+{
+    if (!rc_bit(rc, &l->Choice))
+        return LZMA_MATCH_LEN_MIN + rc_tree(rc, l->Low[PosState], LZMA_LEN_LOW_BITS);
+    if (!rc_bit(rc, &l->Choice2))
+        return LZMA_MATCH_LEN_MIN + LZMA_LEN_LOW_SYMBOLS +
+            rc_tree(rc, l->Mid[PosState], LZMA_LEN_MID_BITS);
+    return LZMA_MATCH_LEN_MIN + LZMA_LEN_LOW_SYMBOLS + LZMA_LEN_MID_SYMBOLS +
+        rc_tree(rc, l->High, LZMA_LEN_HIGH_BITS);
+}
+
+/* The distance of a new match, less one, from its slot and extra bits. */
+static inline UINT32
+lzma_dist(struct rc *rc, struct lzma_probs *P, UINTN Len)
+{
+    UINT32 Slot, Bits, Dist;
+
+    Len -= LZMA_MATCH_LEN_MIN;
+    Slot = rc_tree(rc, P->DistSlot[Len < LZMA_DIST_STATES ? Len : LZMA_DIST_STATES - 1], LZMA_DIST_SLOT_BITS);
+    if (Slot < LZMA_DIST_MODEL_START)
+        return Slot;
+
+    Bits = (Slot >> 1) - 1;
+    Dist = (2 | (Slot & 1)) << Bits;
+    if (Slot < LZMA_DIST_MODEL_END)
+        return Dist + rc_reverse(rc, P->DistSpecial + Dist - Slot - 1, Bits);
+
+    Dist += rc_direct(rc, Bits - LZMA_ALIGN_BITS) << LZMA_ALIGN_BITS;
+    return Dist + rc_reverse(rc, P->DistAlign, LZMA_ALIGN_BITS);
+}
+
+/* Reset the coder state and every probability the properties use. */
+static VOID
+lzma_reset(struct xz_ctx *x)
+{
+    UINT16 *p = (UINT16 *)&x->P;
+    UINTN i, n;
+
+    n = (UINTN)(x->P.Literal[0] - p) + ((UINTN)LZMA_LITERAL_SIZE << (x->Lc + x->Lp));
+    for (i = 0; i < n; i++)
+        p[i] = RC_MODEL_TOTAL / 2;
+
+    x->State = 0;
+    x->Rep[0] = x->Rep[1] = x->Rep[2] = x->Rep[3] = 0;
+}
+
+/*
+ * Decode one LZMA chunk of InLen bytes at In, padded by LZMA_IN_MARGIN,
+ * until the output reaches Limit. Matches may be copied in 8-byte pieces
+ * up to OutEnd. The coder state is kept in locals and written back at the
+ * end, as the chunk always ends on a symbol boundary.
+ */
+static EFI_STATUS
+lzma_chunk(struct xz_ctx *x, const UINT8 *In, UINTN InLen, UINT8 **OutPos, UINT8 *Limit, UINT8 *OutEnd)
+{
+    struct lzma_probs *P = &x->P;
+    const UINT8 *InEnd = In + InLen;
+    UINT8 *dict = x->DictStart;
+    UINT8 *out = *OutPos;
+    UINT8 *end;
+    const UINT8 *p;
+    UINT16 *probs;
+    struct rc rc;
+    UINTN State = x->State;
+    UINTN PosMask = (1U << x->Pb) - 1;
+    UINTN LpMask = (1U << x->Lp) - 1;
+    UINTN Lc = x->Lc;
+    UINTN PosState, Len;
+    UINT32 Rep0 = x->Rep[0], Rep1 = x->Rep[1], Rep2 = x->Rep[2], Rep3 = x->Rep[3];
+    UINT32 Symbol, MatchByte, MatchBit, Offset, Dist, Bit;
+
+    if (InLen < 5 || In[0] != 0)
+        return EFI_COMPROMISED_DATA;
+    rc.Range = 0xFFFFFFFF;
+    rc.Code = XZ_GET32_BE(In + 1);
+    rc.In = In + 5;
+
+    while (out < Limit) {
+        if (rc.In > InEnd)
+            return EFI_COMPROMISED_DATA;
+
+        PosState = (UINTN)(out - dict) & PosMask;
+        if (!rc_bit(&rc, &P->IsMatch[State][PosState])) {
+            probs = P->Literal[((((UINTN)(out - dict)) & LpMask) << Lc) +
+                (out > dict ? out[-1] >> (8 - Lc) : 0)];
+            if (State < LZMA_LIT_STATES) {
+                Symbol = rc_tree(&rc, probs, 8);
+            } else {
+                // After a match, the byte at the last distance steers the coding.
+                if (Rep0 >= (UINTN)(out - dict))
+                    return EFI_COMPROMISED_DATA;
+                MatchByte = (UINT32)out[-(INTN)Rep0 - 1] << 1;
+                Offset = 0x100;
+                Symbol = 1;
+                do {
+                    MatchBit = MatchByte & Offset;
+                    MatchByte <<= 1;
+                    Bit = rc_bit(&rc, &probs[Offset + MatchBit + Symbol]);
+                    Symbol = (Symbol << 1) | Bit;
+                    Offset &= MatchBit ^ (Bit - 1U);
+                } while (Symbol < 0x100);
+            }
+            *out++ = (UINT8)Symbol;
+            State = State < 4 ? 0 : State < 10 ? State - 3 : State - 6;
+            continue;
+        }
+
+        if (!rc_bit(&rc, &P->IsRep[State])) {
+            Len = lzma_len(&rc, &P->MatchLen, PosState);
+            Dist = lzma_dist(&rc, P, Len);
+            Rep3 = Rep2;
+            Rep2 = Rep1;
+            Rep1 = Rep0;
+            Rep0 = Dist;
+            State = State < LZMA_LIT_STATES ? 7 : 10;
+        } else {
+            if (!rc_bit(&rc, &P->IsRep0[State])) {
+                if (!rc_bit(&rc, &P->IsRep0Long[State][PosState])) {
+                    // A single byte from the last distance.
+                    if (Rep0 >= (UINTN)(out - dict))
+                        return EFI_COMPROMISED_DATA;
+                    *out = out[-(INTN)Rep0 - 1];
+                    out++;
+                    State = State < LZMA_LIT_STATES ? 9 : 11;
+                    continue;
+                }
+            } else {
+                if (!rc_bit(&rc, &P->IsRep1[State])) {
+                    Dist = Rep1;
+                } else {
+                    if (!rc_bit(&rc, &P->IsRep2[State])) {
+                        Dist = Rep2;
+                    } else {
+                        Dist = Rep3;
+                        Rep3 = Rep2;
+                    }
+                    Rep2 = Rep1;
+                }
+                Rep1 = Rep0;
+                Rep0 = Dist;
+            }
+            Len = lzma_len(&rc, &P->RepLen, PosState);
+            State = State < LZMA_LIT_STATES ? 8 : 11;
+        }
+
+        if (Rep0 >= (UINTN)(out - dict) || Len > (UINTN)(Limit - out))
+            return EFI_COMPROMISED_DATA;
+
+        p = out - Rep0 - 1;
+        end = out + Len;
+        if (Rep0 >= 7 && (UINTN)(OutEnd - end) >= 8) {
+            do {
+                copy8(out, p);
+                out += 8;
+                p += 8;
+            } while (out < end);
+            out = end;
+        } else {
+            do {
+                *out++ = *p++;
+            } while (out < end);
+        }
+    }
+
+    // The chunk must use up its input exactly, leaving the coder flushed.
+    rc_normalize(&rc);
+    if (rc.In != InEnd || rc.Code != 0)
+        return EFI_COMPROMISED_DATA;
+
+    x->State = State;
+    x->Rep[0] = Rep0;
+    x->Rep[1] = Rep1;
+    x->Rep[2] = Rep2;
+    x->Rep[3] = Rep3;
+    *OutPos = out;
+    return EFI_SUCCESS;
+}
+
+/* Get the next piece of input. */
+static EFI_STATUS
+xz_next(struct xz_input *s)
+{
+    EFI_STATUS Status;
+
+    Status = s->Input(s->Context, &s->Piece, &s->Left);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (s->Left == 0)
+        return EFI_END_OF_FILE;
+    s->Fed += s->Left;
+    return EFI_SUCCESS;
+}
+
+/* Copy the next Len bytes of input to Buf. */
+static EFI_STATUS
+xz_read(struct xz_input *s, VOID *Buf, UINTN Len)
+{
+    UINT8 *p = Buf;
+    UINTN n;
+    EFI_STATUS Status;
+
+    while (Len > 0) {
+        if (s->Left == 0) {
+            Status = xz_next(s);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+        n = Len < s->Left ? Len : s->Left;
+        CopyMem(p, s->Piece, n);
+        p += n;
+        s->Piece += n;
+        s->Left -= n;
+        Len -= n;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/* Bytes of input used so far. */
+static inline UINT64
+xz_pos(struct xz_input *s)
+{
+    return s->Fed - s->Left;
+}
+
+/* Read a variable length integer from a buffer. */
+static EFI_STATUS
+xz_vli(const UINT8 *p, UINTN Len, UINT64 *Value, UINTN *Used)
+{
+    UINT64 v = 0;
+    UINTN i;
+
+    for (i = 0; i < Len && i < XZ_VLI_BYTES_MAX; i++) {
+        v |= (UINT64)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            // The shortest encoding only.
+            if (i > 0 && p[i] == 0)
+                return EFI_COMPROMISED_DATA;
+            *Value = v;
+            *Used = i + 1;
+            return EFI_SUCCESS;
+        }
+    }
+
+    return EFI_COMPROMISED_DATA;
+}
+
+/* Read a variable length integer from the input, summing it into *Crc. */
+static EFI_STATUS
+xz_read_vli(struct xz_input *s, UINT64 *Value, UINT32 *Crc)
+{
+    EFI_STATUS Status;
+    UINT8 Buf[XZ_VLI_BYTES_MAX];
+    UINTN i, Used;
+
+    for (i = 0; i < XZ_VLI_BYTES_MAX; i++) {
+        Status = xz_read(s, &Buf[i], 1);
+        if (EFI_ERROR(Status))
+            return Status;
+        if (!(Buf[i] & 0x80))
+            break;
+    }
+    if (i == XZ_VLI_BYTES_MAX)
+        return EFI_COMPROMISED_DATA;
+
+    *Crc = crc32(*Crc, Buf, i + 1);
+    return xz_vli(Buf, i + 1, Value, &Used);
+}
+
+/*
+ * Decode LZMA2 chunks into *OutPos until the end marker. The compressed
+ * chunks are gathered into x->Chunk, stored ones copied straight out.
+ */
+static EFI_STATUS
+xz_lzma2(struct xz_ctx *x, struct xz_input *s, inflate_progress_fn Progress,
+    UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos)
+{
+    EFI_STATUS Status;
+    UINT8 Hdr[5];
+    UINT8 *out = *OutPos;
+    UINTN Control, Unpacked, Packed, Props;
+
+    x->NeedDictReset = TRUE;
+    x->NeedProps = TRUE;
+
+    for (;;) {
+        Status = xz_read(s, Hdr, 1);
+        if (EFI_ERROR(Status))
+            return Status;
+        Control = Hdr[0];
+        if (Control == 0x00)
+            break;
+
+        if (Control >= 0xE0 || Control == 0x01) {
+            x->DictStart = out;
+            x->NeedDictReset = FALSE;
+            x->NeedProps = TRUE;
+        } else if (x->NeedDictReset) {
+            return EFI_COMPROMISED_DATA;
+        }
+
+        if (Control < 0x80) {
+            // A stored chunk.
+            if (Control > 0x02)
+                return EFI_COMPROMISED_DATA;
+            Status = xz_read(s, Hdr, 2);
+            if (EFI_ERROR(Status))
+                return Status;
+            Unpacked = (((UINTN)Hdr[0] << 8) | Hdr[1]) + 1;
+            if (Unpacked > (UINTN)(OutEnd - out))
+                return EFI_COMPROMISED_DATA;
+            Status = xz_read(s, out, Unpacked);
+            if (EFI_ERROR(Status))
+                return Status;
+            out += Unpacked;
+        } else {
+            Status = xz_read(s, Hdr, Control >= 0xC0 ? 5 : 4);
+            if (EFI_ERROR(Status))
+                return Status;
+            Unpacked = (((Control & 0x1F) << 16) | ((UINTN)Hdr[0] << 8) | Hdr[1]) + 1;
+            Packed = (((UINTN)Hdr[2] << 8) | Hdr[3]) + 1;
+
+            if (Control >= 0xC0) {
+                Props = Hdr[4];
+                if (Props >= LZMA_PROPS_MAX)
+                    return EFI_COMPROMISED_DATA;
+                x->Lc = (UINT8)(Props % 9);
+                Props /= 9;
+                x->Lp = (UINT8)(Props % 5);
+                x->Pb = (UINT8)(Props / 5);
+                if (x->Lc + x->Lp > LZMA_LC_LP_MAX)
+                    return EFI_COMPROMISED_DATA;
+                x->NeedProps = FALSE;
+                lzma_reset(x);
+            } else if (x->NeedProps) {
+                return EFI_COMPROMISED_DATA;
+            } else if (Control >= 0xA0) {
+                lzma_reset(x);
+            }
+
+            if (Unpacked > (UINTN)(OutEnd - out))
+                return EFI_COMPROMISED_DATA;
+            Status = xz_read(s, x->Chunk, Packed);
+            if (EFI_ERROR(Status))
+                return Status;
+            Status = lzma_chunk(x, x->Chunk, Packed, &out, out + Unpacked, OutEnd);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+
+        *OutPos = out;
+        if (Progress)
+            Progress(s->Context, (UINTN)(out - Out));
+    }
+
+    *OutPos = out;
+    return EFI_SUCCESS;
+}
+
+#if defined(XZ_FILTER_BCJ) && XZ_FILTER_BCJ == XZ_FILTER_X86
+static inline BOOLEAN
+x86_msbyte(UINT8 b)
+{
+    return b == 0x00 || b == 0xFF;
+}
+
+/*
+ * Undo the x86 BCJ filter: the 32-bit operands of CALL (E8) and JMP (E9)
+ * were turned from relative to absolute, where they look like addresses
+ * near the image, unless a recent E8/E9 byte makes that doubtful.
+ */
+static VOID
+xz_bcj(UINT8 *Buf, UINTN Size, UINT32 Pos)
+{
+    static const BOOLEAN MaskAllowed[8] = { TRUE, TRUE, TRUE, FALSE, TRUE, FALSE, FALSE, FALSE };
+    static const UINT8 MaskBit[8] = { 0, 1, 2, 2, 3, 3, 3, 3 };
+    UINTN i, PrevPos = (UINTN)-1;
+    UINT32 PrevMask = 0, Src, Dest, j;
+    UINT8 b;
+
+    if (Size <= 4)
+        return;
+    Size -= 4;
+
+    for (i = 0; i < Size; i++) {
+        if ((Buf[i] & 0xFE) != 0xE8)
+            continue;
+
+        PrevPos = i - PrevPos;
+        if (PrevPos > 3) {
+            PrevMask = 0;
+        } else {
+            PrevMask = (PrevMask << (PrevPos - 1)) & 7;
+            if (PrevMask != 0) {
+                b = Buf[i + 4 - MaskBit[PrevMask]];
+                if (!MaskAllowed[PrevMask] || x86_msbyte(b)) {
+                    PrevPos = i;
+                    PrevMask = (PrevMask << 1) | 1;
+                    continue;
+                }
+            }
+        }
+        PrevPos = i;
+
+        if (!x86_msbyte(Buf[i + 4])) {
+            PrevMask = (PrevMask << 1) | 1;
+            continue;
+        }
+
+        Src = XZ_GET32(Buf + i + 1);
+        for (;;) {
+            Dest = Src - (Pos + (UINT32)i + 5);
+            if (PrevMask == 0)
+                break;
+            j = MaskBit[PrevMask] * 8;
+            b = (UINT8)(Dest >> (24 - j));
+            if (!x86_msbyte(b))
+                break;
+            Src = Dest ^ ((1U << (32 - j)) - 1);
+        }
+        Dest &= 0x01FFFFFF;
+        Dest |= 0U - (Dest & 0x01000000);
+        Buf[i + 1] = (UINT8)Dest;
+        Buf[i + 2] = (UINT8)(Dest >> 8);
+        Buf[i + 3] = (UINT8)(Dest >> 16);
+        Buf[i + 4] = (UINT8)(Dest >> 24);
+        i += 4;
+    }
+}
+#elif defined(XZ_FILTER_BCJ) && XZ_FILTER_BCJ == XZ_FILTER_ARM64
+/*
+ * Undo the ARM64 BCJ filter: the targets of BL, and of ADRP when they
+ * are within 512MB, were turned from relative to absolute.
+ */
+static VOID
+xz_bcj(UINT8 *Buf, UINTN Size, UINT32 Pos)
+{
+    UINTN i;
+    UINT32 Instr, Addr;
+
+    Size &= ~(UINTN)3;
+    for (i = 0; i < Size; i += 4) {
+        Instr = XZ_GET32(Buf + i);
+        if ((Instr >> 26) == 0x25) {
+            Addr = Instr - ((Pos + (UINT32)i) >> 2);
+            Instr = 0x94000000 | (Addr & 0x03FFFFFF);
+        } else if ((Instr & 0x9F000000) == 0x90000000) {
+            Addr = ((Instr >> 29) & 3) | ((Instr >> 3) & 0x1FFFFC);
+            if ((Addr + 0x020000) & 0x1C0000)
+                continue;
+            Addr -= (Pos + (UINT32)i) >> 12;
+            Instr &= 0x9000001F;
+            Instr |= (Addr & 3) << 29;
+            Instr |= (Addr & 0x03FFFC) << 3;
+            Instr |= (0U - (Addr & 0x020000)) & 0xE00000;
+        } else {
+            continue;
+        }
+        Buf[i] = (UINT8)Instr;
+        Buf[i + 1] = (UINT8)(Instr >> 8);
+        Buf[i + 2] = (UINT8)(Instr >> 16);
+        Buf[i + 3] = (UINT8)(Instr >> 24);
+    }
+}
+#elif defined(XZ_FILTER_BCJ) && XZ_FILTER_BCJ == XZ_FILTER_RISCV
+static inline VOID
+put32(UINT8 *p, UINT32 v)
+{
+    p[0] = (UINT8)v;
+    p[1] = (UINT8)(v >> 8);
+    p[2] = (UINT8)(v >> 16);
+    p[3] = (UINT8)(v >> 24);
+}
+
+/*
+ * Undo the RISC-V BCJ filter: the targets of JAL, and of AUIPC paired
+ * with the instruction that uses its register, were made absolute; the
+ * encoder rewrote the pairs so that they are told from look-alikes.
+ */
+static VOID
+xz_bcj(UINT8 *Buf, UINTN Size, UINT32 Pos)
+{
+    UINTN i;
+    UINT32 Instr, Instr2, Addr, Rs1, b1, b2, b3;
+
+    if (Size < 8)
+        return;
+    Size -= 8;
+
+    for (i = 0; i <= Size; i += 2) {
+        Instr = Buf[i];
+        if (Instr == 0xEF) {
+            // JAL
+            b1 = Buf[i + 1];
+            if ((b1 & 0x0D) != 0)
+                continue;
+            b2 = Buf[i + 2];
+            b3 = Buf[i + 3];
+            Addr = ((b1 & 0xF0) << 13) | (b2 << 9) | (b3 << 1);
+            Addr -= Pos + (UINT32)i;
+            Buf[i + 1] = (UINT8)((b1 & 0x0F) | ((Addr >> 8) & 0xF0));
+            Buf[i + 2] = (UINT8)(((Addr >> 16) & 0x0F) | ((Addr >> 7) & 0x10) | ((Addr << 4) & 0xE0));
+            Buf[i + 3] = (UINT8)(((Addr >> 4) & 0x7F) | ((Addr >> 13) & 0x80));
+            i += 4 - 2;
+        } else if ((Instr & 0x7F) == 0x17) {
+            // AUIPC
+            Instr = XZ_GET32(Buf + i);
+            if (Instr & 0xE80) {
+                // rd is not x0 or x2: a pair the encoder did not convert.
+                Instr2 = XZ_GET32(Buf + i + 4);
+                if (((Instr << 8) ^ (Instr2 - 3)) & 0xF8003) {
+                    i += 6 - 2;
+                    continue;
+                }
+                Addr = (Instr & 0xFFFFF000) + (Instr2 >> 20);
+                Instr = 0x17 | (2 << 7) | (Instr2 << 12);
+                Instr2 = Addr;
+            } else {
+                // rd is x0 or x2: a converted pair, or a real one to leave.
+                Rs1 = Instr >> 27;
+                if ((UINT32)((Instr - 0x3117) << 18) >= (Rs1 & 0x1D)) {
+                    i += 4 - 2;
+                    continue;
+                }
+                Addr = XZ_GET32_BE(Buf + i + 4);
+                Addr -= Pos + (UINT32)i;
+                Instr2 = (Instr >> 12) | (Addr << 20);
+                Instr = 0x17 | (Rs1 << 7) | ((Addr + 0x800) & 0xFFFFF000);
+            }
+            put32(Buf + i, Instr);
+            put32(Buf + i + 4, Instr2);
+            i += 8 - 2;
+        }
+    }
+}
+#endif
+
+/*
+ * Read a block header, whose first byte (its size) has been read, and
+ * get the filter chain: LZMA2, behind the build's BCJ filter or alone.
+ */
+static EFI_STATUS
+xz_block_header(struct xz_input *s, UINT8 SizeByte, UINTN *HeaderSize, BOOLEAN *Bcj,
+    UINT32 *BcjStart, UINT64 *Compressed, UINT64 *Uncompressed)
+{
+    EFI_STATUS Status;
+    UINT8 Hdr[XZ_BLOCK_HEADER_MAX];
+    UINTN Size, Pos, Used, Filters, i;
+    UINT64 Id, PropSize;
+    UINT8 Flags;
+
+    Size = ((UINTN)SizeByte + 1) * 4;
+    Hdr[0] = SizeByte;
+    Status = xz_read(s, Hdr + 1, Size - 1);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (crc32(0, Hdr, Size - 4) != XZ_GET32(Hdr + Size - 4))
+        return EFI_CRC_ERROR;
+
+    Flags = Hdr[1];
+    if (Flags & XZ_BLOCK_RESERVED)
+        return EFI_UNSUPPORTED;
+    Filters = (Flags & XZ_BLOCK_FILTERS_MASK) + 1;
+    Pos = 2;
+    Size -= 4;
+
+    *Compressed = XZ_VLI_UNKNOWN;
+    *Uncompressed = XZ_VLI_UNKNOWN;
+    if (Flags & XZ_BLOCK_COMPRESSED) {
+        Status = xz_vli(Hdr + Pos, Size - Pos, Compressed, &Used);
+        if (EFI_ERROR(Status) || *Compressed == 0)
+            return EFI_COMPROMISED_DATA;
+        Pos += Used;
+    }
+    if (Flags & XZ_BLOCK_UNCOMPRESSED) {
+        Status = xz_vli(Hdr + Pos, Size - Pos, Uncompressed, &Used);
+        if (EFI_ERROR(Status))
+            return Status;
+        Pos += Used;
+    }
+
+    *Bcj = FALSE;
+    *BcjStart = 0;
+    if (Filters > 2)
+        return EFI_UNSUPPORTED;
+    for (i = 0; i < Filters; i++) {
+        Status = xz_vli(Hdr + Pos, Size - Pos, &Id, &Used);
+        if (EFI_ERROR(Status))
+            return Status;
+        Pos += Used;
+        Status = xz_vli(Hdr + Pos, Size - Pos, &PropSize, &Used);
+        if (EFI_ERROR(Status))
+            return Status;
+        Pos += Used;
+        if (PropSize > Size - Pos)
+            return EFI_COMPROMISED_DATA;
+
+        if (i + 1 < Filters) {
+#ifdef XZ_FILTER_BCJ
+            if (Id != XZ_FILTER_BCJ)
+                return EFI_UNSUPPORTED;
+            if (PropSize == 4)
+                *BcjStart = XZ_GET32(Hdr + Pos);
+            else if (PropSize != 0)
+                return EFI_UNSUPPORTED;
+            *Bcj = TRUE;
+#else
+            return EFI_UNSUPPORTED;
+#endif
+        } else {
+            // The dictionary size is not needed: the output is the dictionary.
+            if (Id != XZ_FILTER_LZMA2)
+                return EFI_UNSUPPORTED;
+            if (PropSize != 1 || Hdr[Pos] > LZMA2_DICT_MAX_BITS)
+                return EFI_COMPROMISED_DATA;
+        }
+        Pos += (UINTN)PropSize;
+    }
+
+    // Header padding.
+    for (; Pos < Size; Pos++)
+        if (Hdr[Pos] != 0)
+            return EFI_COMPROMISED_DATA;
+
+    *HeaderSize = Size + 4;
+    return EFI_SUCCESS;
+}
+
+/* Verify a block's check field against its decoded data. */
+static EFI_STATUS
+xz_check(struct xz_input *s, UINTN Check, const UINT8 *Data, UINTN Len)
+{
+    EFI_STATUS Status;
+    UINT8 Field[64];
+    UINT32 Crc;
+    UINT64 Crc64;
+    UINTN Size = xz_check_size(Check);
+
+    Status = xz_read(s, Field, Size);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    switch (Check) {
+    case XZ_CHECK_CRC32:
+        Crc = 0;
+        if (Len > 0) {
+            Status = uefi_call_wrapper(gBS->CalculateCrc32, 3, (VOID *)Data, Len, &Crc);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+        if (Crc != XZ_GET32(Field))
+            return EFI_CRC_ERROR;
+        break;
+    case XZ_CHECK_CRC64:
+        Crc64 = crc64(0, Data, Len);
+        if ((UINT32)Crc64 != XZ_GET32(Field) || (UINT32)(Crc64 >> 32) != XZ_GET32(Field + 4))
+            return EFI_CRC_ERROR;
+        break;
+    default:
+        break;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/* Decode one block, whose header size byte has been read. */
+static EFI_STATUS
+xz_block(struct xz_ctx *x, struct xz_input *s, UINT8 SizeByte, UINTN Check, inflate_progress_fn Progress,
+    UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos, struct xz_totals *t)
+{
+    EFI_STATUS Status;
+    UINT8 Pad[4];
+    UINT8 *BlockStart = *OutPos;
+    UINTN HeaderSize, DataLen, i;
+    UINT64 Start, Compressed, Uncompressed, Used;
+    UINT32 BcjStart;
+    BOOLEAN Bcj;
+
+    Start = xz_pos(s) - 1;
+    Status = xz_block_header(s, SizeByte, &HeaderSize, &Bcj, &BcjStart, &Compressed, &Uncompressed);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (Uncompressed != XZ_VLI_UNKNOWN && Uncompressed > (UINT64)(OutEnd - BlockStart))
+        return EFI_COMPROMISED_DATA;
+
+    Status = xz_lzma2(x, s, Progress, Out, OutEnd, OutPos);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    DataLen = (UINTN)(*OutPos - BlockStart);
+    Used = xz_pos(s) - Start - HeaderSize;
+    if ((Compressed != XZ_VLI_UNKNOWN && Used != Compressed) ||
+        (Uncompressed != XZ_VLI_UNKNOWN && DataLen != Uncompressed))
+        return EFI_COMPROMISED_DATA;
+
+    // Block padding, to a multiple of four bytes.
+    i = (UINTN)((4 - ((HeaderSize + Used) & 3)) & 3);
+    if (i > 0) {
+        Status = xz_read(s, Pad, i);
+        if (EFI_ERROR(Status))
+            return Status;
+        while (i > 0)
+            if (Pad[--i] != 0)
+                return EFI_COMPROMISED_DATA;
+    }
+
+#ifdef XZ_FILTER_BCJ
+    if (Bcj)
+        xz_bcj(BlockStart, DataLen, BcjStart);
+#endif
+
+    Status = xz_check(s, Check, BlockStart, DataLen);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    t->Blocks++;
+    t->Unpadded += HeaderSize + Used + xz_check_size(Check);
+    t->Uncompressed += DataLen;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read the index, whose indicator byte has been read, and check it
+ * against the blocks, then the footer.
+ */
+static EFI_STATUS
+xz_index(struct xz_input *s, const UINT8 *Flags, const struct xz_totals *t)
+{
+    EFI_STATUS Status;
+    UINT8 Buf[XZ_FOOTER_SIZE];
+    struct xz_totals Listed = { 0, 0, 0 };
+    UINT32 Crc;
+    UINT64 Count, Unpadded, Uncompressed, Start, Size, i;
+    UINTN Pad;
+
+    Start = xz_pos(s) - 1;
+    Buf[0] = 0;
+    Crc = crc32(0, Buf, 1);
+
+    Status = xz_read_vli(s, &Count, &Crc);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (Count != t->Blocks)
+        return EFI_COMPROMISED_DATA;
+    for (i = 0; i < Count; i++) {
+        Status = xz_read_vli(s, &Unpadded, &Crc);
+        if (EFI_ERROR(Status))
+            return Status;
+        Status = xz_read_vli(s, &Uncompressed, &Crc);
+        if (EFI_ERROR(Status))
+            return Status;
+        Listed.Unpadded += Unpadded;
+        Listed.Uncompressed += Uncompressed;
+    }
+    if (Listed.Unpadded != t->Unpadded || Listed.Uncompressed != t->Uncompressed)
+        return EFI_COMPROMISED_DATA;
+
+    // Index padding, then its CRC32.
+    Pad = (UINTN)((4 - ((xz_pos(s) - Start) & 3)) & 3);
+    Status = xz_read(s, Buf, Pad + 4);
+    if (EFI_ERROR(Status))
+        return Status;
+    Crc = crc32(Crc, Buf, Pad);
+    for (i = 0; i < Pad; i++)
+        if (Buf[i] != 0)
+            return EFI_COMPROMISED_DATA;
+    if (Crc != XZ_GET32(Buf + Pad))
+        return EFI_CRC_ERROR;
+    Size = xz_pos(s) - Start;
+
+    // The footer repeats the stream flags and gives the index size.
+    Status = xz_read(s, Buf, XZ_FOOTER_SIZE);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (Buf[10] != XzFooterMagic[0] || Buf[11] != XzFooterMagic[1])
+        return EFI_COMPROMISED_DATA;
+    if (crc32(0, Buf + 4, 6) != XZ_GET32(Buf))
+        return EFI_CRC_ERROR;
+    if (Buf[8] != Flags[0] || Buf[9] != Flags[1])
+        return EFI_COMPROMISED_DATA;
+    if (((UINT64)XZ_GET32(Buf + 4) + 1) * 4 != Size)
+        return EFI_COMPROMISED_DATA;
+
+    return EFI_SUCCESS;
+}
+
+/* Decode one stream, whose magic has been read. */
+static EFI_STATUS
+xz_stream(struct xz_ctx *x, struct xz_input *s, inflate_progress_fn Progress,
+    UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos)
+{
+    EFI_STATUS Status;
+    struct xz_totals t = { 0, 0, 0 };
+    UINT8 Hdr[XZ_HEADER_SIZE - sizeof(XzMagic)];
+    UINT8 SizeByte;
+    UINTN Check;
+
+    Status = xz_read(s, Hdr, sizeof(Hdr));
+    if (EFI_ERROR(Status))
+        return Status;
+    if (crc32(0, Hdr, 2) != XZ_GET32(Hdr + 2))
+        return EFI_CRC_ERROR;
+    if (Hdr[0] != 0 || Hdr[1] > XZ_CHECK_MAX)
+        return EFI_UNSUPPORTED;
+    Check = Hdr[1];
+
+    for (;;) {
+        Status = xz_read(s, &SizeByte, 1);
+        if (EFI_ERROR(Status))
+            return Status;
+        if (SizeByte == 0)
+            return xz_index(s, Hdr, &t);
+
+        Status = xz_block(x, s, SizeByte, Check, Progress, Out, OutEnd, OutPos, &t);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+}
+
+/* The decoder state is large; keep one around rather than allocate per call. */
+static struct xz_ctx *
+xz_get_ctx(VOID)
+{
+    struct xz_ctx *x;
+
+    if (CachedCtx && !CachedCtx->Busy) {
+        x = CachedCtx;
+    } else {
+        x = AllocatePool(sizeof(*x));
+        if (!x)
+            return NULL;
+        if (!CachedCtx)
+            CachedCtx = x;
+    }
+    x->Busy = TRUE;
+    return x;
+}
+
+static VOID
+xz_put_ctx(struct xz_ctx *x)
+{
+    x->Busy = FALSE;
+    if (x != CachedCtx)
+        FreePool(x);
+}
+
+BOOLEAN
+IsXz(const VOID *Header)
+{
+    return CompareMem((VOID *)Header, (VOID *)XzMagic, sizeof(XzMagic)) == 0;
+}
+
+/*
+ * XzStream: decode the xz streams whose input arrives in pieces from
+ * Input, one after another into one contiguous buffer. Stream padding
+ * between and after them is skipped. The streams end with the input, or
+ * at anything that is neither padding nor another stream.
+ */
+EFI_STATUS
+XzStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct xz_input s;
+    struct xz_ctx *x;
+    EFI_STATUS Status;
+    UINT8 Word[sizeof(XzMagic)];
+    UINT8 *OutPos = Out;
+    UINTN Streams = 0;
+
+    if (!Input || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    x = xz_get_ctx();
+    if (!x)
+        return EFI_OUT_OF_RESOURCES;
+    crc_init();
+
+    s.Input = Input;
+    s.Context = Context;
+    s.Piece = NULL;
+    s.Left = 0;
+    s.Fed = 0;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    for (;;) {
+        if (s.Left == 0 && Streams > 0) {
+            Status = xz_next(&s);
+            if (Status == EFI_END_OF_FILE) {
+                Status = EFI_SUCCESS;
+                break;
+            }
+            if (EFI_ERROR(Status))
+                break;
+        }
+
+        Status = xz_read(&s, Word, 4);
+        if (EFI_ERROR(Status))
+            break;
+        if (Streams > 0 && XZ_GET32(Word) == 0)
+            continue;
+
+        Status = xz_read(&s, Word + 4, 2);
+        if (EFI_ERROR(Status) && Status != EFI_END_OF_FILE)
+            break;
+        if (EFI_ERROR(Status) || !IsXz(Word)) {
+            Status = Streams == 0 ? EFI_UNSUPPORTED : EFI_SUCCESS;
+            break;
+        }
+
+        Status = xz_stream(x, &s, Progress, Out, (UINT8 *)Out + OutSize, &OutPos);
+        if (EFI_ERROR(Status))
+            break;
+        Streams++;
+    }
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+
+    xz_put_ctx(x);
+
+    *OutLen = (UINTN)(OutPos - (UINT8 *)Out);
+    BootCounterAdd(BOOT_CTR_XZ_IN, s.Fed - s.Left);
+    BootCounterAdd(BOOT_CTR_XZ_OUT, *OutLen);
+
+    // The input ending inside a stream means it was cut short.
+    if (Status == EFI_END_OF_FILE)
+        return EFI_COMPROMISED_DATA;
+    return Status;
+}
+
+struct xz_buffer {
+    const UINT8 *Buf;
+    UINTN Len;
+};
+
+/* inflate_input_fn: the whole buffer, then the end of the input. */
+static EFI_STATUS
+xz_buffer_input(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct xz_buffer *b = Context;
+
+    *Buf = (UINT8 *)b->Buf;
+    *Len = b->Len;
+    b->Len = 0;
+    return EFI_SUCCESS;
+}
+
+/*
+ * XzBuffer: decode xz streams that are all in memory. Also the
+ * decompress_fn for SquashFS, whose blocks are single streams.
+ */
+EFI_STATUS
+XzBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct xz_buffer b;
+
+    if (!In)
+        return EFI_INVALID_PARAMETER;
+
+    b.Buf = In;
+    b.Len = InLen;
+    return XzStream(xz_buffer_input, NULL, &b, Out, OutSize, OutLen);
+}
+
+/*
+ * XzDecodedBound: the decoded size of the xz streams in memory at In,
+ * from their indexes. Streams are walked from the end, as each one's
+ * footer locates its index and the index gives the size of its blocks.
+ */
+EFI_STATUS
+XzDecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound)
+{
+    const UINT8 *Start = In;
+    const UINT8 *p, *Index;
+    UINT64 Total = 0, Count, Unpadded, Uncompressed, Blocks, i;
+    UINTN End, IndexSize, Pos, Used;
+    EFI_STATUS Status;
+
+    if (!In || !Bound || InLen < sizeof(XzMagic))
+        return EFI_INVALID_PARAMETER;
+    if (!IsXz(In))
+        return EFI_UNSUPPORTED;
+
+    // Only whole streams and padding are accepted, so the end is 4-aligned.
+    End = InLen & ~(UINTN)3;
+    while (End > 0) {
+        if (XZ_GET32(Start + End - 4) == 0) {
+            End -= 4;
+            continue;
+        }
+        if (End < XZ_HEADER_SIZE + XZ_FOOTER_SIZE)
+            return EFI_COMPROMISED_DATA;
+
+        p = Start + End - XZ_FOOTER_SIZE;
+        if (p[10] != XzFooterMagic[0] || p[11] != XzFooterMagic[1])
+            return EFI_COMPROMISED_DATA;
+        IndexSize = ((UINTN)XZ_GET32(p + 4) + 1) * 4;
+        if (IndexSize > End - XZ_HEADER_SIZE - XZ_FOOTER_SIZE)
+            return EFI_COMPROMISED_DATA;
+
+        Index = p - IndexSize;
+        if (Index[0] != 0)
+            return EFI_COMPROMISED_DATA;
+        Pos = 1;
+        Status = xz_vli(Index + Pos, IndexSize - Pos, &Count, &Used);
+        if (EFI_ERROR(Status))
+            return Status;
+        Pos += Used;
+        Blocks = 0;
+        for (i = 0; i < Count; i++) {
+            Status = xz_vli(Index + Pos, IndexSize - Pos, &Unpadded, &Used);
+            if (EFI_ERROR(Status))
+                return Status;
+            Pos += Used;
+            Status = xz_vli(Index + Pos, IndexSize - Pos, &Uncompressed, &Used);
+            if (EFI_ERROR(Status))
+                return Status;
+            Pos += Used;
+            Blocks += (Unpadded + 3) & ~3ULL;
+            Total += Uncompressed;
+            if (Blocks > End)
+                return EFI_COMPROMISED_DATA;
+        }
+
+        // Back over the blocks and the stream header.
+        if (Blocks + XZ_HEADER_SIZE > (UINT64)(Index - Start))
+            return EFI_COMPROMISED_DATA;
+        End = (UINTN)(Index - Start) - (UINTN)Blocks - XZ_HEADER_SIZE;
+        if (!IsXz(Start + End))
+            return EFI_COMPROMISED_DATA;
+    }
+
+    *Bound = Total;
+    return EFI_SUCCESS;
+}
+
+/*
+ * XzInPlaceMargin: as Lz4InPlaceMargin(), for XzBuffer(). LZMA2 chunks are
+ * copied out to x->Chunk before they are decoded, so only the headers,
+ * checks and stored chunks' three bytes in 64K have to be allowed for.
+ * Block headers are the largest of those.
+ */
+UINTN
+XzInPlaceMargin(UINTN InLen)
+{
+    return (InLen >> 8) + XZ_BLOCK_HEADER_MAX + 256;
+}
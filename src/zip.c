@@ -46,53 +46,737 @@
 #include <efilib.h>
 
 #include "boot.h"
+#include "clock.h"
+#include "decompress.h"
+#include "inflate.h"
 #include "zip.h"
 
-#define RETRY_WARNING_COUNT 100
-#define INBUFSIZE   0x2000
+#define ZIP_GET16(p)    ((UINT16)((p)[0] | ((p)[1] << 8)))
+#define ZIP_GET32(p)    ((UINT32)(p)[0] | ((UINT32)(p)[1] << 8) | ((UINT32)(p)[2] << 16) | ((UINT32)(p)[3] << 24))
 
+/*
+ * Read the next piece of the transfer into the ring. The loader is single
+ * threaded, so the ring is only refilled once the consumer has drained
+ * part of it; a full ring is reported rather than waited on. Reads stop
+ * at the end of the ring and never exceed ZIP_INBUF_SIZE.
+ */
 EFI_STATUS
 ReadBlockToBuffer(struct ZipInfo *Zip, EFI_FILE_PROTOCOL *BootFile)
 {
     EFI_STATUS Status;
-    UINTN NumAttempts = 0;
+    UINTN Free, Wix, ReqLen, Len;
 
-    /*
-     * Wait while buffer is full.
-     */
-    while ((Zip->FileBufW - Zip->FileBufR) == Zip->FileBufSize) {
-        NumAttempts++;
+    Free = Zip->FileBufSize - (Zip->FileBufW - Zip->FileBufR);
+    if (Free == 0)
+        return EFI_BUFFER_TOO_SMALL;
 
-        if ((NumAttempts % RETRY_WARNING_COUNT) == 0)
-            Print(L"ZIP: ReadBlockToBuffer stuck waiting for buffer to empty (retry #%u)\r\n", NumAttempts);
-
-        gBS->Stall(20000);
-    }
-
-    /*
-     * Calculate read size.
-     */
-    UINTN ReqLen = MIN(Zip->Remain, INBUFSIZE);
-    UINTN Len = ReqLen;
+    if (Zip->Remain <= 0 || Zip->InputDone)
+        return EFI_END_OF_FILE;
 
     /*
      * Ring buffer write index (power-of-two mask).
      */
-    UINTN Wix = Zip->FileBufW & (Zip->FileBufSize - 1);
+    Wix = Zip->FileBufW & (Zip->FileBufSize - 1);
+    ReqLen = MIN(Free, Zip->FileBufSize - Wix);
+    ReqLen = MIN(ReqLen, Zip->InBufSize);
+    ReqLen = MIN(ReqLen, (UINTN)Zip->Remain);
+    Len = ReqLen;
 
     /*
-     * Read from input.
+     * Read from input. The last piece may come with EFI_END_OF_FILE.
      */
     Status = ReadInputData(Zip->FileBuf + Wix, &Len);
+    if (EFI_ERROR(Status) && Status != EFI_END_OF_FILE)
+        return Status;
 
     if (Len > ReqLen)
         Len = ReqLen;
 
-    if (!EFI_ERROR(Status)) {
-        ImageReadProgress += Len;
-        Zip->FileBufW += Len;
-        Zip->Remain -= Len;
+    ImageReadProgress += Len;
+    Zip->FileBufW += Len;
+    Zip->Remain -= Len;
+
+    if (Status == EFI_END_OF_FILE)
+        Zip->InputDone = TRUE;
+
+    if (Len == 0)
+        return EFI_END_OF_FILE;
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Make sure the ring holds at least one unread byte.
+ */
+static EFI_STATUS
+ZipFill(struct ZipInfo *Zip)
+{
+    EFI_STATUS Status;
+
+    while (Zip->FileBufW == Zip->FileBufR) {
+        Status = ReadBlockToBuffer(Zip, NULL);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Copy Len bytes out of the ring into Dest, or skip them if Dest is NULL.
+ * If Crc is given, the bytes copied are folded into it as they go.
+ */
+static EFI_STATUS
+ZipRingRead(struct ZipInfo *Zip, UINT8 *Dest, UINTN Len, UINT32 *Crc)
+{
+    EFI_STATUS Status;
+    UINTN Rix, n;
+
+    while (Len > 0) {
+        Status = ZipFill(Zip);
+        if (EFI_ERROR(Status))
+            return Status;
+
+        Rix = Zip->FileBufR & (Zip->FileBufSize - 1);
+        n = MIN(Len, Zip->FileBufW - Zip->FileBufR);
+        n = MIN(n, Zip->FileBufSize - Rix);
+        if (Dest) {
+            CopyMem(Dest, Zip->FileBuf + Rix, n);
+            if (Crc)
+                *Crc = Crc32(*Crc, Dest, n);
+            Dest += n;
+        }
+        Zip->FileBufR += n;
+        Len -= n;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * ZipReadLocalHeader()
+ *
+ * Description:
+ * Parse the local file header at the start of the transfer, leaving the
+ * ring positioned at the entry's data. The sizes must be in the header:
+ * the output buffer is sized from them before anything is inflated.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_UNSUPPORTED for entries we cannot stream,
+ * EFI_COMPROMISED_DATA for a bad header, or the input error.
+ */
+EFI_STATUS
+ZipReadLocalHeader(struct ZipInfo *Zip)
+{
+    EFI_STATUS Status;
+    UINT8 Hdr[LOCHDR];
+
+    Zip->ProcessedHeader = ZIP_HEADER_PROCESSING;
+
+    Status = ZipRingRead(Zip, Hdr, LOCHDR, NULL);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    if (ZIP_GET32(Hdr) != LOCSIG) {
+        Status = EFI_COMPROMISED_DATA;
+        goto fail;
+    }
+
+    Zip->Flags = ZIP_GET16(Hdr + LOCFLG);
+    Zip->CompressionMethod = ZIP_GET16(Hdr + LOCHOW);
+    Zip->Crc = ZIP_GET32(Hdr + LOCCRC);
+    Zip->CompressedSize = ZIP_GET32(Hdr + LOCSIZ);
+    Zip->UncompressedSize = ZIP_GET32(Hdr + LOCLEN);
+    Zip->FilenameLength = ZIP_GET16(Hdr + LOCFIL);
+    Zip->ExtraLength = ZIP_GET16(Hdr + LOCEXT);
+    Zip->NameOffset = LOCHDR;
+    Zip->DataOffset = LOCHDR + Zip->FilenameLength + Zip->ExtraLength;
+
+    // Encrypted entries, sizes deferred to a data descriptor and ZIP64
+    // entries all need information we do not have yet.
+    if ((Zip->Flags & (CRPFLG | EXTFLG)) || Zip->CompressedSize == 0xFFFFFFFF ||
+        Zip->UncompressedSize == 0xFFFFFFFF ||
+        (Zip->CompressionMethod != STORED && Zip->CompressionMethod != DEFLATED)) {
+        Status = EFI_UNSUPPORTED;
+        goto fail;
+    }
+
+    if (Zip->CompressionMethod == STORED && Zip->CompressedSize != Zip->UncompressedSize) {
+        Status = EFI_COMPROMISED_DATA;
+        goto fail;
+    }
+
+    Status = uefi_call_wrapper(gBS->AllocatePool, 3, EfiLoaderData, Zip->FilenameLength + 1, (VOID **)&Zip->Filename);
+    if (EFI_ERROR(Status)) {
+        Zip->Filename = NULL;
+        goto fail;
+    }
+
+    Status = ZipRingRead(Zip, (UINT8 *)Zip->Filename, Zip->FilenameLength, NULL);
+    if (EFI_ERROR(Status))
+        goto fail;
+    Zip->Filename[Zip->FilenameLength] = '\0';
+
+    Status = ZipRingRead(Zip, NULL, Zip->ExtraLength, NULL);
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    Zip->ProcessedHeader = ZIP_HEADER_DONE;
+    Zip->HeaderDone = 1;
+    return EFI_SUCCESS;
+
+fail:
+    Zip->ProcessedHeader = ZIP_ERROR;
+    return Status;
+}
+
+/*
+ * Input for InflateStream(): the unread part of the ring, up to its end
+ * and up to the end of the entry's data. The piece handed out last time
+ * has been consumed, so it is released first.
+ */
+static EFI_STATUS
+ZipInflateInput(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct ZipInfo *Zip = Context;
+    EFI_STATUS Status;
+    UINTN Rix, n;
+
+    Zip->FileBufR += Zip->Pending;
+    Zip->Pending = 0;
+
+    if (Zip->DataRemain == 0)
+        return EFI_END_OF_FILE;
+
+    Status = ZipFill(Zip);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    Rix = Zip->FileBufR & (Zip->FileBufSize - 1);
+    n = MIN(Zip->FileBufW - Zip->FileBufR, Zip->FileBufSize - Rix);
+    n = MIN(n, Zip->DataRemain);
+
+    *Buf = Zip->FileBuf + Rix;
+    *Len = n;
+    Zip->Pending = n;
+    Zip->DataRemain -= n;
+    return EFI_SUCCESS;
+}
+
+static VOID
+ZipInflateProgress(VOID *Context, UINTN OutLen)
+{
+    struct ZipInfo *Zip = Context;
+
+    UpdateProgressBar(0, FileSize - Zip->Remain);
+}
+
+/*
+ * Function:
+ * ZipExtract()
+ *
+ * Description:
+ * Decompress the entry whose header ZipReadLocalHeader() has parsed
+ * straight into Out, reading the rest of the transfer through the ring
+ * as inflate() asks for it. The CRC-32 is summed over the output as it
+ * is produced and checked against the header at the end.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_COMPROMISED_DATA for a corrupt entry,
+ * EFI_CRC_ERROR if the output does not match the header, or the input
+ * error.
+ */
+EFI_STATUS
+ZipExtract(struct ZipInfo *Zip, UINT8 *Out, UINTN OutSize, UINTN *OutLen)
+{
+    EFI_STATUS Status;
+    UINT32 Crc;
+
+    if (Zip->ProcessedHeader != ZIP_HEADER_DONE)
+        return EFI_NOT_READY;
+    if (OutSize < (UINTN)Zip->UncompressedSize)
+        return EFI_BUFFER_TOO_SMALL;
+
+    Crc = 0;
+    if (Zip->CompressionMethod == STORED) {
+        Status = ZipRingRead(Zip, Out, Zip->CompressedSize, &Crc);
+        *OutLen = EFI_ERROR(Status) ? 0 : (UINTN)Zip->CompressedSize;
+        UpdateProgressBar(0, FileSize - Zip->Remain);
+    } else {
+        Zip->DataRemain = Zip->CompressedSize;
+        Zip->Pending = 0;
+        Status = InflateStream(ZipInflateInput, ZipInflateProgress, Zip, Out, Zip->UncompressedSize, OutLen, &Crc);
+
+        // Give back what inflate() was still holding, and skip anything
+        // of the entry it did not need.
+        Zip->FileBufR += Zip->Pending;
+        Zip->Pending = 0;
+        if (!EFI_ERROR(Status))
+            Status = ZipRingRead(Zip, NULL, Zip->DataRemain, NULL);
+        Zip->DataRemain = 0;
+    }
+    if (EFI_ERROR(Status))
+        return Status;
+
+    if (*OutLen != (UINTN)Zip->UncompressedSize)
+        return EFI_COMPROMISED_DATA;
+
+    if (Crc != (UINT32)Zip->Crc) {
+        PrintToScreen(L"%a: CRC-32 mismatch: %08x, expected %08x\n", Zip->Filename, Crc, (UINT32)Zip->Crc);
+        return EFI_CRC_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * ZipDrain()
+ *
+ * Description:
+ * Read and discard the rest of the transfer (the central directory, and
+ * any further entries), so that the sender sees it complete.
+ */
+EFI_STATUS
+ZipDrain(struct ZipInfo *Zip)
+{
+    EFI_STATUS Status;
+    UINTN Len;
+
+    Zip->FileBufR = Zip->FileBufW;
+    while (Zip->Remain > 0) {
+        Status = ReadBlockToBuffer(Zip, NULL);
+        if (Status == EFI_END_OF_FILE)
+            break;
+        if (EFI_ERROR(Status))
+            return Status;
+        Zip->FileBufR = Zip->FileBufW;
+    }
+
+    /* Let the input source see the end of the transfer too. */
+    while (!Zip->InputDone) {
+        Len = Zip->FileBufSize;
+        Status = ReadInputData(Zip->FileBuf, &Len);
+        if (Status == EFI_END_OF_FILE || (!EFI_ERROR(Status) && Len == 0))
+            break;
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    Zip->InputDone = TRUE;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Does the file start with a zip local header?
+ */
+BOOLEAN
+IsZip(const VOID *Header)
+{
+    return ZIP_GET32((const UINT8 *)Header) == LOCSIG;
+}
+
+/*
+ * Read Len bytes at Offset in File. A file that ends first is corrupt.
+ */
+static EFI_STATUS
+ZipFileRead(EFI_FILE_PROTOCOL *File, UINT64 Offset, VOID *Buf, UINTN Len)
+{
+    EFI_STATUS Status;
+    UINTN n;
+
+    Status = uefi_call_wrapper(File->SetPosition, 2, File, Offset);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    while (Len > 0) {
+        n = Len;
+        Status = uefi_call_wrapper(File->Read, 3, File, &n, Buf);
+        if (EFI_ERROR(Status))
+            return Status;
+        if (n == 0)
+            return EFI_COMPROMISED_DATA;
+        BootCounterAdd(BOOT_CTR_FILE_READ, n);
+        Buf = (UINT8 *)Buf + n;
+        Len -= n;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read the last TailLen bytes of the file into *Tail and find the end
+ * record in them, searching back over the comment that may follow it.
+ * *Tail is the caller's to free, whatever the outcome.
+ */
+static EFI_STATUS
+ZipReadTail(EFI_FILE_PROTOCOL *File, UINT64 FileSize, UINTN TailLen, UINT8 **Tail, UINT8 **End)
+{
+    EFI_STATUS Status;
+    UINT8 *p;
+
+    *Tail = AllocatePool(TailLen);
+    if (!*Tail)
+        return EFI_OUT_OF_RESOURCES;
+    Status = ZipFileRead(File, FileSize - TailLen, *Tail, TailLen);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    for (p = *Tail + TailLen - ENDHDR; ; p--) {
+        if (ZIP_GET32(p) == ENDSIG && ZIP_GET16(p + ENDCOM) <= (UINTN)(*Tail + TailLen - p) - ENDHDR) {
+            *End = p;
+            return EFI_SUCCESS;
+        }
+        if (p == *Tail)
+            return EFI_NOT_FOUND;
+    }
+}
+
+/*
+ * Function:
+ * ZipOpenIndex()
+ *
+ * Description:
+ * Index the entries of a zip file from its central directory. The end
+ * record is found by searching back from the end of the file over the
+ * archive comment; the central directory usually sits just before it and
+ * is then already in the same read, and otherwise is read on its own.
+ * Data prepended to the archive, such as a self-extractor's stub, moves
+ * every offset by the same amount, which is allowed for. The index,
+ * names included, is one allocation.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_UNSUPPORTED for ZIP64 archives,
+ * EFI_COMPROMISED_DATA if the file is not a zip file or the directory is
+ * corrupt, or the read error.
+ */
+EFI_STATUS
+ZipOpenIndex(EFI_FILE_PROTOCOL *File, struct ZipIndex **Index)
+{
+    EFI_STATUS Status;
+    EFI_FILE_INFO *Info;
+    struct ZipIndex *Zi = NULL;
+    struct ZipEntry *E;
+    UINT8 *Tail = NULL, *CdBuf = NULL, *Cd, *p, *End;
+    CHAR8 *Names;
+    UINT64 FileSize, TailPos, EndPos, CdPos, CdOffset, Shift;
+    UINTN InfoSize, TailLen, CdSize, Count, NameLen, Len, i;
+
+    *Index = NULL;
+
+    InfoSize = SIZE_OF_EFI_FILE_INFO + 512;
+    Info = AllocatePool(InfoSize);
+    if (!Info)
+        return EFI_OUT_OF_RESOURCES;
+    Status = uefi_call_wrapper(File->GetInfo, 4, File, &gEfiFileInfoGuid, &InfoSize, Info);
+    FileSize = EFI_ERROR(Status) ? 0 : Info->FileSize;
+    FreePool(Info);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (FileSize < ENDHDR)
+        return EFI_COMPROMISED_DATA;
+
+    // The end record is followed only by a comment of up to 64KB, but
+    // most archives have none, so the last ZIP_TAIL_GUESS bytes usually
+    // hold it, and often the whole central directory too.
+    TailLen = (UINTN)MIN(FileSize, ZIP_TAIL_GUESS);
+    Status = ZipReadTail(File, FileSize, TailLen, &Tail, &p);
+    if (Status == EFI_NOT_FOUND && TailLen < MIN(FileSize, ENDHDR + 0xFFFF)) {
+        FreePool(Tail);
+        TailLen = (UINTN)MIN(FileSize, ENDHDR + 0xFFFF);
+        Status = ZipReadTail(File, FileSize, TailLen, &Tail, &p);
+    }
+    if (Status == EFI_NOT_FOUND)
+        Status = EFI_COMPROMISED_DATA;
+    if (EFI_ERROR(Status))
+        goto fail;
+
+    TailPos = FileSize - TailLen;
+    Count = ZIP_GET16(p + ENDTOT);
+    CdSize = ZIP_GET32(p + ENDSIZ);
+    CdOffset = ZIP_GET32(p + ENDOFF);
+    EndPos = TailPos + (UINTN)(p - Tail);
+
+    // ZIP64 archives keep the real values in a record of their own.
+    if (Count == 0xFFFF || CdSize == 0xFFFFFFFF || CdOffset == 0xFFFFFFFF) {
+        Status = EFI_UNSUPPORTED;
+        goto fail;
+    }
+
+    if (CdSize > EndPos || Count > CdSize / CENHDR || CdOffset > EndPos - CdSize) {
+        Status = EFI_COMPROMISED_DATA;
+        goto fail;
     }
+    CdPos = EndPos - CdSize;
+    Shift = CdPos - CdOffset;
 
+    if (CdPos >= TailPos) {
+        Cd = Tail + (UINTN)(CdPos - TailPos);
+    } else {
+        CdBuf = AllocatePool(MAX(CdSize, 1));
+        if (!CdBuf) {
+            Status = EFI_OUT_OF_RESOURCES;
+            goto fail;
+        }
+        Status = ZipFileRead(File, CdPos, CdBuf, CdSize);
+        if (EFI_ERROR(Status))
+            goto fail;
+        Cd = CdBuf;
+    }
+
+    // Each name and its NUL fit in the header it came from.
+    Zi = AllocatePool(sizeof(*Zi) + Count * sizeof(*E) + CdSize);
+    if (!Zi) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto fail;
+    }
+    Zi->File = File;
+    Zi->CentralOffset = CdPos;
+    Zi->Count = Count;
+    Zi->Entries = (struct ZipEntry *)(Zi + 1);
+    Names = (CHAR8 *)(Zi->Entries + Count);
+
+    End = Cd + CdSize;
+    for (i = 0, E = Zi->Entries; i < Count; i++, E++) {
+        if ((UINTN)(End - Cd) < CENHDR || ZIP_GET32(Cd) != CENSIG) {
+            Status = EFI_COMPROMISED_DATA;
+            goto fail;
+        }
+        NameLen = ZIP_GET16(Cd + CENNAM);
+        Len = CENHDR + NameLen + ZIP_GET16(Cd + CENEXT) + ZIP_GET16(Cd + CENCOM);
+        if ((UINTN)(End - Cd) < Len) {
+            Status = EFI_COMPROMISED_DATA;
+            goto fail;
+        }
+
+        E->Name = Names;
+        CopyMem(Names, Cd + CENHDR, NameLen);
+        Names[NameLen] = '\0';
+        Names += NameLen + 1;
+        E->Flags = ZIP_GET16(Cd + CENFLG);
+        E->CompressionMethod = ZIP_GET16(Cd + CENHOW);
+        E->Crc = ZIP_GET32(Cd + CENCRC);
+        E->CompressedSize = ZIP_GET32(Cd + CENSIZ);
+        E->UncompressedSize = ZIP_GET32(Cd + CENLEN);
+        E->HeaderOffset = ZIP_GET32(Cd + CENOFF) + Shift;
+        if (E->HeaderOffset >= CdPos) {
+            Status = EFI_COMPROMISED_DATA;
+            goto fail;
+        }
+        Cd += Len;
+    }
+
+    FreePool(Tail);
+    if (CdBuf)
+        FreePool(CdBuf);
+    *Index = Zi;
+    return EFI_SUCCESS;
+
+fail:
+    if (Tail)
+        FreePool(Tail);
+    if (CdBuf)
+        FreePool(CdBuf);
+    if (Zi)
+        FreePool(Zi);
     return Status;
 }
+
+static BOOLEAN
+ZipIsDirectory(const struct ZipEntry *Entry)
+{
+    const CHAR8 *n = Entry->Name;
+
+    while (*n)
+        n++;
+    return n > Entry->Name && n[-1] == '/';
+}
+
+/*
+ * Function:
+ * ZipFindEntry()
+ *
+ * Description:
+ * Look up an entry by name. Backslashes in Name match the slashes zip
+ * files separate directories with, and a leading one is ignored. With no
+ * Name, the archive must hold exactly one file, which is returned.
+ *
+ * Return value:
+ * The entry, or NULL if there is none (or no single one).
+ */
+struct ZipEntry *
+ZipFindEntry(struct ZipIndex *Index, const CHAR16 *Name)
+{
+    struct ZipEntry *E, *Found = NULL;
+    const CHAR8 *n;
+    const CHAR16 *w;
+    UINTN i;
+
+    if (!Name || *Name == L'\0') {
+        for (i = 0, E = Index->Entries; i < Index->Count; i++, E++) {
+            if (ZipIsDirectory(E))
+                continue;
+            if (Found)
+                return NULL;
+            Found = E;
+        }
+        return Found;
+    }
+
+    while (*Name == L'\\' || *Name == L'/')
+        Name++;
+
+    for (i = 0, E = Index->Entries; i < Index->Count; i++, E++) {
+        for (n = E->Name, w = Name; *n != '\0' && *w != L'\0'; n++, w++) {
+            if ((CHAR16)*n != *w && !(*n == '/' && *w == L'\\'))
+                break;
+        }
+        if (*n == '\0' && *w == L'\0')
+            return E;
+    }
+
+    return NULL;
+}
+
+/*
+ * Input for InflateStream(): the entry's compressed data, read from the
+ * file a piece at a time.
+ */
+struct zip_file_input {
+    EFI_FILE_PROTOCOL *File;
+    UINT8 *Buf;
+    UINTN Left;             /* compressed bytes not yet read */
+};
+
+static EFI_STATUS
+ZipFileInput(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct zip_file_input *In = Context;
+    EFI_STATUS Status;
+    UINTN n;
+
+    if (In->Left == 0)
+        return EFI_END_OF_FILE;
+
+    n = MIN(In->Left, ZIP_FILE_CHUNK);
+    Status = uefi_call_wrapper(In->File->Read, 3, In->File, &n, In->Buf);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (n == 0)
+        return EFI_END_OF_FILE;
+
+    BootCounterAdd(BOOT_CTR_FILE_READ, n);
+    In->Left -= n;
+    *Buf = In->Buf;
+    *Len = n;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * ZipExtractEntry()
+ *
+ * Description:
+ * Extract one indexed entry into Out, reading only its local header and
+ * its data. A stored entry is read straight into Out; a deflated one is
+ * inflated there from a ZIP_FILE_CHUNK input buffer. Either way the
+ * CRC-32 is summed a piece at a time and checked against the central
+ * directory, which also has the sizes of entries written with a data
+ * descriptor.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, EFI_UNSUPPORTED for encrypted, ZIP64 or
+ * otherwise compressed entries, EFI_BUFFER_TOO_SMALL if Out cannot hold
+ * the entry, EFI_COMPROMISED_DATA for a corrupt entry, EFI_CRC_ERROR if
+ * the output does not match the directory, or the read error.
+ */
+EFI_STATUS
+ZipExtractEntry(struct ZipIndex *Index, struct ZipEntry *Entry, UINT8 *Out, UINTN OutSize, UINTN *OutLen)
+{
+    EFI_STATUS Status;
+    struct zip_file_input In;
+    UINT8 Hdr[LOCHDR];
+    UINT64 DataOffset;
+    UINT32 Crc;
+    UINTN Got, n;
+
+    *OutLen = 0;
+
+    if ((Entry->Flags & CRPFLG) || Entry->CompressedSize == 0xFFFFFFFF ||
+        Entry->UncompressedSize == 0xFFFFFFFF ||
+        (Entry->CompressionMethod != STORED && Entry->CompressionMethod != DEFLATED))
+        return EFI_UNSUPPORTED;
+
+    if (OutSize < Entry->UncompressedSize)
+        return EFI_BUFFER_TOO_SMALL;
+
+    // The local header's name and extra field need not match the
+    // directory's in length, so the data is found from the header itself.
+    Status = ZipFileRead(Index->File, Entry->HeaderOffset, Hdr, LOCHDR);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (ZIP_GET32(Hdr) != LOCSIG)
+        return EFI_COMPROMISED_DATA;
+
+    DataOffset = Entry->HeaderOffset + LOCHDR + ZIP_GET16(Hdr + LOCFIL) + ZIP_GET16(Hdr + LOCEXT);
+    if (DataOffset + Entry->CompressedSize > Index->CentralOffset)
+        return EFI_COMPROMISED_DATA;
+
+    Status = uefi_call_wrapper(Index->File->SetPosition, 2, Index->File, DataOffset);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    Crc = 0;
+    if (Entry->CompressionMethod == STORED) {
+        if (Entry->CompressedSize != Entry->UncompressedSize)
+            return EFI_COMPROMISED_DATA;
+
+        for (Got = 0; Got < Entry->UncompressedSize; Got += n) {
+            n = MIN(Entry->UncompressedSize - Got, ZIP_FILE_CHUNK);
+            Status = uefi_call_wrapper(Index->File->Read, 3, Index->File, &n, Out + Got);
+            if (EFI_ERROR(Status))
+                return Status;
+            if (n == 0)
+                return EFI_COMPROMISED_DATA;
+            BootCounterAdd(BOOT_CTR_FILE_READ, n);
+            Crc = Crc32(Crc, Out + Got, n);
+        }
+        *OutLen = Got;
+    } else {
+        In.File = Index->File;
+        In.Left = Entry->CompressedSize;
+        In.Buf = AllocatePool(ZIP_FILE_CHUNK);
+        if (!In.Buf)
+            return EFI_OUT_OF_RESOURCES;
+
+        Status = InflateStream(ZipFileInput, NULL, &In, Out, Entry->UncompressedSize, OutLen, &Crc);
+        FreePool(In.Buf);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
+
+    if (*OutLen != Entry->UncompressedSize)
+        return EFI_COMPROMISED_DATA;
+
+    if (Crc != Entry->Crc) {
+        PrintToScreen(L"%a: CRC-32 mismatch: %08x, expected %08x\n", Entry->Name, Crc, Entry->Crc);
+        return EFI_CRC_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * ZipCloseIndex()
+ *
+ * Description:
+ * Free an index made by ZipOpenIndex(). The file is the caller's to close.
+ */
+VOID
+ZipCloseIndex(struct ZipIndex *Index)
+{
+    if (Index)
+        FreePool(Index);
+}
@@ -0,0 +1,1821 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * zstd.c
+ * Zstandard frame decoder (RFC 8878).
+ *
+ * A compressed block holds Huffman coded literals and a series of
+ * sequences, each a literal length, a match length and an offset, coded
+ * with three interleaved FSE (tANS) states in one backward bitstream.
+ * Both bitstreams are read from a 64-bit word refilled a few symbols at a
+ * time; literal and match copies are done in whole chunks while the
+ * output has WILD_MARGIN bytes to spare, as in lz4.c.
+ *
+ * The window is the output buffer itself, so a frame needs no history of
+ * its own whatever its window size. The window size a frame asks for is
+ * still checked against ZstdMaxWindowLog, which the configuration sets,
+ * and matches may not reach further back than it, or into a dictionary.
+ *
+ * A frame that names a dictionary is decoded with the one set by
+ * ZstdSetDictionary(), whose entropy tables, repeat offsets and content
+ * then stand in for the frame's history.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "clock.h"
+#include "decompress.h"
+
+#define ZSTD_MAGIC              0xFD2FB528
+#define ZSTD_SKIP_MAGIC         0x184D2A50
+#define ZSTD_SKIP_MASK          0xFFFFFFF0
+#define ZSTD_DICT_MAGIC         0xEC30A437
+
+#define ZSTD_FHD_FCS_SHIFT      6
+#define ZSTD_FHD_SINGLE_SEGMENT 0x20
+#define ZSTD_FHD_RESERVED       0x08
+#define ZSTD_FHD_CHECKSUM       0x04
+#define ZSTD_FHD_DICT_ID_MASK   0x03
+
+#define ZSTD_BLOCK_MAX          (128 << 10)
+#define ZSTD_WINDOWLOG_MIN      10
+#define ZSTD_WINDOWLOG_MAX      31
+#define ZSTD_WINDOWLOG_DEFAULT  27
+
+#define BLOCK_RAW               0
+#define BLOCK_RLE               1
+#define BLOCK_COMPRESSED        2
+
+#define LIT_RAW                 0
+#define LIT_RLE                 1
+#define LIT_COMPRESSED          2
+#define LIT_TREELESS            3
+
+#define MODE_PREDEFINED         0
+#define MODE_RLE                1
+#define MODE_FSE                2
+#define MODE_REPEAT             3
+
+#define HUF_MAX_BITS            11
+#define HUF_MAX_SYMBOLS         256
+#define HUF_WEIGHT_LOG          6
+
+#define LL_MAX_SYMBOL           35
+#define ML_MAX_SYMBOL           52
+#define OF_MAX_SYMBOL           31
+#define OF_DEFAULT_SYMBOLS      29
+#define LL_MAX_LOG              9
+#define ML_MAX_LOG              9
+#define OF_MAX_LOG              8
+#define FSE_MAX_LOG             9
+#define FSE_MAX_SYMBOL          ML_MAX_SYMBOL
+
+#define READY_HUF               0x01
+#define READY_LL                0x02
+#define READY_OF                0x04
+#define READY_ML                0x08
+#define READY_ALL               0x0F
+
+#define WILD_MARGIN             16      /* output room for chunked copies */
+
+#define XXH_PRIME1              0x9E3779B185EBCA87ULL
+#define XXH_PRIME2              0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3              0x165667B19E3779F9ULL
+#define XXH_PRIME4              0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5              0x27D4EB2F165667C5ULL
+
+#define ZSTD_GET16(p)           ((UINT32)(p)[0] | ((UINT32)(p)[1] << 8))
+#define ZSTD_GET24(p)           (ZSTD_GET16(p) | ((UINT32)(p)[2] << 16))
+#define ZSTD_GET32(p)           (ZSTD_GET24(p) | ((UINT32)(p)[3] << 24))
+
+/* One entry of a Huffman decoding table. */
+struct huf_entry {
+    UINT8 Symbol;
+    UINT8 Bits;
+};
+
+/* One state of an FSE decoding table, as described. */
+struct fse_entry {
+    UINT16 Next;            /* baseline of the next state */
+    UINT8 Symbol;
+    UINT8 Bits;             /* state bits to read */
+};
+
+/* One state of a sequence decoding table, with its code's value folded in. */
+struct seq_entry {
+    UINT32 Base;            /* smallest value of the code */
+    UINT16 Next;
+    UINT8 Bits;
+    UINT8 Extra;            /* value bits to read */
+};
+
+/* The entropy state carried from block to block, or out of a dictionary. */
+struct zstd_tables {
+    struct huf_entry Huf[1 << HUF_MAX_BITS];
+    struct seq_entry LL[1 << LL_MAX_LOG];
+    struct seq_entry OF[1 << OF_MAX_LOG];
+    struct seq_entry ML[1 << ML_MAX_LOG];
+    UINT8 HufLog, LLLog, OFLog, MLLog;
+    UINT8 Ready;            /* READY_* for tables a later block may repeat */
+    UINT32 Rep[3];
+};
+
+struct zstd_dict {
+    UINT32 Id;
+    struct zstd_tables Tables;
+    const UINT8 *Content;
+    UINTN ContentLen;
+    UINT8 *Buf;
+};
+
+struct zstd_ctx {
+    struct zstd_tables T;
+    UINT8 Lit[ZSTD_BLOCK_MAX + WILD_MARGIN];
+    const UINT8 *LitPtr;
+    const UINT8 *LitEnd;
+    const UINT8 *LitLimit;  /* literals may be read in chunks up to here */
+    UINT8 *FrameStart;
+    const UINT8 *Dict;      /* dictionary content before FrameStart */
+    UINTN DictLen;
+    UINT64 MaxOffset;       /* the window, and the dictionary behind it */
+    BOOLEAN Busy;
+};
+
+/* Piecewise input, with a staging buffer for blocks split across pieces. */
+struct zstd_input {
+    inflate_input_fn Input;
+    VOID *Context;
+    UINT8 *Piece;
+    UINTN Left;             /* bytes of Piece not yet used */
+    UINTN Fed;              /* bytes handed over by Input */
+    UINT8 *Block;
+};
+
+static const UINT8 FcsSize[4] = { 0, 2, 4, 8 };
+static const UINT8 DictIdSize[4] = { 0, 1, 2, 4 };
+
+/* Backward bitstream: Word was loaded from Ptr, Used bits taken off its top. */
+struct bits {
+    UINT64 Word;
+    UINTN Used;
+    const UINT8 *Ptr;
+    const UINT8 *Start;
+};
+
+UINT8 ZstdMaxWindowLog = ZSTD_WINDOWLOG_DEFAULT;
+
+static struct zstd_dict *Dictionary;
+static struct zstd_ctx *CachedCtx;
+
+static const UINT32 ll_base[LL_MAX_SYMBOL + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+    8192, 16384, 32768, 65536
+};
+static const UINT8 ll_extra[LL_MAX_SYMBOL + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+    13, 14, 15, 16
+};
+static const UINT32 ml_base[ML_MAX_SYMBOL + 1] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+    19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+    35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+    4099, 8195, 16387, 32771, 65539
+};
+static const UINT8 ml_extra[ML_MAX_SYMBOL + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16
+};
+
+/* The predefined distributions, at accuracy logs 6, 6 and 5. */
+static const INT16 ll_default[LL_MAX_SYMBOL + 1] = {
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+    -1, -1, -1, -1
+};
+static const INT16 ml_default[ML_MAX_SYMBOL + 1] = {
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+    -1, -1, -1, -1, -1
+};
+static const INT16 of_default[OF_DEFAULT_SYMBOLS] = {
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+static inline UINT64
+rotl64(UINT64 x, unsigned r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline UINT32
+read32(const UINT8 *p)
+{
+    UINT32 v;
+
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline UINT64
+read64(const UINT8 *p)
+{
+    UINT64 v;
+
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned
+highbit(UINT32 x)
+{
+    return 31 - __builtin_clz(x);
+}
+
+static inline UINT64
+xxh64_round(UINT64 acc, UINT64 v)
+{
+    return rotl64(acc + v * XXH_PRIME2, 31) * XXH_PRIME1;
+}
+
+static inline UINT64
+xxh64_merge(UINT64 h, UINT64 v)
+{
+    return (h ^ xxh64_round(0, v)) * XXH_PRIME1 + XXH_PRIME4;
+}
+
+/* XXH64 of one buffer; a frame's checksum is its low 32 bits. */
+static UINT64
+xxh64(const VOID *Buf, UINTN Len, UINT64 Seed)
+{
+    const UINT8 *p = Buf;
+    const UINT8 *end = p + Len;
+    UINT64 v1, v2, v3, v4, h;
+
+    if (Len >= 32) {
+        v1 = Seed + XXH_PRIME1 + XXH_PRIME2;
+        v2 = Seed + XXH_PRIME2;
+        v3 = Seed;
+        v4 = Seed - XXH_PRIME1;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = Seed + XXH_PRIME5;
+    }
+
+    h += (UINT64)Len;
+    for (; end - p >= 8; p += 8)
+        h = rotl64(h ^ xxh64_round(0, read64(p)), 27) * XXH_PRIME1 + XXH_PRIME4;
+    if (end - p >= 4) {
+        h = rotl64(h ^ ((UINT64)read32(p) * XXH_PRIME1), 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = rotl64(h ^ (*p * XXH_PRIME5), 11) * XXH_PRIME1;
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline __attribute__((always_inline)) void
+copy8(UINT8 *out, const UINT8 *src)
+{
+    UINT64 w;
+
+    __builtin_memcpy(&w, src, sizeof(w));
+    __builtin_memcpy(out, &w, sizeof(w));
+}
+
+static inline __attribute__((always_inline)) void
+copy16(UINT8 *out, const UINT8 *src)
+{
+    UINT64 w, w2;
+
+    __builtin_memcpy(&w, src, sizeof(w));
+    __builtin_memcpy(&w2, src + sizeof(w), sizeof(w2));
+    __builtin_memcpy(out, &w, sizeof(w));
+    __builtin_memcpy(out + sizeof(w), &w2, sizeof(w2));
+}
+
+/*
+ * For an offset below 8, the smallest multiple of it that is at least 8:
+ * once the first 8 bytes of the match are in place, copying from that far
+ * back repeats the same pattern a whole word at a time.
+ */
+static const UINT8 short_stride[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+
+/*
+ * Copy a match of len bytes from offset back. Stores are whole chunks,
+ * so this may write up to WILD_MARGIN - 1 bytes past the match.
+ */
+static inline __attribute__((always_inline)) void
+copy_match_wild(UINT8 *out, UINTN len, UINTN offset)
+{
+    const UINT8 *src = out - offset;
+    UINT8 *end = out + len;
+    UINTN i;
+
+    if (offset >= 16) {
+        do {
+            copy16(out, src);
+            src += 16;
+            out += 16;
+        } while (out < end);
+        return;
+    }
+
+    if (offset < 8) {
+        for (i = 0; i < 8; i++)
+            out[i] = src[i];
+        out += 8;
+        src = out - short_stride[offset];
+        if (out >= end)
+            return;
+    }
+
+    /* each word read was completely written by an earlier store */
+    do {
+        copy8(out, src);
+        src += 8;
+        out += 8;
+    } while (out < end);
+}
+
+/*
+ * Start reading the backward bitstream [Start, Start + Len). Its last
+ * byte holds a marker bit above the first bit of data.
+ */
+static inline EFI_STATUS
+bits_init(struct bits *b, const UINT8 *Start, UINTN Len)
+{
+    UINTN i;
+
+    if (Len == 0 || Start[Len - 1] == 0)
+        return EFI_COMPROMISED_DATA;
+
+    b->Start = Start;
+    if (Len >= sizeof(b->Word)) {
+        b->Ptr = Start + Len - sizeof(b->Word);
+        b->Word = read64(b->Ptr);
+        b->Used = 0;
+    } else {
+        b->Ptr = Start;
+        b->Word = 0;
+        for (i = 0; i < Len; i++)
+            b->Word |= (UINT64)Start[i] << (8 * i);
+        b->Used = 8 * (sizeof(b->Word) - Len);
+    }
+    b->Used += 8 - highbit(Start[Len - 1]);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Refill the word, leaving at least 57 bits to read unless the stream is
+ * nearly done. Reading past the start gives garbage, which bits_done()
+ * catches.
+ */
+static inline __attribute__((always_inline)) void
+bits_reload(struct bits *b)
+{
+    UINTN n;
+
+    if (b->Used > 64)
+        return;
+    n = b->Used >> 3;
+    if ((UINTN)(b->Ptr - b->Start) < n)
+        n = (UINTN)(b->Ptr - b->Start);
+    if (n == 0)
+        return;
+    b->Ptr -= n;
+    b->Used -= 8 * n;
+    b->Word = read64(b->Ptr);
+}
+
+static inline __attribute__((always_inline)) UINTN
+bits_peek(const struct bits *b, UINTN n)
+{
+    return (UINTN)((b->Word << (b->Used & 63)) >> 1 >> (63 - n));
+}
+
+static inline __attribute__((always_inline)) UINTN
+bits_read(struct bits *b, UINTN n)
+{
+    UINTN v = bits_peek(b, n);
+
+    b->Used += n;
+    return v;
+}
+
+/* Was the stream read exactly to its start? */
+static inline BOOLEAN
+bits_done(const struct bits *b)
+{
+    return b->Ptr == b->Start && b->Used == 64;
+}
+
+static inline BOOLEAN
+bits_overrun(const struct bits *b)
+{
+    return b->Ptr == b->Start && b->Used > 64;
+}
+
+/* Little-endian bits at bit offset Off of [In, In + Len); zeros past the end. */
+static UINT32
+fwd_bits(const UINT8 *In, UINTN Len, UINTN Off, UINTN n)
+{
+    UINT32 v = 0;
+    UINTN i, Byte = Off >> 3;
+
+    for (i = 0; i < 4 && Byte + i < Len; i++)
+        v |= (UINT32)In[Byte + i] << (8 * i);
+    return (v >> (Off & 7)) & ((1U << n) - 1);
+}
+
+/*
+ * Read an FSE table description: the accuracy log and the normalized
+ * count of each symbol up to MaxSymbol, where -1 marks a symbol less
+ * likely than 1 in (1 << *Log). *Used receives its length in bytes.
+ */
+static EFI_STATUS
+fse_read_counts(const UINT8 *In, UINTN Len, INT16 *Counts, UINTN MaxSymbol, UINTN MaxLog,
+    UINTN *Log, UINTN *NumSymbols, UINTN *Used)
+{
+    UINTN Off, Sym, Bits, i, Repeat;
+    UINT32 Val, Mask, Threshold;
+    INT32 Remaining, Count;
+
+    if (Len == 0)
+        return EFI_COMPROMISED_DATA;
+    *Log = (In[0] & 15) + 5;
+    if (*Log > MaxLog)
+        return EFI_COMPROMISED_DATA;
+
+    Off = 4;
+    Sym = 0;
+    Remaining = (1 << *Log) + 1;
+    while (Remaining > 1 && Sym <= MaxSymbol) {
+        Bits = highbit(Remaining) + 1;
+        Val = fwd_bits(In, Len, Off, Bits);
+        Mask = (1U << (Bits - 1)) - 1;
+        Threshold = (1U << Bits) - 1 - Remaining;
+        if ((Val & Mask) < Threshold) {
+            Val &= Mask;
+            Off += Bits - 1;
+        } else {
+            if (Val > Mask)
+                Val -= Threshold;
+            Off += Bits;
+        }
+
+        Count = (INT32)Val - 1;
+        Remaining -= Count < 0 ? -Count : Count;
+        Counts[Sym++] = (INT16)Count;
+
+        // A zero count is followed by 2-bit repeat flags for more zeros.
+        if (Count == 0) {
+            do {
+                Repeat = fwd_bits(In, Len, Off, 2);
+                Off += 2;
+                for (i = 0; i < Repeat && Sym <= MaxSymbol; i++)
+                    Counts[Sym++] = 0;
+            } while (Repeat == 3 && Off <= 8 * Len);
+        }
+        if (Off > 8 * Len)
+            return EFI_COMPROMISED_DATA;
+    }
+
+    if (Remaining != 1 || Sym < 2)
+        return EFI_COMPROMISED_DATA;
+
+    *NumSymbols = Sym;
+    *Used = (Off + 7) >> 3;
+    return EFI_SUCCESS;
+}
+
+/* Spread the symbols of a distribution over a decoding table. */
+static EFI_STATUS
+fse_build(struct fse_entry *Table, const INT16 *Counts, UINTN NumSymbols, UINTN Log)
+{
+    UINT16 Next[FSE_MAX_SYMBOL + 1];
+    UINTN Size = (UINTN)1 << Log;
+    UINTN High = Size - 1;
+    UINTN Step = (Size >> 1) + (Size >> 3) + 3;
+    UINTN Pos = 0;
+    UINTN s, i, x;
+    INT16 Count;
+
+    for (s = 0; s < NumSymbols; s++) {
+        if (Counts[s] == -1) {
+            Table[High--].Symbol = (UINT8)s;
+            Next[s] = 1;
+        } else {
+            Next[s] = (UINT16)Counts[s];
+        }
+    }
+
+    for (s = 0; s < NumSymbols; s++) {
+        for (Count = 0; Count < Counts[s]; Count++) {
+            Table[Pos].Symbol = (UINT8)s;
+            do {
+                Pos = (Pos + Step) & (Size - 1);
+            } while (Pos > High);
+        }
+    }
+    if (Pos != 0)
+        return EFI_COMPROMISED_DATA;
+
+    for (i = 0; i < Size; i++) {
+        x = Next[Table[i].Symbol]++;
+        Table[i].Bits = (UINT8)(Log - highbit((UINT32)x));
+        Table[i].Next = (UINT16)((x << Table[i].Bits) - Size);
+    }
+
+    return EFI_SUCCESS;
+}
+
+/* Build a sequence table from a distribution, with each code's value. */
+static EFI_STATUS
+seq_build(struct seq_entry *Table, const INT16 *Counts, UINTN NumSymbols, UINTN Log,
+    const UINT32 *Base, const UINT8 *Extra)
+{
+    struct fse_entry Fse[1 << FSE_MAX_LOG];
+    EFI_STATUS Status;
+    UINTN i, s;
+
+    Status = fse_build(Fse, Counts, NumSymbols, Log);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    for (i = 0; i < ((UINTN)1 << Log); i++) {
+        s = Fse[i].Symbol;
+        Table[i].Base = Base ? Base[s] : (UINT32)1 << s;
+        Table[i].Extra = Extra ? Extra[s] : (UINT8)s;
+        Table[i].Next = Fse[i].Next;
+        Table[i].Bits = Fse[i].Bits;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read the Huffman weights that FSE compressed into Len bytes, with two
+ * states taking turns until the bitstream runs out.
+ */
+static EFI_STATUS
+huf_read_fse_weights(const UINT8 *In, UINTN Len, UINT8 *Weights, UINTN *NumWeights)
+{
+    struct fse_entry Table[1 << HUF_WEIGHT_LOG];
+    INT16 Counts[HUF_MAX_BITS + 2];
+    struct bits b;
+    EFI_STATUS Status;
+    UINTN Log, NumSymbols, Used, s1, s2, n = 0;
+
+    Status = fse_read_counts(In, Len, Counts, HUF_MAX_BITS + 1, HUF_WEIGHT_LOG, &Log, &NumSymbols, &Used);
+    if (EFI_ERROR(Status))
+        return Status;
+    Status = fse_build(Table, Counts, NumSymbols, Log);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (Used >= Len)
+        return EFI_COMPROMISED_DATA;
+    Status = bits_init(&b, In + Used, Len - Used);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    s1 = bits_read(&b, Log);
+    s2 = bits_read(&b, Log);
+    for (;;) {
+        if (n > HUF_MAX_SYMBOLS - 2)
+            return EFI_COMPROMISED_DATA;
+        bits_reload(&b);
+        Weights[n++] = Table[s1].Symbol;
+        s1 = Table[s1].Next + bits_read(&b, Table[s1].Bits);
+        if (bits_overrun(&b)) {
+            Weights[n++] = Table[s2].Symbol;
+            break;
+        }
+        Weights[n++] = Table[s2].Symbol;
+        s2 = Table[s2].Next + bits_read(&b, Table[s2].Bits);
+        if (bits_overrun(&b)) {
+            Weights[n++] = Table[s1].Symbol;
+            break;
+        }
+    }
+
+    *NumWeights = n;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read a Huffman tree description into T->Huf. The weight of the last
+ * symbol is not stored: it is what completes the code.
+ */
+static EFI_STATUS
+huf_read_table(struct zstd_tables *T, const UINT8 *In, UINTN Len, UINTN *Used)
+{
+    UINT8 Weights[HUF_MAX_SYMBOLS];
+    UINT32 Rank[HUF_MAX_BITS + 2];
+    EFI_STATUS Status;
+    UINTN n, i, j, Header, MaxBits, Pos, Run;
+    UINT32 Total, Left;
+    UINT8 w;
+
+    if (Len == 0)
+        return EFI_COMPROMISED_DATA;
+    Header = In[0];
+    if (Header < 128) {
+        if (Header == 0 || Len - 1 < Header)
+            return EFI_COMPROMISED_DATA;
+        Status = huf_read_fse_weights(In + 1, Header, Weights, &n);
+        if (EFI_ERROR(Status))
+            return Status;
+        *Used = 1 + Header;
+    } else {
+        n = Header - 127;
+        if (Len - 1 < (n + 1) / 2)
+            return EFI_COMPROMISED_DATA;
+        for (i = 0; i < n; i++)
+            Weights[i] = (i & 1) ? In[1 + i / 2] & 15 : In[1 + i / 2] >> 4;
+        *Used = 1 + (n + 1) / 2;
+    }
+    if (n >= HUF_MAX_SYMBOLS)
+        return EFI_COMPROMISED_DATA;
+
+    Total = 0;
+    for (i = 0; i < n; i++) {
+        if (Weights[i] > HUF_MAX_BITS)
+            return EFI_COMPROMISED_DATA;
+        if (Weights[i])
+            Total += (UINT32)1 << (Weights[i] - 1);
+    }
+    if (Total == 0)
+        return EFI_COMPROMISED_DATA;
+    MaxBits = highbit(Total) + 1;
+    if (MaxBits > HUF_MAX_BITS)
+        return EFI_COMPROMISED_DATA;
+    Left = ((UINT32)1 << MaxBits) - Total;
+    if (Left & (Left - 1))
+        return EFI_COMPROMISED_DATA;
+    Weights[n++] = (UINT8)(highbit(Left) + 1);
+
+    // Longest codes first; a weight w symbol fills 1 << (w - 1) entries.
+    SetMem(Rank, sizeof(Rank), 0);
+    for (i = 0; i < n; i++)
+        Rank[Weights[i]]++;
+    Pos = 0;
+    for (w = 1; w <= MaxBits; w++) {
+        Run = Rank[w] << (w - 1);
+        Rank[w] = (UINT32)Pos;
+        Pos += Run;
+    }
+
+    for (i = 0; i < n; i++) {
+        w = Weights[i];
+        if (w == 0)
+            continue;
+        Pos = Rank[w];
+        Run = (UINTN)1 << (w - 1);
+        for (j = 0; j < Run; j++) {
+            T->Huf[Pos + j].Symbol = (UINT8)i;
+            T->Huf[Pos + j].Bits = (UINT8)(MaxBits + 1 - w);
+        }
+        Rank[w] += (UINT32)Run;
+    }
+
+    T->HufLog = (UINT8)MaxBits;
+    T->Ready |= READY_HUF;
+    return EFI_SUCCESS;
+}
+
+static inline __attribute__((always_inline)) UINT8
+huf_decode(struct bits *b, const struct huf_entry *Table, UINTN Log)
+{
+    const struct huf_entry *e = &Table[bits_peek(b, Log)];
+
+    b->Used += e->Bits;
+    return e->Symbol;
+}
+
+/* Decode n literals from one Huffman coded stream. */
+static EFI_STATUS
+huf_stream(const struct zstd_tables *T, const UINT8 *In, UINTN Len, UINT8 *Out, UINTN n)
+{
+    const struct huf_entry *Table = T->Huf;
+    UINTN Log = T->HufLog;
+    UINT8 *End = Out + n;
+    struct bits b;
+    EFI_STATUS Status;
+
+    Status = bits_init(&b, In, Len);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    while (End - Out >= 4) {
+        bits_reload(&b);
+        Out[0] = huf_decode(&b, Table, Log);
+        Out[1] = huf_decode(&b, Table, Log);
+        Out[2] = huf_decode(&b, Table, Log);
+        Out[3] = huf_decode(&b, Table, Log);
+        Out += 4;
+    }
+    while (Out < End) {
+        bits_reload(&b);
+        *Out++ = huf_decode(&b, Table, Log);
+    }
+
+    return bits_done(&b) ? EFI_SUCCESS : EFI_COMPROMISED_DATA;
+}
+
+/*
+ * Decode n literals from four Huffman coded streams, each a quarter of
+ * them, behind a table of the first three streams' sizes. The streams
+ * are interleaved so that their table lookups overlap.
+ */
+static EFI_STATUS
+huf_streams4(const struct zstd_tables *T, const UINT8 *In, UINTN Len, UINT8 *Out, UINTN n)
+{
+    const struct huf_entry *Table = T->Huf;
+    UINTN Log = T->HufLog;
+    struct bits b[4];
+    UINT8 *o[4], *e[4];
+    UINTN Size[4], Seg, i;
+    const UINT8 *p;
+    EFI_STATUS Status;
+
+    if (Len < 6 + 4)
+        return EFI_COMPROMISED_DATA;
+    Size[0] = ZSTD_GET16(In);
+    Size[1] = ZSTD_GET16(In + 2);
+    Size[2] = ZSTD_GET16(In + 4);
+    if (Size[0] + Size[1] + Size[2] > Len - 6)
+        return EFI_COMPROMISED_DATA;
+    Size[3] = Len - 6 - Size[0] - Size[1] - Size[2];
+
+    Seg = (n + 3) / 4;
+    if (3 * Seg > n)
+        return EFI_COMPROMISED_DATA;
+
+    p = In + 6;
+    for (i = 0; i < 4; i++) {
+        Status = bits_init(&b[i], p, Size[i]);
+        if (EFI_ERROR(Status))
+            return Status;
+        p += Size[i];
+        o[i] = Out + i * Seg;
+        e[i] = i < 3 ? o[i] + Seg : Out + n;
+    }
+
+    // The last stream is the shortest.
+    while (e[3] - o[3] >= 4) {
+        for (i = 0; i < 4; i++)
+            bits_reload(&b[i]);
+        for (i = 0; i < 4; i++) {
+            o[0][i] = huf_decode(&b[0], Table, Log);
+            o[1][i] = huf_decode(&b[1], Table, Log);
+            o[2][i] = huf_decode(&b[2], Table, Log);
+            o[3][i] = huf_decode(&b[3], Table, Log);
+        }
+        for (i = 0; i < 4; i++)
+            o[i] += 4;
+    }
+
+    for (i = 0; i < 4; i++) {
+        while (o[i] < e[i]) {
+            bits_reload(&b[i]);
+            *o[i]++ = huf_decode(&b[i], Table, Log);
+        }
+        if (!bits_done(&b[i]))
+            return EFI_COMPROMISED_DATA;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read the literals section of a compressed block into z->Lit, or point
+ * at raw literals in place. *Used receives the section's length.
+ */
+static EFI_STATUS
+zstd_literals(struct zstd_ctx *z, const UINT8 *In, UINTN Len, UINTN BlockMax, UINTN *Used)
+{
+    EFI_STATUS Status;
+    UINTN Type, Format, Regen, Comp, Header, TableLen;
+    UINT64 h;
+
+    if (Len == 0)
+        return EFI_COMPROMISED_DATA;
+    Type = In[0] & 3;
+    Format = (In[0] >> 2) & 3;
+
+    if (Type == LIT_RAW || Type == LIT_RLE) {
+        switch (Format) {
+        case 1:
+            Header = 2;
+            break;
+        case 3:
+            Header = 3;
+            break;
+        default:
+            Header = 1;
+            break;
+        }
+        if (Len < Header)
+            return EFI_COMPROMISED_DATA;
+        if (Header == 1)
+            Regen = In[0] >> 3;
+        else if (Header == 2)
+            Regen = ZSTD_GET16(In) >> 4;
+        else
+            Regen = ZSTD_GET24(In) >> 4;
+        if (Regen > BlockMax)
+            return EFI_COMPROMISED_DATA;
+
+        if (Type == LIT_RAW) {
+            if (Len - Header < Regen)
+                return EFI_COMPROMISED_DATA;
+            z->LitPtr = In + Header;
+            z->LitEnd = z->LitPtr + Regen;
+            z->LitLimit = In + Len;
+            *Used = Header + Regen;
+        } else {
+            if (Len - Header < 1)
+                return EFI_COMPROMISED_DATA;
+            SetMem(z->Lit, Regen, In[Header]);
+            z->LitPtr = z->Lit;
+            z->LitEnd = z->Lit + Regen;
+            z->LitLimit = z->Lit + sizeof(z->Lit);
+            *Used = Header + 1;
+        }
+        return EFI_SUCCESS;
+    }
+
+    Header = Format < 2 ? 3 : Format + 2;
+    if (Len < Header)
+        return EFI_COMPROMISED_DATA;
+    h = ZSTD_GET24(In);
+    if (Header > 3)
+        h |= (UINT64)In[3] << 24;
+    if (Header > 4)
+        h |= (UINT64)In[4] << 32;
+    switch (Header) {
+    case 3:
+        Regen = (h >> 4) & 0x3FF;
+        Comp = (h >> 14) & 0x3FF;
+        break;
+    case 4:
+        Regen = (h >> 4) & 0x3FFF;
+        Comp = (h >> 18) & 0x3FFF;
+        break;
+    default:
+        Regen = (h >> 4) & 0x3FFFF;
+        Comp = (h >> 22) & 0x3FFFF;
+        break;
+    }
+    if (Regen > BlockMax || Comp > Len - Header)
+        return EFI_COMPROMISED_DATA;
+
+    In += Header;
+    if (Type == LIT_COMPRESSED) {
+        Status = huf_read_table(&z->T, In, Comp, &TableLen);
+        if (EFI_ERROR(Status))
+            return Status;
+    } else {
+        if (!(z->T.Ready & READY_HUF))
+            return EFI_COMPROMISED_DATA;
+        TableLen = 0;
+    }
+
+    if (Format == 0)
+        Status = huf_stream(&z->T, In + TableLen, Comp - TableLen, z->Lit, Regen);
+    else
+        Status = huf_streams4(&z->T, In + TableLen, Comp - TableLen, z->Lit, Regen);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    z->LitPtr = z->Lit;
+    z->LitEnd = z->Lit + Regen;
+    z->LitLimit = z->Lit + sizeof(z->Lit);
+    *Used = Header + Comp;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Set up one of the three sequence tables by its compression mode.
+ * *Used receives the length of its description.
+ */
+static EFI_STATUS
+zstd_seq_table(struct zstd_tables *T, UINTN Which, UINTN Mode, const UINT8 *In, UINTN Len, UINTN *Used)
+{
+    static struct seq_entry Predefined[3][1 << FSE_MAX_LOG];
+    static UINT8 PredefinedLog[3];
+    static BOOLEAN PredefinedReady;
+    static const UINTN MaxSymbol[3] = { LL_MAX_SYMBOL, OF_MAX_SYMBOL, ML_MAX_SYMBOL };
+    static const UINTN MaxLog[3] = { LL_MAX_LOG, OF_MAX_LOG, ML_MAX_LOG };
+    static const UINT32 *const Base[3] = { ll_base, NULL, ml_base };
+    static const UINT8 *const Extra[3] = { ll_extra, NULL, ml_extra };
+    static const UINT8 Ready[3] = { READY_LL, READY_OF, READY_ML };
+    struct seq_entry *Table;
+    UINT8 *Log;
+    INT16 Counts[FSE_MAX_SYMBOL + 1];
+    EFI_STATUS Status;
+    UINTN l, n, s;
+
+    switch (Which) {
+    case 0:
+        Table = T->LL;
+        Log = &T->LLLog;
+        break;
+    case 1:
+        Table = T->OF;
+        Log = &T->OFLog;
+        break;
+    default:
+        Table = T->ML;
+        Log = &T->MLLog;
+        break;
+    }
+
+    *Used = 0;
+    switch (Mode) {
+    case MODE_PREDEFINED:
+        if (!PredefinedReady) {
+            seq_build(Predefined[0], ll_default, LL_MAX_SYMBOL + 1, 6, ll_base, ll_extra);
+            seq_build(Predefined[1], of_default, OF_DEFAULT_SYMBOLS, 5, NULL, NULL);
+            seq_build(Predefined[2], ml_default, ML_MAX_SYMBOL + 1, 6, ml_base, ml_extra);
+            PredefinedLog[0] = 6;
+            PredefinedLog[1] = 5;
+            PredefinedLog[2] = 6;
+            PredefinedReady = TRUE;
+        }
+        *Log = PredefinedLog[Which];
+        CopyMem(Table, Predefined[Which], sizeof(*Table) << *Log);
+        break;
+
+    case MODE_RLE:
+        if (Len < 1 || In[0] > MaxSymbol[Which])
+            return EFI_COMPROMISED_DATA;
+        s = In[0];
+        Table[0].Base = Base[Which] ? Base[Which][s] : (UINT32)1 << s;
+        Table[0].Extra = Extra[Which] ? Extra[Which][s] : (UINT8)s;
+        Table[0].Next = 0;
+        Table[0].Bits = 0;
+        *Log = 0;
+        *Used = 1;
+        break;
+
+    case MODE_FSE:
+        Status = fse_read_counts(In, Len, Counts, MaxSymbol[Which], MaxLog[Which], &l, &n, Used);
+        if (EFI_ERROR(Status))
+            return Status;
+        Status = seq_build(Table, Counts, n, l, Base[Which], Extra[Which]);
+        if (EFI_ERROR(Status))
+            return Status;
+        *Log = (UINT8)l;
+        break;
+
+    default:
+        if (!(T->Ready & Ready[Which]))
+            return EFI_COMPROMISED_DATA;
+        return EFI_SUCCESS;
+    }
+
+    T->Ready |= Ready[Which];
+    return EFI_SUCCESS;
+}
+
+/*
+ * Copy a match that starts offset bytes back, in the dictionary's content
+ * for as far as it reaches before the frame.
+ */
+static EFI_STATUS
+copy_match_dict(struct zstd_ctx *z, UINT8 *out, UINTN len, UINTN offset)
+{
+    UINTN Back = (UINTN)(out - z->FrameStart);
+    UINTN n;
+
+    if (offset - Back > z->DictLen)
+        return EFI_COMPROMISED_DATA;
+    n = offset - Back;
+    if (n > len)
+        n = len;
+    CopyMem(out, (VOID *)(z->Dict + z->DictLen - (offset - Back)), n);
+    for (out += n, len -= n; len > 0; len--, out++)
+        *out = *(out - offset);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Decode the sequences section of a block and carry out each sequence,
+ * then copy the literals left over. The literals, repeat offsets and
+ * bitstream are kept in locals in the loop, where stores to the output
+ * would otherwise make the compiler reload them.
+ */
+static EFI_STATUS
+zstd_sequences(struct zstd_ctx *z, const UINT8 *In, UINTN Len, UINT8 **OutPos, UINT8 *OutEnd)
+{
+    struct zstd_tables *T = &z->T;
+    const struct seq_entry *ll, *of, *ml;
+    const UINT8 *lit = z->LitPtr;
+    const UINT8 *lit_end = z->LitEnd;
+    const UINT8 *lit_limit = z->LitLimit;
+    UINT8 *out = *OutPos;
+    UINT8 *p, *end;
+    struct bits b;
+    EFI_STATUS Status;
+    UINTN NumSeq, Used, Modes, i, llState, ofState, mlState;
+    UINTN LitLen, MatchLen, Offset, Value, Rep0, Rep1, Rep2;
+
+    if (Len == 0)
+        return EFI_COMPROMISED_DATA;
+    if (In[0] < 128) {
+        NumSeq = In[0];
+        Used = 1;
+    } else if (In[0] < 255) {
+        if (Len < 2)
+            return EFI_COMPROMISED_DATA;
+        NumSeq = ((In[0] - 128) << 8) + In[1];
+        Used = 2;
+    } else {
+        if (Len < 3)
+            return EFI_COMPROMISED_DATA;
+        NumSeq = ZSTD_GET16(In + 1) + 0x7F00;
+        Used = 3;
+    }
+    In += Used;
+    Len -= Used;
+
+    if (NumSeq > 0) {
+        if (Len < 1 || (In[0] & 3))
+            return EFI_COMPROMISED_DATA;
+        Modes = In[0];
+        In++;
+        Len--;
+        for (i = 0; i < 3; i++) {
+            Status = zstd_seq_table(T, i, (Modes >> (6 - 2 * i)) & 3, In, Len, &Used);
+            if (EFI_ERROR(Status))
+                return Status;
+            In += Used;
+            Len -= Used;
+        }
+
+        Status = bits_init(&b, In, Len);
+        if (EFI_ERROR(Status))
+            return Status;
+        llState = bits_read(&b, T->LLLog);
+        ofState = bits_read(&b, T->OFLog);
+        mlState = bits_read(&b, T->MLLog);
+        Rep0 = T->Rep[0];
+        Rep1 = T->Rep[1];
+        Rep2 = T->Rep[2];
+
+        for (i = 0; i < NumSeq; i++) {
+            ll = &T->LL[llState];
+            of = &T->OF[ofState];
+            ml = &T->ML[mlState];
+
+            // Offset and match length, then literal length and the next states.
+            bits_reload(&b);
+            Value = of->Base + bits_read(&b, of->Extra);
+            MatchLen = ml->Base + bits_read(&b, ml->Extra);
+            bits_reload(&b);
+            LitLen = ll->Base + bits_read(&b, ll->Extra);
+
+            if (Value > 3) {
+                Offset = Value - 3;
+                Rep2 = Rep1;
+                Rep1 = Rep0;
+                Rep0 = Offset;
+            } else {
+                // Repeat offsets; with no literals, they shift by one.
+                Value = Value - 1 + (LitLen == 0);
+                if (Value == 0) {
+                    Offset = Rep0;
+                } else {
+                    if (Value == 1) {
+                        Offset = Rep1;
+                    } else {
+                        Offset = Value == 2 ? Rep2 : Rep0 - 1;
+                        Rep2 = Rep1;
+                    }
+                    Rep1 = Rep0;
+                    Rep0 = Offset;
+                }
+            }
+
+            if (i + 1 < NumSeq) {
+                llState = ll->Next + bits_read(&b, ll->Bits);
+                mlState = ml->Next + bits_read(&b, ml->Bits);
+                ofState = of->Next + bits_read(&b, of->Bits);
+            }
+
+            if (LitLen > (UINTN)(lit_end - lit) || LitLen + MatchLen > (UINTN)(OutEnd - out) ||
+                Offset == 0 || Offset > z->MaxOffset)
+                return EFI_COMPROMISED_DATA;
+
+            // Room for the match's chunks leaves room for the literals' too.
+            end = out + LitLen;
+            if ((UINTN)(OutEnd - end) >= MatchLen + WILD_MARGIN && (UINTN)(lit_limit - lit) >= LitLen + 16) {
+                do {
+                    copy16(out, lit);
+                    lit += 16;
+                    out += 16;
+                } while (out < end);
+                lit -= out - end;
+            } else {
+                CopyMem(out, (VOID *)lit, LitLen);
+                lit += LitLen;
+            }
+            out = end;
+
+            if (Offset > (UINTN)(out - z->FrameStart)) {
+                Status = copy_match_dict(z, out, MatchLen, Offset);
+                if (EFI_ERROR(Status))
+                    return Status;
+            } else if ((UINTN)(OutEnd - out) >= MatchLen + WILD_MARGIN) {
+                copy_match_wild(out, MatchLen, Offset);
+            } else {
+                for (p = out, end = out + MatchLen; p < end; p++)
+                    *p = *(p - Offset);
+            }
+            out += MatchLen;
+        }
+
+        if (!bits_done(&b))
+            return EFI_COMPROMISED_DATA;
+        T->Rep[0] = (UINT32)Rep0;
+        T->Rep[1] = (UINT32)Rep1;
+        T->Rep[2] = (UINT32)Rep2;
+    } else if (Len != 0) {
+        return EFI_COMPROMISED_DATA;
+    }
+
+    LitLen = (UINTN)(lit_end - lit);
+    if (LitLen > (UINTN)(OutEnd - out))
+        return EFI_COMPROMISED_DATA;
+    CopyMem(out, (VOID *)lit, LitLen);
+    *OutPos = out + LitLen;
+    return EFI_SUCCESS;
+}
+
+/* Decode one compressed block into *OutPos, going no further than OutEnd. */
+static EFI_STATUS
+zstd_block(struct zstd_ctx *z, const UINT8 *In, UINTN Len, UINTN BlockMax, UINT8 **OutPos, UINT8 *OutEnd)
+{
+    EFI_STATUS Status;
+    UINTN Used;
+
+    Status = zstd_literals(z, In, Len, BlockMax, &Used);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    if ((UINTN)(OutEnd - *OutPos) > BlockMax)
+        OutEnd = *OutPos + BlockMax;
+    return zstd_sequences(z, In + Used, Len - Used, OutPos, OutEnd);
+}
+
+/* Get the next piece of input. */
+static EFI_STATUS
+zstd_next(struct zstd_input *s)
+{
+    EFI_STATUS Status;
+
+    Status = s->Input(s->Context, &s->Piece, &s->Left);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (s->Left == 0)
+        return EFI_END_OF_FILE;
+    s->Fed += s->Left;
+    return EFI_SUCCESS;
+}
+
+/* Copy the next Len bytes of input to Buf, or skip them if Buf is NULL. */
+static EFI_STATUS
+zstd_read(struct zstd_input *s, VOID *Buf, UINTN Len)
+{
+    UINT8 *p = Buf;
+    UINTN n;
+    EFI_STATUS Status;
+
+    while (Len > 0) {
+        if (s->Left == 0) {
+            Status = zstd_next(s);
+            if (EFI_ERROR(Status))
+                return Status;
+        }
+        n = Len < s->Left ? Len : s->Left;
+        if (p) {
+            CopyMem(p, s->Piece, n);
+            p += n;
+        }
+        s->Piece += n;
+        s->Left -= n;
+        Len -= n;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/*
+ * Point *Data at the next Len bytes of input: in place when they are in
+ * the current piece, otherwise gathered into the staging buffer.
+ */
+static EFI_STATUS
+zstd_data(struct zstd_input *s, UINTN Len, const UINT8 **Data)
+{
+    if (s->Left >= Len) {
+        *Data = s->Piece;
+        s->Piece += Len;
+        s->Left -= Len;
+        return EFI_SUCCESS;
+    }
+
+    if (!s->Block) {
+        s->Block = AllocatePool(ZSTD_BLOCK_MAX);
+        if (!s->Block)
+            return EFI_OUT_OF_RESOURCES;
+    }
+
+    *Data = s->Block;
+    return zstd_read(s, s->Block, Len);
+}
+
+/*
+ * Decode one frame, whose magic number has been read. *OutPos tracks the
+ * end of the output decoded so far.
+ */
+static EFI_STATUS
+zstd_frame(struct zstd_ctx *z, struct zstd_input *s, inflate_progress_fn Progress,
+    UINT8 *Out, UINT8 *OutEnd, UINT8 **OutPos)
+{
+    EFI_STATUS Status;
+    const UINT8 *Data;
+    UINT8 Desc[14];
+    UINT8 *FrameStart = *OutPos;
+    UINT8 *out = FrameStart;
+    UINTN n, Fcs, IdLen, BlockMax, Exp;
+    UINT64 ContentSize = 0, WindowSize;
+    UINT32 DictId = 0, Header, Size;
+    UINT8 Flags;
+    BOOLEAN Last;
+
+    Status = zstd_read(s, Desc, 1);
+    if (EFI_ERROR(Status))
+        return Status;
+    Flags = Desc[0];
+    if (Flags & ZSTD_FHD_RESERVED)
+        return EFI_COMPROMISED_DATA;
+
+    Fcs = FcsSize[Flags >> ZSTD_FHD_FCS_SHIFT];
+    if (Fcs == 0 && (Flags & ZSTD_FHD_SINGLE_SEGMENT))
+        Fcs = 1;
+    IdLen = DictIdSize[Flags & ZSTD_FHD_DICT_ID_MASK];
+    n = ((Flags & ZSTD_FHD_SINGLE_SEGMENT) ? 0 : 1) + IdLen + Fcs;
+    Status = zstd_read(s, Desc + 1, n);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    n = 1;
+    WindowSize = 0;
+    if (!(Flags & ZSTD_FHD_SINGLE_SEGMENT)) {
+        Exp = (Desc[n] >> 3) + ZSTD_WINDOWLOG_MIN;
+        WindowSize = (UINT64)1 << Exp;
+        WindowSize += (WindowSize >> 3) * (Desc[n] & 7);
+        n++;
+    }
+    switch (IdLen) {
+    case 1:
+        DictId = Desc[n];
+        break;
+    case 2:
+        DictId = ZSTD_GET16(Desc + n);
+        break;
+    case 4:
+        DictId = ZSTD_GET32(Desc + n);
+        break;
+    }
+    n += IdLen;
+    switch (Fcs) {
+    case 1:
+        ContentSize = Desc[n];
+        break;
+    case 2:
+        ContentSize = ZSTD_GET16(Desc + n) + 256;
+        break;
+    case 4:
+        ContentSize = ZSTD_GET32(Desc + n);
+        break;
+    case 8:
+        ContentSize = ZSTD_GET32(Desc + n) | ((UINT64)ZSTD_GET32(Desc + n + 4) << 32);
+        break;
+    }
+    if (Flags & ZSTD_FHD_SINGLE_SEGMENT)
+        WindowSize = ContentSize;
+
+    if (WindowSize > ((UINT64)1 << ZstdMaxWindowLog))
+        return EFI_UNSUPPORTED;
+    if (Fcs && ContentSize > (UINT64)(OutEnd - out))
+        return EFI_COMPROMISED_DATA;
+    BlockMax = WindowSize < ZSTD_BLOCK_MAX ? (UINTN)WindowSize : ZSTD_BLOCK_MAX;
+
+    if (DictId) {
+        if (!Dictionary || Dictionary->Id != DictId)
+            return EFI_NOT_FOUND;
+        CopyMem(&z->T, &Dictionary->Tables, sizeof(z->T));
+        z->Dict = Dictionary->Content;
+        z->DictLen = Dictionary->ContentLen;
+    } else {
+        z->T.Ready = 0;
+        z->T.Rep[0] = 1;
+        z->T.Rep[1] = 4;
+        z->T.Rep[2] = 8;
+        z->Dict = NULL;
+        z->DictLen = 0;
+    }
+    z->FrameStart = FrameStart;
+    z->MaxOffset = WindowSize + z->DictLen;
+
+    do {
+        Status = zstd_read(s, Desc, 3);
+        if (EFI_ERROR(Status))
+            return Status;
+        Header = ZSTD_GET24(Desc);
+        Last = Header & 1;
+        Size = Header >> 3;
+        if (Size > BlockMax)
+            return EFI_COMPROMISED_DATA;
+
+        switch ((Header >> 1) & 3) {
+        case BLOCK_RAW:
+            if ((UINTN)(OutEnd - out) < Size)
+                return EFI_COMPROMISED_DATA;
+            Status = zstd_read(s, out, Size);
+            if (EFI_ERROR(Status))
+                return Status;
+            out += Size;
+            break;
+
+        case BLOCK_RLE:
+            if ((UINTN)(OutEnd - out) < Size)
+                return EFI_COMPROMISED_DATA;
+            Status = zstd_read(s, Desc, 1);
+            if (EFI_ERROR(Status))
+                return Status;
+            SetMem(out, Size, Desc[0]);
+            out += Size;
+            break;
+
+        case BLOCK_COMPRESSED:
+            Status = zstd_data(s, Size, &Data);
+            if (EFI_ERROR(Status))
+                return Status;
+            Status = zstd_block(z, Data, Size, BlockMax, &out, OutEnd);
+            if (EFI_ERROR(Status))
+                return Status;
+            break;
+
+        default:
+            return EFI_COMPROMISED_DATA;
+        }
+        *OutPos = out;
+
+        if (Progress)
+            Progress(s->Context, (UINTN)(out - Out));
+    } while (!Last);
+
+    if (Fcs && ContentSize != (UINT64)(out - FrameStart))
+        return EFI_COMPROMISED_DATA;
+
+    if (Flags & ZSTD_FHD_CHECKSUM) {
+        Status = zstd_read(s, Desc, 4);
+        if (EFI_ERROR(Status))
+            return Status;
+        if ((UINT32)xxh64(FrameStart, (UINTN)(out - FrameStart), 0) != ZSTD_GET32(Desc))
+            return EFI_CRC_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/* The decoder state is large; keep one around rather than allocate per call. */
+static struct zstd_ctx *
+zstd_get_ctx(VOID)
+{
+    struct zstd_ctx *z;
+
+    if (CachedCtx && !CachedCtx->Busy) {
+        z = CachedCtx;
+    } else {
+        z = AllocatePool(sizeof(*z));
+        if (!z)
+            return NULL;
+        if (!CachedCtx)
+            CachedCtx = z;
+    }
+    z->Busy = TRUE;
+    return z;
+}
+
+static VOID
+zstd_put_ctx(struct zstd_ctx *z)
+{
+    z->Busy = FALSE;
+    if (z != CachedCtx)
+        FreePool(z);
+}
+
+BOOLEAN
+IsZstd(const VOID *Header)
+{
+    const UINT8 *p = Header;
+
+    return ZSTD_GET32(p) == ZSTD_MAGIC;
+}
+
+/*
+ * ZstdStream: decode the zstd frames whose input arrives in pieces from
+ * Input, one after another into one contiguous buffer. Skippable frames
+ * are passed over. The frames end with the input, or at anything that is
+ * not another frame, such as zero padding at the end of a partition.
+ */
+EFI_STATUS
+ZstdStream(inflate_input_fn Input, inflate_progress_fn Progress, VOID *Context,
+    VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct zstd_input s;
+    struct zstd_ctx *z;
+    EFI_STATUS Status;
+    UINT8 Word[4];
+    UINT8 *OutPos = Out;
+    UINT32 Magic;
+    UINTN Frames = 0;
+
+    if (!Input || !Out || !OutLen)
+        return EFI_INVALID_PARAMETER;
+
+    z = zstd_get_ctx();
+    if (!z)
+        return EFI_OUT_OF_RESOURCES;
+
+    s.Input = Input;
+    s.Context = Context;
+    s.Piece = NULL;
+    s.Left = 0;
+    s.Fed = 0;
+    s.Block = NULL;
+
+    BootPhaseBegin(BOOT_PHASE_DECOMPRESS);
+    for (;;) {
+        if (s.Left == 0 && Frames > 0) {
+            Status = zstd_next(&s);
+            if (Status == EFI_END_OF_FILE) {
+                Status = EFI_SUCCESS;
+                break;
+            }
+            if (EFI_ERROR(Status))
+                break;
+        }
+
+        Status = zstd_read(&s, Word, sizeof(Word));
+        if (EFI_ERROR(Status))
+            break;
+        Magic = ZSTD_GET32(Word);
+
+        if (Magic == ZSTD_MAGIC) {
+            Status = zstd_frame(z, &s, Progress, Out, (UINT8 *)Out + OutSize, &OutPos);
+        } else if ((Magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+            Status = zstd_read(&s, Word, sizeof(Word));
+            if (!EFI_ERROR(Status))
+                Status = zstd_read(&s, NULL, ZSTD_GET32(Word));
+        } else {
+            if (Frames == 0)
+                Status = EFI_UNSUPPORTED;
+            break;
+        }
+        if (EFI_ERROR(Status))
+            break;
+        Frames++;
+    }
+    BootPhaseEnd(BOOT_PHASE_DECOMPRESS);
+
+    if (s.Block)
+        FreePool(s.Block);
+    zstd_put_ctx(z);
+
+    *OutLen = (UINTN)(OutPos - (UINT8 *)Out);
+    BootCounterAdd(BOOT_CTR_ZSTD_IN, s.Fed - s.Left);
+    BootCounterAdd(BOOT_CTR_ZSTD_OUT, *OutLen);
+
+    // The input ending inside a frame means it was cut short.
+    if (Status == EFI_END_OF_FILE)
+        return EFI_COMPROMISED_DATA;
+    return Status;
+}
+
+struct zstd_buffer {
+    const UINT8 *Buf;
+    UINTN Len;
+};
+
+/* inflate_input_fn: the whole buffer, then the end of the input. */
+static EFI_STATUS
+zstd_buffer_input(VOID *Context, UINT8 **Buf, UINTN *Len)
+{
+    struct zstd_buffer *b = Context;
+
+    *Buf = (UINT8 *)b->Buf;
+    *Len = b->Len;
+    b->Len = 0;
+    return EFI_SUCCESS;
+}
+
+/*
+ * ZstdBuffer: decode zstd frames that are all in memory. Also the
+ * decompress_fn for SquashFS, whose blocks are single frames.
+ */
+EFI_STATUS
+ZstdBuffer(const VOID *In, UINTN InLen, VOID *Out, UINTN OutSize, UINTN *OutLen)
+{
+    struct zstd_buffer b;
+
+    if (!In)
+        return EFI_INVALID_PARAMETER;
+
+    b.Buf = In;
+    b.Len = InLen;
+    return ZstdStream(zstd_buffer_input, NULL, &b, Out, OutSize, OutLen);
+}
+
+/*
+ * ZstdDecodedBound: an upper bound on the decoded size of the zstd frames
+ * in memory at In, from each frame's content size if it records one,
+ * otherwise from its blocks: a raw or RLE block's size is in its header,
+ * a compressed one is at most the block maximum.
+ */
+EFI_STATUS
+ZstdDecodedBound(const VOID *In, UINTN InLen, UINT64 *Bound)
+{
+    const UINT8 *p = In;
+    const UINT8 *end = p + InLen;
+    UINT64 Total = 0, Frame, WindowSize, ContentSize;
+    UINTN Fcs, BlockMax;
+    UINT32 Magic, Header, Size;
+    UINT8 Flags;
+
+    if (!In || !Bound || InLen < 4)
+        return EFI_INVALID_PARAMETER;
+    if (!IsZstd(In))
+        return EFI_UNSUPPORTED;
+
+    while (end - p >= 4) {
+        Magic = ZSTD_GET32(p);
+        if ((Magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+            if (end - p < 8 || (UINTN)(end - p - 8) < ZSTD_GET32(p + 4))
+                return EFI_COMPROMISED_DATA;
+            p += 8 + ZSTD_GET32(p + 4);
+            continue;
+        }
+        if (Magic != ZSTD_MAGIC)
+            break;
+        if (end - p < 5)
+            return EFI_COMPROMISED_DATA;
+
+        Flags = p[4];
+        Fcs = FcsSize[Flags >> ZSTD_FHD_FCS_SHIFT];
+        if (Fcs == 0 && (Flags & ZSTD_FHD_SINGLE_SEGMENT))
+            Fcs = 1;
+        p += 5;
+        WindowSize = 0;
+        if (!(Flags & ZSTD_FHD_SINGLE_SEGMENT)) {
+            if (p >= end)
+                return EFI_COMPROMISED_DATA;
+            WindowSize = (UINT64)1 << ((*p >> 3) + ZSTD_WINDOWLOG_MIN);
+            WindowSize += (WindowSize >> 3) * (*p & 7);
+            p++;
+        }
+        if ((UINTN)(end - p) < DictIdSize[Flags & ZSTD_FHD_DICT_ID_MASK] + Fcs + 3)
+            return EFI_COMPROMISED_DATA;
+        p += DictIdSize[Flags & ZSTD_FHD_DICT_ID_MASK];
+        ContentSize = 0;
+        switch (Fcs) {
+        case 1:
+            ContentSize = p[0];
+            break;
+        case 2:
+            ContentSize = ZSTD_GET16(p) + 256;
+            break;
+        case 4:
+            ContentSize = ZSTD_GET32(p);
+            break;
+        case 8:
+            ContentSize = ZSTD_GET32(p) | ((UINT64)ZSTD_GET32(p + 4) << 32);
+            break;
+        }
+        p += Fcs;
+        if (Flags & ZSTD_FHD_SINGLE_SEGMENT)
+            WindowSize = ContentSize;
+        BlockMax = WindowSize < ZSTD_BLOCK_MAX ? (UINTN)WindowSize : ZSTD_BLOCK_MAX;
+
+        Frame = 0;
+        do {
+            if (end - p < 3)
+                return EFI_COMPROMISED_DATA;
+            Header = ZSTD_GET24(p);
+            Size = Header >> 3;
+            p += 3;
+            switch ((Header >> 1) & 3) {
+            case BLOCK_RAW:
+                Frame += Size;
+                break;
+            case BLOCK_RLE:
+                Frame += Size;
+                Size = 1;
+                break;
+            default:
+                Frame += BlockMax;
+                break;
+            }
+            if ((UINTN)(end - p) < Size)
+                return EFI_COMPROMISED_DATA;
+            p += Size;
+        } while (!(Header & 1));
+        if (Flags & ZSTD_FHD_CHECKSUM) {
+            if (end - p < 4)
+                return EFI_COMPROMISED_DATA;
+            p += 4;
+        }
+
+        Total += Fcs ? ContentSize : Frame;
+    }
+
+    *Bound = Total;
+    return EFI_SUCCESS;
+}
+
+/*
+ * ZstdInPlaceMargin: as Lz4InPlaceMargin(), for ZstdBuffer(). A block's
+ * sequences are read from its end backwards, and raw literals are used
+ * where they lie, so the whole of the block being decoded has to survive
+ * until it is done; that costs up to a block on top of the headers.
+ */
+UINTN
+ZstdInPlaceMargin(UINTN InLen)
+{
+    return (InLen >> 8) + ZSTD_BLOCK_MAX + 256 + WILD_MARGIN;
+}
+
+/*
+ * ZstdSetDictionary: use the dictionary Dict, as written by "zstd --train",
+ * for frames that name it; NULL drops it. The dictionary is copied.
+ */
+EFI_STATUS
+ZstdSetDictionary(const VOID *Dict, UINTN Len)
+{
+    struct zstd_dict *d;
+    const UINT8 *p, *end;
+    INT16 Counts[FSE_MAX_SYMBOL + 1];
+    static const UINTN Order[3] = { 1, 2, 0 };
+    static const UINTN MaxSymbol[3] = { LL_MAX_SYMBOL, OF_MAX_SYMBOL, ML_MAX_SYMBOL };
+    static const UINTN MaxLog[3] = { LL_MAX_LOG, OF_MAX_LOG, ML_MAX_LOG };
+    static const UINT32 *const Base[3] = { ll_base, NULL, ml_base };
+    static const UINT8 *const Extra[3] = { ll_extra, NULL, ml_extra };
+    struct seq_entry *Table[3];
+    UINT8 *Log[3];
+    EFI_STATUS Status;
+    UINTN i, w, l, n, Used;
+
+    if (Dictionary) {
+        FreePool(Dictionary->Buf);
+        FreePool(Dictionary);
+        Dictionary = NULL;
+    }
+    if (!Dict)
+        return EFI_SUCCESS;
+
+    if (Len < 8 || ZSTD_GET32((const UINT8 *)Dict) != ZSTD_DICT_MAGIC)
+        return EFI_UNSUPPORTED;
+
+    d = AllocateZeroPool(sizeof(*d));
+    if (!d)
+        return EFI_OUT_OF_RESOURCES;
+    d->Buf = AllocatePool(Len);
+    if (!d->Buf) {
+        FreePool(d);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    CopyMem(d->Buf, (VOID *)Dict, Len);
+    p = d->Buf;
+    end = p + Len;
+
+    d->Id = ZSTD_GET32(p + 4);
+    if (d->Id == 0) {
+        Status = EFI_COMPROMISED_DATA;
+        goto fail;
+    }
+    p += 8;
+
+    Status = huf_read_table(&d->Tables, p, (UINTN)(end - p), &Used);
+    if (EFI_ERROR(Status))
+        goto fail;
+    p += Used;
+
+    // The tables are stored offsets first, then match and literal lengths.
+    Table[0] = d->Tables.LL;
+    Table[1] = d->Tables.OF;
+    Table[2] = d->Tables.ML;
+    Log[0] = &d->Tables.LLLog;
+    Log[1] = &d->Tables.OFLog;
+    Log[2] = &d->Tables.MLLog;
+    for (i = 0; i < 3; i++) {
+        w = Order[i];
+        Status = fse_read_counts(p, (UINTN)(end - p), Counts, MaxSymbol[w], MaxLog[w], &l, &n, &Used);
+        if (EFI_ERROR(Status))
+            goto fail;
+        Status = seq_build(Table[w], Counts, n, l, Base[w], Extra[w]);
+        if (EFI_ERROR(Status))
+            goto fail;
+        *Log[w] = (UINT8)l;
+        p += Used;
+    }
+
+    if (end - p < 12) {
+        Status = EFI_COMPROMISED_DATA;
+        goto fail;
+    }
+    for (i = 0; i < 3; i++) {
+        d->Tables.Rep[i] = ZSTD_GET32(p + 4 * i);
+        if (d->Tables.Rep[i] == 0 || d->Tables.Rep[i] > (UINTN)(end - p - 12)) {
+            Status = EFI_COMPROMISED_DATA;
+            goto fail;
+        }
+    }
+    p += 12;
+
+    d->Tables.Ready = READY_ALL;
+    d->Content = p;
+    d->ContentLen = (UINTN)(end - p);
+    Dictionary = d;
+    return EFI_SUCCESS;
+
+fail:
+    FreePool(d->Buf);
+    FreePool(d);
+    return Status;
+}
+
+/* ZstdDictionaryId: the ID of the dictionary in use, or 0 for none. */
+UINT32
+ZstdDictionaryId(VOID)
+{
+    return Dictionary ? Dictionary->Id : 0;
+}
@@ -0,0 +1,657 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * efi.h
+ * Thin host-side stand-in for the GNU-EFI headers.
+ *
+ * Only the subset of types, protocols and status codes used by HeliumBoot is
+ * provided, so that the filesystem and VTOC code can be compiled and profiled
+ * as an ordinary Linux program. Layouts follow the UEFI specification, but
+ * nothing here is meant to be passed to real firmware.
+ */
+
+#ifndef _HOST_EFI_H_
+#define _HOST_EFI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EFIAPI
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST const
+
+#ifndef TRUE
+#define TRUE	((BOOLEAN)1)
+#define FALSE	((BOOLEAN)0)
+#endif
+
+typedef uint8_t UINT8;
+typedef int8_t INT8;
+typedef uint16_t UINT16;
+typedef int16_t INT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+typedef uintptr_t UINTN;
+typedef intptr_t INTN;
+typedef UINT8 BOOLEAN;
+typedef char CHAR8;
+typedef UINT16 CHAR16;
+typedef void VOID;
+
+typedef UINTN EFI_STATUS;
+typedef UINT64 EFI_LBA;
+typedef UINT64 EFI_PHYSICAL_ADDRESS;
+typedef UINT64 EFI_VIRTUAL_ADDRESS;
+typedef UINTN EFI_TPL;
+typedef VOID *EFI_HANDLE;
+typedef VOID *EFI_EVENT;
+
+typedef struct {
+	UINT32 Data1;
+	UINT16 Data2;
+	UINT16 Data3;
+	UINT8 Data4[8];
+} EFI_GUID;
+
+/*
+ * Status codes.
+ */
+#define EFI_MAX_BIT		((UINTN)1 << (sizeof(UINTN) * 8 - 1))
+#define EFIERR(a)		(EFI_MAX_BIT | (a))
+#define EFI_ERROR(a)		(((INTN)(a)) < 0)
+
+#define EFI_SUCCESS		0
+#define EFI_LOAD_ERROR		EFIERR(1)
+#define EFI_INVALID_PARAMETER	EFIERR(2)
+#define EFI_UNSUPPORTED		EFIERR(3)
+#define EFI_BAD_BUFFER_SIZE	EFIERR(4)
+#define EFI_BUFFER_TOO_SMALL	EFIERR(5)
+#define EFI_NOT_READY		EFIERR(6)
+#define EFI_DEVICE_ERROR	EFIERR(7)
+#define EFI_WRITE_PROTECTED	EFIERR(8)
+#define EFI_OUT_OF_RESOURCES	EFIERR(9)
+#define EFI_VOLUME_CORRUPTED	EFIERR(10)
+#define EFI_VOLUME_FULL		EFIERR(11)
+#define EFI_NO_MEDIA		EFIERR(12)
+#define EFI_MEDIA_CHANGED	EFIERR(13)
+#define EFI_NOT_FOUND		EFIERR(14)
+#define EFI_ACCESS_DENIED	EFIERR(15)
+#define EFI_NO_RESPONSE		EFIERR(16)
+#define EFI_NO_MAPPING		EFIERR(17)
+#define EFI_TIMEOUT		EFIERR(18)
+#define EFI_NOT_STARTED		EFIERR(19)
+#define EFI_ALREADY_STARTED	EFIERR(20)
+#define EFI_ABORTED		EFIERR(21)
+#define EFI_PROTOCOL_ERROR	EFIERR(24)
+#define EFI_INCOMPATIBLE_VERSION EFIERR(25)
+#define EFI_SECURITY_VIOLATION	EFIERR(26)
+#define EFI_CRC_ERROR		EFIERR(27)
+#define EFI_END_OF_MEDIA	EFIERR(28)
+#define EFI_END_OF_FILE		EFIERR(31)
+#define EFI_COMPROMISED_DATA	EFIERR(33)
+
+#define EFIWARN(a)		(a)
+#define EFI_WARN_DELETE_FAILURE	EFIWARN(2)
+
+#define EFI_PAGE_SIZE		4096
+#define EFI_PAGE_MASK		0xFFF
+#define EFI_PAGE_SHIFT		12
+#define EFI_SIZE_TO_PAGES(a)	(((a) >> EFI_PAGE_SHIFT) + (((a) & EFI_PAGE_MASK) ? 1 : 0))
+
+/*
+ * Firmware calls are plain C calls on the host.
+ */
+#define uefi_call_wrapper(func, va_num, ...)	(func)(__VA_ARGS__)
+
+/*
+ * Memory.
+ */
+typedef enum {
+	EfiReservedMemoryType,
+	EfiLoaderCode,
+	EfiLoaderData,
+	EfiBootServicesCode,
+	EfiBootServicesData,
+	EfiRuntimeServicesCode,
+	EfiRuntimeServicesData,
+	EfiConventionalMemory,
+	EfiUnusableMemory,
+	EfiACPIReclaimMemory,
+	EfiACPIMemoryNVS,
+	EfiMemoryMappedIO,
+	EfiMemoryMappedIOPortSpace,
+	EfiPalCode,
+	EfiPersistentMemory,
+	EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+typedef enum {
+	AllocateAnyPages,
+	AllocateMaxAddress,
+	AllocateAddress,
+	MaxAllocateType
+} EFI_ALLOCATE_TYPE;
+
+typedef struct {
+	UINT32 Type;
+	UINT32 Pad;
+	EFI_PHYSICAL_ADDRESS PhysicalStart;
+	EFI_VIRTUAL_ADDRESS VirtualStart;
+	UINT64 NumberOfPages;
+	UINT64 Attribute;
+} EFI_MEMORY_DESCRIPTOR;
+
+#define NextMemoryDescriptor(Ptr, Size)	((EFI_MEMORY_DESCRIPTOR *)(((UINT8 *)Ptr) + Size))
+
+typedef enum {
+	AllHandles,
+	ByRegisterNotify,
+	ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum {
+	EFI_NATIVE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+typedef enum {
+	EfiResetCold,
+	EfiResetWarm,
+	EfiResetShutdown
+} EFI_RESET_TYPE;
+
+typedef struct {
+	UINT16 Year;
+	UINT8 Month;
+	UINT8 Day;
+	UINT8 Hour;
+	UINT8 Minute;
+	UINT8 Second;
+	UINT8 Pad1;
+	UINT32 Nanosecond;
+	INT16 TimeZone;
+	UINT8 Daylight;
+	UINT8 Pad2;
+} EFI_TIME;
+
+/*
+ * Device paths.
+ */
+typedef struct _EFI_DEVICE_PATH_PROTOCOL {
+	UINT8 Type;
+	UINT8 SubType;
+	UINT8 Length[2];
+} EFI_DEVICE_PATH_PROTOCOL;
+
+typedef EFI_DEVICE_PATH_PROTOCOL EFI_DEVICE_PATH;
+
+#define HARDWARE_DEVICE_PATH	0x01
+#define MEDIA_DEVICE_PATH	0x04
+#define MEDIA_HARDDRIVE_DP	0x01
+#define MEDIA_VENDOR_DP		0x03
+#define MEDIA_FILEPATH_DP	0x04
+#define END_DEVICE_PATH_TYPE	0x7f
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE	0xff
+
+typedef struct {
+	EFI_DEVICE_PATH_PROTOCOL Header;
+	EFI_GUID Guid;
+} VENDOR_DEVICE_PATH;
+
+#define DevicePathType(a)	(((a)->Type) & 0x7f)
+#define DevicePathSubType(a)	((a)->SubType)
+#define DevicePathNodeLength(a)	((UINTN)((a)->Length[0] | ((a)->Length[1] << 8)))
+#define NextDevicePathNode(a)	((EFI_DEVICE_PATH_PROTOCOL *)(((UINT8 *)(a)) + DevicePathNodeLength(a)))
+#define IsDevicePathEnd(a)	(DevicePathType(a) == END_DEVICE_PATH_TYPE && (a)->SubType == END_ENTIRE_DEVICE_PATH_SUBTYPE)
+#define SetDevicePathNodeLength(a, l)	{ (a)->Length[0] = (UINT8)(l); (a)->Length[1] = (UINT8)((l) >> 8); }
+#define SetDevicePathEndNode(a)	{ (a)->Type = END_DEVICE_PATH_TYPE; (a)->SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE; SetDevicePathNodeLength(a, sizeof(EFI_DEVICE_PATH_PROTOCOL)); }
+
+/*
+ * Block I/O.
+ */
+typedef struct {
+	UINT32 MediaId;
+	BOOLEAN RemovableMedia;
+	BOOLEAN MediaPresent;
+	BOOLEAN LogicalPartition;
+	BOOLEAN ReadOnly;
+	BOOLEAN WriteCaching;
+	UINT32 BlockSize;
+	UINT32 IoAlign;
+	EFI_LBA LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+struct _EFI_BLOCK_IO_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_RESET)(struct _EFI_BLOCK_IO_PROTOCOL *This, BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_READ)(struct _EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_WRITE)(struct _EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_FLUSH)(struct _EFI_BLOCK_IO_PROTOCOL *This);
+
+typedef struct _EFI_BLOCK_IO_PROTOCOL {
+	UINT64 Revision;
+	EFI_BLOCK_IO_MEDIA *Media;
+	EFI_BLOCK_RESET Reset;
+	EFI_BLOCK_READ ReadBlocks;
+	EFI_BLOCK_WRITE WriteBlocks;
+	EFI_BLOCK_FLUSH FlushBlocks;
+} EFI_BLOCK_IO_PROTOCOL;
+
+typedef EFI_BLOCK_IO_PROTOCOL EFI_BLOCK_IO;
+
+#define EFI_BLOCK_IO_PROTOCOL_REVISION	0x00010000
+#define EFI_BLOCK_IO_PROTOCOL_GUID \
+	{ 0x964e5b21, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+
+/*
+ * File protocol.
+ */
+#define EFI_FILE_MODE_READ	0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE	0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE	0x8000000000000000ULL
+
+#define EFI_FILE_READ_ONLY	0x0000000000000001ULL
+#define EFI_FILE_HIDDEN		0x0000000000000002ULL
+#define EFI_FILE_SYSTEM		0x0000000000000004ULL
+#define EFI_FILE_RESERVED	0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY	0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE	0x0000000000000020ULL
+
+#define EFI_FILE_PROTOCOL_REVISION	0x00010000
+#define EFI_FILE_HANDLE_REVISION	EFI_FILE_PROTOCOL_REVISION
+
+struct _EFI_FILE_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_FILE_OPEN)(struct _EFI_FILE_PROTOCOL *File, struct _EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_CLOSE)(struct _EFI_FILE_PROTOCOL *File);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_DELETE)(struct _EFI_FILE_PROTOCOL *File);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_READ)(struct _EFI_FILE_PROTOCOL *File, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_WRITE)(struct _EFI_FILE_PROTOCOL *File, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_POSITION)(struct _EFI_FILE_PROTOCOL *File, UINT64 *Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_POSITION)(struct _EFI_FILE_PROTOCOL *File, UINT64 Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_INFO)(struct _EFI_FILE_PROTOCOL *File, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_INFO)(struct _EFI_FILE_PROTOCOL *File, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_FLUSH)(struct _EFI_FILE_PROTOCOL *File);
+
+typedef struct _EFI_FILE_PROTOCOL {
+	UINT64 Revision;
+	EFI_FILE_OPEN Open;
+	EFI_FILE_CLOSE Close;
+	EFI_FILE_DELETE Delete;
+	EFI_FILE_READ Read;
+	EFI_FILE_WRITE Write;
+	EFI_FILE_GET_POSITION GetPosition;
+	EFI_FILE_SET_POSITION SetPosition;
+	EFI_FILE_GET_INFO GetInfo;
+	EFI_FILE_SET_INFO SetInfo;
+	EFI_FILE_FLUSH Flush;
+} EFI_FILE_PROTOCOL;
+
+typedef EFI_FILE_PROTOCOL EFI_FILE;
+typedef EFI_FILE_PROTOCOL *EFI_FILE_HANDLE;
+
+typedef struct {
+	UINT64 Size;
+	UINT64 FileSize;
+	UINT64 PhysicalSize;
+	EFI_TIME CreateTime;
+	EFI_TIME LastAccessTime;
+	EFI_TIME ModificationTime;
+	UINT64 Attribute;
+	CHAR16 FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO	offsetof(EFI_FILE_INFO, FileName)
+
+typedef struct {
+	UINT64 Size;
+	BOOLEAN ReadOnly;
+	UINT64 VolumeSize;
+	UINT64 FreeSpace;
+	UINT32 BlockSize;
+	CHAR16 VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_INFO	offsetof(EFI_FILE_SYSTEM_INFO, VolumeLabel)
+
+#define EFI_FILE_INFO_ID \
+	{ 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+#define EFI_FILE_SYSTEM_INFO_ID \
+	{ 0x09576e93, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+
+struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_OPEN_VOLUME)(struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *This, EFI_FILE_PROTOCOL **Root);
+
+typedef struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL {
+	UINT64 Revision;
+	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_OPEN_VOLUME OpenVolume;
+} EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+
+typedef EFI_SIMPLE_FILE_SYSTEM_PROTOCOL EFI_FILE_IO_INTERFACE;
+
+#define EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION	0x00010000
+#define EFI_FILE_IO_INTERFACE_REVISION	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION
+
+/*
+ * Serial I/O.
+ */
+typedef struct {
+	UINT32 ControlMask;
+	UINT32 Timeout;
+	UINT64 BaudRate;
+	UINT32 ReceiveFifoDepth;
+	UINT32 DataBits;
+	UINT32 Parity;
+	UINT32 StopBits;
+} SERIAL_IO_MODE;
+
+typedef enum {
+	DefaultParity,
+	NoParity,
+	EvenParity,
+	OddParity,
+	MarkParity,
+	SpaceParity
+} EFI_PARITY_TYPE;
+
+typedef enum {
+	DefaultStopBits,
+	OneStopBit,
+	OneFiveStopBits,
+	TwoStopBits
+} EFI_STOP_BITS_TYPE;
+
+struct _EFI_SERIAL_IO_PROTOCOL;
+
+typedef struct _EFI_SERIAL_IO_PROTOCOL {
+	UINT32 Revision;
+	EFI_STATUS (EFIAPI *Reset)(struct _EFI_SERIAL_IO_PROTOCOL *This);
+	EFI_STATUS (EFIAPI *SetAttributes)(struct _EFI_SERIAL_IO_PROTOCOL *This, UINT64 BaudRate, UINT32 ReceiveFifoDepth, UINT32 Timeout, EFI_PARITY_TYPE Parity, UINT8 DataBits, EFI_STOP_BITS_TYPE StopBits);
+	EFI_STATUS (EFIAPI *SetControl)(struct _EFI_SERIAL_IO_PROTOCOL *This, UINT32 Control);
+	EFI_STATUS (EFIAPI *GetControl)(struct _EFI_SERIAL_IO_PROTOCOL *This, UINT32 *Control);
+	EFI_STATUS (EFIAPI *Write)(struct _EFI_SERIAL_IO_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer);
+	EFI_STATUS (EFIAPI *Read)(struct _EFI_SERIAL_IO_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer);
+	SERIAL_IO_MODE *Mode;
+} EFI_SERIAL_IO_PROTOCOL;
+
+typedef EFI_SERIAL_IO_PROTOCOL SERIAL_IO_INTERFACE;
+
+/*
+ * Text console.
+ */
+typedef struct {
+	UINT16 ScanCode;
+	CHAR16 UnicodeChar;
+} EFI_INPUT_KEY;
+
+#define SCAN_NULL	0x0000
+#define SCAN_UP		0x0001
+#define SCAN_DOWN	0x0002
+#define SCAN_RIGHT	0x0003
+#define SCAN_LEFT	0x0004
+#define SCAN_ESC	0x0017
+
+#define CHAR_NULL		0x0000
+#define CHAR_BACKSPACE		0x0008
+#define CHAR_TAB		0x0009
+#define CHAR_LINEFEED		0x000A
+#define CHAR_CARRIAGE_RETURN	0x000D
+
+struct _SIMPLE_INPUT_INTERFACE;
+struct _SIMPLE_TEXT_OUTPUT_INTERFACE;
+
+typedef struct _SIMPLE_INPUT_INTERFACE {
+	EFI_STATUS (EFIAPI *Reset)(struct _SIMPLE_INPUT_INTERFACE *This, BOOLEAN ExtendedVerification);
+	EFI_STATUS (EFIAPI *ReadKeyStroke)(struct _SIMPLE_INPUT_INTERFACE *This, EFI_INPUT_KEY *Key);
+	EFI_EVENT WaitForKey;
+} SIMPLE_INPUT_INTERFACE;
+
+typedef struct {
+	INT32 MaxMode;
+	INT32 Mode;
+	INT32 Attribute;
+	INT32 CursorColumn;
+	INT32 CursorRow;
+	BOOLEAN CursorVisible;
+} SIMPLE_TEXT_OUTPUT_MODE;
+
+typedef struct _SIMPLE_TEXT_OUTPUT_INTERFACE {
+	EFI_STATUS (EFIAPI *Reset)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, BOOLEAN ExtendedVerification);
+	EFI_STATUS (EFIAPI *OutputString)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, CHAR16 *String);
+	EFI_STATUS (EFIAPI *TestString)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, CHAR16 *String);
+	EFI_STATUS (EFIAPI *QueryMode)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN ModeNumber, UINTN *Columns, UINTN *Rows);
+	EFI_STATUS (EFIAPI *SetMode)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN ModeNumber);
+	EFI_STATUS (EFIAPI *SetAttribute)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN Attribute);
+	EFI_STATUS (EFIAPI *ClearScreen)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This);
+	EFI_STATUS (EFIAPI *SetCursorPosition)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN Column, UINTN Row);
+	EFI_STATUS (EFIAPI *EnableCursor)(struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, BOOLEAN Enable);
+	SIMPLE_TEXT_OUTPUT_MODE *Mode;
+} SIMPLE_TEXT_OUTPUT_INTERFACE;
+
+#define EFI_BLACK	0x00
+#define EFI_BLUE	0x01
+#define EFI_GREEN	0x02
+#define EFI_CYAN	0x03
+#define EFI_RED		0x04
+#define EFI_MAGENTA	0x05
+#define EFI_BROWN	0x06
+#define EFI_LIGHTGRAY	0x07
+#define EFI_WHITE	0x0F
+#define EFI_TEXT_ATTR(f, b)	((f) | ((b) << 4))
+
+/*
+ * Graphics output.
+ */
+typedef struct {
+	UINT8 Blue;
+	UINT8 Green;
+	UINT8 Red;
+	UINT8 Reserved;
+} EFI_GRAPHICS_OUTPUT_BLT_PIXEL;
+
+typedef enum {
+	EfiBltVideoFill,
+	EfiBltVideoToBltBuffer,
+	EfiBltBufferToVideo,
+	EfiBltVideoToVideo,
+	EfiGraphicsOutputBltOperationMax
+} EFI_GRAPHICS_OUTPUT_BLT_OPERATION;
+
+typedef enum {
+	PixelRedGreenBlueReserved8BitPerColor,
+	PixelBlueGreenRedReserved8BitPerColor,
+	PixelBitMask,
+	PixelBltOnly,
+	PixelFormatMax
+} EFI_GRAPHICS_PIXEL_FORMAT;
+
+typedef struct {
+	UINT32 RedMask;
+	UINT32 GreenMask;
+	UINT32 BlueMask;
+	UINT32 ReservedMask;
+} EFI_PIXEL_BITMASK;
+
+typedef struct {
+	UINT32 Version;
+	UINT32 HorizontalResolution;
+	UINT32 VerticalResolution;
+	EFI_GRAPHICS_PIXEL_FORMAT PixelFormat;
+	EFI_PIXEL_BITMASK PixelInformation;
+	UINT32 PixelsPerScanLine;
+} EFI_GRAPHICS_OUTPUT_MODE_INFORMATION;
+
+typedef struct {
+	UINT32 MaxMode;
+	UINT32 Mode;
+	EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+	UINTN SizeOfInfo;
+	EFI_PHYSICAL_ADDRESS FrameBufferBase;
+	UINTN FrameBufferSize;
+} EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE;
+
+struct _EFI_GRAPHICS_OUTPUT_PROTOCOL;
+
+typedef struct _EFI_GRAPHICS_OUTPUT_PROTOCOL {
+	EFI_STATUS (EFIAPI *QueryMode)(struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This, UINT32 ModeNumber, UINTN *SizeOfInfo, EFI_GRAPHICS_OUTPUT_MODE_INFORMATION **Info);
+	EFI_STATUS (EFIAPI *SetMode)(struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This, UINT32 ModeNumber);
+	EFI_STATUS (EFIAPI *Blt)(struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer, EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation, UINTN SourceX, UINTN SourceY, UINTN DestinationX, UINTN DestinationY, UINTN Width, UINTN Height, UINTN Delta);
+	EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode;
+} EFI_GRAPHICS_OUTPUT_PROTOCOL;
+
+#define EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID \
+	{ 0x9042a9de, 0x23dc, 0x4a38, { 0x96, 0xfb, 0x7a, 0xde, 0xd0, 0x80, 0x51, 0x6a } }
+
+/*
+ * Tables.
+ */
+typedef struct {
+	UINT64 Signature;
+	UINT32 Revision;
+	UINT32 HeaderSize;
+	UINT32 CRC32;
+	UINT32 Reserved;
+} EFI_TABLE_HEADER;
+
+typedef struct {
+	EFI_GUID VendorGuid;
+	VOID *VendorTable;
+} EFI_CONFIGURATION_TABLE;
+
+typedef struct {
+	EFI_TABLE_HEADER Hdr;
+	EFI_STATUS (EFIAPI *GetTime)(EFI_TIME *Time, VOID *Capabilities);
+	EFI_STATUS (EFIAPI *SetTime)(EFI_TIME *Time);
+	VOID *GetWakeupTime;
+	VOID *SetWakeupTime;
+	VOID *SetVirtualAddressMap;
+	VOID *ConvertPointer;
+	VOID *GetVariable;
+	VOID *GetNextVariableName;
+	VOID *SetVariable;
+	VOID *GetNextHighMonotonicCount;
+	/* Returns EFI_STATUS so that callers can assign uefi_call_wrapper(). */
+	EFI_STATUS (EFIAPI *ResetSystem)(EFI_RESET_TYPE ResetType, EFI_STATUS ResetStatus, UINTN DataSize, CHAR16 *ResetData);
+} EFI_RUNTIME_SERVICES;
+
+typedef struct {
+	EFI_TABLE_HEADER Hdr;
+	VOID *RaiseTPL;
+	VOID *RestoreTPL;
+	EFI_STATUS (EFIAPI *AllocatePages)(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN NoPages, EFI_PHYSICAL_ADDRESS *Memory);
+	EFI_STATUS (EFIAPI *FreePages)(EFI_PHYSICAL_ADDRESS Memory, UINTN NoPages);
+	EFI_STATUS (EFIAPI *GetMemoryMap)(UINTN *MemoryMapSize, EFI_MEMORY_DESCRIPTOR *MemoryMap, UINTN *MapKey, UINTN *DescriptorSize, UINT32 *DescriptorVersion);
+	EFI_STATUS (EFIAPI *AllocatePool)(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer);
+	EFI_STATUS (EFIAPI *FreePool)(VOID *Buffer);
+	VOID *CreateEvent;
+	VOID *SetTimer;
+	EFI_STATUS (EFIAPI *WaitForEvent)(UINTN NumberOfEvents, EFI_EVENT *Event, UINTN *Index);
+	VOID *SignalEvent;
+	VOID *CloseEvent;
+	VOID *CheckEvent;
+	EFI_STATUS (EFIAPI *InstallProtocolInterface)(EFI_HANDLE *Handle, EFI_GUID *Protocol, EFI_INTERFACE_TYPE InterfaceType, VOID *Interface);
+	EFI_STATUS (EFIAPI *ReinstallProtocolInterface)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID *OldInterface, VOID *NewInterface);
+	EFI_STATUS (EFIAPI *UninstallProtocolInterface)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID *Interface);
+	EFI_STATUS (EFIAPI *HandleProtocol)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
+	VOID *Reserved;
+	VOID *RegisterProtocolNotify;
+	EFI_STATUS (EFIAPI *LocateHandle)(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *BufferSize, EFI_HANDLE *Buffer);
+	VOID *LocateDevicePath;
+	EFI_STATUS (EFIAPI *InstallConfigurationTable)(EFI_GUID *Guid, VOID *Table);
+	EFI_STATUS (EFIAPI *LoadImage)(BOOLEAN BootPolicy, EFI_HANDLE ParentImageHandle, EFI_DEVICE_PATH *FilePath, VOID *SourceBuffer, UINTN SourceSize, EFI_HANDLE *ImageHandle);
+	EFI_STATUS (EFIAPI *StartImage)(EFI_HANDLE ImageHandle, UINTN *ExitDataSize, CHAR16 **ExitData);
+	EFI_STATUS (EFIAPI *Exit)(EFI_HANDLE ImageHandle, EFI_STATUS ExitStatus, UINTN ExitDataSize, CHAR16 *ExitData);
+	EFI_STATUS (EFIAPI *UnloadImage)(EFI_HANDLE ImageHandle);
+	EFI_STATUS (EFIAPI *ExitBootServices)(EFI_HANDLE ImageHandle, UINTN MapKey);
+	VOID *GetNextMonotonicCount;
+	EFI_STATUS (EFIAPI *Stall)(UINTN Microseconds);
+	EFI_STATUS (EFIAPI *SetWatchdogTimer)(UINTN Timeout, UINT64 WatchdogCode, UINTN DataSize, CHAR16 *WatchdogData);
+	VOID *ConnectController;
+	VOID *DisconnectController;
+	VOID *OpenProtocol;
+	VOID *CloseProtocol;
+	VOID *OpenProtocolInformation;
+	VOID *ProtocolsPerHandle;
+	EFI_STATUS (EFIAPI *LocateHandleBuffer)(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer);
+	EFI_STATUS (EFIAPI *LocateProtocol)(EFI_GUID *Protocol, VOID *Registration, VOID **Interface);
+	EFI_STATUS (EFIAPI *InstallMultipleProtocolInterfaces)(EFI_HANDLE *Handle, ...);
+	EFI_STATUS (EFIAPI *UninstallMultipleProtocolInterfaces)(EFI_HANDLE Handle, ...);
+	EFI_STATUS (EFIAPI *CalculateCrc32)(VOID *Data, UINTN DataSize, UINT32 *Crc32);
+	VOID (EFIAPI *CopyMem)(VOID *Destination, VOID *Source, UINTN Length);
+	VOID (EFIAPI *SetMem)(VOID *Buffer, UINTN Size, UINT8 Value);
+	VOID *CreateEventEx;
+} EFI_BOOT_SERVICES;
+
+typedef struct {
+	EFI_TABLE_HEADER Hdr;
+	CHAR16 *FirmwareVendor;
+	UINT32 FirmwareRevision;
+	EFI_HANDLE ConsoleInHandle;
+	SIMPLE_INPUT_INTERFACE *ConIn;
+	EFI_HANDLE ConsoleOutHandle;
+	SIMPLE_TEXT_OUTPUT_INTERFACE *ConOut;
+	EFI_HANDLE StandardErrorHandle;
+	SIMPLE_TEXT_OUTPUT_INTERFACE *StdErr;
+	EFI_RUNTIME_SERVICES *RuntimeServices;
+	EFI_BOOT_SERVICES *BootServices;
+	UINTN NumberOfTableEntries;
+	EFI_CONFIGURATION_TABLE *ConfigurationTable;
+} EFI_SYSTEM_TABLE;
+
+/*
+ * Loaded image.
+ */
+typedef struct {
+	UINT32 Revision;
+	EFI_HANDLE ParentHandle;
+	EFI_SYSTEM_TABLE *SystemTable;
+	EFI_HANDLE DeviceHandle;
+	EFI_DEVICE_PATH *FilePath;
+	VOID *Reserved;
+	UINT32 LoadOptionsSize;
+	VOID *LoadOptions;
+	VOID *ImageBase;
+	UINT64 ImageSize;
+	EFI_MEMORY_TYPE ImageCodeType;
+	EFI_MEMORY_TYPE ImageDataType;
+	EFI_STATUS (EFIAPI *Unload)(EFI_HANDLE ImageHandle);
+} EFI_LOADED_IMAGE_PROTOCOL;
+
+typedef EFI_LOADED_IMAGE_PROTOCOL EFI_LOADED_IMAGE;
+
+#endif /* _HOST_EFI_H_ */
@@ -0,0 +1,680 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * efi_shim.c
+ * Host-side implementation of the GNU-EFI library subset declared in
+ * efilib.h, plus a minimal set of boot and runtime services.
+ *
+ * Memory comes from the C library and the handle database only hands out
+ * dummy handles, which is enough for the filesystem and VTOC code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+EFI_GUID gEfiBlockIoProtocolGuid = EFI_BLOCK_IO_PROTOCOL_GUID;
+EFI_GUID gEfiDevicePathProtocolGuid = { 0x09576e91, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiLoadedImageProtocolGuid = { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleFileSystemProtocolGuid = { 0x964e5b22, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileInfoGuid = EFI_FILE_INFO_ID;
+EFI_GUID gEfiFileSystemInfoGuid = EFI_FILE_SYSTEM_INFO_ID;
+EFI_GUID gEfiSerialIoProtocolGuid = { 0xbb25cf6f, 0xf1d4, 0x11d2, { 0x9a, 0x0c, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0xfd } };
+EFI_GUID gEfiGraphicsOutputProtocolGuid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
+
+/*
+ * Boot services.
+ */
+static EFI_STATUS EFIAPI
+host_allocate_pages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN NoPages, EFI_PHYSICAL_ADDRESS *Memory)
+{
+	void *p;
+
+	if (Type != AllocateAnyPages)
+		return EFI_UNSUPPORTED;
+
+	p = aligned_alloc(EFI_PAGE_SIZE, NoPages * EFI_PAGE_SIZE);
+	if (!p)
+		return EFI_OUT_OF_RESOURCES;
+
+	*Memory = (EFI_PHYSICAL_ADDRESS)(UINTN)p;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_free_pages(EFI_PHYSICAL_ADDRESS Memory, UINTN NoPages)
+{
+	free((void *)(UINTN)Memory);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_get_memory_map(UINTN *MemoryMapSize, EFI_MEMORY_DESCRIPTOR *MemoryMap, UINTN *MapKey, UINTN *DescriptorSize, UINT32 *DescriptorVersion)
+{
+	return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI
+host_allocate_pool(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer)
+{
+	*Buffer = malloc(Size ? Size : 1);
+	return *Buffer ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI
+host_free_pool(VOID *Buffer)
+{
+	free(Buffer);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_handle_protocol(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface)
+{
+	return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI
+host_locate_handle_buffer(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer)
+{
+	return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+host_install_multiple(EFI_HANDLE *Handle, ...)
+{
+	static UINTN NextHandle = 0x1000;
+
+	if (*Handle == NULL)
+		*Handle = (EFI_HANDLE)NextHandle++;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_uninstall_multiple(EFI_HANDLE Handle, ...)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_stall(UINTN Microseconds)
+{
+	usleep(Microseconds);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_set_watchdog(UINTN Timeout, UINT64 WatchdogCode, UINTN DataSize, CHAR16 *WatchdogData)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_calculate_crc32(VOID *Data, UINTN DataSize, UINT32 *Crc32)
+{
+	const UINT8 *p = Data;
+	UINT32 Crc = 0xFFFFFFFF;
+	int i;
+
+	while (DataSize--) {
+		Crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			Crc = (Crc >> 1) ^ (0xEDB88320 & -(Crc & 1));
+	}
+
+	*Crc32 = ~Crc;
+	return EFI_SUCCESS;
+}
+
+static EFI_BOOT_SERVICES HostBootServices = {
+	.AllocatePages = host_allocate_pages,
+	.FreePages = host_free_pages,
+	.GetMemoryMap = host_get_memory_map,
+	.AllocatePool = host_allocate_pool,
+	.FreePool = host_free_pool,
+	.HandleProtocol = host_handle_protocol,
+	.LocateHandleBuffer = host_locate_handle_buffer,
+	.InstallMultipleProtocolInterfaces = host_install_multiple,
+	.UninstallMultipleProtocolInterfaces = host_uninstall_multiple,
+	.Stall = host_stall,
+	.SetWatchdogTimer = host_set_watchdog,
+	.CalculateCrc32 = host_calculate_crc32,
+};
+
+/*
+ * Runtime services.
+ */
+static EFI_STATUS EFIAPI
+host_get_time(EFI_TIME *Time, VOID *Capabilities)
+{
+	struct timespec ts;
+	struct tm tm;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	localtime_r(&ts.tv_sec, &tm);
+
+	memset(Time, 0, sizeof(*Time));
+	Time->Year = tm.tm_year + 1900;
+	Time->Month = tm.tm_mon + 1;
+	Time->Day = tm.tm_mday;
+	Time->Hour = tm.tm_hour;
+	Time->Minute = tm.tm_min;
+	Time->Second = tm.tm_sec;
+	Time->Nanosecond = ts.tv_nsec;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+host_reset_system(EFI_RESET_TYPE ResetType, EFI_STATUS ResetStatus, UINTN DataSize, CHAR16 *ResetData)
+{
+	exit((int)(ResetStatus & 0xff));
+}
+
+static EFI_RUNTIME_SERVICES HostRuntimeServices = {
+	.GetTime = host_get_time,
+	.ResetSystem = host_reset_system,
+};
+
+static EFI_SYSTEM_TABLE HostSystemTable = {
+	.RuntimeServices = &HostRuntimeServices,
+	.BootServices = &HostBootServices,
+};
+
+EFI_SYSTEM_TABLE *ST = &HostSystemTable, *gST = &HostSystemTable;
+EFI_BOOT_SERVICES *BS = &HostBootServices, *gBS = &HostBootServices;
+EFI_RUNTIME_SERVICES *RT = &HostRuntimeServices, *gRT = &HostRuntimeServices;
+
+VOID
+InitializeLib(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
+{
+}
+
+/*
+ * Memory.
+ */
+VOID *
+AllocatePool(UINTN Size)
+{
+	return malloc(Size ? Size : 1);
+}
+
+VOID *
+AllocateZeroPool(UINTN Size)
+{
+	return calloc(1, Size ? Size : 1);
+}
+
+VOID *
+ReallocatePool(VOID *OldPool, UINTN OldSize, UINTN NewSize)
+{
+	return realloc(OldPool, NewSize);
+}
+
+VOID
+FreePool(VOID *Buffer)
+{
+	free(Buffer);
+}
+
+VOID
+CopyMem(VOID *Dest, CONST VOID *Src, UINTN Len)
+{
+	memmove(Dest, Src, Len);
+}
+
+VOID
+SetMem(VOID *Buffer, UINTN Size, UINT8 Value)
+{
+	memset(Buffer, Value, Size);
+}
+
+VOID
+ZeroMem(VOID *Buffer, UINTN Size)
+{
+	memset(Buffer, 0, Size);
+}
+
+INTN
+CompareMem(CONST VOID *Dest, CONST VOID *Src, UINTN Len)
+{
+	return memcmp(Dest, Src, Len);
+}
+
+INTN
+CompareGuid(CONST EFI_GUID *Guid1, CONST EFI_GUID *Guid2)
+{
+	return memcmp(Guid1, Guid2, sizeof(EFI_GUID)) != 0;
+}
+
+/*
+ * Strings.
+ */
+UINTN
+StrLen(CONST CHAR16 *s1)
+{
+	UINTN n = 0;
+
+	while (s1[n])
+		n++;
+	return n;
+}
+
+UINTN
+StrnLen(CONST CHAR16 *s1, UINTN Len)
+{
+	UINTN n = 0;
+
+	while (n < Len && s1[n])
+		n++;
+	return n;
+}
+
+INTN
+StrCmp(CONST CHAR16 *s1, CONST CHAR16 *s2)
+{
+	while (*s1 && *s1 == *s2) {
+		s1++;
+		s2++;
+	}
+	return (INTN)*s1 - (INTN)*s2;
+}
+
+INTN
+StrnCmp(CONST CHAR16 *s1, CONST CHAR16 *s2, UINTN len)
+{
+	while (len) {
+		if (*s1 != *s2)
+			return (INTN)*s1 - (INTN)*s2;
+		if (*s1 == 0)
+			break;
+		s1++;
+		s2++;
+		len--;
+	}
+	return 0;
+}
+
+VOID
+StrCpy(CHAR16 *Dest, CONST CHAR16 *Src)
+{
+	while ((*Dest++ = *Src++) != 0)
+		;
+}
+
+VOID
+StrnCpy(CHAR16 *Dest, CONST CHAR16 *Src, UINTN Len)
+{
+	while (Len && *Src) {
+		*Dest++ = *Src++;
+		Len--;
+	}
+	if (Len)
+		*Dest = 0;
+}
+
+VOID
+StrCat(CHAR16 *Dest, CONST CHAR16 *Src)
+{
+	StrCpy(Dest + StrLen(Dest), Src);
+}
+
+UINTN
+AsciiStrLen(CONST CHAR8 *s1)
+{
+	return strlen(s1);
+}
+
+/*
+ * Formatted output. Supports the conversions used by HeliumBoot:
+ * %s (CHAR16), %a (CHAR8), %c, %d, %u, %x, %X, %p and %r, with the
+ * optional '-' and '0' flags, a field width and the 'l'/'ll' modifiers.
+ */
+static const char *
+host_status_str(EFI_STATUS Status)
+{
+	static const char *Errors[] = {
+		"Success", "Load Error", "Invalid Parameter", "Unsupported",
+		"Bad Buffer Size", "Buffer Too Small", "Not Ready", "Device Error",
+		"Write Protected", "Out of Resources", "Volume Corrupt", "Volume Full",
+		"No Media", "Media changed", "Not Found", "Access Denied",
+		"No Response", "No mapping", "Time out", "Not started",
+		"Already started", "Aborted", "ICMP Error", "TFTP Error",
+		"Protocol Error", "Incompatible Version", "Security Violation",
+		"CRC Error", "End of Media", "Reserved (29)", "Reserved (30)",
+		"End of File", "Invalid Language", "Compromised Data",
+	};
+	UINTN Code = Status & ~EFI_MAX_BIT;
+
+	if (!EFI_ERROR(Status))
+		return Status == EFI_SUCCESS ? "Success" : "Warning";
+	if (Code < sizeof(Errors) / sizeof(Errors[0]))
+		return Errors[Code];
+	return "Unknown Error";
+}
+
+static UINTN
+host_vformat(char *Out, UINTN OutSize, CONST CHAR16 *fmt, va_list args)
+{
+	UINTN n = 0;
+	char num[64];
+
+#define PUTC(ch) do { if (n + 1 < OutSize) Out[n] = (char)(ch); n++; } while (0)
+
+	for (; *fmt; fmt++) {
+		BOOLEAN Left = FALSE, Zero = FALSE;
+		UINTN Width = 0, Long = 0, Len, i;
+		const char *Str = NULL;
+		CHAR16 *WStr = NULL;
+		UINT64 Value;
+
+		if (*fmt != L'%') {
+			PUTC(*fmt < 0x80 ? *fmt : '?');
+			continue;
+		}
+
+		fmt++;
+		for (;; fmt++) {
+			if (*fmt == L'-')
+				Left = TRUE;
+			else if (*fmt == L'0')
+				Zero = TRUE;
+			else
+				break;
+		}
+		if (*fmt == L'*') {
+			Width = va_arg(args, int);
+			fmt++;
+		}
+		while (*fmt >= L'0' && *fmt <= L'9')
+			Width = Width * 10 + (*fmt++ - L'0');
+		while (*fmt == L'l') {
+			Long++;
+			fmt++;
+		}
+
+		switch (*fmt) {
+		case L's':
+			WStr = va_arg(args, CHAR16 *);
+			if (!WStr)
+				Str = "(null)";
+			break;
+		case L'a':
+			Str = va_arg(args, char *);
+			if (!Str)
+				Str = "(null)";
+			break;
+		case L'c':
+			num[0] = (char)va_arg(args, int);
+			num[1] = '\0';
+			Str = num;
+			break;
+		case L'r':
+			Str = host_status_str(va_arg(args, EFI_STATUS));
+			break;
+		case L'd':
+			Value = Long ? (UINT64)va_arg(args, INT64) : (UINT64)(INT64)va_arg(args, int);
+			snprintf(num, sizeof(num), "%lld", (long long)Value);
+			Str = num;
+			break;
+		case L'u':
+			Value = Long ? va_arg(args, UINT64) : va_arg(args, unsigned int);
+			snprintf(num, sizeof(num), "%llu", (unsigned long long)Value);
+			Str = num;
+			break;
+		case L'x':
+		case L'X':
+			Value = Long ? va_arg(args, UINT64) : va_arg(args, unsigned int);
+			snprintf(num, sizeof(num), *fmt == L'x' ? "%llx" : "%llX", (unsigned long long)Value);
+			Str = num;
+			break;
+		case L'p':
+			snprintf(num, sizeof(num), "%p", va_arg(args, void *));
+			Str = num;
+			break;
+		case L'%':
+			Str = "%";
+			break;
+		default:
+			Str = "?";
+			break;
+		}
+
+		Len = WStr ? StrLen(WStr) : strlen(Str);
+		if (!Left) {
+			for (i = Len; i < Width; i++)
+				PUTC(Zero ? '0' : ' ');
+		}
+		for (i = 0; i < Len; i++)
+			PUTC(WStr ? (WStr[i] < 0x80 ? WStr[i] : '?') : Str[i]);
+		if (Left) {
+			for (i = Len; i < Width; i++)
+				PUTC(' ');
+		}
+	}
+
+#undef PUTC
+
+	if (OutSize)
+		Out[n < OutSize ? n : OutSize - 1] = '\0';
+	return n;
+}
+
+UINTN
+UnicodeVSPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, va_list args)
+{
+	char Buffer[1024];
+	UINTN Len, i, Max = StrSize / sizeof(CHAR16);
+
+	host_vformat(Buffer, sizeof(Buffer), fmt, args);
+	Len = strlen(Buffer);
+	if (Max == 0)
+		return 0;
+	if (Len > Max - 1)
+		Len = Max - 1;
+	for (i = 0; i < Len; i++)
+		Str[i] = (UINT8)Buffer[i];
+	Str[Len] = 0;
+	return Len;
+}
+
+UINTN
+UnicodeSPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...)
+{
+	va_list args;
+	UINTN Len;
+
+	va_start(args, fmt);
+	Len = UnicodeVSPrint(Str, StrSize, fmt, args);
+	va_end(args);
+	return Len;
+}
+
+UINTN
+SPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...)
+{
+	va_list args;
+	UINTN Len;
+
+	va_start(args, fmt);
+	Len = UnicodeVSPrint(Str, StrSize, fmt, args);
+	va_end(args);
+	return Len;
+}
+
+CHAR16 *
+PoolPrint(CONST CHAR16 *fmt, ...)
+{
+	va_list args;
+	CHAR16 *Str = AllocatePool(1024 * sizeof(CHAR16));
+
+	if (!Str)
+		return NULL;
+	va_start(args, fmt);
+	UnicodeVSPrint(Str, 1024 * sizeof(CHAR16), fmt, args);
+	va_end(args);
+	return Str;
+}
+
+UINTN
+VPrint(CONST CHAR16 *fmt, va_list args)
+{
+	char Buffer[1024];
+	UINTN Len;
+
+	Len = host_vformat(Buffer, sizeof(Buffer), fmt, args);
+	fputs(Buffer, stdout);
+	return Len;
+}
+
+UINTN
+Print(CONST CHAR16 *fmt, ...)
+{
+	va_list args;
+	UINTN Len;
+
+	va_start(args, fmt);
+	Len = VPrint(fmt, args);
+	va_end(args);
+	return Len;
+}
+
+VOID
+Input(CHAR16 *Prompt, CHAR16 *InStr, UINTN StrLen)
+{
+	if (StrLen)
+		InStr[0] = 0;
+}
+
+/*
+ * Arithmetic.
+ */
+UINT64
+MultU64x32(UINT64 Multiplicand, UINTN Multiplier)
+{
+	return Multiplicand * Multiplier;
+}
+
+UINT64
+DivU64x32(UINT64 Dividend, UINTN Divisor, UINTN *Remainder)
+{
+	if (Remainder)
+		*Remainder = Dividend % Divisor;
+	return Dividend / Divisor;
+}
+
+/*
+ * Device paths. No host handle carries one.
+ */
+UINTN
+DevicePathSize(EFI_DEVICE_PATH *DevPath)
+{
+	EFI_DEVICE_PATH *p = DevPath;
+
+	while (!IsDevicePathEnd(p))
+		p = NextDevicePathNode(p);
+	return (UINTN)((UINT8 *)p - (UINT8 *)DevPath) + sizeof(EFI_DEVICE_PATH);
+}
+
+EFI_DEVICE_PATH *
+DuplicateDevicePath(EFI_DEVICE_PATH *DevPath)
+{
+	UINTN Size = DevicePathSize(DevPath);
+	EFI_DEVICE_PATH *New = AllocatePool(Size);
+
+	if (New)
+		memcpy(New, DevPath, Size);
+	return New;
+}
+
+EFI_DEVICE_PATH *
+AppendDevicePathNode(EFI_DEVICE_PATH *Src1, EFI_DEVICE_PATH *Src2)
+{
+	UINTN Size1 = Src1 ? DevicePathSize(Src1) - sizeof(EFI_DEVICE_PATH) : 0;
+	UINTN Size2 = DevicePathNodeLength(Src2);
+	EFI_DEVICE_PATH *New = AllocatePool(Size1 + Size2 + sizeof(EFI_DEVICE_PATH));
+	EFI_DEVICE_PATH *End;
+
+	if (!New)
+		return NULL;
+	if (Size1)
+		memcpy(New, Src1, Size1);
+	memcpy((UINT8 *)New + Size1, Src2, Size2);
+	End = (EFI_DEVICE_PATH *)((UINT8 *)New + Size1 + Size2);
+	SetDevicePathEndNode(End);
+	return New;
+}
+
+EFI_DEVICE_PATH *
+DevicePathFromHandle(EFI_HANDLE Handle)
+{
+	return NULL;
+}
+
+EFI_DEVICE_PATH *
+FileDevicePath(EFI_HANDLE Device, CHAR16 *FileName)
+{
+	return NULL;
+}
+
+CHAR16 *
+DevicePathToStr(EFI_DEVICE_PATH *DevPath)
+{
+	return PoolPrint(L"HostPath");
+}
+
+/*
+ * Misc.
+ */
+EFI_STATUS
+WaitForSingleEvent(EFI_EVENT Event, UINT64 Timeout)
+{
+	return EFI_TIMEOUT;
+}
+
+EFI_STATUS
+LibLocateProtocol(EFI_GUID *ProtocolGuid, VOID **Interface)
+{
+	return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+LibLocateHandle(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer)
+{
+	return EFI_NOT_FOUND;
+}
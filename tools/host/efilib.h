@@ -0,0 +1,117 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * efilib.h
+ * Host-side stand-in for the GNU-EFI library interface.
+ *
+ * The functions declared here are implemented in efi_shim.c on top of the
+ * C library.
+ */
+
+#ifndef _HOST_EFILIB_H_
+#define _HOST_EFILIB_H_
+
+#include <stdarg.h>
+
+#include "efi.h"
+
+extern EFI_SYSTEM_TABLE *ST, *gST;
+extern EFI_BOOT_SERVICES *BS, *gBS;
+extern EFI_RUNTIME_SERVICES *RT, *gRT;
+
+extern EFI_GUID gEfiBlockIoProtocolGuid;
+extern EFI_GUID gEfiDevicePathProtocolGuid;
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID gEfiFileSystemInfoGuid;
+extern EFI_GUID gEfiSerialIoProtocolGuid;
+extern EFI_GUID gEfiGraphicsOutputProtocolGuid;
+
+#define BlockIoProtocol		gEfiBlockIoProtocolGuid
+#define DevicePathProtocol	gEfiDevicePathProtocolGuid
+#define LoadedImageProtocol	gEfiLoadedImageProtocolGuid
+#define FileSystemProtocol	gEfiSimpleFileSystemProtocolGuid
+#define GenericFileInfo		gEfiFileInfoGuid
+#define FileSystemInfo		gEfiFileSystemInfoGuid
+#define SerialIoProtocol	gEfiSerialIoProtocolGuid
+#define GraphicsOutputProtocol	gEfiGraphicsOutputProtocolGuid
+
+#define _CR(Record, TYPE, Field)	((TYPE *)((CHAR8 *)(Record) - (CHAR8 *)&(((TYPE *)0)->Field)))
+
+extern VOID InitializeLib(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable);
+
+extern VOID *AllocatePool(UINTN Size);
+extern VOID *AllocateZeroPool(UINTN Size);
+extern VOID *ReallocatePool(VOID *OldPool, UINTN OldSize, UINTN NewSize);
+extern VOID FreePool(VOID *Buffer);
+
+extern VOID CopyMem(VOID *Dest, CONST VOID *Src, UINTN Len);
+extern VOID SetMem(VOID *Buffer, UINTN Size, UINT8 Value);
+extern VOID ZeroMem(VOID *Buffer, UINTN Size);
+extern INTN CompareMem(CONST VOID *Dest, CONST VOID *Src, UINTN Len);
+extern INTN CompareGuid(CONST EFI_GUID *Guid1, CONST EFI_GUID *Guid2);
+
+extern UINTN StrLen(CONST CHAR16 *s1);
+extern UINTN StrnLen(CONST CHAR16 *s1, UINTN Len);
+extern INTN StrCmp(CONST CHAR16 *s1, CONST CHAR16 *s2);
+extern INTN StrnCmp(CONST CHAR16 *s1, CONST CHAR16 *s2, UINTN len);
+extern VOID StrCpy(CHAR16 *Dest, CONST CHAR16 *Src);
+extern VOID StrnCpy(CHAR16 *Dest, CONST CHAR16 *Src, UINTN Len);
+extern VOID StrCat(CHAR16 *Dest, CONST CHAR16 *Src);
+extern UINTN AsciiStrLen(CONST CHAR8 *s1);
+
+extern UINTN Print(CONST CHAR16 *fmt, ...);
+extern UINTN SPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...);
+extern UINTN UnicodeSPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...);
+extern CHAR16 *PoolPrint(CONST CHAR16 *fmt, ...);
+extern UINTN VPrint(CONST CHAR16 *fmt, va_list args);
+extern UINTN UnicodeVSPrint(CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, va_list args);
+extern VOID Input(CHAR16 *Prompt, CHAR16 *InStr, UINTN StrLen);
+
+extern UINT64 MultU64x32(UINT64 Multiplicand, UINTN Multiplier);
+extern UINT64 DivU64x32(UINT64 Dividend, UINTN Divisor, UINTN *Remainder);
+
+extern EFI_DEVICE_PATH *DevicePathFromHandle(EFI_HANDLE Handle);
+extern EFI_DEVICE_PATH *FileDevicePath(EFI_HANDLE Device, CHAR16 *FileName);
+extern EFI_DEVICE_PATH *AppendDevicePathNode(EFI_DEVICE_PATH *Src1, EFI_DEVICE_PATH *Src2);
+extern EFI_DEVICE_PATH *DuplicateDevicePath(EFI_DEVICE_PATH *DevPath);
+extern UINTN DevicePathSize(EFI_DEVICE_PATH *DevPath);
+extern CHAR16 *DevicePathToStr(EFI_DEVICE_PATH *DevPath);
+
+extern EFI_STATUS WaitForSingleEvent(EFI_EVENT Event, UINT64 Timeout);
+extern EFI_STATUS LibLocateProtocol(EFI_GUID *ProtocolGuid, VOID **Interface);
+extern EFI_STATUS LibLocateHandle(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer);
+
+#endif /* _HOST_EFILIB_H_ */
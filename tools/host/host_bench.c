@@ -0,0 +1,353 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * host_bench.c
+ * Host-side benchmark of the VTOC and filesystem plugin code.
+ *
+ * The plugins are compiled for Linux against the EFI shim and run on a disk
+ * image through a mock Block I/O device. Each phase reports device calls,
+ * blocks, bytes and wall time, so that caching and read coalescing work can
+ * be measured without booting QEMU.
+ *
+ * Usage: host_bench [options] image
+ *	-b size		logical block size (default 512)
+ *	-s slice	VTOC slice to mount (default 0)
+ *	-w		the image is a single volume, such as an ESP, with no VTOC
+ *	-d path		directory to list (default \)
+ *	-f path		file to read sequentially (default: none)
+ *	-c bytes	read chunk size (default 65536)
+ *	-n count	repeat the ls/open/read phases (default 1)
+ *	-l usec		simulated latency per ReadBlocks() call (default 0)
+ *	-t MB/s		simulated transfer rate (default unlimited)
+ *	-v		show the plugins' console output
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "boot.h"
+#include "disk.h"
+#include "fs.h"
+#include "vtoc.h"
+
+#include "mock_bio.h"
+
+/*
+ * Stand-ins for globals and console routines owned by main.c, download.c
+ * and video.c, which are not part of the host build.
+ */
+EFI_HANDLE gImageHandle = NULL;
+UINTN FileSize = 0;
+#if _LP64
+UINT64 *ActualDestinationAddress = NULL;
+#else
+UINT32 *ActualDestinationAddress = NULL;
+#endif
+BOOLEAN VideoInitFlag = FALSE;
+BOOLEAN FramebufferAllowed = FALSE;
+BOOLEAN ImageDeflated = FALSE;
+
+static BOOLEAN Verbose = FALSE;
+
+void
+PrintToScreen(const CHAR16 *Fmt, ...)
+{
+	va_list args;
+
+	if (!Verbose)
+		return;
+
+	va_start(args, Fmt);
+	VPrint(Fmt, args);
+	va_end(args);
+}
+
+void
+GetScreenSize(UINTN *ScreenWidth, UINTN *ScreenHeight)
+{
+	*ScreenWidth = 80;
+	*ScreenHeight = 25;
+}
+
+/*
+ * Phase accounting.
+ */
+struct bench_phase {
+	const char *Name;
+	UINT64 StartNs;
+};
+
+static struct mock_bio *Disk;
+
+static UINT64
+bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+bench_begin(struct bench_phase *Phase, const char *Name)
+{
+	Phase->Name = Name;
+	MockBioResetStats(Disk);
+	Phase->StartNs = bench_now_ns();
+}
+
+static void
+bench_end(struct bench_phase *Phase, EFI_STATUS Status)
+{
+	UINT64 Ns = bench_now_ns() - Phase->StartNs;
+	struct mock_bio_stats *s = &Disk->Stats;
+	double Ms = Ns / 1e6;
+	double MBs = Ns ? (s->Bytes / 1048576.0) / (Ns / 1e9) : 0;
+
+	printf("%-8s %10llu %10llu %12llu %10.3f %10.3f %9.1f  %s\n", Phase->Name,
+		(unsigned long long)s->Calls, (unsigned long long)s->Blocks,
+		(unsigned long long)s->Bytes, Ms, s->DelayNs / 1e6, MBs,
+		EFI_ERROR(Status) ? "FAILED" : "ok");
+}
+
+static CHAR16 *
+bench_wide(const char *s)
+{
+	UINTN i, Len = strlen(s);
+	CHAR16 *w = AllocatePool((Len + 2) * sizeof(CHAR16));
+
+	if (!w)
+		return NULL;
+	for (i = 0; i < Len; i++)
+		w[i] = s[i] == '/' ? L'\\' : (CHAR16)(UINT8)s[i];
+	w[Len] = L'\0';
+	return w;
+}
+
+static void
+bench_narrow(const CHAR16 *w, char *s, UINTN Size)
+{
+	UINTN i;
+
+	for (i = 0; i + 1 < Size && w[i] != L'\0'; i++)
+		s[i] = w[i] < 0x80 ? (char)w[i] : '?';
+	s[i] = '\0';
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: host_bench [-vw] [-b blksz] [-s slice] [-d dir] [-f file] [-c chunk]\n"
+		"                  [-n count] [-l usec] [-t MB/s] image\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	EFI_STATUS Status;
+	EFI_BLOCK_IO_PROTOCOL *BlockIo;
+	EFI_FILE_PROTOCOL *File;
+	struct mbr_partition Partitions[4];
+	struct svr4_vtoc Vtoc;
+	struct fs_tab_entry *fs = NULL;
+	struct bench_phase Phase;
+	UINT32 PartitionStart, SliceLBA = 0;
+	BOOLEAN WholeVolume = FALSE;
+	UINT32 BlockSize = 512, Slice = 0;
+	UINT64 LatencyUs = 0, Rate = 0, Total;
+	UINTN Chunk = 65536, Count = 1, i, ReadSize, Entries;
+	CHAR16 *DirPath, *FilePath = NULL;
+	void *mount_ctx = NULL;
+	void *sb, *Buffer, *Dir;
+	char Name[32];
+	int ch;
+
+	DirPath = bench_wide("\\");
+
+	while ((ch = getopt(argc, argv, "b:s:d:f:c:n:l:t:vw")) != -1) {
+		switch (ch) {
+		case 'b':
+			BlockSize = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			Slice = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			DirPath = bench_wide(optarg);
+			break;
+		case 'f':
+			FilePath = bench_wide(optarg);
+			break;
+		case 'c':
+			Chunk = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			Count = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			LatencyUs = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			Rate = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 'v':
+			Verbose = TRUE;
+			break;
+		case 'w':
+			WholeVolume = TRUE;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1 || Chunk == 0 || Slice >= V_NUMPAR)
+		usage();
+
+	Status = MockBioOpen(argv[optind], BlockSize, &Disk);
+	if (EFI_ERROR(Status)) {
+		fprintf(stderr, "host_bench: cannot open %s\n", argv[optind]);
+		return 1;
+	}
+	MockBioSetTiming(Disk, LatencyUs, Rate);
+	BlockIo = &Disk->BlockIo;
+
+	printf("%-8s %10s %10s %12s %10s %10s %9s\n", "phase", "calls", "blocks", "bytes", "wall ms", "dev ms", "MB/s");
+
+	// Partition table and VTOC.
+	if (!WholeVolume) {
+		bench_begin(&Phase, "vtoc");
+		Status = GetPartitionData(BlockIo, Partitions);
+		if (!EFI_ERROR(Status))
+			Status = FindSysVPartition(Partitions, &PartitionStart);
+		if (!EFI_ERROR(Status))
+			Status = ReadVtoc(&Vtoc, BlockIo, PartitionStart);
+		bench_end(&Phase, Status);
+		if (EFI_ERROR(Status))
+			return 1;
+
+		if (Slice >= Vtoc.v_nparts || Vtoc.v_part[Slice].p_size <= 0) {
+			fprintf(stderr, "host_bench: slice %u is not in use\n", Slice);
+			return 1;
+		}
+		SliceLBA = Vtoc.v_part[Slice].p_start;
+	}
+
+	// Detect and mount, the same way MountSlice() does.
+	bench_begin(&Phase, "mount");
+	Status = EFI_NOT_FOUND;
+	for (fs = fs_tab; fs->fs_name != NULL; fs++) {
+		if (fs->sb_size == 0 || !fs->detect_fs || !fs->mount_fs)
+			continue;
+		sb = AllocateZeroPool(fs->sb_size);
+		Status = fs->detect_fs(BlockIo, SliceLBA, sb);
+		if (!EFI_ERROR(Status))
+			Status = fs->mount_fs(BlockIo, SliceLBA, sb, &mount_ctx);
+		FreePool(sb);
+		if (!EFI_ERROR(Status))
+			break;
+	}
+	bench_end(&Phase, Status);
+	if (EFI_ERROR(Status)) {
+		fprintf(stderr, "host_bench: no filesystem on slice %u\n", Slice);
+		return 1;
+	}
+	bench_narrow(fs->fs_name, Name, sizeof(Name));
+	printf("# %s filesystem on slice %u at LBA %u\n", Name, Slice, SliceLBA);
+
+	for (i = 0; i < Count; i++) {
+		bench_begin(&Phase, "ls");
+		Status = fs->list_dir ? fs->list_dir(mount_ctx, DirPath) : EFI_UNSUPPORTED;
+		bench_end(&Phase, Status);
+
+		if (fs->open_dir) {
+			bench_begin(&Phase, "readdir");
+			Buffer = AllocatePool(Chunk);
+			Entries = 0;
+			Status = fs->open_dir(mount_ctx, DirPath, &Dir);
+			if (!EFI_ERROR(Status)) {
+				for (;;) {
+					ReadSize = Chunk;
+					Status = fs->read_dir(Dir, &ReadSize, Buffer);
+					if (EFI_ERROR(Status) || ReadSize == 0)
+						break;
+					Entries++;
+				}
+				fs->close_dir(Dir);
+			}
+			bench_end(&Phase, Status);
+			printf("# %lu directory entries\n", (unsigned long)Entries);
+			FreePool(Buffer);
+		}
+
+		if (!FilePath || !fs->open)
+			continue;
+
+		bench_begin(&Phase, "open");
+		Status = fs->open(mount_ctx, FilePath, EFI_FILE_MODE_READ, (void **)&File);
+		bench_end(&Phase, Status);
+		if (EFI_ERROR(Status))
+			continue;
+
+		Buffer = AllocatePool(Chunk);
+		Total = 0;
+		bench_begin(&Phase, "read");
+		for (;;) {
+			ReadSize = Chunk;
+			Status = uefi_call_wrapper(File->Read, 3, File, &ReadSize, Buffer);
+			if (EFI_ERROR(Status) || ReadSize == 0)
+				break;
+			Total += ReadSize;
+		}
+		bench_end(&Phase, Status);
+		printf("# read %llu bytes in %lu byte chunks\n", (unsigned long long)Total, (unsigned long)Chunk);
+
+		uefi_call_wrapper(File->Close, 1, File);
+		FreePool(Buffer);
+	}
+
+	bench_begin(&Phase, "umount");
+	Status = fs->umount_fs ? fs->umount_fs(mount_ctx) : EFI_SUCCESS;
+	bench_end(&Phase, Status);
+
+	MockBioClose(Disk);
+	return 0;
+}
@@ -0,0 +1,691 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * mkimage.c
+ * Synthetic SysV disk image generator for the host benchmark and QEMU.
+ *
+ * Writes an MBR with a single 0x63 partition, a pdinfo and VTOC at
+ * VTOC_SEC, and one populated slice per -s option. Slices are laid out
+ * with the same structures the loader reads, so an image that does not
+ * mount is a bug on one side or the other.
+ *
+ * Usage: mkimage [options] -s type[:MB] [-s ...] image
+ *	-s type[:MB]	add a slice: bfs or s5, size in MiB (default 32)
+ *	-n count	files per slice (default 16)
+ *	-d depth	directory depth on s5 slices (default 0, all in /)
+ *	-z min[-max]	file size range, K and M suffixes allowed (default 4K)
+ *	-f percent	fragmentation: chance that a block (s5) or file (bfs)
+ *			is placed at a random free position (default 0)
+ *	-B type		s5 block type: 1 (512), 2 (1K), 3 (2K) (default 2)
+ *	-r seed		random seed for sizes, placement and contents (default 1)
+ *	-m		print a manifest (slice, path, size) on stdout
+ *
+ * File contents are a pseudo-random stream seeded from the seed, slice
+ * and inode number, so a reader can be checked against the manifest.
+ *
+ * The free block and free inode lists of s5 slices are left empty
+ * (s_nfree and s_ninode are zero); the images are for read-only use.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#undef S_IFMT	// vnode.h has its own.
+
+#include "bfs.h"
+#include "part.h"
+#include "s5fs.h"
+#include "vtoc.h"
+
+#define SECSIZE		512
+#define PART_START	63		// First sector of the SysV partition.
+#define PART_RESV	64		// Sectors before the first slice (boot, pdinfo, VTOC).
+#define DEF_SLICE_MB	32
+
+#define FsOKAY		0x7c269d38	// s_state = FsOKAY - s_time for a clean fs.
+
+enum slice_type {
+	SLICE_BFS,
+	SLICE_S5
+};
+
+struct slice_spec {
+	enum slice_type Type;
+	UINT32 Sectors;
+	UINT32 Start;
+};
+
+static struct slice_spec Slices[V_NUMPAR];
+static UINTN NumSlices;
+
+static UINT32 FileCount = 16;
+static UINT32 Depth = 0;
+static UINT64 MinSize = 4096, MaxSize = 4096;
+static UINT32 Frag = 0;
+static UINT32 S5Type = Fs2b;
+static UINT64 Seed = 1;
+static BOOLEAN Manifest = FALSE;
+
+static UINT64 RandState;
+
+/*
+ * xorshift64*, good enough for sizes, placement and file contents.
+ */
+static UINT64
+rnd_next(UINT64 *State)
+{
+	UINT64 x = *State;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*State = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static UINT64
+rnd(void)
+{
+	return rnd_next(&RandState);
+}
+
+static void
+fill_contents(UINT8 *Dest, UINT64 Len, UINTN Slice, UINT32 Ino)
+{
+	UINT64 State = (Seed ^ ((UINT64)Slice << 48) ^ ((UINT64)Ino * 0x9E3779B97F4A7C15ULL)) | 1;
+	UINT64 i, v;
+
+	for (i = 0; i + 8 <= Len; i += 8) {
+		v = rnd_next(&State);
+		memcpy(Dest + i, &v, 8);
+	}
+	if (i < Len) {
+		v = rnd_next(&State);
+		memcpy(Dest + i, &v, Len - i);
+	}
+}
+
+static UINT64
+pick_size(void)
+{
+	if (MaxSize <= MinSize)
+		return MinSize;
+	return MinSize + rnd() % (MaxSize - MinSize + 1);
+}
+
+static void __attribute__((noreturn))
+fail(const char *Msg, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "mkimage: ");
+	va_start(args, Msg);
+	vfprintf(stderr, Msg, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+/*
+ * BFS slice.
+ *
+ * Layout: superblock, the dirent table, the root directory (a flat list
+ * of bfs_ldirs), then one contiguous extent per file. Fragmentation
+ * leaves a random gap of free blocks in front of a file.
+ */
+static void
+bfs_dirent_set(UINT8 *Base, UINT16 Ino, UINT64 Start, UINT64 Size, vtype_t Type, UINT32 Mode, UINT32 NLink)
+{
+	struct bfs_dirent *de = (struct bfs_dirent *)(Base + BFS_INO2OFF(Ino));
+
+	memset(de, 0, sizeof(*de));
+	de->d_ino = Ino;
+	if (Size != 0) {
+		de->d_sblock = Start / BFS_BSIZE;
+		de->d_eblock = (Start + Size - 1) / BFS_BSIZE;
+		de->d_eoffset = Start + Size;
+	}
+	de->d_fattr.va_type = Type;
+	de->d_fattr.va_mode = Mode;
+	de->d_fattr.va_nlink = NLink;
+}
+
+static void
+build_bfs(UINTN Slice, UINT8 *Base, UINT64 Bytes)
+{
+	struct bfs_superblock *sb = (struct bfs_superblock *)(Base + BFS_SUPEROFF);
+	struct bfs_ldirs *ld;
+	UINT64 DataStart, RootSize, Pos, Size, Gap;
+	UINT32 i;
+	UINT16 Ino;
+
+	if (FileCount > 0xFFFF - BFSROOTINO)
+		fail("bfs: too many files (%u)", FileCount);
+	if (Depth != 0)
+		fprintf(stderr, "mkimage: bfs has no subdirectories, ignoring -d on slice %lu\n", (unsigned long)Slice);
+
+	DataStart = BFS_DIRSTART + (UINT64)(FileCount + 1) * sizeof(struct bfs_dirent);
+	DataStart = (DataStart + BFS_BSIZE - 1) & ~(UINT64)(BFS_BSIZE - 1);
+	RootSize = (UINT64)(FileCount + 2) * sizeof(struct bfs_ldirs);
+	if (DataStart + RootSize > Bytes)
+		fail("bfs: slice %lu too small for %u files", (unsigned long)Slice, FileCount);
+
+	sb->bdsup_bfsmagic = BFS_MAGIC;
+	sb->bdsup_start = DataStart;
+	sb->bdsup_end = Bytes - 1;
+	sb->bdcp_fromblock = -1;
+	sb->bdcp_toblock = -1;
+	sb->bdcpb_fromblock = -1;
+	sb->bdcpb_toblock = -1;
+
+	bfs_dirent_set(Base, BFSROOTINO, DataStart, RootSize, VDIR, S_IFDIR | 0755, 2);
+
+	ld = (struct bfs_ldirs *)(Base + DataStart);
+	ld[0].l_ino = BFSROOTINO;
+	memcpy(ld[0].l_name, ".", 1);
+	ld[1].l_ino = BFSROOTINO;
+	memcpy(ld[1].l_name, "..", 2);
+
+	Pos = (DataStart + RootSize + BFS_BSIZE - 1) & ~(UINT64)(BFS_BSIZE - 1);
+	for (i = 0; i < FileCount; i++) {
+		Ino = BFSROOTINO + 1 + i;
+		Size = pick_size();
+
+		if (Frag && rnd() % 100 < Frag) {
+			Gap = Bytes > Pos ? (Bytes - Pos) / (FileCount - i + 1) : 0;
+			Pos += Gap ? (rnd() % (Gap / BFS_BSIZE + 1)) * BFS_BSIZE : 0;
+		}
+		if (Pos + Size > Bytes)
+			fail("bfs: slice %lu full after %u files", (unsigned long)Slice, i);
+
+		bfs_dirent_set(Base, Ino, Pos, Size, VREG, S_IFREG | 0644, 1);
+		fill_contents(Base + Pos, Size, Slice, Ino);
+
+		ld[i + 2].l_ino = Ino;
+		snprintf((char *)ld[i + 2].l_name, BFS_MAXFNLEN, "f%05u", i);
+
+		if (Manifest)
+			printf("%lu /f%05u %llu\n", (unsigned long)Slice, i, (unsigned long long)Size);
+
+		Pos = (Pos + Size + BFS_BSIZE - 1) & ~(UINT64)(BFS_BSIZE - 1);
+	}
+}
+
+/*
+ * S5 slice.
+ *
+ * Blocks 0 and 1 hold the boot block and superblock, the i-list starts
+ * at block 2. Data blocks are allocated from a cursor that jumps to a
+ * random free block Frag percent of the time.
+ */
+struct s5_build {
+	UINTN Slice;
+	UINT8 *Base;
+	UINT32 BSize;
+	UINT32 InoPB;
+	UINT32 NIndir;
+	UINT32 NBlocks;
+	UINT32 ISize;
+	UINT32 NInodes;
+	UINT32 NextIno;
+	UINT32 Cursor;
+	UINT32 Used;
+	UINT8 *Map;
+};
+
+static UINT8 *
+s5_block(struct s5_build *b, UINT32 Blk)
+{
+	return b->Base + (UINT64)Blk * b->BSize;
+}
+
+static struct s5_dinode *
+s5_inode(struct s5_build *b, UINT32 Ino)
+{
+	UINT32 Idx = Ino - 1;
+
+	return (struct s5_dinode *)(s5_block(b, 2 + Idx / b->InoPB) + (Idx % b->InoPB) * sizeof(struct s5_dinode));
+}
+
+static UINT32
+s5_alloc(struct s5_build *b)
+{
+	UINT32 Data = b->NBlocks - b->ISize;
+	UINT32 i, Blk = 0;
+
+	if (b->Used == Data)
+		fail("s5: slice %lu full", (unsigned long)b->Slice);
+
+	if (Frag && rnd() % 100 < Frag)
+		b->Cursor = rnd() % Data;
+
+	for (i = 0; i < Data; i++) {
+		Blk = (b->Cursor + i) % Data;
+		if (!b->Map[Blk])
+			break;
+	}
+
+	b->Map[Blk] = 1;
+	b->Used++;
+	b->Cursor = Blk + 1;
+	Blk += b->ISize;
+	memset(s5_block(b, Blk), 0, b->BSize);
+	return Blk;
+}
+
+static void
+s5_set_daddr(struct s5_dinode *din, UINTN Idx, UINT32 Blk)
+{
+	din->di_addr[Idx * 3] = Blk & 0xFF;
+	din->di_addr[Idx * 3 + 1] = (Blk >> 8) & 0xFF;
+	din->di_addr[Idx * 3 + 2] = (Blk >> 16) & 0xFF;
+}
+
+static UINT32
+s5_get_daddr(struct s5_dinode *din, UINTN Idx)
+{
+	return (UINT8)din->di_addr[Idx * 3] | ((UINT8)din->di_addr[Idx * 3 + 1] << 8) |
+		((UINT8)din->di_addr[Idx * 3 + 2] << 16);
+}
+
+/*
+ * Map logical block Lbn of an inode to Blk, allocating indirect blocks
+ * on the way.
+ */
+static void
+s5_map(struct s5_build *b, struct s5_dinode *din, UINT64 Lbn, UINT32 Blk)
+{
+	UINT64 Span = 1, Div;
+	UINT32 Lvl, Top, *Slot;
+
+	if (Lbn < NADDR - 3) {
+		s5_set_daddr(din, Lbn, Blk);
+		return;
+	}
+
+	Lbn -= NADDR - 3;
+	for (Lvl = 1; Lvl <= 3; Lvl++) {
+		Span *= b->NIndir;
+		if (Lbn < Span)
+			break;
+		Lbn -= Span;
+	}
+	if (Lvl > 3)
+		fail("s5: file too large");
+
+	Top = s5_get_daddr(din, NADDR - 4 + Lvl);
+	if (Top == 0) {
+		Top = s5_alloc(b);
+		s5_set_daddr(din, NADDR - 4 + Lvl, Top);
+	}
+
+	for (Div = Span / b->NIndir; ; Div /= b->NIndir) {
+		Slot = (UINT32 *)s5_block(b, Top) + (Lbn / Div) % b->NIndir;
+		if (Div == 1) {
+			*Slot = Blk;
+			return;
+		}
+		if (*Slot == 0)
+			*Slot = s5_alloc(b);
+		Top = *Slot;
+	}
+}
+
+static UINT32
+s5_new_inode(struct s5_build *b, UINT16 Mode, INT16 NLink, UINT64 Size)
+{
+	struct s5_dinode *din;
+	UINT32 Ino = b->NextIno++;
+
+	if (Ino > b->NInodes)
+		fail("s5: out of inodes");
+	if (Size > 0x7FFFFFFF)
+		fail("s5: file too large");
+
+	din = s5_inode(b, Ino);
+	memset(din, 0, sizeof(*din));
+	din->di_mode = Mode;
+	din->di_nlink = NLink;
+	din->di_size = Size;
+	return Ino;
+}
+
+static void
+s5_write(struct s5_build *b, UINT32 Ino, const UINT8 *Data, UINT64 Size)
+{
+	struct s5_dinode *din = s5_inode(b, Ino);
+	UINT64 Lbn, Off, Len;
+	UINT32 Blk;
+
+	for (Lbn = 0, Off = 0; Off < Size; Lbn++, Off += Len) {
+		Len = Size - Off < b->BSize ? Size - Off : b->BSize;
+		Blk = s5_alloc(b);
+		memcpy(s5_block(b, Blk), Data + Off, Len);
+		s5_map(b, din, Lbn, Blk);
+	}
+}
+
+static void
+s5_dirent(UINT8 *Dir, UINT32 *Count, UINT32 Ino, const char *Name)
+{
+	struct s5_direct *de = (struct s5_direct *)Dir + (*Count)++;
+
+	de->d_ino = Ino;
+	memcpy(de->d_name, Name, strnlen(Name, DIRSIZ));
+}
+
+/*
+ * Build directory Level of the chain, holding every (Depth + 1)th file.
+ * Returns the directory's inode number.
+ */
+static UINT32
+s5_build_dir(struct s5_build *b, UINT32 Level, UINT32 Parent, char *Path)
+{
+	UINT32 Ino, Child, Count = 0, i, NLink = 2, NEnt;
+	UINT64 Size;
+	UINTN PathLen = strlen(Path);
+	UINT8 *Dir, *Buf;
+	char Name[DIRSIZ + 1];
+
+	NEnt = 3 + FileCount / (Depth + 1) + 1;
+	Dir = calloc(NEnt, SDSIZ);
+	if (!Dir)
+		fail("out of memory");
+
+	Ino = s5_new_inode(b, S_IFDIR | 0755, 2, 0);
+	s5_dirent(Dir, &Count, Ino, ".");
+	s5_dirent(Dir, &Count, Parent ? Parent : Ino, "..");
+
+	for (i = Level; i < FileCount; i += Depth + 1) {
+		Size = pick_size();
+		snprintf(Name, sizeof(Name), "f%05u", i);
+		Child = s5_new_inode(b, S_IFREG | 0644, 1, Size);
+		Buf = malloc(Size ? Size : 1);
+		if (!Buf)
+			fail("out of memory");
+		fill_contents(Buf, Size, b->Slice, Child);
+		s5_write(b, Child, Buf, Size);
+		free(Buf);
+		s5_dirent(Dir, &Count, Child, Name);
+		if (Manifest)
+			printf("%lu %s/%s %llu\n", (unsigned long)b->Slice, Path, Name, (unsigned long long)Size);
+	}
+
+	if (Level < Depth) {
+		snprintf(Name, sizeof(Name), "d%u", Level + 1);
+		snprintf(Path + PathLen, 8 * (Depth + 1) - PathLen, "/%s", Name);
+		Child = s5_build_dir(b, Level + 1, Ino, Path);
+		Path[PathLen] = '\0';
+		s5_dirent(Dir, &Count, Child, Name);
+		NLink++;
+	}
+
+	s5_inode(b, Ino)->di_nlink = NLink;
+	s5_inode(b, Ino)->di_size = Count * SDSIZ;
+	s5_write(b, Ino, Dir, Count * SDSIZ);
+	free(Dir);
+	return Ino;
+}
+
+static void
+build_s5(UINTN Slice, UINT8 *Base, UINT64 Bytes)
+{
+	struct s5_superblock *sb = (struct s5_superblock *)(Base + SUPERBOFF);
+	struct s5_build b;
+	char *Path;
+	UINT32 Root;
+
+	memset(&b, 0, sizeof(b));
+	b.Slice = Slice;
+	b.Base = Base;
+	b.BSize = FsBSIZE(S5Type);
+	b.InoPB = b.BSize / sizeof(struct s5_dinode);
+	b.NIndir = b.BSize / sizeof(INT32);
+	b.NBlocks = Bytes / b.BSize;
+
+	// Inode 1 is reserved, 2 is the root; leave some slack for growth.
+	b.NInodes = FileCount + Depth + 2;
+	b.NInodes += b.NInodes / 8 + b.InoPB;
+	b.ISize = 2 + (b.NInodes + b.InoPB - 1) / b.InoPB;
+	b.NInodes = (b.ISize - 2) * b.InoPB;
+	if (b.NInodes > 0xFFFF)
+		fail("s5: too many files (%u)", FileCount);
+	if (b.ISize >= b.NBlocks)
+		fail("s5: slice %lu too small for %u inodes", (unsigned long)Slice, b.NInodes);
+
+	b.NextIno = S5ROOTINO;
+	b.Map = calloc(b.NBlocks - b.ISize, 1);
+	Path = calloc(Depth + 1, 8);
+	if (!b.Map || !Path)
+		fail("out of memory");
+
+	Root = s5_build_dir(&b, 0, 0, Path);
+	if (Root != S5ROOTINO)
+		fail("s5: root is inode %u", Root);
+
+	sb->s_isize = b.ISize;
+	sb->s_fsize = b.NBlocks;
+	sb->s_tfree = b.NBlocks - b.ISize - b.Used;
+	sb->s_tinode = b.NInodes - (b.NextIno - 1);
+	memcpy(sb->s_fname, "bench", 5);
+	memcpy(sb->s_fpack, "hbmk", 4);
+	sb->s_time = 0;
+	sb->s_state = FsOKAY - sb->s_time;
+	sb->s_magic = FsMAGIC;
+	sb->s_type = S5Type;
+
+	free(Path);
+	free(b.Map);
+}
+
+/*
+ * MBR, pdinfo and VTOC.
+ */
+static void
+build_label(UINT8 *Disk, UINT64 Sectors)
+{
+	struct mbr_partition *mp = (struct mbr_partition *)(Disk + 446);
+	struct svr4_pdinfo *pd = (struct svr4_pdinfo *)(Disk + (PART_START + VTOC_SEC) * SECSIZE);
+	struct svr4_vtoc *vt = (struct svr4_vtoc *)(pd + 1);
+	UINTN i;
+
+	mp->boot_indicator = 0x80;
+	mp->os_type = 0x63;
+	mp->starting_lba = PART_START;
+	mp->size_in_lba = Sectors - PART_START;
+	Disk[510] = 0x55;
+	Disk[511] = 0xAA;
+
+	pd->sanity = VALID_PD;
+	pd->version = 1;
+	pd->sectors = 63;
+	pd->tracks = 16;
+	pd->cyls = Sectors / (63 * 16);
+	pd->bytes = SECSIZE;
+	pd->logicalst = PART_START;
+	pd->vtoc_ptr = (PART_START + VTOC_SEC) * SECSIZE + sizeof(*pd);
+	pd->vtoc_len = sizeof(*vt);
+
+	vt->v_sanity = VTOC_SANE;
+	vt->v_version = V_VERSION;
+	memcpy(vt->v_volume, "HBBENCH", 7);
+	vt->v_nparts = V_NUMPAR;
+	for (i = 0; i < NumSlices; i++) {
+		if (Slices[i].Type == SLICE_BFS)
+			vt->v_part[i].p_tag = V_STAND;
+		else
+			vt->v_part[i].p_tag = i == 0 ? V_ROOT : V_USR;
+		vt->v_part[i].p_start = Slices[i].Start;
+		vt->v_part[i].p_size = Slices[i].Sectors;
+	}
+}
+
+static UINT64
+parse_size(const char *s)
+{
+	char *End;
+	UINT64 v = strtoull(s, &End, 0);
+
+	if (*End == 'K' || *End == 'k')
+		v <<= 10;
+	else if (*End == 'M' || *End == 'm')
+		v <<= 20;
+	return v;
+}
+
+static void
+parse_slice(const char *Arg)
+{
+	struct slice_spec *sp;
+	const char *Colon = strchr(Arg, ':');
+	UINTN Len = Colon ? (UINTN)(Colon - Arg) : strlen(Arg);
+	UINT64 MB = Colon ? strtoull(Colon + 1, NULL, 0) : DEF_SLICE_MB;
+
+	if (NumSlices == V_NUMPAR)
+		fail("too many slices");
+	if (MB == 0 || MB > 0xFFFFFFFFULL / (1048576 / SECSIZE))
+		fail("bad slice size in %s", Arg);
+
+	sp = &Slices[NumSlices++];
+	if (Len == 3 && !strncmp(Arg, "bfs", 3))
+		sp->Type = SLICE_BFS;
+	else if (Len == 2 && !strncmp(Arg, "s5", 2))
+		sp->Type = SLICE_S5;
+	else
+		fail("unknown slice type %s", Arg);
+	sp->Sectors = MB * (1048576 / SECSIZE);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mkimage [-m] [-n files] [-d depth] [-z min[-max]] [-f percent] [-B 1|2|3]\n"
+		"               [-r seed] -s bfs|s5[:MB] [-s ...] image\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	UINT64 Sectors, Bytes;
+	UINT32 Next;
+	UINT8 *Disk;
+	char *Dash;
+	UINTN i;
+	int ch, fd;
+
+	while ((ch = getopt(argc, argv, "s:n:d:z:f:B:r:m")) != -1) {
+		switch (ch) {
+		case 's':
+			parse_slice(optarg);
+			break;
+		case 'n':
+			FileCount = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			Depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'z':
+			MinSize = MaxSize = parse_size(optarg);
+			Dash = strchr(optarg, '-');
+			if (Dash)
+				MaxSize = parse_size(Dash + 1);
+			break;
+		case 'f':
+			Frag = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			S5Type = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			Seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'm':
+			Manifest = TRUE;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1 || NumSlices == 0)
+		usage();
+	if (S5Type < Fs1b || S5Type > Fs4b)
+		fail("bad s5 block type %u", S5Type);
+	if (Frag > 100 || Depth > 64)
+		usage();
+
+	RandState = Seed | 1;
+
+	Next = PART_START + PART_RESV;
+	for (i = 0; i < NumSlices; i++) {
+		Slices[i].Start = Next;
+		Next += Slices[i].Sectors;
+	}
+	Sectors = Next;
+	Bytes = Sectors * SECSIZE;
+
+	fd = open(argv[optind], O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		fail("%s: %s", argv[optind], strerror(errno));
+	if (ftruncate(fd, Bytes) < 0)
+		fail("%s: %s", argv[optind], strerror(errno));
+	Disk = mmap(NULL, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (Disk == MAP_FAILED)
+		fail("%s: %s", argv[optind], strerror(errno));
+
+	build_label(Disk, Sectors);
+	for (i = 0; i < NumSlices; i++) {
+		UINT8 *Base = Disk + (UINT64)Slices[i].Start * SECSIZE;
+		UINT64 SliceBytes = (UINT64)Slices[i].Sectors * SECSIZE;
+
+		if (Slices[i].Type == SLICE_BFS)
+			build_bfs(i, Base, SliceBytes);
+		else
+			build_s5(i, Base, SliceBytes);
+	}
+
+	if (munmap(Disk, Bytes) < 0 || close(fd) < 0)
+		fail("%s: %s", argv[optind], strerror(errno));
+
+	return 0;
+}
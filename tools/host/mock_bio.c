@@ -0,0 +1,225 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * mock_bio.c
+ * EFI_BLOCK_IO_PROTOCOL backed by a disk image file.
+ *
+ * Every ReadBlocks() call costs a fixed latency plus the transfer time at the
+ * configured rate. The delay is spent busy-waiting so that it shows up in wall
+ * time with microsecond accuracy, the same way a polled firmware driver would.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "mock_bio.h"
+
+static UINT64
+mock_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+mock_delay(struct mock_bio *Bio, UINTN Bytes)
+{
+	UINT64 Ns = Bio->LatencyNs;
+	UINT64 End;
+
+	if (Bio->BytesPerSec)
+		Ns += (UINT64)Bytes * 1000000000ULL / Bio->BytesPerSec;
+
+	if (Ns == 0)
+		return;
+
+	Bio->Stats.DelayNs += Ns;
+	End = mock_now_ns() + Ns;
+	while (mock_now_ns() < End)
+		;
+}
+
+static EFI_STATUS EFIAPI
+mock_reset(EFI_BLOCK_IO_PROTOCOL *This, BOOLEAN ExtendedVerification)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mock_read(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+{
+	struct mock_bio *Bio = (struct mock_bio *)This;
+	UINTN BlockSize = Bio->Media.BlockSize;
+	UINTN Done = 0;
+	ssize_t n;
+
+	Bio->Stats.Calls++;
+
+	if (MediaId != Bio->Media.MediaId) {
+		Bio->Stats.Errors++;
+		return EFI_MEDIA_CHANGED;
+	}
+
+	if (!Buffer || BufferSize % BlockSize) {
+		Bio->Stats.Errors++;
+		return BufferSize % BlockSize ? EFI_BAD_BUFFER_SIZE : EFI_INVALID_PARAMETER;
+	}
+
+	if (Lba > Bio->Media.LastBlock || BufferSize / BlockSize > Bio->Media.LastBlock - Lba + 1) {
+		Bio->Stats.Errors++;
+		return EFI_INVALID_PARAMETER;
+	}
+
+	while (Done < BufferSize) {
+		n = pread(Bio->Fd, (UINT8 *)Buffer + Done, BufferSize - Done, (off_t)(Lba * BlockSize + Done));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			Bio->Stats.Errors++;
+			return EFI_DEVICE_ERROR;
+		}
+		Done += n;
+	}
+
+	mock_delay(Bio, BufferSize);
+
+	Bio->Stats.Blocks += BufferSize / BlockSize;
+	Bio->Stats.Bytes += BufferSize;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+mock_write(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+{
+	return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+mock_flush(EFI_BLOCK_IO_PROTOCOL *This)
+{
+	return EFI_SUCCESS;
+}
+
+/*
+ * Function:
+ * MockBioOpen()
+ *
+ * Description:
+ * Open a disk image read-only and wrap it in a whole-disk Block I/O protocol.
+ * A trailing partial block of the image is ignored.
+ *
+ * Arguments:
+ * Path: Image file name.
+ * BlockSize: Logical block size reported in the media descriptor.
+ * Out: Receives the device.
+ *
+ * Return value:
+ * EFI_SUCCESS on success, any other code on failure.
+ */
+EFI_STATUS
+MockBioOpen(const char *Path, UINT32 BlockSize, struct mock_bio **Out)
+{
+	struct mock_bio *Bio;
+	struct stat st;
+	int Fd;
+
+	if (!Path || !Out || BlockSize == 0 || (BlockSize & (BlockSize - 1)))
+		return EFI_INVALID_PARAMETER;
+
+	Fd = open(Path, O_RDONLY);
+	if (Fd < 0)
+		return EFI_NOT_FOUND;
+
+	if (fstat(Fd, &st) < 0 || st.st_size < BlockSize) {
+		close(Fd);
+		return EFI_VOLUME_CORRUPTED;
+	}
+
+	Bio = calloc(1, sizeof(*Bio));
+	if (!Bio) {
+		close(Fd);
+		return EFI_OUT_OF_RESOURCES;
+	}
+
+	Bio->Fd = Fd;
+	Bio->Media.MediaId = 1;
+	Bio->Media.RemovableMedia = FALSE;
+	Bio->Media.MediaPresent = TRUE;
+	Bio->Media.LogicalPartition = FALSE;
+	Bio->Media.ReadOnly = TRUE;
+	Bio->Media.BlockSize = BlockSize;
+	Bio->Media.IoAlign = 0;
+	Bio->Media.LastBlock = st.st_size / BlockSize - 1;
+
+	Bio->BlockIo.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION;
+	Bio->BlockIo.Media = &Bio->Media;
+	Bio->BlockIo.Reset = mock_reset;
+	Bio->BlockIo.ReadBlocks = mock_read;
+	Bio->BlockIo.WriteBlocks = mock_write;
+	Bio->BlockIo.FlushBlocks = mock_flush;
+
+	*Out = Bio;
+	return EFI_SUCCESS;
+}
+
+void
+MockBioClose(struct mock_bio *Bio)
+{
+	if (!Bio)
+		return;
+	close(Bio->Fd);
+	free(Bio);
+}
+
+void
+MockBioSetTiming(struct mock_bio *Bio, UINT64 LatencyUs, UINT64 BytesPerSec)
+{
+	Bio->LatencyNs = LatencyUs * 1000;
+	Bio->BytesPerSec = BytesPerSec;
+}
+
+void
+MockBioResetStats(struct mock_bio *Bio)
+{
+	SetMem(&Bio->Stats, sizeof(Bio->Stats), 0);
+}
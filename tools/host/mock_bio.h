@@ -0,0 +1,70 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * mock_bio.h
+ * EFI_BLOCK_IO_PROTOCOL backed by a disk image file, for host benchmarks.
+ */
+
+#ifndef _MOCK_BIO_H_
+#define _MOCK_BIO_H_
+
+#include <efi.h>
+#include <efilib.h>
+
+/*
+ * Per-device counters. Reset between benchmark phases.
+ */
+struct mock_bio_stats {
+	UINT64 Calls;		// ReadBlocks() calls.
+	UINT64 Blocks;		// Blocks transferred.
+	UINT64 Bytes;		// Bytes transferred.
+	UINT64 Errors;		// Calls that failed.
+	UINT64 DelayNs;		// Simulated device time.
+};
+
+struct mock_bio {
+	EFI_BLOCK_IO_PROTOCOL BlockIo;
+	EFI_BLOCK_IO_MEDIA Media;
+	int Fd;
+	UINT64 LatencyNs;	// Fixed cost per call.
+	UINT64 BytesPerSec;	// Transfer rate, 0 for unlimited.
+	struct mock_bio_stats Stats;
+};
+
+extern EFI_STATUS MockBioOpen(const char *Path, UINT32 BlockSize, struct mock_bio **Out);
+extern void MockBioClose(struct mock_bio *Bio);
+extern void MockBioSetTiming(struct mock_bio *Bio, UINT64 LatencyUs, UINT64 BytesPerSec);
+extern void MockBioResetStats(struct mock_bio *Bio);
+
+#endif /* _MOCK_BIO_H_ */
@@ -0,0 +1,369 @@
+/*
+ * HeliumBoot/EFI - A simple UEFI bootloader.
+ *
+ * Copyright (c) 2026 Stefanos Stefanidis.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * tracesym.c
+ * Symbolizer for "trace dump" output from trace builds.
+ *
+ * Reads the dump captured from the serial port and the boot_trace.so it
+ * came from, rebuilds the call stacks from the entry and exit records and
+ * prints them as folded stacks ("a;b;c nanoseconds", self time only), the
+ * input format of flamegraph.pl. With -r it lists the records instead.
+ *
+ * Usage: tracesym [-r] boot_trace.so dump.bin
+ *
+ * The dump may start with other serial output; everything before the
+ * header magic is skipped. Frames whose entry was already overwritten in
+ * the ring are recovered from their exit records and put at the bottom
+ * of the stack.
+ */
+
+#include <elf.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "trace.h"
+
+#define MAX_DEPTH	256
+#define HASH_SIZE	65536		// power of two
+
+struct symbol {
+	UINT64 Addr;
+	const char *Name;
+};
+
+struct folded {
+	char *Stack;
+	UINT64 Ns;
+};
+
+static struct symbol *Syms;
+static size_t NumSyms;
+static struct folded Folded[HASH_SIZE];
+
+static void __attribute__((noreturn))
+fail(const char *Msg, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "tracesym: ");
+	va_start(args, Msg);
+	vfprintf(stderr, Msg, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static UINT8 *
+read_file(const char *Path, size_t *Size)
+{
+	FILE *f;
+	UINT8 *Buf;
+	long Len;
+
+	f = fopen(Path, "rb");
+	if (!f)
+		fail("%s: %s", Path, strerror(errno));
+	if (fseek(f, 0, SEEK_END) < 0 || (Len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) < 0)
+		fail("%s: %s", Path, strerror(errno));
+	Buf = malloc(Len ? Len : 1);
+	if (!Buf)
+		fail("out of memory");
+	if (fread(Buf, 1, Len, f) != (size_t)Len)
+		fail("%s: short read", Path);
+	fclose(f);
+
+	*Size = Len;
+	return Buf;
+}
+
+static int
+sym_cmp(const void *a, const void *b)
+{
+	const struct symbol *x = a, *y = b;
+
+	return (x->Addr > y->Addr) - (x->Addr < y->Addr);
+}
+
+/*
+ * Collect the function symbols of the .so, from .symtab if it was not
+ * stripped, else from .dynsym.
+ */
+static void
+load_symbols(const char *Path)
+{
+	Elf64_Ehdr *Eh;
+	Elf64_Shdr *Sh, *Tab = NULL;
+	Elf64_Sym *Sym;
+	const char *Str;
+	UINT8 *Img;
+	size_t Size, i, n;
+
+	Img = read_file(Path, &Size);
+	Eh = (Elf64_Ehdr *)Img;
+	if (Size < sizeof(*Eh) || memcmp(Eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+	    Eh->e_ident[EI_CLASS] != ELFCLASS64)
+		fail("%s: not a 64-bit ELF file", Path);
+	if (Eh->e_shoff + (UINT64)Eh->e_shnum * sizeof(*Sh) > Size)
+		fail("%s: bad section table", Path);
+
+	Sh = (Elf64_Shdr *)(Img + Eh->e_shoff);
+	for (i = 0; i < Eh->e_shnum; i++) {
+		if (Sh[i].sh_type == SHT_SYMTAB)
+			Tab = &Sh[i];
+		else if (Sh[i].sh_type == SHT_DYNSYM && !Tab)
+			Tab = &Sh[i];
+	}
+	if (!Tab || Tab->sh_link >= Eh->e_shnum)
+		fail("%s: no symbol table", Path);
+	if (Tab->sh_offset + Tab->sh_size > Size || Sh[Tab->sh_link].sh_offset + Sh[Tab->sh_link].sh_size > Size)
+		fail("%s: bad symbol table", Path);
+
+	Sym = (Elf64_Sym *)(Img + Tab->sh_offset);
+	Str = (const char *)(Img + Sh[Tab->sh_link].sh_offset);
+	n = Tab->sh_size / sizeof(*Sym);
+
+	Syms = calloc(n, sizeof(*Syms));
+	if (!Syms)
+		fail("out of memory");
+	for (i = 0; i < n; i++) {
+		if (ELF64_ST_TYPE(Sym[i].st_info) != STT_FUNC || Sym[i].st_value == 0)
+			continue;
+		if (Sym[i].st_name >= Sh[Tab->sh_link].sh_size)
+			continue;
+		Syms[NumSyms].Addr = Sym[i].st_value;
+		Syms[NumSyms].Name = Str + Sym[i].st_name;
+		NumSyms++;
+	}
+
+	qsort(Syms, NumSyms, sizeof(*Syms), sym_cmp);
+}
+
+static const char *
+sym_name(UINT64 Addr)
+{
+	static char Buf[32];
+	size_t lo = 0, hi = NumSyms;
+
+	// The hooks are passed function entry points, so an exact match
+	// is expected; anything else is printed as a bare address.
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (Syms[mid].Addr < Addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < NumSyms && Syms[lo].Addr == Addr)
+		return Syms[lo].Name;
+
+	snprintf(Buf, sizeof(Buf), "0x%llx", (unsigned long long)Addr);
+	return Buf;
+}
+
+static UINT64
+to_ns(UINT64 Ticks, UINT64 Freq)
+{
+	return (Ticks / Freq) * 1000000000 + ((Ticks % Freq) * 1000000000) / Freq;
+}
+
+static void
+add_folded(UINT64 *Stack, int Depth, UINT64 Ns)
+{
+	char Buf[MAX_DEPTH * 48];
+	size_t Len = 0;
+	UINT32 h = 2166136261u;
+	int i;
+
+	if (Depth == 0 || Ns == 0)
+		return;
+
+	for (i = 0; i < Depth; i++)
+		Len += snprintf(Buf + Len, sizeof(Buf) - Len, "%s%s", i ? ";" : "", sym_name(Stack[i]));
+	for (i = 0; Buf[i]; i++)
+		h = (h ^ (UINT8)Buf[i]) * 16777619u;
+
+	for (h &= HASH_SIZE - 1; Folded[h].Stack; h = (h + 1) & (HASH_SIZE - 1)) {
+		if (strcmp(Folded[h].Stack, Buf) == 0) {
+			Folded[h].Ns += Ns;
+			return;
+		}
+	}
+
+	Folded[h].Stack = strdup(Buf);
+	if (!Folded[h].Stack)
+		fail("out of memory");
+	Folded[h].Ns = Ns;
+}
+
+/*
+ * Replay the records against a shadow stack. An exit that matches
+ * nothing on the stack belongs to a frame entered before the oldest
+ * record; with Outer set, those frames are collected (outermost first)
+ * so that the real pass can start with them already on the stack.
+ */
+static int
+replay(struct trace_entry *Ent, UINT32 Count, UINT64 Freq, UINT64 *Stack, int Depth,
+    UINT64 *Outer, int *NumOuter)
+{
+	UINT64 Fn, Now, Prev = 0;
+	UINT32 i;
+	int j;
+
+	for (i = 0; i < Count; i++) {
+		Fn = Ent[i].Fn;
+		Now = Ent[i].Ticks & ~TRACE_EXIT;
+
+		if (!Outer && i > 0 && Now > Prev)
+			add_folded(Stack, Depth, to_ns(Now - Prev, Freq));
+		Prev = Now;
+
+		if (!(Ent[i].Ticks & TRACE_EXIT)) {
+			if (Depth == MAX_DEPTH)
+				fail("call stack deeper than %d", MAX_DEPTH);
+			Stack[Depth++] = Fn;
+			continue;
+		}
+
+		for (j = Depth - 1; j >= 0 && Stack[j] != Fn; j--)
+			;
+		if (j >= 0) {
+			Depth = j;
+			continue;
+		}
+
+		Depth = 0;
+		if (Outer && *NumOuter < MAX_DEPTH) {
+			memmove(Outer + 1, Outer, *NumOuter * sizeof(*Outer));
+			Outer[0] = Fn;
+			(*NumOuter)++;
+		}
+	}
+
+	return Depth;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: tracesym [-r] boot_trace.so dump.bin\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct trace_dump_header Hdr;
+	struct trace_entry *Ent;
+	UINT64 Stack[MAX_DEPTH], Outer[MAX_DEPTH], Base;
+	BOOLEAN Raw = FALSE;
+	UINT8 *Dump;
+	size_t Size, Off;
+	UINT32 Magic = TRACE_MAGIC;
+	int NumOuter = 0;
+	UINT32 i;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "r")) != -1) {
+		switch (ch) {
+		case 'r':
+			Raw = TRUE;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 2)
+		usage();
+
+	load_symbols(argv[optind]);
+	Dump = read_file(argv[optind + 1], &Size);
+
+	for (Off = 0; Off + sizeof(Hdr) <= Size; Off++)
+		if (memcmp(Dump + Off, &Magic, sizeof(Magic)) == 0)
+			break;
+	if (Off + sizeof(Hdr) > Size)
+		fail("%s: no trace header found", argv[optind + 1]);
+
+	memcpy(&Hdr, Dump + Off, sizeof(Hdr));
+	if (Hdr.Version != TRACE_VERSION || Hdr.EntrySize != sizeof(struct trace_entry))
+		fail("%s: unsupported trace version %u", argv[optind + 1], Hdr.Version);
+	if (Hdr.ClockFrequency == 0)
+		fail("%s: no clock frequency in header", argv[optind + 1]);
+	Off += sizeof(Hdr);
+	if ((Size - Off) / sizeof(struct trace_entry) < Hdr.Count) {
+		fprintf(stderr, "tracesym: dump truncated, %zu of %u records\n",
+		    (Size - Off) / sizeof(struct trace_entry), Hdr.Count);
+		Hdr.Count = (Size - Off) / sizeof(struct trace_entry);
+	}
+	if (Hdr.Lost)
+		fprintf(stderr, "tracesym: %u older records were overwritten\n", Hdr.Lost);
+
+	Ent = malloc(Hdr.Count * sizeof(*Ent) + 1);
+	if (!Ent)
+		fail("out of memory");
+	memcpy(Ent, Dump + Off, Hdr.Count * sizeof(*Ent));
+
+	// Addresses in the .so are relative to the image base.
+	Base = Hdr.ImageBase;
+	for (i = 0; i < Hdr.Count; i++)
+		Ent[i].Fn -= Base;
+
+	if (Raw) {
+		UINT64 T0 = Hdr.Count ? Ent[0].Ticks & ~TRACE_EXIT : 0;
+
+		for (i = 0; i < Hdr.Count; i++)
+			printf("%12llu %s %s\n",
+			    (unsigned long long)to_ns((Ent[i].Ticks & ~TRACE_EXIT) - T0, Hdr.ClockFrequency),
+			    (Ent[i].Ticks & TRACE_EXIT) ? "<" : ">", sym_name(Ent[i].Fn));
+		return 0;
+	}
+
+	replay(Ent, Hdr.Count, Hdr.ClockFrequency, Stack, 0, Outer, &NumOuter);
+	memcpy(Stack, Outer, NumOuter * sizeof(*Stack));
+	replay(Ent, Hdr.Count, Hdr.ClockFrequency, Stack, NumOuter, NULL, NULL);
+
+	for (i = 0; i < HASH_SIZE; i++)
+		if (Folded[i].Stack)
+			printf("%s %llu\n", Folded[i].Stack, (unsigned long long)Folded[i].Ns);
+
+	return 0;
+}